@@ -1,14 +1,176 @@
 #include <iostream>
 #include <stdexcept>
 #include <cstdlib>
+#include <cstring>
+#include <string>
 
 #include <Engine.hpp>
 
-int main()
+static EngineConfig parseArguments(int argc, char** argv)
 {
-	Engine app;
+	EngineConfig config;
 
+	for (int i = 1; i < argc; ++i)
+	{
+		auto nextValue = [&]() -> std::string
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::invalid_argument(std::string("[Application]: Missing value for ") + argv[i]);
+			}
+			return argv[++i];
+		};
+
+		if (strcmp(argv[i], "--update-rate") == 0)
+		{
+			config.updateRate = std::stod(nextValue());
+		}
+		else if (strcmp(argv[i], "--render-rate") == 0)
+		{
+			config.renderRate = std::stod(nextValue());
+		}
+		else if (strcmp(argv[i], "--no-async-compute") == 0)
+		{
+			config.asyncCompute = false;
+		}
+		else if (strcmp(argv[i], "--texture-budget") == 0)
+		{
+			config.textureBudgetMiB = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--no-meshlets") == 0)
+		{
+			config.meshlets = false;
+		}
+		else if (strcmp(argv[i], "--no-mesh-shaders") == 0)
+		{
+			config.meshShaders = false;
+		}
+		else if (strcmp(argv[i], "--no-occlusion") == 0)
+		{
+			config.occlusionCulling = false;
+		}
+		else if (strcmp(argv[i], "--lod-error") == 0)
+		{
+			config.lodPixelError = std::stof(nextValue());
+		}
+		else if (strcmp(argv[i], "--no-dynamic-resolution") == 0)
+		{
+			config.dynamicResolution = false;
+		}
+		else if (strcmp(argv[i], "--min-render-scale") == 0)
+		{
+			config.minRenderScale = std::stof(nextValue());
+		}
+		else if (strcmp(argv[i], "--max-render-scale") == 0)
+		{
+			config.maxRenderScale = std::stof(nextValue());
+		}
+		else if (strcmp(argv[i], "--frame-budget") == 0)
+		{
+			config.gpuFrameBudgetMs = std::stod(nextValue());
+		}
+		else if (strcmp(argv[i], "--upscale") == 0)
+		{
+			std::string filter = nextValue();
+			if (filter == "bilinear")
+			{
+				config.upscaleFilter = UpscaleFilter::Bilinear;
+			}
+			else if (filter == "sharpen")
+			{
+				config.upscaleFilter = UpscaleFilter::Sharpen;
+			}
+			else {
+				throw std::invalid_argument("[Application]: Unknown upscale filter " + filter + " (bilinear or sharpen)");
+			}
+		}
+		else if (strcmp(argv[i], "--present-mode") == 0)
+		{
+			std::string mode = nextValue();
+			if (mode == "immediate")
+			{
+				config.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+			}
+			else if (mode == "fifo-relaxed")
+			{
+				config.presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+			}
+			else if (mode == "mailbox")
+			{
+				config.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+			}
+			else if (mode == "fifo")
+			{
+				config.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+			}
+			else {
+				throw std::invalid_argument("[Application]: Unknown present mode " + mode + " (immediate, fifo-relaxed, mailbox or fifo)");
+			}
+		}
+		else if (strcmp(argv[i], "--swapchain-images") == 0)
+		{
+			config.swapchainImageCount = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--max-queued-frames") == 0)
+		{
+			config.maxQueuedFrames = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--pacer-spin") == 0)
+		{
+			config.pacerSpinMs = std::stod(nextValue());
+		}
+		else if (strcmp(argv[i], "--startup-report") == 0)
+		{
+			config.startupReport = true;
+		}
+		else if (strcmp(argv[i], "--no-pipeline-libraries") == 0)
+		{
+			config.pipelineLibraries = false;
+		}
+		else if (strcmp(argv[i], "--markers") == 0)
+		{
+			config.markerCount = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--no-instancing") == 0)
+		{
+			config.instancing = false;
+		}
+		else if (strcmp(argv[i], "--particles") == 0)
+		{
+			config.particleCount = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--no-particle-sort") == 0)
+		{
+			config.particleSort = false;
+		}
+		else if (strcmp(argv[i], "--lights") == 0)
+		{
+			config.lightCount = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--windows") == 0)
+		{
+			config.windowCount = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--capture") == 0)
+		{
+			config.capturePath = nextValue();
+		}
+		else if (strcmp(argv[i], "--capture-frame") == 0)
+		{
+			config.captureFrame = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else {
+			throw std::invalid_argument(std::string("[Application]: Unknown argument ") + argv[i]);
+		}
+	}
+
+	return config;
+}
+
+int main(int argc, char** argv)
+{
 	try {
+		Engine app(parseArguments(argc, argv));
 		app.run();
 	} catch (const std::exception& e) {
 		std::cerr << e.what() << std::endl;
@@ -16,4 +178,4 @@ int main()
 	}
 
 	return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
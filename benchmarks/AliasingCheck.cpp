@@ -0,0 +1,129 @@
+#include <RenderGraph.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//Checks planAliasing without a device: transients alive at the same time never share a byte, offsets keep their
+//alignment, and transients whose pass ranges are disjoint do end up in the same memory.
+
+static bool lifetimesOverlap(const AliasingRequest& _a, const AliasingRequest& _b)
+{
+	return _a.firstPass <= _b.lastPass && _b.firstPass <= _a.lastPass;
+}
+
+static bool bytesOverlap(const AliasingPlan& _plan, const std::vector<AliasingRequest>& _requests, size_t _a, size_t _b)
+{
+	return _plan.offsets[_a] < _plan.offsets[_b] + _requests[_b].size && _plan.offsets[_b] < _plan.offsets[_a] + _requests[_a].size;
+}
+
+//Returns the first broken rule, empty when the plan is valid.
+static std::string validate(const std::vector<AliasingRequest>& _requests, const AliasingPlan& _plan)
+{
+	if (_plan.offsets.size() != _requests.size())
+	{
+		return "one offset per request";
+	}
+	for (size_t i = 0; i < _requests.size(); ++i)
+	{
+		if (_plan.offsets[i] % _requests[i].alignment != 0)
+		{
+			return "request " + std::to_string(i) + " is misaligned";
+		}
+		if (_plan.offsets[i] + _requests[i].size > _plan.totalSize)
+		{
+			return "request " + std::to_string(i) + " ends past the block";
+		}
+		for (size_t j = i + 1; j < _requests.size(); ++j)
+		{
+			if (lifetimesOverlap(_requests[i], _requests[j]) && bytesOverlap(_plan, _requests, i, j))
+			{
+				return "requests " + std::to_string(i) + " and " + std::to_string(j) + " are alive together but share bytes";
+			}
+		}
+	}
+	return "";
+}
+
+static bool check(const char* _name, bool _passed, const std::string& _detail = "")
+{
+	std::cout << "[Aliasing]: " << _name << ": " << (_passed ? "ok" : "FAILED") << (_detail.empty() ? "" : ", " + _detail) << "\n";
+	return _passed;
+}
+
+int main()
+{
+	bool passed = true;
+
+	//size, alignment, firstPass, lastPass
+	{
+		std::vector<AliasingRequest> requests = { { 4096, 256, 0, 2 }, { 4096, 256, 1, 3 } };
+		AliasingPlan plan = planAliasing(requests);
+		std::string error = validate(requests, plan);
+		passed &= check("overlapping lifetimes get their own bytes", error.empty() && plan.totalSize == 8192, error);
+	}
+	{
+		//like depth dying before the scene color is upscaled: the second pair starts after the first is done
+		std::vector<AliasingRequest> requests = { { 4096, 256, 0, 1 }, { 4096, 256, 2, 3 }, { 1024, 256, 0, 0 }, { 1024, 256, 1, 3 } };
+		AliasingPlan plan = planAliasing(requests);
+		std::string error = validate(requests, plan);
+		bool shared = bytesOverlap(plan, requests, 0, 1) && bytesOverlap(plan, requests, 2, 3);
+		passed &= check("disjoint lifetimes share bytes", error.empty() && shared && plan.totalSize == 5120, error);
+	}
+	{
+		std::vector<AliasingRequest> requests = { { 100, 1, 0, 0 }, { 3000, 1024, 0, 0 } };
+		AliasingPlan plan = planAliasing(requests);
+		std::string error = validate(requests, plan);
+		passed &= check("offsets are aligned", error.empty(), error);
+	}
+
+	//random graphs: every plan has to be valid and never larger than giving each request its own aligned range
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<uint32_t> countDistribution(1, 24);
+	std::uniform_int_distribution<uint32_t> passDistribution(0, 15);
+	std::uniform_int_distribution<VkDeviceSize> sizeDistribution(1, 1 << 20);
+	std::uniform_int_distribution<uint32_t> alignmentDistribution(0, 16);
+	uint32_t failures = 0;
+	std::string firstError;
+	VkDeviceSize unaliasedTotal = 0;
+	VkDeviceSize aliasedTotal = 0;
+	for (uint32_t iteration = 0; iteration < 10000; ++iteration)
+	{
+		std::vector<AliasingRequest> requests(countDistribution(rng));
+		VkDeviceSize bound = 0;
+		for (AliasingRequest& request : requests)
+		{
+			uint32_t a = passDistribution(rng);
+			uint32_t b = passDistribution(rng);
+			request.size = sizeDistribution(rng);
+			request.alignment = VkDeviceSize(1) << alignmentDistribution(rng);
+			request.firstPass = std::min(a, b);
+			request.lastPass = std::max(a, b);
+			bound += request.size + request.alignment - 1;
+		}
+
+		AliasingPlan plan = planAliasing(requests);
+		std::string error = validate(requests, plan);
+		if (error.empty() && plan.totalSize > bound)
+		{
+			error = "the block is larger than not aliasing at all";
+		}
+		if (!error.empty())
+		{
+			failures++;
+			firstError = firstError.empty() ? "iteration " + std::to_string(iteration) + ": " + error : firstError;
+		}
+		for (const AliasingRequest& request : requests)
+		{
+			unaliasedTotal += request.size;
+		}
+		aliasedTotal += plan.totalSize;
+	}
+	passed &= check("10000 random graphs", failures == 0, failures == 0 ? std::to_string(aliasedTotal * 100 / unaliasedTotal) +
+		"% of the unaliased memory" : std::to_string(failures) + " invalid plans, first " + firstError);
+
+	return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
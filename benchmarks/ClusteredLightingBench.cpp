@@ -0,0 +1,217 @@
+#include <ClusteredLighting.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+//The fragments of a frame, every eighth pixel of 1920x1080 on a rolling surface seen through the identity camera,
+//so world space is the depth buffer's space. Depth is reversed like the engine's.
+struct Fragment {
+	glm::vec2 pixel;
+	float depth;
+	glm::vec3 position;
+	glm::vec3 normal;
+};
+
+static const glm::vec2 FrameExtent(1920.0f, 1080.0f);
+
+static std::vector<Fragment> makeFragments()
+{
+	std::vector<Fragment> fragments;
+	for (uint32_t y = 0; y < 1080; y += 8)
+	{
+		for (uint32_t x = 0; x < 1920; x += 8)
+		{
+			Fragment fragment;
+			fragment.pixel = glm::vec2(x + 0.5f, y + 0.5f);
+			glm::vec2 ndc = fragment.pixel / FrameExtent * 2.0f - 1.0f;
+			fragment.depth = 0.5f + 0.3f * std::sin(ndc.x * 3.0f) * std::cos(ndc.y * 2.0f);
+			fragment.position = glm::vec3(ndc.x, ndc.y, fragment.depth);
+			fragment.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+			fragments.push_back(fragment);
+		}
+	}
+	return fragments;
+}
+
+//Engine::updateLights at time 0 scales the radius down with the count so about as many lights overlap any point,
+//which keeps the work per fragment flat. The fixed sweep keeps the 16 light radius, so the overlap grows with the count.
+static float scaledRadius(uint32_t _count)
+{
+	return 0.6f * std::cbrt(16.0f / _count);
+}
+
+static const float FixedRadius = 0.6f;
+
+static std::vector<PointLight> makeLights(uint32_t _count, float _radius)
+{
+	std::vector<PointLight> lights(_count);
+	for (uint32_t i = 0; i < _count; ++i)
+	{
+		uint32_t hash = i * 2654435761u;
+		float phase = (hash & 0xffffu) / 65535.0f * 6.2831853f;
+		lights[i].position = glm::vec3(0.9f * std::sin(phase), 0.9f * std::cos(phase * 2.0f), 0.5f + 0.45f * std::sin(phase * 3.0f));
+		lights[i].radius = _radius;
+		lights[i].color = 2.0f * glm::vec3(((hash >> 8) & 0xffu) / 255.0f, ((hash >> 16) & 0xffu) / 255.0f, (hash >> 24) / 255.0f);
+	}
+	return lights;
+}
+
+//light_cluster.comp on the CPU: every cluster tests every light and gets a compact range of one index list.
+static void binLights(const ClusterGrid& _grid, const std::vector<PointLight>& _lights, uint32_t _maxClusterLights,
+	std::vector<uint32_t>& _clusterFirst, std::vector<uint32_t>& _clusterCount, std::vector<uint32_t>& _indices)
+{
+	const glm::mat4 inverseViewProjection(1.0f);
+	_indices.clear();
+	for (uint32_t z = 0; z < _grid.slices; ++z)
+	{
+		for (uint32_t y = 0; y < _grid.tilesY; ++y)
+		{
+			for (uint32_t x = 0; x < _grid.tilesX; ++x)
+			{
+				glm::vec3 boundsMin;
+				glm::vec3 boundsMax;
+				_grid.bounds(inverseViewProjection, x, y, z, boundsMin, boundsMax);
+
+				uint32_t cluster = (z * _grid.tilesY + y) * _grid.tilesX + x;
+				_clusterFirst[cluster] = static_cast<uint32_t>(_indices.size());
+				uint32_t count = 0;
+				for (uint32_t i = 0; i < _lights.size() && count < _maxClusterLights; ++i)
+				{
+					if (sphereIntersectsBox(_lights[i].position, _lights[i].radius, boundsMin, boundsMax))
+					{
+						_indices.push_back(i);
+						count++;
+					}
+				}
+				_clusterCount[cluster] = count;
+			}
+		}
+	}
+}
+
+//clustered.frag's loop body
+static glm::vec3 shade(const Fragment& _fragment, const PointLight& _light)
+{
+	glm::vec3 toLight = _light.position - _fragment.position;
+	float lightDistance = glm::length(toLight);
+	float falloff = lightDistance / _light.radius;
+	float window = glm::clamp(1.0f - falloff * falloff * falloff * falloff, 0.0f, 1.0f);
+	float attenuation = window * window / (1.0f + lightDistance * lightDistance);
+	float diffuse = std::max(glm::dot(_fragment.normal, toLight * (1.0f / std::max(lightDistance, 1e-4f))), 0.0f);
+	return _light.color * (diffuse * attenuation);
+}
+
+static void bench(const ClusterGrid& _grid, const std::vector<Fragment>& _fragments, uint32_t _lightCount, float _radius,
+	double& _baseline)
+{
+	std::vector<PointLight> lights = makeLights(_lightCount, _radius);
+	std::vector<uint32_t> clusterFirst(_grid.count());
+	std::vector<uint32_t> clusterCount(_grid.count());
+	std::vector<uint32_t> indices;
+	const uint32_t maxClusterLights = 256;
+
+	Clock::time_point start = Clock::now();
+	binLights(_grid, lights, maxClusterLights, clusterFirst, clusterCount, indices);
+	double binTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+	//the sums keep the shading from being optimized away and show both loops light the same
+	const int repeats = 3;
+	double clusteredTime = 0.0;
+	double bruteForceTime = 0.0;
+	uint64_t lightsVisited = 0;
+	double clusteredSum = 0.0;
+	double bruteForceSum = 0.0;
+	for (int r = 0; r < repeats; ++r)
+	{
+		start = Clock::now();
+		glm::vec3 sum(0.0f);
+		for (const Fragment& fragment : _fragments)
+		{
+			uint32_t cluster = _grid.find(fragment.pixel, fragment.depth, FrameExtent);
+			uint32_t first = clusterFirst[cluster];
+			for (uint32_t i = 0; i < clusterCount[cluster]; ++i)
+			{
+				sum += shade(fragment, lights[indices[first + i]]);
+			}
+			lightsVisited += clusterCount[cluster];
+		}
+		clusteredTime += std::chrono::duration<double>(Clock::now() - start).count();
+		clusteredSum = sum.x + sum.y + sum.z;
+
+		start = Clock::now();
+		sum = glm::vec3(0.0f);
+		for (const Fragment& fragment : _fragments)
+		{
+			for (const PointLight& light : lights)
+			{
+				sum += shade(fragment, light);
+			}
+		}
+		bruteForceTime += std::chrono::duration<double>(Clock::now() - start).count();
+		bruteForceSum = sum.x + sum.y + sum.z;
+	}
+	double fragments = static_cast<double>(_fragments.size()) * repeats;
+	double clusteredPerFragment = clusteredTime / fragments * 1e9;
+	double bruteForcePerFragment = bruteForceTime / fragments * 1e9;
+	if (_baseline == 0.0)
+	{
+		_baseline = clusteredPerFragment;
+	}
+
+	std::cout << "[Bench]: " << _lightCount << " lights (radius " << lights[0].radius << "): binned in " << binTime * 1e3
+		<< " ms, avg " << static_cast<double>(indices.size()) / _grid.count() << " per cluster\n";
+	//a cluster keeps at most maxClusterLights, past that the clustered sum falls short of lighting with every light
+	std::cout << "[Bench]:   clustered:   " << lightsVisited / fragments << " lights per fragment, " << clusteredPerFragment
+		<< " ns per fragment (" << clusteredPerFragment / _baseline << "x the first count)\n";
+	std::cout << "[Bench]:   every light: " << _lightCount << " lights per fragment, " << bruteForcePerFragment
+		<< " ns per fragment, light differs by " << std::abs(clusteredSum - bruteForceSum) / std::max(bruteForceSum, 1e-9) * 100.0
+		<< "%\n";
+}
+
+//clustered_lighting_bench [light counts...], 16 64 256 1024 4096 by default
+int main(int argc, char** argv)
+{
+	std::vector<uint32_t> lightCounts;
+	for (int i = 1; i < argc; ++i)
+	{
+		uint32_t count = static_cast<uint32_t>(std::strtoul(argv[i], nullptr, 10));
+		if (count == 0)
+		{
+			std::cerr << "[Bench]: Light counts must be positive, got " << argv[i] << "\n";
+			return 1;
+		}
+		lightCounts.push_back(count);
+	}
+	if (lightCounts.empty())
+	{
+		lightCounts = { 16, 64, 256, 1024, 4096 };
+	}
+
+	std::cout << "[Bench]: CPU emulation of the binning pass and the fragment loop. Run the engine with --lights N for\n"
+		<< "[Bench]: the GPU times of the same scene.\n";
+	ClusterGrid grid;
+	std::vector<Fragment> fragments = makeFragments();
+
+	std::cout << "[Bench]: Radius scaled with the count, like the engine's scene:\n";
+	double baseline = 0.0;
+	for (uint32_t lightCount : lightCounts)
+	{
+		bench(grid, fragments, lightCount, scaledRadius(lightCount), baseline);
+	}
+
+	std::cout << "[Bench]: Fixed radius " << FixedRadius << ", more lights reach every fragment as the count grows:\n";
+	baseline = 0.0;
+	for (uint32_t lightCount : lightCounts)
+	{
+		bench(grid, fragments, lightCount, FixedRadius, baseline);
+	}
+
+	return 0;
+}
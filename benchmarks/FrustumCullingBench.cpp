@@ -0,0 +1,88 @@
+#include <FrustumCulling.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+//Column-major perspective * look-at for a camera at the origin looking down -z, Vulkan clip conventions.
+static void buildViewProjection(float* _matrix)
+{
+	const float fovY = 1.0f;
+	const float aspect = 16.0f / 9.0f;
+	const float zNear = 0.1f;
+	const float zFar = 500.0f;
+	const float f = 1.0f / std::tan(fovY * 0.5f);
+
+	for (int i = 0; i < 16; ++i)
+	{
+		_matrix[i] = 0.0f;
+	}
+	_matrix[0] = f / aspect;
+	_matrix[5] = -f;
+	_matrix[10] = zFar / (zNear - zFar);
+	_matrix[11] = -1.0f;
+	_matrix[14] = zFar * zNear / (zNear - zFar);
+}
+
+static void benchObjectCount(size_t _count, const Frustum& _frustum)
+{
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 5.0f);
+
+	BoundingSpheres spheres;
+	spheres.resize(_count);
+	for (size_t i = 0; i < _count; ++i)
+	{
+		spheres.set(i, position(rng), position(rng), position(rng), size(rng));
+	}
+
+	std::vector<uint32_t> reference(cullingOutputCapacity(spheres));
+	std::vector<uint32_t> output(cullingOutputCapacity(spheres));
+	uint32_t referenceCount = cullSpheres(spheres, _frustum, reference.data(), CullingPath::Scalar);
+
+	const CullingPath paths[] = { CullingPath::Scalar, CullingPath::SSE2, CullingPath::AVX2 };
+	for (CullingPath path : paths)
+	{
+		if (static_cast<int>(path) > static_cast<int>(bestCullingPath()))
+		{
+			continue;
+		}
+
+		uint32_t visibleCount = cullSpheres(spheres, _frustum, output.data(), path);
+		bool matches = visibleCount == referenceCount &&
+			std::equal(reference.begin(), reference.begin() + referenceCount, output.begin());
+
+		const int repeats = _count >= 1000000 ? 20 : 200;
+		Clock::time_point start = Clock::now();
+		for (int r = 0; r < repeats; ++r)
+		{
+			visibleCount = cullSpheres(spheres, _frustum, output.data(), path);
+		}
+		double elapsed = std::chrono::duration<double>(Clock::now() - start).count() / repeats;
+
+		std::cout << "[Bench]: " << _count << " objects, " << cullingPathName(path) << ": "
+			<< elapsed * 1e6 << " us (" << _count / elapsed / 1e6 << " M objects/s), "
+			<< visibleCount << " visible" << (matches ? "" : "  MISMATCH vs scalar") << "\n";
+	}
+}
+
+int main()
+{
+	float viewProjection[16];
+	buildViewProjection(viewProjection);
+	Frustum frustum = Frustum::fromViewProjection(viewProjection);
+
+	std::cout << "[Bench]: best culling path: " << cullingPathName(bestCullingPath()) << "\n";
+	for (size_t count : { size_t(10000), size_t(100000), size_t(1000000) })
+	{
+		benchObjectCount(count, frustum);
+	}
+
+	return 0;
+}
@@ -0,0 +1,168 @@
+#include <InstanceBatcher.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+//What recording a draw costs the CPU without a device: each command is appended to a stream the way a command
+//buffer stores it, state changes included. GPU time isn't measured here, the engine prints it with --markers.
+struct CommandStream {
+	std::vector<uint8_t> bytes;
+
+	template <typename T>
+	void write(uint32_t _command, const T& _payload)
+	{
+		size_t offset = bytes.size();
+		bytes.resize(offset + sizeof(uint32_t) + sizeof(T));
+		std::memcpy(bytes.data() + offset, &_command, sizeof(uint32_t));
+		std::memcpy(bytes.data() + offset + sizeof(uint32_t), &_payload, sizeof(T));
+	}
+};
+
+enum Command : uint32_t { BindPipeline, BindMesh, PushConstants, DrawIndexed };
+
+struct DrawIndexedCommand {
+	uint32_t indexCount;
+	uint32_t instanceCount;
+	uint32_t firstIndex;
+	int32_t vertexOffset;
+	uint32_t firstInstance;
+};
+
+struct Object {
+	uint32_t mesh;
+	InstanceMaterial material;
+	InstanceData data;
+};
+
+static std::vector<Object> makeObjects(uint32_t _count, uint32_t _meshes, uint32_t _materials)
+{
+	std::mt19937 rng(42);
+	std::uniform_int_distribution<uint32_t> mesh(0, _meshes - 1);
+	std::uniform_int_distribution<uint32_t> material(0, _materials - 1);
+	std::uniform_real_distribution<float> offset(-100.0f, 100.0f);
+
+	std::vector<Object> objects(_count);
+	for (Object& object : objects)
+	{
+		object.mesh = mesh(rng);
+		object.material = material(rng);
+		object.data.transform[0] = glm::vec4(1.0f, 0.0f, 0.0f, offset(rng));
+		object.data.transform[1] = glm::vec4(0.0f, 1.0f, 0.0f, offset(rng));
+		object.data.transform[2] = glm::vec4(0.0f, 0.0f, 1.0f, offset(rng));
+		object.data.color = rng();
+	}
+	return objects;
+}
+
+//The draw loop without instancing: objects in scene order, the transform pushed and the object drawn one at a time.
+static uint64_t recordPerObject(const std::vector<Object>& _objects, CommandStream& _stream)
+{
+	uint64_t draws = 0;
+	uint32_t boundMaterial = UINT32_MAX;
+	uint32_t boundMesh = UINT32_MAX;
+	for (const Object& object : _objects)
+	{
+		if (object.material != boundMaterial)
+		{
+			_stream.write(BindPipeline, object.material);
+			boundMaterial = object.material;
+		}
+		if (object.mesh != boundMesh)
+		{
+			_stream.write(BindMesh, object.mesh);
+			boundMesh = object.mesh;
+		}
+		_stream.write(PushConstants, object.data);
+		_stream.write(DrawIndexed, DrawIndexedCommand{ 36, 1, 0, 0, 0 });
+		draws++;
+	}
+	return draws;
+}
+
+//The instancing path: batch, pack into the instance buffer, one draw per group.
+static uint64_t recordInstanced(const std::vector<Object>& _objects, InstanceBatcher& _batcher, std::vector<InstanceData>& _buffer,
+	CommandStream& _stream)
+{
+	_batcher.clear();
+	for (const Object& object : _objects)
+	{
+		_batcher.add(object.mesh, object.material, object.data);
+	}
+	const std::vector<InstanceGroup>& groups = _batcher.pack(_buffer.data(), _buffer.size());
+
+	uint64_t draws = 0;
+	uint32_t boundMaterial = UINT32_MAX;
+	for (const InstanceGroup& group : groups)
+	{
+		if (group.material != boundMaterial)
+		{
+			_stream.write(BindPipeline, group.material);
+			boundMaterial = group.material;
+		}
+		_stream.write(BindMesh, group.mesh);
+		_stream.write(DrawIndexed, DrawIndexedCommand{ 36, group.instanceCount, 0, 0, group.firstInstance });
+		draws++;
+	}
+	return draws;
+}
+
+static void bench(uint32_t _objectCount, uint32_t _meshes, uint32_t _materials)
+{
+	std::vector<Object> objects = makeObjects(_objectCount, _meshes, _materials);
+	InstanceBatcher batcher;
+	std::vector<InstanceData> buffer(_objectCount);
+	CommandStream stream;
+	stream.bytes.reserve(static_cast<size_t>(_objectCount) * 128);
+
+	const int repeats = 10;
+	double perObjectTime = 0.0;
+	double instancedTime = 0.0;
+	uint64_t perObjectDraws = 0;
+	uint64_t instancedDraws = 0;
+	//one warm up round each, so the batcher's buckets and the stream are allocated
+	for (int r = 0; r <= repeats; ++r)
+	{
+		stream.bytes.clear();
+		Clock::time_point start = Clock::now();
+		perObjectDraws = recordPerObject(objects, stream);
+		double perObject = std::chrono::duration<double>(Clock::now() - start).count();
+
+		stream.bytes.clear();
+		start = Clock::now();
+		instancedDraws = recordInstanced(objects, batcher, buffer, stream);
+		double instanced = std::chrono::duration<double>(Clock::now() - start).count();
+
+		if (r > 0)
+		{
+			perObjectTime += perObject;
+			instancedTime += instanced;
+		}
+	}
+	perObjectTime /= repeats;
+	instancedTime /= repeats;
+
+	std::cout << "[Bench]: " << _objectCount << " objects, " << _meshes << " meshes x " << _materials << " materials\n";
+	std::cout << "[Bench]:   one draw per object: " << perObjectDraws << " draws in " << perObjectTime * 1e3 << " ms, "
+		<< perObjectDraws / perObjectTime / 1e6 << " M draws/s, " << _objectCount / perObjectTime / 1e6 << " M objects/s\n";
+	std::cout << "[Bench]:   instanced:           " << instancedDraws << " draws in " << instancedTime * 1e3 << " ms, "
+		<< instancedDraws / instancedTime / 1e6 << " M draws/s, " << _objectCount / instancedTime / 1e6 << " M objects/s ("
+		<< perObjectTime / instancedTime << "x)\n";
+}
+
+int main()
+{
+	std::cout << "[Bench]: CPU side only, commands go to an in-memory stream. A driver adds its own cost to every call on top,\n"
+		<< "[Bench]: which weighs on one draw per object far more than on the few instanced draws.\n";
+	bench(10000, 4, 2);
+	bench(100000, 16, 4);
+	bench(500000, 16, 4);
+	bench(500000, 256, 8);
+
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include <JobSystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static double secondsSince(Clock::time_point _start)
+{
+	return std::chrono::duration<double>(Clock::now() - _start).count();
+}
+
+//Round trip of spawning a single job and waiting for it, median over many runs.
+static void benchForkJoinLatency(JobSystem& _jobs)
+{
+	const uint32_t iterations = 20000;
+	std::vector<double> samples(iterations);
+
+	for (uint32_t i = 0; i < iterations; ++i)
+	{
+		JobCounter counter;
+		Clock::time_point start = Clock::now();
+		_jobs.run(counter, []() {});
+		_jobs.wait(counter);
+		samples[i] = secondsSince(start);
+	}
+
+	std::sort(samples.begin(), samples.end());
+	std::cout << "[Bench]: fork/join latency: median " << samples[iterations / 2] * 1e6
+		<< " us, p99 " << samples[iterations * 99 / 100] * 1e6 << " us\n";
+}
+
+//Empty jobs spawned from inside a job so they go through the worker deques rather than the injection queue.
+static void benchEmptyTaskThroughput(JobSystem& _jobs)
+{
+	const uint32_t taskCount = 1000000;
+
+	Clock::time_point start = Clock::now();
+	JobCounter root;
+	JobCounter children;
+	_jobs.run(root, [&_jobs, &children]() {
+		for (uint32_t i = 0; i < taskCount; ++i)
+		{
+			_jobs.run(children, []() {});
+		}
+	});
+	_jobs.wait(root);
+	_jobs.wait(children);
+	double elapsed = secondsSince(start);
+
+	std::cout << "[Bench]: empty task throughput: " << taskCount / elapsed / 1e6 << " M tasks/s\n";
+}
+
+static void benchParallelForScaling()
+{
+	static constexpr uint32_t elementCount = 1 << 22;
+	static constexpr uint32_t chunkSize = 4096;
+	std::vector<float> data(elementCount, 1.0f);
+
+	auto kernel = [&data](uint32_t _first, uint32_t _last) {
+		for (uint32_t i = _first; i < _last; ++i)
+		{
+			float x = data[i];
+			for (int k = 0; k < 32; ++k)
+			{
+				x = std::sqrt(x * x + 1.0f);
+			}
+			data[i] = x;
+		}
+	};
+
+	uint32_t hardwareThreads = std::max(1u, std::thread::hardware_concurrency());
+	double baseline = 0.0;
+
+	//worker count + the calling thread, which also executes jobs while it waits. A JobSystem always has a worker,
+	//so the single thread row runs the same chunks inline on the calling thread instead.
+	for (uint32_t threads = 1; threads <= hardwareThreads; threads *= 2)
+	{
+		std::unique_ptr<JobSystem> jobs = threads > 1 ? std::make_unique<JobSystem>(threads - 1) : nullptr;
+		auto run = [&jobs, &kernel]() {
+			if (jobs)
+			{
+				jobs->parallelFor(0, elementCount, chunkSize, kernel);
+				return;
+			}
+			for (uint32_t first = 0; first < elementCount; first += chunkSize)
+			{
+				kernel(first, std::min(first + chunkSize, elementCount));
+			}
+		};
+		run();
+
+		Clock::time_point start = Clock::now();
+		const uint32_t repeats = 5;
+		for (uint32_t r = 0; r < repeats; ++r)
+		{
+			run();
+		}
+		double elapsed = secondsSince(start) / repeats;
+		if (threads == 1)
+		{
+			baseline = elapsed;
+		}
+
+		std::cout << "[Bench]: parallelFor " << threads << " threads: " << elapsed * 1e3
+			<< " ms, speedup " << baseline / elapsed << "x\n";
+	}
+}
+
+int main()
+{
+	{
+		JobSystem jobs;
+		std::cout << "[Bench]: " << jobs.getWorkerCount() << " workers\n";
+		benchForkJoinLatency(jobs);
+		benchEmptyTaskThroughput(jobs);
+	}
+	benchParallelForScaling();
+
+	return 0;
+}
@@ -0,0 +1,464 @@
+#include <CaptureReplay.hpp>
+#include <MeshFormat.hpp>
+
+#include "Json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <vulkanUtils.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+//--baseline names a file that doesn't exist (yet), CTest reports the regression check as skipped on it
+constexpr int ExitNoBaseline = 77;
+
+struct SuiteOptions {
+	std::filesystem::path output = "perf_results.json";
+	std::filesystem::path baseline;		//compared against when set
+	double tolerance = 0.15;			//relative change a metric may regress by, unless the baseline gives its own
+	std::filesystem::path shaderDir = "res/shaders";
+	std::filesystem::path scratchDir = std::filesystem::temp_directory_path() / "vkengine_perf";	//the scenes' captures
+	std::string deviceName;				//"llvmpipe" picks lavapipe
+	uint32_t iterations = 50;			//replays per scene, after warmup
+	uint32_t warmup = 5;
+};
+
+struct Metric {
+	std::string name;
+	double value;
+	std::string unit;
+	bool higherIsBetter;
+};
+
+static void printUsage()
+{
+	std::cout << "Usage: perf_suite [options]\n"
+		<< "  --output <file>     where the results are written as JSON (default perf_results.json)\n"
+		<< "  --baseline <file>   compare the results against it, failing on regressions\n"
+		<< "  --tolerance <x>     relative change a metric may regress by (default 0.15), the baseline can set its own\n"
+		<< "  --shaders <dir>     compiled shaders (default res/shaders)\n"
+		<< "  --scratch <dir>     where the scenes are captured to (default the temp directory)\n"
+		<< "  --device <name>     run on the device whose name contains <name>, llvmpipe for lavapipe\n"
+		<< "  --iterations <n>    timed replays of each scene (default 50)\n"
+		<< "  --warmup <n>        untimed replays before them (default 5)\n";
+}
+
+static SuiteOptions parseArguments(int argc, char** argv)
+{
+	SuiteOptions options;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		auto nextValue = [&]() -> std::string
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::invalid_argument(std::string("[Perf]: Missing value for ") + argv[i]);
+			}
+			return argv[++i];
+		};
+
+		if (strcmp(argv[i], "--output") == 0)
+		{
+			options.output = nextValue();
+		}
+		else if (strcmp(argv[i], "--baseline") == 0)
+		{
+			options.baseline = nextValue();
+		}
+		else if (strcmp(argv[i], "--tolerance") == 0)
+		{
+			options.tolerance = std::stod(nextValue());
+		}
+		else if (strcmp(argv[i], "--shaders") == 0)
+		{
+			options.shaderDir = nextValue();
+		}
+		else if (strcmp(argv[i], "--scratch") == 0)
+		{
+			options.scratchDir = nextValue();
+		}
+		else if (strcmp(argv[i], "--device") == 0)
+		{
+			options.deviceName = nextValue();
+		}
+		else if (strcmp(argv[i], "--iterations") == 0)
+		{
+			options.iterations = std::max(static_cast<uint32_t>(std::stoul(nextValue())), 1u);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0)
+		{
+			options.warmup = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--help") == 0)
+		{
+			printUsage();
+			std::exit(EXIT_SUCCESS);
+		}
+		else {
+			throw std::invalid_argument(std::string("[Perf]: Unknown argument ") + argv[i]);
+		}
+	}
+
+	if (options.tolerance < 0.0)
+	{
+		throw std::invalid_argument("[Perf]: Tolerance can't be negative!");
+	}
+	return options;
+}
+
+static double median(std::vector<double> _samples)
+{
+	if (_samples.empty())
+	{
+		return 0.0;
+	}
+	std::sort(_samples.begin(), _samples.end());
+	return _samples[_samples.size() / 2];
+}
+
+//A _size x _size quad grid over [0, 1]^2 facing the camera, so unorm positions map straight onto the grid.
+static CookedMesh makeGrid(uint32_t _size)
+{
+	std::vector<MeshVertex> vertices;
+	for (uint32_t y = 0; y <= _size; ++y)
+	{
+		for (uint32_t x = 0; x <= _size; ++x)
+		{
+			float u = static_cast<float>(x) / _size;
+			float v = static_cast<float>(y) / _size;
+			vertices.push_back({ { u, v, 0.5f + 0.01f * ((x + y) % 2) }, { 0.0f, 0.0f, 1.0f }, { u, v } });
+		}
+	}
+	std::vector<uint32_t> indices;
+	for (uint32_t y = 0; y < _size; ++y)
+	{
+		for (uint32_t x = 0; x < _size; ++x)
+		{
+			uint32_t corner = y * (_size + 1) + x;
+			indices.insert(indices.end(), { corner, corner + 1, corner + _size + 1, corner + 1, corner + _size + 2, corner + _size + 1 });
+		}
+	}
+	return packMesh(vertices, indices);
+}
+
+//Matches the push constant block in mesh.vert, like the engine's MeshPushConstants
+struct MeshPushConstants {
+	float positionOffset[4];
+	float positionScale[4];
+};
+
+//What the engine's mesh pipeline looks like in a capture. Both windings are drawn, the grids are generated without
+//caring which way they face.
+static CapturePipelineKey meshPipelineKey()
+{
+	CapturePipelineKey key{};
+	std::strncpy(key.vertexShader, "mesh.spv", sizeof(key.vertexShader) - 1);
+	std::strncpy(key.fragmentShader, "frag.spv", sizeof(key.fragmentShader) - 1);
+	key.vertexStride = sizeof(PackedVertex);
+	key.cullMode = VK_CULL_MODE_NONE;
+	key.frontFace = VK_FRONT_FACE_CLOCKWISE;
+	key.depthCompareOp = VK_COMPARE_OP_GREATER_OR_EQUAL;
+	key.depthWrite = 1;
+	key.pushConstantStages = VK_SHADER_STAGE_VERTEX_BIT;
+	key.pushConstantSize = sizeof(MeshPushConstants);
+	return key;
+}
+
+//A capture of _objects copies of _mesh, each in its own tile of a _columns wide grid over the viewport. Objects push
+//their tile, so the constants change every draw like they would per object. _trianglesPerDraw limits every draw to a
+//part of the mesh, 0 draws all of it.
+static void captureScene(const std::filesystem::path& _path, const CookedMesh& _mesh, uint32_t _objects, uint32_t _columns,
+	uint32_t _trianglesPerDraw)
+{
+	FrameCapture capture;
+	size_t vertexBytes = _mesh.vertices.size() * sizeof(PackedVertex);
+	uint32_t vertexBuffer = capture.createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBytes);
+	capture.uploadBuffer(vertexBuffer, 0, _mesh.vertices.data(), vertexBytes);
+	uint32_t indexBuffer = capture.createBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, _mesh.indices.size());
+	capture.uploadBuffer(indexBuffer, 0, _mesh.indices.data(), _mesh.indices.size());
+
+	const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	capture.beginPass(clearColor, 0.0f);
+	capture.bindPipeline(meshPipelineKey());
+	capture.bindVertexBuffer(vertexBuffer, 0);
+	capture.bindIndexBuffer(indexBuffer, 0, _mesh.header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32);
+
+	uint32_t rows = (_objects + _columns - 1) / _columns;
+	float tileWidth = 2.0f / _columns;
+	float tileHeight = 2.0f / rows;
+	const MeshLod& lod = _mesh.lods[0];
+	uint32_t drawTriangles = _trianglesPerDraw != 0 ? std::min(_trianglesPerDraw, lod.indexCount / 3) : lod.indexCount / 3;
+	uint32_t drawRanges = lod.indexCount / 3 / drawTriangles;
+	for (uint32_t object = 0; object < _objects; ++object)
+	{
+		MeshPushConstants pushConstants{
+			{ -1.0f + (object % _columns) * tileWidth, -1.0f + (object / _columns) * tileHeight,
+				_mesh.header.positionOffset[2], 0.0f },		//positionOffset
+			{ tileWidth * _mesh.header.positionScale[0], tileHeight * _mesh.header.positionScale[1],
+				_mesh.header.positionScale[2], 0.0f }		//positionScale
+		};
+		capture.pushConstants(VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(pushConstants), &pushConstants);
+		uint32_t firstIndex = lod.firstIndex + (object % drawRanges) * drawTriangles * 3;
+		capture.drawIndexed(drawTriangles * 3, 1, firstIndex, 0, object);
+	}
+	capture.endPass();
+
+	capture.write(_path, { 1280, 720 }, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_D32_SFLOAT, 0);
+}
+
+//Only buffers, a load of it is an upload of _bytes
+static void captureUpload(const std::filesystem::path& _path, size_t _bytes)
+{
+	FrameCapture capture;
+	std::vector<uint8_t> data(_bytes);
+	for (size_t i = 0; i < data.size(); ++i)
+	{
+		data[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+	}
+	uint32_t buffer = capture.createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, _bytes);
+	capture.uploadBuffer(buffer, 0, data.data(), data.size());
+	capture.write(_path, { 64, 64 }, VK_FORMAT_B8G8R8A8_UNORM, VK_FORMAT_D32_SFLOAT, 0);
+}
+
+static void replayScene(CaptureReplayer& _replayer, const std::string& _name, const std::filesystem::path& _path,
+	const SuiteOptions& _options, std::vector<Metric>& _metrics)
+{
+	CaptureFile capture;
+	capture.open(_path);
+	_replayer.load(capture);
+
+	std::vector<double> recordTimes;
+	std::vector<double> frameTimes;
+	std::vector<double> gpuTimes;
+	for (uint32_t i = 0; i < _options.warmup + _options.iterations; ++i)
+	{
+		ReplayTiming timing = _replayer.replay();
+		if (i < _options.warmup)
+		{
+			continue;
+		}
+		recordTimes.push_back(timing.recordTime);
+		frameTimes.push_back(timing.frameTime);
+		if (timing.gpuTimed)
+		{
+			gpuTimes.push_back(timing.gpuTime);
+		}
+	}
+
+	_metrics.push_back({ "scene." + _name + ".record_ms", median(recordTimes) * 1e3, "ms", false });
+	_metrics.push_back({ "scene." + _name + ".frame_ms", median(frameTimes) * 1e3, "ms", false });
+	if (!gpuTimes.empty())
+	{
+		_metrics.push_back({ "scene." + _name + ".gpu_ms", median(gpuTimes) * 1e3, "ms", false });
+	}
+	if (_name == "draw_calls")
+	{
+		_metrics.push_back({ "draw_calls.per_second", _replayer.getDrawCount() / std::max(median(recordTimes), 1e-9), "draws/s", true });
+	}
+	std::cout << "[Perf]: " << _name << ": " << _replayer.getDrawCount() << " draws, " << median(frameTimes) * 1e3
+		<< " ms per frame\n";
+	_replayer.unload();
+}
+
+//Every buffer the engine creates has an allocation of its own, so this is how fast it can create them.
+static void benchAllocations(CaptureReplayer& _replayer, std::vector<Metric>& _metrics)
+{
+	const uint32_t count = 512;
+	const VkDeviceSize size = 256 * 1024;
+	std::vector<VkBuffer> buffers(count);
+	std::vector<VkDeviceMemory> memory(count);
+	std::vector<double> rounds;
+	for (int round = 0; round < 5; ++round)
+	{
+		Clock::time_point start = Clock::now();
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			createBuffer(_replayer.getDevice(), _replayer.getPhysicalDevice(), size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, {}, buffers[i], memory[i]);
+		}
+		for (uint32_t i = 0; i < count; ++i)
+		{
+			vkDestroyBuffer(_replayer.getDevice(), buffers[i], nullptr);
+			vkFreeMemory(_replayer.getDevice(), memory[i], nullptr);
+		}
+		rounds.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+	}
+	_metrics.push_back({ "allocator.buffers_per_second", count / std::max(median(rounds), 1e-9), "buffers/s", true });
+}
+
+static void benchUploads(CaptureReplayer& _replayer, const std::filesystem::path& _path, std::vector<Metric>& _metrics)
+{
+	CaptureFile capture;
+	capture.open(_path);
+	std::vector<double> bandwidths;
+	for (int round = 0; round < 5; ++round)
+	{
+		ReplayLoadStats stats = _replayer.load(capture);
+		bandwidths.push_back(stats.uploadBytes / std::max(stats.uploadTime, 1e-9) / (1024.0 * 1024.0));
+	}
+	_replayer.unload();
+	_metrics.push_back({ "upload.mib_per_second", median(bandwidths), "MiB/s", true });
+}
+
+static void writeResults(const std::filesystem::path& _path, const std::string& _device, const std::vector<Metric>& _metrics)
+{
+	std::ofstream file(_path, std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[Perf]: Couldn't create " + _path.string());
+	}
+
+	//device names have no quotes or backslashes to escape
+	file << std::setprecision(6) << "{\n  \"device\": \"" << _device << "\",\n  \"metrics\": {\n";
+	for (size_t i = 0; i < _metrics.size(); ++i)
+	{
+		const Metric& metric = _metrics[i];
+		file << "    \"" << metric.name << "\": { \"value\": " << metric.value << ", \"unit\": \"" << metric.unit
+			<< "\", \"better\": \"" << (metric.higherIsBetter ? "higher" : "lower") << "\" }"
+			<< (i + 1 < _metrics.size() ? ",\n" : "\n");
+	}
+	file << "  }\n}\n";
+	if (!file)
+	{
+		throw std::runtime_error("[Perf]: Failed writing " + _path.string());
+	}
+}
+
+//Returns how many metrics regressed beyond their tolerance. Metrics of the baseline missing from the results count
+//as regressed, new ones are only listed.
+static uint32_t compareResults(const std::filesystem::path& _baselinePath, const std::vector<Metric>& _metrics,
+	double _tolerance)
+{
+	std::ifstream file(_baselinePath);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[Perf]: Couldn't open the baseline " + _baselinePath.string());
+	}
+	std::stringstream text;
+	text << file.rdbuf();
+	JsonValue baseline = parseJson(text.str());
+	const JsonValue* baselineMetrics = baseline.find("metrics");
+	if (!baselineMetrics || baselineMetrics->type != JsonValue::Type::Object)
+	{
+		throw std::runtime_error("[Perf]: " + _baselinePath.string() + " has no metrics!");
+	}
+	std::cout << "[Perf]: Comparing against " << _baselinePath.string() << ", measured on "
+		<< baseline.getString("device", "an unknown device") << "\n";
+
+	uint32_t regressions = 0;
+	for (const auto& [name, expected] : baselineMetrics->object)
+	{
+		auto found = std::find_if(_metrics.begin(), _metrics.end(), [&](const Metric& _metric) { return _metric.name == name; });
+		if (found == _metrics.end())
+		{
+			std::cout << "[Perf]:   " << name << ": missing from the results, REGRESSED\n";
+			regressions++;
+			continue;
+		}
+
+		double reference = expected.getNumber("value", 0.0);
+		double tolerance = expected.getNumber("tolerance", _tolerance);
+		double change = reference != 0.0 ? (found->value - reference) / reference : 0.0;
+		//positive when it got worse
+		double regression = found->higherIsBetter ? -change : change;
+		bool regressed = regression > tolerance;
+		regressions += regressed ? 1 : 0;
+		std::cout << "[Perf]:   " << name << ": " << found->value << " " << found->unit << " against " << reference << " ("
+			<< std::showpos << change * 100.0 << std::noshowpos << "%, tolerance " << tolerance * 100.0 << "%)"
+			<< (regressed ? " REGRESSED" : regression < -tolerance ? " improved" : "") << "\n";
+	}
+	for (const Metric& metric : _metrics)
+	{
+		if (!baselineMetrics->find(metric.name))
+		{
+			std::cout << "[Perf]:   " << metric.name << ": " << metric.value << " " << metric.unit << ", not in the baseline\n";
+		}
+	}
+	return regressions;
+}
+
+//perf_suite [--output file] [--baseline file] [--tolerance x] [--shaders dir] [--device name] ...
+//Exits with 1 when a metric regressed against the baseline, so CTest can run it as the regression check,
+//and with ExitNoBaseline before measuring anything when there is no baseline to compare against.
+int main(int argc, char** argv)
+{
+	CaptureReplayer replayer;
+	try {
+		SuiteOptions options = parseArguments(argc, argv);
+		if (!options.baseline.empty() && !std::filesystem::exists(options.baseline))
+		{
+			std::cout << "[Perf]: No baseline at " << options.baseline.string() << ", build perf_baseline to record one\n";
+			return ExitNoBaseline;
+		}
+		std::vector<Metric> metrics;
+
+		//the scenes are captured before anything is timed, cooking the grids takes a while
+		std::filesystem::create_directories(options.scratchDir);
+		std::filesystem::path denseScene = options.scratchDir / "dense_mesh.vkcap";
+		std::filesystem::path objectScene = options.scratchDir / "many_objects.vkcap";
+		std::filesystem::path drawScene = options.scratchDir / "draw_calls.vkcap";
+		std::filesystem::path uploadScene = options.scratchDir / "upload.vkcap";
+		CookedMesh denseGrid = makeGrid(256);
+		CookedMesh smallGrid = makeGrid(16);
+		captureScene(denseScene, denseGrid, 1, 1, 0);			//one draw of 131072 triangles over the whole target
+		captureScene(objectScene, smallGrid, 2048, 64, 0);		//2048 draws of 512 triangles
+		captureScene(drawScene, smallGrid, 20000, 200, 1);		//20000 draws of one triangle, recording dominates
+		captureUpload(uploadScene, 64 * 1024 * 1024);
+
+		Clock::time_point start = Clock::now();
+		replayer.init({ options.shaderDir, options.deviceName });
+		metrics.push_back({ "startup.device_ms", std::chrono::duration<double>(Clock::now() - start).count() * 1e3, "ms", false });
+		std::cout << "[Perf]: Running on " << replayer.getDeviceName() << "\n";
+
+		//the first load creates its pipelines without any cache, like the engine's first run
+		{
+			CaptureFile capture;
+			capture.open(denseScene);
+			start = Clock::now();
+			replayer.load(capture);
+			metrics.push_back({ "startup.first_scene_ms", std::chrono::duration<double>(Clock::now() - start).count() * 1e3,
+				"ms", false });
+			replayer.unload();
+		}
+
+		replayScene(replayer, "dense_mesh", denseScene, options, metrics);
+		replayScene(replayer, "many_objects", objectScene, options, metrics);
+		replayScene(replayer, "draw_calls", drawScene, options, metrics);
+		benchUploads(replayer, uploadScene, metrics);
+		benchAllocations(replayer, metrics);
+
+		writeResults(options.output, replayer.getDeviceName(), metrics);
+		std::cout << "[Perf]: Wrote " << metrics.size() << " metrics to " << options.output.string() << "\n";
+
+		if (!options.baseline.empty())
+		{
+			uint32_t regressions = compareResults(options.baseline, metrics, options.tolerance);
+			replayer.destroy();
+			if (regressions != 0)
+			{
+				std::cerr << "[Perf]: " << regressions << " metrics regressed!" << std::endl;
+				return 1;
+			}
+			std::cout << "[Perf]: No regressions\n";
+			return EXIT_SUCCESS;
+		}
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		replayer.destroy();
+		return EXIT_FAILURE;
+	}
+
+	replayer.destroy();
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,351 @@
+#include <CaptureReplay.hpp>
+#include <PushConstants.hpp>
+#include <vulkanUtils.hpp>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+//Small per draw data as a vertex shader would read it: an affine transform and indices into object and material tables
+struct DrawConstants {
+	float transform[12];
+	uint32_t objectIndex;
+	uint32_t materialIndex;
+	uint32_t padding[2];
+};
+using DrawConstantBlock = PushConstantBlock<DrawConstants, VK_SHADER_STAGE_VERTEX_BIT>;
+
+//Both ways of getting DrawConstants to a shader: a pipeline layout with a push constant range, and one with a dynamic
+//uniform buffer whose offset moves to the draw's slot in a host visible ring.
+struct BenchDevice {
+	VkDevice device = VK_NULL_HANDLE;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkPipelineLayout pushLayout = VK_NULL_HANDLE;
+	VkDescriptorSetLayout setLayout = VK_NULL_HANDLE;
+	VkPipelineLayout uniformLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkBuffer uniformBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory uniformMemory = VK_NULL_HANDLE;
+	uint8_t* uniformMapped = nullptr;
+	VkDeviceSize uniformStride = 0;
+
+	void init(const CaptureReplayer& _replayer, uint32_t _drawCount)
+	{
+		device = _replayer.getDevice();
+		VkPhysicalDevice physicalDevice = _replayer.getPhysicalDevice();
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		DrawConstantBlock::validate(properties.limits);
+
+		VkCommandPoolCreateInfo poolInfo{
+			VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,	//sType
+			nullptr,									//pNext
+			0,											//flags
+			_replayer.getQueueFamily()					//queueFamilyIndex
+		};
+		if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[Bench]: Couldn't create the command pool!");
+		}
+		VkCommandBufferAllocateInfo allocateInfo{
+			VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,	//sType
+			nullptr,										//pNext
+			commandPool,									//commandPool
+			VK_COMMAND_BUFFER_LEVEL_PRIMARY,				//level
+			1												//commandBufferCount
+		};
+		if (vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[Bench]: Couldn't allocate the command buffer!");
+		}
+
+		VkPushConstantRange pushConstantRange = DrawConstantBlock::range();
+		VkPipelineLayoutCreateInfo pushLayoutInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+			nullptr,										//pNext
+			0,												//flags
+			0,												//setLayoutCount
+			nullptr,										//pSetLayouts
+			1,												//pushConstantRangeCount
+			&pushConstantRange								//pPushConstantRanges
+		};
+		VkDescriptorSetLayoutBinding binding{
+			0,											//binding
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	//descriptorType
+			1,											//descriptorCount
+			VK_SHADER_STAGE_VERTEX_BIT,					//stageFlags
+			nullptr										//pImmutableSamplers
+		};
+		VkDescriptorSetLayoutCreateInfo setLayoutInfo{
+			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			1,														//bindingCount
+			&binding												//pBindings
+		};
+		if (vkCreatePipelineLayout(device, &pushLayoutInfo, nullptr, &pushLayout) != VK_SUCCESS ||
+			vkCreateDescriptorSetLayout(device, &setLayoutInfo, nullptr, &setLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[Bench]: Couldn't create the layouts!");
+		}
+		VkPipelineLayoutCreateInfo uniformLayoutInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+			nullptr,										//pNext
+			0,												//flags
+			1,												//setLayoutCount
+			&setLayout,										//pSetLayouts
+			0,												//pushConstantRangeCount
+			nullptr											//pPushConstantRanges
+		};
+		if (vkCreatePipelineLayout(device, &uniformLayoutInfo, nullptr, &uniformLayout) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[Bench]: Couldn't create the layouts!");
+		}
+
+		//one slot per draw, so no draw overwrites data an earlier one of the same frame still has to read
+		uniformStride = alignUp(sizeof(DrawConstants), properties.limits.minUniformBufferOffsetAlignment);
+		VkDeviceSize size = uniformStride * _drawCount;
+		createBuffer(device, physicalDevice, size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, {}, uniformBuffer, uniformMemory);
+		void* mapped = nullptr;
+		if (vkMapMemory(device, uniformMemory, 0, size, 0, &mapped) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[Bench]: Couldn't map the uniform buffer!");
+		}
+		uniformMapped = static_cast<uint8_t*>(mapped);
+
+		VkDescriptorPoolSize poolSize{
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	//type
+			1											//descriptorCount
+		};
+		VkDescriptorPoolCreateInfo descriptorPoolInfo{
+			VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+			nullptr,										//pNext
+			0,												//flags
+			1,												//maxSets
+			1,												//poolSizeCount
+			&poolSize										//pPoolSizes
+		};
+		if (vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[Bench]: Couldn't create the descriptor pool!");
+		}
+		VkDescriptorSetAllocateInfo setInfo{
+			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+			nullptr,										//pNext
+			descriptorPool,									//descriptorPool
+			1,												//descriptorSetCount
+			&setLayout										//pSetLayouts
+		};
+		if (vkAllocateDescriptorSets(device, &setInfo, &descriptorSet) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[Bench]: Couldn't allocate the descriptor set!");
+		}
+		VkDescriptorBufferInfo bufferInfo{
+			uniformBuffer,			//buffer
+			0,						//offset
+			sizeof(DrawConstants)	//range
+		};
+		VkWriteDescriptorSet write{
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,		//sType
+			nullptr,									//pNext
+			descriptorSet,								//dstSet
+			0,											//dstBinding
+			0,											//dstArrayElement
+			1,											//descriptorCount
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,	//descriptorType
+			nullptr,									//pImageInfo
+			&bufferInfo,								//pBufferInfo
+			nullptr										//pTexelBufferView
+		};
+		vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+	}
+
+	void destroy()
+	{
+		if (device == VK_NULL_HANDLE)
+		{
+			return;
+		}
+		vkDeviceWaitIdle(device);
+		vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+		if (uniformMapped)
+		{
+			vkUnmapMemory(device, uniformMemory);
+		}
+		vkDestroyBuffer(device, uniformBuffer, nullptr);
+		vkFreeMemory(device, uniformMemory, nullptr);
+		vkDestroyPipelineLayout(device, uniformLayout, nullptr);
+		vkDestroyDescriptorSetLayout(device, setLayout, nullptr);
+		vkDestroyPipelineLayout(device, pushLayout, nullptr);
+		vkDestroyCommandPool(device, commandPool, nullptr);
+		device = VK_NULL_HANDLE;
+	}
+};
+
+//Runs of _runLength draws share their data, like objects drawn once per pass or submeshes of one object.
+static std::vector<DrawConstants> makeDraws(uint32_t _count, uint32_t _runLength)
+{
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> value(-100.0f, 100.0f);
+
+	std::vector<DrawConstants> draws(_count);
+	for (uint32_t i = 0; i < _count; ++i)
+	{
+		if (i % _runLength != 0)
+		{
+			draws[i] = draws[i - 1];
+			continue;
+		}
+		for (float& element : draws[i].transform)
+		{
+			element = value(rng);
+		}
+		draws[i].objectIndex = i / _runLength;
+		draws[i].materialIndex = rng() % 64;
+		draws[i].padding[0] = 0;
+		draws[i].padding[1] = 0;
+	}
+	return draws;
+}
+
+enum class DataPath { PushEvery, PushChanged, Uniform };
+
+static double record(BenchDevice& _device, const std::vector<DrawConstants>& _draws, DataPath _path, DrawConstantBlock& _block)
+{
+	VkCommandBufferBeginInfo beginInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,	//sType
+		nullptr,										//pNext
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,	//flags
+		nullptr											//pInheritanceInfo
+	};
+	vkResetCommandPool(_device.device, _device.commandPool, 0);
+	VkCommandBuffer commandBuffer = _device.commandBuffer;
+
+	//the draws themselves would need a render pass and a pipeline and cost the same on every path, only the per draw
+	//data is recorded
+	Clock::time_point start = Clock::now();
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	switch (_path)
+	{
+	case DataPath::PushEvery:
+		for (const DrawConstants& draw : _draws)
+		{
+			vkCmdPushConstants(commandBuffer, _device.pushLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawConstants), &draw);
+		}
+		break;
+	case DataPath::PushChanged:
+		_block.reset();
+		for (const DrawConstants& draw : _draws)
+		{
+			_block.push(commandBuffer, _device.pushLayout, draw);
+		}
+		break;
+	case DataPath::Uniform:
+		for (size_t i = 0; i < _draws.size(); ++i)
+		{
+			uint32_t offset = static_cast<uint32_t>(i * _device.uniformStride);
+			std::memcpy(_device.uniformMapped + offset, &_draws[i], sizeof(DrawConstants));
+			vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _device.uniformLayout, 0, 1,
+				&_device.descriptorSet, 1, &offset);
+		}
+		break;
+	}
+	vkEndCommandBuffer(commandBuffer);
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void bench(BenchDevice& _device, uint32_t _drawCount, uint32_t _runLength)
+{
+	std::vector<DrawConstants> draws = makeDraws(_drawCount, _runLength);
+	const DataPath paths[] = { DataPath::Uniform, DataPath::PushEvery, DataPath::PushChanged };
+	const char* names[] = { "uniform buffer:        ", "push every draw:       ", "push when changed:     " };
+
+	const int repeats = 20;
+	double times[3] = {};
+	DrawConstantBlock block;
+	//one warm up round, so the pool has grown to the command buffer's size
+	for (int r = 0; r <= repeats; ++r)
+	{
+		for (int p = 0; p < 3; ++p)
+		{
+			double time = record(_device, draws, paths[p], block);
+			if (r > 0)
+			{
+				times[p] += time;
+			}
+		}
+	}
+
+	std::cout << "[Bench]: " << _drawCount << " draws, data changing every " << _runLength << " draw"
+		<< (_runLength == 1 ? "" : "s") << "\n";
+	for (int p = 0; p < 3; ++p)
+	{
+		double time = times[p] / repeats;
+		std::cout << "[Bench]:   " << names[p] << time * 1e9 / _drawCount << " ns per draw, " << time * 1e3 << " ms";
+		if (p > 0)
+		{
+			std::cout << " (" << times[0] / times[p] << "x)";
+		}
+		std::cout << "\n";
+	}
+	std::cout << "[Bench]:   " << block.getSkipped() / (repeats + 1) << " of " << _drawCount << " pushes left out\n";
+}
+
+//push_constants_bench [--device name] [--draws n]
+int main(int argc, char** argv)
+{
+	std::string deviceName;
+	uint32_t drawCount = 100000;
+	for (int i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "--device") == 0 && i + 1 < argc)
+		{
+			deviceName = argv[++i];
+		}
+		else if (strcmp(argv[i], "--draws") == 0 && i + 1 < argc)
+		{
+			drawCount = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+		}
+		else {
+			std::cerr << "[Bench]: Usage: push_constants_bench [--device name] [--draws n]\n";
+			return 1;
+		}
+	}
+	if (drawCount == 0)
+	{
+		std::cerr << "[Bench]: The draw count must be positive\n";
+		return 1;
+	}
+
+	CaptureReplayer replayer;
+	BenchDevice device;
+	try {
+		replayer.init({ "", deviceName });
+		device.init(replayer, drawCount);
+		std::cout << "[Bench]: CPU time recording per draw data on " << replayer.getDeviceName() << ", the uniform path\n"
+			<< "[Bench]: includes writing the data into the mapped ring.\n";
+		bench(device, drawCount, 1);
+		bench(device, drawCount, 4);
+		bench(device, drawCount, 16);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		device.destroy();
+		replayer.destroy();
+		return 1;
+	}
+
+	device.destroy();
+	replayer.destroy();
+	return 0;
+}
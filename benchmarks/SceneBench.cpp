@@ -0,0 +1,87 @@
+#include <Scene.hpp>
+#include <JobSystem.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+//1024 roots with a 4-ary tree hanging under them, about six levels deep at a million entities
+static std::vector<Entity> buildHierarchy(Scene& _scene, uint32_t _count)
+{
+	const uint32_t rootCount = 1024;
+	std::vector<Entity> entities;
+	entities.reserve(_count);
+
+	std::mt19937 rng(42);
+	std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+
+	for (uint32_t i = 0; i < _count; ++i)
+	{
+		Entity parent = i < rootCount ? InvalidEntity : entities[(i - rootCount) / 4];
+		Entity entity = _scene.createEntity(parent);
+
+		Transform transform;
+		transform.position = glm::vec3(offset(rng), offset(rng), offset(rng));
+		transform.rotation = glm::quat(glm::vec3(offset(rng), offset(rng), offset(rng)));
+		_scene.setLocalTransform(entity, transform);
+		_scene.setBoundingRadius(entity, 0.5f);
+
+		entities.push_back(entity);
+	}
+
+	return entities;
+}
+
+static double timeUpdate(Scene& _scene, JobSystem* _jobs)
+{
+	Clock::time_point start = Clock::now();
+	_scene.updateTransforms(_jobs);
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void benchDirtyFraction(Scene& _scene, const std::vector<Entity>& _entities, JobSystem* _jobs, double _fraction, const char* _label)
+{
+	std::mt19937 rng(7);
+	std::uniform_int_distribution<size_t> pick(0, _entities.size() - 1);
+
+	const int repeats = 10;
+	double total = 0.0;
+	for (int r = 0; r < repeats; ++r)
+	{
+		size_t dirtyCount = static_cast<size_t>(_entities.size() * _fraction);
+		for (size_t i = 0; i < dirtyCount; ++i)
+		{
+			Entity entity = _entities[pick(rng)];
+			_scene.setLocalTransform(entity, _scene.getLocalTransform(entity));
+		}
+		total += timeUpdate(_scene, _jobs);
+	}
+
+	std::cout << "[Bench]: " << _label << ", " << _fraction * 100.0 << "% dirty: "
+		<< total / repeats * 1e3 << " ms\n";
+}
+
+int main()
+{
+	const uint32_t entityCount = 1000000;
+
+	Scene scene;
+	std::vector<Entity> entities = buildHierarchy(scene, entityCount);
+	JobSystem jobs;
+
+	double firstUpdate = timeUpdate(scene, &jobs);
+	std::cout << "[Bench]: " << entityCount << " entities in " << scene.depthLevels() << " levels, "
+		<< jobs.getWorkerCount() << " workers\n";
+	std::cout << "[Bench]: first update (sort + all dirty): " << firstUpdate * 1e3 << " ms\n";
+
+	for (double fraction : { 1.0, 0.1, 0.01, 0.0 })
+	{
+		benchDirtyFraction(scene, entities, nullptr, fraction, "single thread");
+		benchDirtyFraction(scene, entities, &jobs, fraction, "job system");
+	}
+
+	return 0;
+}
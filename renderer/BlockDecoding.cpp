@@ -0,0 +1,502 @@
+#include <BlockDecoding.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+using Texels = uint8_t[16][4];	//one decoded 4x4 block, row major RGBA8
+
+BlockFormatInfo getBlockFormatInfo(VkFormat _format)
+{
+	switch (_format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11_UNORM_BLOCK:
+	case VK_FORMAT_EAC_R11_SNORM_BLOCK:
+		return { 4, 4, 8 };
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+	case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+	case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+	case VK_FORMAT_BC7_UNORM_BLOCK:
+	case VK_FORMAT_BC7_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+	case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
+	case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
+		return { 4, 4, 16 };
+	default:
+		break;
+	}
+
+	//ASTC is always 16 bytes, only the footprint changes. The enum lists UNORM and SRGB of each size in pairs.
+	static const uint32_t astcFootprints[][2] = {
+		{ 4, 4 }, { 5, 4 }, { 5, 5 }, { 6, 5 }, { 6, 6 }, { 8, 5 }, { 8, 6 },
+		{ 8, 8 }, { 10, 5 }, { 10, 6 }, { 10, 8 }, { 10, 10 }, { 12, 10 }, { 12, 12 }
+	};
+	if (_format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && _format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+	{
+		const uint32_t* footprint = astcFootprints[(_format - VK_FORMAT_ASTC_4x4_UNORM_BLOCK) / 2];
+		return { footprint[0], footprint[1], 16 };
+	}
+
+	return {};
+}
+
+VkDeviceSize getCompressedLevelSize(VkFormat _format, uint32_t _width, uint32_t _height)
+{
+	BlockFormatInfo info = getBlockFormatInfo(_format);
+	if (info.bytesPerBlock == 0)
+	{
+		throw std::invalid_argument("[Texture]: Format isn't block compressed!");
+	}
+
+	VkDeviceSize blocksX = (_width + info.blockWidth - 1) / info.blockWidth;
+	VkDeviceSize blocksY = (_height + info.blockHeight - 1) / info.blockHeight;
+	return blocksX * blocksY * info.bytesPerBlock;
+}
+
+VkFormat getDecodedFormat(VkFormat _format)
+{
+	switch (_format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+		return VK_FORMAT_R8G8B8A8_UNORM;
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+		return VK_FORMAT_R8G8B8A8_SNORM;
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		return VK_FORMAT_R8G8B8A8_SRGB;
+	default:
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
+static uint8_t clampByte(int _value)
+{
+	return static_cast<uint8_t>(std::clamp(_value, 0, 255));
+}
+
+static uint64_t readLittleEndian(const uint8_t* _bytes, uint32_t _count)
+{
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < _count; ++i)
+	{
+		value |= static_cast<uint64_t>(_bytes[i]) << (8 * i);
+	}
+	return value;
+}
+
+//ETC blocks are stored big endian
+static uint64_t readBigEndian64(const uint8_t* _bytes)
+{
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		value = (value << 8) | _bytes[i];
+	}
+	return value;
+}
+
+//BC1 colour block, also the colour half of BC2/BC3 which always use the four colour mode
+static void decodeColorBlock(const uint8_t* _block, bool _threeColorMode, bool _punchThroughAlpha, Texels& _out)
+{
+	uint32_t colors[2] = {
+		static_cast<uint32_t>(readLittleEndian(_block, 2)),
+		static_cast<uint32_t>(readLittleEndian(_block + 2, 2))
+	};
+
+	int palette[4][4];
+	for (int i = 0; i < 2; ++i)
+	{
+		uint32_t r = (colors[i] >> 11) & 0x1F;
+		uint32_t g = (colors[i] >> 5) & 0x3F;
+		uint32_t b = colors[i] & 0x1F;
+		palette[i][0] = (r << 3) | (r >> 2);
+		palette[i][1] = (g << 2) | (g >> 4);
+		palette[i][2] = (b << 3) | (b >> 2);
+		palette[i][3] = 255;
+	}
+
+	if (colors[0] > colors[1] || !_threeColorMode)
+	{
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+			palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+		}
+		palette[2][3] = palette[3][3] = 255;
+	} else {
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = 0;
+		}
+		palette[2][3] = 255;
+		palette[3][3] = _punchThroughAlpha ? 0 : 255;
+	}
+
+	uint32_t indices = static_cast<uint32_t>(readLittleEndian(_block + 4, 4));
+	for (int i = 0; i < 16; ++i)
+	{
+		const int* color = palette[(indices >> (2 * i)) & 3];
+		for (int c = 0; c < 4; ++c)
+		{
+			_out[i][c] = static_cast<uint8_t>(color[c]);
+		}
+	}
+}
+
+//BC4 block, also BC3 alpha and each BC5 channel
+static void decodeChannelBlock(const uint8_t* _block, uint32_t _channel, Texels& _out)
+{
+	int endpoints[2] = { _block[0], _block[1] };
+	int palette[8] = { endpoints[0], endpoints[1] };
+
+	if (endpoints[0] > endpoints[1])
+	{
+		for (int i = 1; i <= 6; ++i)
+		{
+			palette[i + 1] = ((7 - i) * endpoints[0] + i * endpoints[1] + 3) / 7;
+		}
+	} else {
+		for (int i = 1; i <= 4; ++i)
+		{
+			palette[i + 1] = ((5 - i) * endpoints[0] + i * endpoints[1] + 2) / 5;
+		}
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+
+	uint64_t indices = readLittleEndian(_block + 2, 6);
+	for (int i = 0; i < 16; ++i)
+	{
+		_out[i][_channel] = static_cast<uint8_t>(palette[(indices >> (3 * i)) & 7]);
+	}
+}
+
+//Rounds half away from zero, so the signed palette is symmetric around 0
+static int roundedDivide(int _value, int _divisor)
+{
+	return _value >= 0 ? (_value + _divisor / 2) / _divisor : -((-_value + _divisor / 2) / _divisor);
+}
+
+//Signed BC4 block and each signed BC5 channel, stored as int8 bits. -128 decodes like -127.
+static void decodeSignedChannelBlock(const uint8_t* _block, uint32_t _channel, Texels& _out)
+{
+	int endpoints[2] = { std::max<int>(static_cast<int8_t>(_block[0]), -127), std::max<int>(static_cast<int8_t>(_block[1]), -127) };
+	int palette[8] = { endpoints[0], endpoints[1] };
+
+	if (endpoints[0] > endpoints[1])
+	{
+		for (int i = 1; i <= 6; ++i)
+		{
+			palette[i + 1] = roundedDivide((7 - i) * endpoints[0] + i * endpoints[1], 7);
+		}
+	} else {
+		for (int i = 1; i <= 4; ++i)
+		{
+			palette[i + 1] = roundedDivide((5 - i) * endpoints[0] + i * endpoints[1], 5);
+		}
+		palette[6] = -127;
+		palette[7] = 127;
+	}
+
+	uint64_t indices = readLittleEndian(_block + 2, 6);
+	for (int i = 0; i < 16; ++i)
+	{
+		_out[i][_channel] = static_cast<uint8_t>(static_cast<int8_t>(palette[(indices >> (3 * i)) & 7]));
+	}
+}
+
+//BC2 alpha, 4 bits per texel
+static void decodeExplicitAlpha(const uint8_t* _block, Texels& _out)
+{
+	for (int i = 0; i < 16; ++i)
+	{
+		_out[i][3] = static_cast<uint8_t>(((_block[i / 2] >> (4 * (i & 1))) & 0xF) * 17);
+	}
+}
+
+//ETC2 RGB block: the ETC1 individual and differential modes plus T, H and planar, which use the
+//differential encodings that would overflow in R, G and B respectively.
+static void decodeEtc2ColorBlock(const uint8_t* _block, Texels& _out)
+{
+	static const int modifiers[8][2] = {
+		{ 2, 8 }, { 5, 17 }, { 9, 29 }, { 13, 42 }, { 18, 60 }, { 24, 80 }, { 33, 106 }, { 47, 183 }
+	};
+	static const int distances[8] = { 3, 6, 11, 16, 23, 32, 41, 64 };
+
+	const uint64_t bits = readBigEndian64(_block);
+	//_count bits ending at bit _high
+	auto field = [bits](uint32_t _high, uint32_t _count) {
+		return static_cast<int>((bits >> (_high + 1 - _count)) & ((1ull << _count) - 1));
+	};
+	auto extend4 = [](int _value) { return _value * 17; };
+	auto extend5 = [](int _value) { return (_value << 3) | (_value >> 2); };
+	auto signExtend3 = [](int _value) { return _value >= 4 ? _value - 8 : _value; };
+	//texels are numbered column major, the MSB and LSB of each index live in separate halves
+	auto texelIndex = [bits](int _x, int _y) {
+		int i = _x * 4 + _y;
+		return static_cast<int>((((bits >> (16 + i)) & 1) << 1) | ((bits >> i) & 1));
+	};
+	auto write = [&_out](int _x, int _y, int _r, int _g, int _b) {
+		uint8_t* texel = _out[_y * 4 + _x];
+		texel[0] = clampByte(_r);
+		texel[1] = clampByte(_g);
+		texel[2] = clampByte(_b);
+		texel[3] = 255;
+	};
+
+	int base[2][3];
+	if (field(33, 1) == 0)
+	{
+		base[0][0] = extend4(field(63, 4)); base[1][0] = extend4(field(59, 4));
+		base[0][1] = extend4(field(55, 4)); base[1][1] = extend4(field(51, 4));
+		base[0][2] = extend4(field(47, 4)); base[1][2] = extend4(field(43, 4));
+	} else {
+		int r = field(63, 5), g = field(55, 5), b = field(47, 5);
+		int dr = signExtend3(field(58, 3)), dg = signExtend3(field(50, 3)), db = signExtend3(field(42, 3));
+
+		if (r + dr < 0 || r + dr > 31)
+		{
+			//T mode
+			int c1[3] = { extend4((field(60, 2) << 2) | field(57, 2)), extend4(field(55, 4)), extend4(field(51, 4)) };
+			int c2[3] = { extend4(field(47, 4)), extend4(field(43, 4)), extend4(field(39, 4)) };
+			int distance = distances[(field(35, 2) << 1) | field(32, 1)];
+			int paint[4][3];
+			for (int c = 0; c < 3; ++c)
+			{
+				paint[0][c] = c1[c];
+				paint[1][c] = c2[c] + distance;
+				paint[2][c] = c2[c];
+				paint[3][c] = c2[c] - distance;
+			}
+			for (int y = 0; y < 4; ++y)
+			{
+				for (int x = 0; x < 4; ++x)
+				{
+					const int* color = paint[texelIndex(x, y)];
+					write(x, y, color[0], color[1], color[2]);
+				}
+			}
+			return;
+		}
+
+		if (g + dg < 0 || g + dg > 31)
+		{
+			//H mode
+			int c1[3] = { extend4(field(62, 4)), extend4((field(58, 3) << 1) | field(52, 1)), extend4((field(51, 1) << 3) | field(49, 3)) };
+			int c2[3] = { extend4(field(46, 4)), extend4(field(42, 4)), extend4(field(38, 4)) };
+			//the order of the two base colours holds the distance index's lowest bit
+			int order = ((c1[0] << 16) | (c1[1] << 8) | c1[2]) >= ((c2[0] << 16) | (c2[1] << 8) | c2[2]) ? 1 : 0;
+			int distance = distances[(field(34, 1) << 2) | (field(32, 1) << 1) | order];
+			int paint[4][3];
+			for (int c = 0; c < 3; ++c)
+			{
+				paint[0][c] = c1[c] + distance;
+				paint[1][c] = c1[c] - distance;
+				paint[2][c] = c2[c] + distance;
+				paint[3][c] = c2[c] - distance;
+			}
+			for (int y = 0; y < 4; ++y)
+			{
+				for (int x = 0; x < 4; ++x)
+				{
+					const int* color = paint[texelIndex(x, y)];
+					write(x, y, color[0], color[1], color[2]);
+				}
+			}
+			return;
+		}
+
+		if (b + db < 0 || b + db > 31)
+		{
+			//planar mode: origin, horizontal and vertical colour, bilinearly extrapolated
+			auto extend6 = [](int _value) { return (_value << 2) | (_value >> 4); };
+			auto extend7 = [](int _value) { return (_value << 1) | (_value >> 6); };
+			int origin[3] = {
+				extend6(field(62, 6)),
+				extend7((field(56, 1) << 6) | field(54, 6)),
+				extend6((field(48, 1) << 5) | (field(44, 2) << 3) | field(41, 3))
+			};
+			int horizontal[3] = { extend6((field(38, 5) << 1) | field(32, 1)), extend7(field(31, 7)), extend6(field(24, 6)) };
+			int vertical[3] = { extend6(field(18, 6)), extend7(field(12, 7)), extend6(field(5, 6)) };
+			for (int y = 0; y < 4; ++y)
+			{
+				for (int x = 0; x < 4; ++x)
+				{
+					int color[3];
+					for (int c = 0; c < 3; ++c)
+					{
+						color[c] = (x * (horizontal[c] - origin[c]) + y * (vertical[c] - origin[c]) + 4 * origin[c] + 2) >> 2;
+					}
+					write(x, y, color[0], color[1], color[2]);
+				}
+			}
+			return;
+		}
+
+		base[0][0] = extend5(r); base[1][0] = extend5(r + dr);
+		base[0][1] = extend5(g); base[1][1] = extend5(g + dg);
+		base[0][2] = extend5(b); base[1][2] = extend5(b + db);
+	}
+
+	//ETC1: two sub-blocks, side by side or stacked when flipped, each with its own modifier table
+	const int tables[2] = { field(39, 3), field(36, 3) };
+	const bool flip = field(32, 1) != 0;
+	for (int y = 0; y < 4; ++y)
+	{
+		for (int x = 0; x < 4; ++x)
+		{
+			int subBlock = flip ? (y >= 2) : (x >= 2);
+			int index = texelIndex(x, y);
+			int modifier = modifiers[tables[subBlock]][index & 1];
+			if (index & 2)
+			{
+				modifier = -modifier;
+			}
+			write(x, y, base[subBlock][0] + modifier, base[subBlock][1] + modifier, base[subBlock][2] + modifier);
+		}
+	}
+}
+
+//EAC alpha of ETC2 RGBA8
+static void decodeEacAlphaBlock(const uint8_t* _block, Texels& _out)
+{
+	static const int modifiers[16][8] = {
+		{ -3, -6, -9, -15, 2, 5, 8, 14 }, { -3, -7, -10, -13, 2, 6, 9, 12 },
+		{ -2, -5, -8, -13, 1, 4, 7, 12 }, { -2, -4, -6, -13, 1, 3, 5, 12 },
+		{ -3, -6, -8, -12, 2, 5, 7, 11 }, { -3, -7, -9, -11, 2, 6, 8, 10 },
+		{ -4, -7, -8, -11, 3, 6, 7, 10 }, { -3, -5, -8, -11, 2, 4, 7, 10 },
+		{ -2, -6, -8, -10, 1, 5, 7, 9 }, { -2, -5, -8, -10, 1, 4, 7, 9 },
+		{ -2, -4, -8, -10, 1, 3, 7, 9 }, { -2, -5, -7, -10, 1, 4, 6, 9 },
+		{ -3, -4, -7, -10, 2, 3, 6, 9 }, { -1, -2, -3, -10, 0, 1, 2, 9 },
+		{ -4, -6, -8, -9, 3, 5, 7, 8 }, { -3, -5, -7, -9, 2, 4, 6, 8 }
+	};
+
+	const uint64_t bits = readBigEndian64(_block);
+	int base = static_cast<int>(bits >> 56);
+	int multiplier = static_cast<int>((bits >> 52) & 0xF);
+	const int* table = modifiers[(bits >> 48) & 0xF];
+
+	for (int i = 0; i < 16; ++i)
+	{
+		//column major like the colour indices
+		int x = i / 4, y = i % 4;
+		int index = static_cast<int>((bits >> (45 - 3 * i)) & 7);
+		_out[y * 4 + x][3] = clampByte(base + table[index] * multiplier);
+	}
+}
+
+static void decodeBlock(VkFormat _format, const uint8_t* _block, Texels& _out)
+{
+	switch (_format)
+	{
+	case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+		decodeColorBlock(_block, true, false, _out);
+		break;
+	case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+	case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+		decodeColorBlock(_block, true, true, _out);
+		break;
+	case VK_FORMAT_BC2_UNORM_BLOCK:
+	case VK_FORMAT_BC2_SRGB_BLOCK:
+		decodeColorBlock(_block + 8, false, false, _out);
+		decodeExplicitAlpha(_block, _out);
+		break;
+	case VK_FORMAT_BC3_UNORM_BLOCK:
+	case VK_FORMAT_BC3_SRGB_BLOCK:
+		decodeColorBlock(_block + 8, false, false, _out);
+		decodeChannelBlock(_block, 3, _out);
+		break;
+	case VK_FORMAT_BC4_UNORM_BLOCK:
+	case VK_FORMAT_BC5_UNORM_BLOCK:
+		for (int i = 0; i < 16; ++i)
+		{
+			_out[i][1] = _out[i][2] = 0;
+			_out[i][3] = 255;
+		}
+		decodeChannelBlock(_block, 0, _out);
+		if (_format == VK_FORMAT_BC5_UNORM_BLOCK)
+		{
+			decodeChannelBlock(_block + 8, 1, _out);
+		}
+		break;
+	case VK_FORMAT_BC4_SNORM_BLOCK:
+	case VK_FORMAT_BC5_SNORM_BLOCK:
+		for (int i = 0; i < 16; ++i)
+		{
+			_out[i][1] = _out[i][2] = 0;
+			_out[i][3] = 127;
+		}
+		decodeSignedChannelBlock(_block, 0, _out);
+		if (_format == VK_FORMAT_BC5_SNORM_BLOCK)
+		{
+			decodeSignedChannelBlock(_block + 8, 1, _out);
+		}
+		break;
+	case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+		decodeEtc2ColorBlock(_block, _out);
+		break;
+	case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+	case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+		decodeEtc2ColorBlock(_block + 8, _out);
+		decodeEacAlphaBlock(_block, _out);
+		break;
+	default:
+		throw std::invalid_argument("[Texture]: No CPU decoder for this format!");
+	}
+}
+
+void decodeBlocks(VkFormat _format, const uint8_t* _blocks, uint32_t _width, uint32_t _height, uint8_t* _rgba)
+{
+	const uint32_t bytesPerBlock = getBlockFormatInfo(_format).bytesPerBlock;
+	const uint32_t blocksX = (_width + 3) / 4;
+	const uint32_t blocksY = (_height + 3) / 4;
+
+	Texels texels;
+	for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+	{
+		for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+		{
+			decodeBlock(_format, _blocks + (blockY * blocksX + blockX) * bytesPerBlock, texels);
+
+			//blocks hanging over the edge of small mips only write what's inside the level
+			uint32_t columns = std::min(4u, _width - blockX * 4);
+			uint32_t rows = std::min(4u, _height - blockY * 4);
+			for (uint32_t y = 0; y < rows; ++y)
+			{
+				const uint8_t* source = &texels[0][0] + y * 16;
+				uint8_t* row = _rgba + ((static_cast<size_t>(blockY) * 4 + y) * _width + blockX * 4) * 4;
+				std::copy(source, source + columns * 4, row);
+			}
+		}
+	}
+}
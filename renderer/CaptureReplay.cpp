@@ -0,0 +1,803 @@
+#include <CaptureReplay.hpp>
+#include <MeshFormat.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include <vulkanUtils.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+void CaptureReplayer::init(const CaptureReplayConfig& _config)
+{
+	config = _config;
+
+	VkApplicationInfo appInfo{
+		VK_STRUCTURE_TYPE_APPLICATION_INFO,	//sType
+		nullptr,							//pNext
+		"renderer_replay",					//pApplicationName
+		VK_MAKE_API_VERSION(0, 1, 0, 0),	//applicationVersion
+		"No Engine",						//pEngineName
+		VK_MAKE_API_VERSION(0, 1, 0, 0),	//engineVersion
+		VK_API_VERSION_1_0					//apiVersion
+	};
+	VkInstanceCreateInfo instanceInfo{
+		VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,	//sType
+		nullptr,								//pNext
+		0,										//flags
+		&appInfo,								//pApplicationInfo
+		0,										//enabledLayerCount
+		nullptr,								//ppEnabledLayerNames
+		0,										//enabledExtensionCount -> headless, no surface
+		nullptr									//ppEnabledExtensionNames
+	};
+	if (vkCreateInstance(&instanceInfo, nullptr, &instance) != VK_SUCCESS) {
+		throw std::runtime_error("[Replay]: Failed to create a Vulkan instance!");
+	}
+
+	uint32_t deviceCount = 0;
+	vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+	std::vector<VkPhysicalDevice> devices(deviceCount);
+	vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+
+	int bestScore = 0;
+	for (VkPhysicalDevice candidate : devices)
+	{
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(candidate, &properties);
+		if (!config.deviceName.empty() && std::string(properties.deviceName).find(config.deviceName) == std::string::npos)
+		{
+			continue;
+		}
+
+		uint32_t familyCount = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, nullptr);
+		std::vector<VkQueueFamilyProperties> families(familyCount);
+		vkGetPhysicalDeviceQueueFamilyProperties(candidate, &familyCount, families.data());
+		for (uint32_t family = 0; family < familyCount; ++family)
+		{
+			if (!(families[family].queueFlags & VK_QUEUE_GRAPHICS_BIT))
+			{
+				continue;
+			}
+			int score = properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU ? 2 : 1;
+			if (score > bestScore)
+			{
+				bestScore = score;
+				physicalDevice = candidate;
+				deviceName = properties.deviceName;
+				queueFamily = family;
+			}
+			break;
+		}
+	}
+	if (physicalDevice == VK_NULL_HANDLE)
+	{
+		throw std::runtime_error(config.deviceName.empty() ? "[Replay]: No device with a graphics queue!" :
+			"[Replay]: No device named like " + config.deviceName + " with a graphics queue!");
+	}
+
+	float priority = 1.0f;
+	VkDeviceQueueCreateInfo queueInfo{
+		VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0,											//flags
+		queueFamily,								//queueFamilyIndex
+		1,											//queueCount
+		&priority									//pQueuePriorities
+	};
+	VkDeviceCreateInfo deviceInfo{
+		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,	//sType
+		nullptr,								//pNext
+		0,										//flags
+		1,										//queueCreateInfoCount
+		&queueInfo,								//pQueueCreateInfos
+		0,										//enabledLayerCount
+		nullptr,								//ppEnabledLayerNames
+		0,										//enabledExtensionCount
+		nullptr,								//ppEnabledExtensionNames
+		nullptr									//pEnabledFeatures
+	};
+	if (vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device) != VK_SUCCESS) {
+		throw std::runtime_error("[Replay]: Failed to create a logical device!");
+	}
+	vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+	VkCommandPoolCreateInfo poolInfo{
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,			//sType
+		nullptr,											//pNext
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,	//flags
+		queueFamily											//queueFamilyIndex
+	};
+	if (vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Replay]: Failed to create a command pool!");
+	}
+	VkCommandBufferAllocateInfo allocateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		commandPool,									//commandPool
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY,				//level
+		1												//commandBufferCount
+	};
+	if (vkAllocateCommandBuffers(device, &allocateInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[Replay]: Failed to allocate a command buffer!");
+	}
+	VkFenceCreateInfo fenceInfo{
+		VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,	//sType
+		nullptr,								//pNext
+		0										//flags
+	};
+	if (vkCreateFence(device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+		throw std::runtime_error("[Replay]: Failed to create a fence!");
+	}
+
+	gpuTimed = gpuTimer.init(device, physicalDevice, queueFamily);
+}
+
+//Render pass and framebuffer like the engine's main pass, but the images start out undefined every replay since
+//both attachments are cleared
+void CaptureReplayer::createTargets()
+{
+	const CaptureHeader& header = capture->getHeader();
+	extent = { header.width, header.height };
+	VkFormat colorFormat = static_cast<VkFormat>(header.colorFormat);
+	VkFormat depthFormat = static_cast<VkFormat>(header.depthFormat);
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, colorFormat, &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT))
+	{
+		throw std::runtime_error("[Replay]: The device can't render to the captured color format!");
+	}
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, depthFormat, &formatProperties);
+	if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT))
+	{
+		throw std::runtime_error("[Replay]: The device has no depth attachments in the captured depth format!");
+	}
+
+	colorImage.create(device, physicalDevice, colorFormat, extent, 1, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT);
+	depthImage.create(device, physicalDevice, depthFormat, extent, 1, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT);
+	colorView = colorImage.createView(device);
+	depthView = depthImage.createView(device);
+
+	VkAttachmentDescription attachments[] = {
+		{
+			0,									//flags
+			colorFormat,						//format
+			VK_SAMPLE_COUNT_1_BIT,				//samples
+			VK_ATTACHMENT_LOAD_OP_CLEAR,		//loadOp
+			VK_ATTACHMENT_STORE_OP_STORE,		//storeOp
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,	//stencilLoadOp
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,	//stencilStoreOp
+			VK_IMAGE_LAYOUT_UNDEFINED,			//initialLayout
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL	//finalLayout
+		},
+		{
+			0,									//flags
+			depthFormat,						//format
+			VK_SAMPLE_COUNT_1_BIT,				//samples
+			VK_ATTACHMENT_LOAD_OP_CLEAR,		//loadOp
+			VK_ATTACHMENT_STORE_OP_STORE,		//storeOp -> the engine keeps it for Hi-Z, so the replay pays for it too
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,	//stencilLoadOp
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,	//stencilStoreOp
+			VK_IMAGE_LAYOUT_UNDEFINED,			//initialLayout
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL	//finalLayout
+		}
+	};
+	VkAttachmentReference colorReference{ 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };	//attachment, layout
+	VkAttachmentReference depthReference{ 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+	VkSubpassDescription subpass{
+		0,									//flags
+		VK_PIPELINE_BIND_POINT_GRAPHICS,	//pipelineBindPoint
+		0,									//inputAttachmentCount
+		nullptr,							//pInputAttachments
+		1,									//colorAttachmentCount
+		&colorReference,					//pColorAttachments
+		nullptr,							//pResolveAttachments
+		&depthReference,					//pDepthStencilAttachment
+		0,									//preserveAttachmentCount
+		nullptr								//pPreserveAttachments
+	};
+	VkRenderPassCreateInfo renderPassInfo{
+		VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0,											//flags
+		2,											//attachmentCount
+		attachments,								//pAttachments
+		1,											//subpassCount
+		&subpass,									//pSubpasses
+		0,											//dependencyCount
+		nullptr										//pDependencies
+	};
+	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("[Replay]: Failed to create the render pass!");
+	}
+
+	VkImageView views[] = { colorView, depthView };
+	VkFramebufferCreateInfo framebufferInfo{
+		VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0,											//flags
+		renderPass,									//renderPass
+		2,											//attachmentCount
+		views,										//pAttachments
+		extent.width,								//width
+		extent.height,								//height
+		1											//layers
+	};
+	if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[Replay]: Failed to create the framebuffer!");
+	}
+}
+
+//Runs every CreateBuffer and UploadBuffer of the capture-> Uploads go through one staging buffer and one submit, the
+//time it takes is reported on its own and isn't part of the frame.
+void CaptureReplayer::createBuffers(ReplayLoadStats& _stats)
+{
+	const CaptureHeader& header = capture->getHeader();
+	const CaptureCommand* commands = capture->getCommands();
+
+	VkDeviceSize stagingSize = 0;
+	for (uint32_t i = 0; i < header.commandCount; ++i)
+	{
+		const CaptureCommand& command = commands[i];
+		if (command.op == CaptureOp::CreateBuffer)
+		{
+			if (command.args[0] != buffers.size())
+			{
+				throw std::runtime_error("[Replay]: Buffers aren't created in order!");
+			}
+			VkDeviceSize size = std::max<VkDeviceSize>(joinWords(command.args[2], command.args[3]), 4);
+			buffers.push_back(VK_NULL_HANDLE);
+			bufferMemory.push_back(VK_NULL_HANDLE);
+			bufferSizes.push_back(size);
+			createBuffer(device, physicalDevice, size, command.args[1] | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, {}, buffers.back(), bufferMemory.back());
+		}
+		else if (command.op == CaptureOp::UploadBuffer)
+		{
+			getBuffer(command.args[0], joinWords(command.args[1], command.args[2]) + command.args[5]);
+			capture->getData(joinWords(command.args[3], command.args[4]), command.args[5]);
+			stagingSize += alignUp(command.args[5], 16);
+			_stats.uploadBytes += command.args[5];
+		}
+	}
+	if (stagingSize == 0)
+	{
+		return;
+	}
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingMemory;
+	createBuffer(device, physicalDevice, stagingSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, {}, stagingBuffer, stagingMemory);
+	uint8_t* mapped;
+	vkMapMemory(device, stagingMemory, 0, stagingSize, 0, reinterpret_cast<void**>(&mapped));
+
+	Clock::time_point start = Clock::now();
+	VkCommandBufferBeginInfo beginInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,	//sType
+		nullptr,										//pNext
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,	//flags
+		nullptr											//pInheritanceInfo
+	};
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	VkDeviceSize stagingOffset = 0;
+	for (uint32_t i = 0; i < header.commandCount; ++i)
+	{
+		const CaptureCommand& command = commands[i];
+		if (command.op != CaptureOp::UploadBuffer)
+		{
+			continue;
+		}
+		uint32_t size = command.args[5];
+		std::memcpy(mapped + stagingOffset, capture->getData(joinWords(command.args[3], command.args[4]), size), size);
+		VkBufferCopy region{
+			stagingOffset,									//srcOffset
+			joinWords(command.args[1], command.args[2]),	//dstOffset
+			size											//size
+		};
+		if (size != 0)
+		{
+			vkCmdCopyBuffer(commandBuffer, stagingBuffer, buffers[command.args[0]], 1, &region);
+		}
+		stagingOffset += alignUp(size, 16);
+	}
+	vkEndCommandBuffer(commandBuffer);
+	submit();
+	double uploadTime = std::chrono::duration<double>(Clock::now() - start).count();
+
+	vkUnmapMemory(device, stagingMemory);
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingMemory, nullptr);
+
+	_stats.uploadTime = uploadTime;
+}
+
+void CaptureReplayer::createPipelines()
+{
+	const CaptureHeader& header = capture->getHeader();
+	const CapturePipelineKey* keys = capture->getPipelines();
+
+	for (uint32_t i = 0; i < header.pipelineCount; ++i)
+	{
+		const CapturePipelineKey& key = keys[i];
+		if (strnlen(key.vertexShader, sizeof(key.vertexShader)) == sizeof(key.vertexShader) ||
+			strnlen(key.fragmentShader, sizeof(key.fragmentShader)) == sizeof(key.fragmentShader))
+		{
+			throw std::runtime_error("[Replay]: Pipeline " + std::to_string(i) + " has an unterminated shader name!");
+		}
+		if (key.vertexStride != 0 && key.vertexStride != sizeof(PackedVertex))
+		{
+			throw std::runtime_error("[Replay]: Pipeline " + std::to_string(i) + " reads vertices the replay doesn't know!");
+		}
+
+		//descriptor sets aren't captured, a lit pipeline is replayed with the unlit fragment shader
+		std::string fragmentShader = key.fragmentShader;
+		if (key.setLayoutCount != 0)
+		{
+			std::cout << "[Replay]: Pipeline " << i << " used descriptor sets, replaying it with frag.spv instead of "
+				<< fragmentShader << "\n";
+			fragmentShader = "frag.spv";
+		}
+		VkShaderModule vertexModule = loadShaderModule(device, config.shaderDir / key.vertexShader);
+		VkShaderModule fragmentModule = loadShaderModule(device, config.shaderDir / fragmentShader);
+
+		VkPipelineShaderStageCreateInfo stages[] = {
+			{
+				VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,	//sType
+				nullptr,												//pNext
+				0,														//flags
+				VK_SHADER_STAGE_VERTEX_BIT,								//stage
+				vertexModule,											//module
+				"main",													//pName
+				nullptr													//pSpecializationInfo
+			},
+			{
+				VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,	//sType
+				nullptr,												//pNext
+				0,														//flags
+				VK_SHADER_STAGE_FRAGMENT_BIT,							//stage
+				fragmentModule,											//module
+				"main",													//pName
+				nullptr													//pSpecializationInfo
+			}
+		};
+
+		VkVertexInputBindingDescription vertexBinding{
+			0,								//binding
+			key.vertexStride,				//stride
+			VK_VERTEX_INPUT_RATE_VERTEX		//inputRate
+		};
+		VkVertexInputAttributeDescription vertexAttributes[] = {
+			{ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) },	//location, binding, format, offset
+			{ 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) },
+			{ 2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, texcoord) }
+		};
+		bool vertices = key.vertexStride != 0;
+		VkPipelineVertexInputStateCreateInfo vertexInputInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,	//sType
+			nullptr,										//pNext
+			0,												//flags
+			vertices ? 1u : 0u,								//vertexBindingDescriptionCount
+			vertices ? &vertexBinding : nullptr,			//pVertexBindingDescriptions
+			vertices ? 3u : 0u,								//vertexAttributeDescriptionCount
+			vertices ? vertexAttributes : nullptr			//pVertexAttributeDescriptions
+		};
+		VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,	//sType
+			nullptr,														//pNext
+			0,																//flags
+			VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,							//topology
+			VK_FALSE														//primitiveRestartEnable
+		};
+		VkDynamicState dynamicStates[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+		VkPipelineDynamicStateCreateInfo dynamicStateInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			2,														//dynamicStateCount
+			dynamicStates											//pDynamicStates
+		};
+		VkPipelineViewportStateCreateInfo viewportStateInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			1,														//viewportCount
+			nullptr,												//pViewports
+			1,														//scissorCount
+			nullptr													//pScissors
+		};
+		VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,	//sType
+			nullptr,													//pNext
+			0,															//flags
+			VK_FALSE,													//depthClampEnable
+			VK_FALSE,													//rasterizerDiscardEnable
+			VK_POLYGON_MODE_FILL,										//polygonMode
+			key.cullMode,												//cullMode
+			static_cast<VkFrontFace>(key.frontFace),					//frontFace
+			VK_FALSE,													//depthBiasEnable
+			0.0f,														//depthBiasConstantFactor
+			0.0f,														//depthBiasClamp
+			0.0f,														//depthBiasSlopeFactor
+			1.0f														//lineWidth
+		};
+		VkPipelineMultisampleStateCreateInfo multisampleInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,	//sType
+			nullptr,													//pNext
+			0,															//flags
+			VK_SAMPLE_COUNT_1_BIT,										//rasterizationSamples
+			VK_FALSE,													//sampleShadingEnable
+			1.0f,														//minSampleShading
+			nullptr,													//pSampleMask
+			VK_FALSE,													//alphaToCoverageEnable
+			VK_FALSE													//alphaToOneEnable
+		};
+		VkPipelineDepthStencilStateCreateInfo depthStencilInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,	//sType
+			nullptr,													//pNext
+			0,															//flags
+			VK_TRUE,													//depthTestEnable
+			key.depthWrite ? VK_TRUE : VK_FALSE,						//depthWriteEnable
+			static_cast<VkCompareOp>(key.depthCompareOp),				//depthCompareOp
+			VK_FALSE,													//depthBoundsTestEnable
+			VK_FALSE,													//stencilTestEnable
+			VkStencilOpState{},											//front
+			VkStencilOpState{},											//back
+			0.0f,														//minDepthBounds
+			1.0f														//maxDepthBounds
+		};
+		VkPipelineColorBlendAttachmentState colorBlendAttachment{
+			key.blendEnable ? VK_TRUE : VK_FALSE,	//blendEnable
+			VK_BLEND_FACTOR_SRC_ALPHA,				//srcColorBlendFactor
+			VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,	//dstColorBlendFactor
+			VK_BLEND_OP_ADD,						//colorBlendOp
+			VK_BLEND_FACTOR_ONE,					//srcAlphaBlendFactor
+			VK_BLEND_FACTOR_ZERO,					//dstAlphaBlendFactor
+			VK_BLEND_OP_ADD,						//alphaBlendOp
+			VK_COLOR_COMPONENT_R_BIT |				//colorWriteMask
+			VK_COLOR_COMPONENT_G_BIT |
+			VK_COLOR_COMPONENT_B_BIT |
+			VK_COLOR_COMPONENT_A_BIT
+		};
+		VkPipelineColorBlendStateCreateInfo colorBlendInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,	//sType
+			nullptr,													//pNext
+			0,															//flags
+			VK_FALSE,													//logicOpEnable
+			VK_LOGIC_OP_COPY,											//logicOp
+			1,															//attachmentCount
+			&colorBlendAttachment,										//pAttachments
+			{ 0.0f, 0.0f, 0.0f, 0.0f }									//blendConstants
+		};
+
+		VkPushConstantRange pushConstantRange{
+			key.pushConstantStages,		//stageFlags
+			0,							//offset
+			key.pushConstantSize		//size
+		};
+		VkPipelineLayoutCreateInfo layoutInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+			nullptr,										//pNext
+			0,												//flags
+			0,												//setLayoutCount
+			nullptr,										//pSetLayouts
+			key.pushConstantSize != 0 ? 1u : 0u,			//pushConstantRangeCount
+			&pushConstantRange								//pPushConstantRanges
+		};
+		VkPipelineLayout layout;
+		if (vkCreatePipelineLayout(device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+			throw std::runtime_error("[Replay]: Failed to create a pipeline layout!");
+		}
+		pipelineLayouts.push_back(layout);
+
+		VkGraphicsPipelineCreateInfo pipelineInfo{
+			VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,	//sType
+			nullptr,											//pNext
+			0,													//flags
+			2,													//stageCount
+			stages,												//pStages
+			&vertexInputInfo,									//pVertexInputState
+			&inputAssemblyInfo,									//pInputAssemblyState
+			nullptr,											//pTessellationState
+			&viewportStateInfo,									//pViewportState
+			&rasterizationStateInfo,							//pRasterizationState
+			&multisampleInfo,									//pMultisampleState
+			&depthStencilInfo,									//pDepthStencilState
+			&colorBlendInfo,									//pColorBlendState
+			&dynamicStateInfo,									//pDynamicState
+			layout,												//layout
+			renderPass,											//renderPass
+			0,													//subpass
+			VK_NULL_HANDLE,										//basePipelineHandle
+			-1													//basePipelineIndex
+		};
+		VkPipeline pipeline;
+		VkResult result = vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline);
+		vkDestroyShaderModule(device, vertexModule, nullptr);
+		vkDestroyShaderModule(device, fragmentModule, nullptr);
+		if (result != VK_SUCCESS) {
+			throw std::runtime_error("[Replay]: Failed to create pipeline " + std::to_string(i) + "!");
+		}
+		pipelines.push_back(pipeline);
+	}
+}
+
+//Buffer _buffer, checking that it exists and holds at least _end bytes.
+VkBuffer CaptureReplayer::getBuffer(uint32_t _buffer, VkDeviceSize _end) const
+{
+	if (_buffer >= buffers.size() || _end > bufferSizes[_buffer])
+	{
+		throw std::runtime_error("[Replay]: A command uses buffer " + std::to_string(_buffer) + " out of range!");
+	}
+	return buffers[_buffer];
+}
+
+//The frame's pass commands as they were captured, resource commands already ran in createBuffers()
+void CaptureReplayer::record()
+{
+	const CaptureHeader& header = capture->getHeader();
+	const CaptureCommand* commands = capture->getCommands();
+
+	VkCommandBufferBeginInfo beginInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,	//sType
+		nullptr,										//pNext
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,	//flags
+		nullptr											//pInheritanceInfo
+	};
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	if (gpuTimed)
+	{
+		gpuTimer.begin(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	}
+
+	drawCount = 0;
+	bool inPass = false;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	for (uint32_t i = 0; i < header.commandCount; ++i)
+	{
+		const CaptureCommand& command = commands[i];
+		const uint32_t* args = command.args;
+		switch (command.op)
+		{
+		case CaptureOp::BeginPass:
+		{
+			if (inPass)
+			{
+				throw std::runtime_error("[Replay]: A pass begins inside another!");
+			}
+			VkClearValue clearValues[2];
+			std::memcpy(clearValues[0].color.float32, args, sizeof(float) * 4);
+			std::memcpy(&clearValues[1].depthStencil.depth, &args[4], sizeof(float));
+			clearValues[1].depthStencil.stencil = 0;
+			VkRenderPassBeginInfo renderPassBeginInfo{
+				VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,	//sType
+				nullptr,									//pNext
+				renderPass,									//renderPass
+				framebuffer,								//framebuffer
+				VkRect2D { VkOffset2D { 0, 0 }, extent },	//renderArea
+				2,											//clearValueCount
+				clearValues									//pClearValues
+			};
+			vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+			VkViewport viewport{ 0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f };
+			VkRect2D scissor{ VkOffset2D { 0, 0 }, extent };
+			vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+			vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+			inPass = true;
+			break;
+		}
+		case CaptureOp::EndPass:
+			if (!inPass)
+			{
+				throw std::runtime_error("[Replay]: A pass ends that didn't begin!");
+			}
+			vkCmdEndRenderPass(commandBuffer);
+			inPass = false;
+			break;
+		case CaptureOp::BindPipeline:
+			if (args[0] >= pipelines.size())
+			{
+				throw std::runtime_error("[Replay]: A command binds a pipeline out of range!");
+			}
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelines[args[0]]);
+			layout = pipelineLayouts[args[0]];
+			break;
+		case CaptureOp::BindVertexBuffer:
+		{
+			VkDeviceSize offset = joinWords(args[1], args[2]);
+			VkBuffer buffer = getBuffer(args[0], offset);
+			vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+			break;
+		}
+		case CaptureOp::BindIndexBuffer:
+		{
+			VkDeviceSize offset = joinWords(args[1], args[2]);
+			vkCmdBindIndexBuffer(commandBuffer, getBuffer(args[0], offset), offset, static_cast<VkIndexType>(args[3]));
+			break;
+		}
+		case CaptureOp::PushConstants:
+			if (layout == VK_NULL_HANDLE)
+			{
+				throw std::runtime_error("[Replay]: Push constants come before any pipeline!");
+			}
+			vkCmdPushConstants(commandBuffer, layout, args[0], args[1], args[2], capture->getData(joinWords(args[3], args[4]), args[2]));
+			break;
+		case CaptureOp::DrawIndexed:
+			vkCmdDrawIndexed(commandBuffer, args[0], args[1], args[2], static_cast<int32_t>(args[3]), args[4]);
+			drawCount++;
+			break;
+		case CaptureOp::Draw:
+			vkCmdDraw(commandBuffer, args[0], args[1], args[2], args[3]);
+			drawCount++;
+			break;
+		default:
+			break;
+		}
+	}
+	if (inPass)
+	{
+		throw std::runtime_error("[Replay]: The capture ends inside a pass!");
+	}
+
+	if (gpuTimed)
+	{
+		gpuTimer.end(commandBuffer);
+	}
+	vkEndCommandBuffer(commandBuffer);
+}
+
+void CaptureReplayer::submit()
+{
+	VkSubmitInfo submitInfo{
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,	//sType
+		nullptr,						//pNext
+		0,								//waitSemaphoreCount
+		nullptr,						//pWaitSemaphores
+		nullptr,						//pWaitDstStageMask
+		1,								//commandBufferCount
+		&commandBuffer,					//pCommandBuffers
+		0,								//signalSemaphoreCount
+		nullptr							//pSignalSemaphores
+	};
+	if (vkQueueSubmit(queue, 1, &submitInfo, fence) != VK_SUCCESS) {
+		throw std::runtime_error("[Replay]: Could not submit the command buffer!");
+	}
+	vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX);
+	vkResetFences(device, 1, &fence);
+	vkResetCommandBuffer(commandBuffer, 0);
+}
+
+void CaptureReplayer::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		if (instance != VK_NULL_HANDLE)
+		{
+			vkDestroyInstance(instance, nullptr);
+			instance = VK_NULL_HANDLE;
+		}
+		return;
+	}
+
+	unload();
+	gpuTimer.destroy();
+	vkDestroyFence(device, fence, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	vkDestroyDevice(device, nullptr);
+	vkDestroyInstance(instance, nullptr);
+	fence = VK_NULL_HANDLE;
+	commandPool = VK_NULL_HANDLE;
+	commandBuffer = VK_NULL_HANDLE;
+	device = VK_NULL_HANDLE;
+	instance = VK_NULL_HANDLE;
+	physicalDevice = VK_NULL_HANDLE;
+}
+
+ReplayLoadStats CaptureReplayer::load(const CaptureFile& _capture)
+{
+	unload();
+	capture = &_capture;
+
+	ReplayLoadStats stats;
+	createTargets();
+	createBuffers(stats);
+	Clock::time_point start = Clock::now();
+	createPipelines();
+	stats.pipelineTime = std::chrono::duration<double>(Clock::now() - start).count();
+	stats.bufferCount = static_cast<uint32_t>(buffers.size());
+	stats.pipelineCount = static_cast<uint32_t>(pipelines.size());
+	return stats;
+}
+
+void CaptureReplayer::unload()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDeviceWaitIdle(device);
+	for (VkPipeline pipeline : pipelines)
+	{
+		vkDestroyPipeline(device, pipeline, nullptr);
+	}
+	for (VkPipelineLayout layout : pipelineLayouts)
+	{
+		vkDestroyPipelineLayout(device, layout, nullptr);
+	}
+	for (size_t i = 0; i < buffers.size(); ++i)
+	{
+		vkDestroyBuffer(device, buffers[i], nullptr);
+		vkFreeMemory(device, bufferMemory[i], nullptr);
+	}
+	vkDestroyFramebuffer(device, framebuffer, nullptr);
+	vkDestroyRenderPass(device, renderPass, nullptr);
+	vkDestroyImageView(device, colorView, nullptr);
+	vkDestroyImageView(device, depthView, nullptr);
+	colorImage.destroy(device);
+	depthImage.destroy(device);
+
+	pipelines.clear();
+	pipelineLayouts.clear();
+	buffers.clear();
+	bufferMemory.clear();
+	bufferSizes.clear();
+	framebuffer = VK_NULL_HANDLE;
+	renderPass = VK_NULL_HANDLE;
+	colorView = VK_NULL_HANDLE;
+	depthView = VK_NULL_HANDLE;
+	drawCount = 0;
+	capture = nullptr;
+}
+
+ReplayTiming CaptureReplayer::replay()
+{
+	if (!capture)
+	{
+		throw std::runtime_error("[Replay]: Nothing is loaded to replay!");
+	}
+
+	ReplayTiming timing;
+	Clock::time_point recordStart = Clock::now();
+	record();
+	Clock::time_point submitStart = Clock::now();
+	submit();
+	Clock::time_point end = Clock::now();
+
+	timing.recordTime = std::chrono::duration<double>(submitStart - recordStart).count();
+	timing.frameTime = std::chrono::duration<double>(end - recordStart).count();
+	timing.gpuTimed = gpuTimed && gpuTimer.read(timing.gpuTime);
+	return timing;
+}
+
+uint32_t CaptureReplayer::getDrawCount() const
+{
+	return drawCount;
+}
+
+const std::string& CaptureReplayer::getDeviceName() const
+{
+	return deviceName;
+}
+
+VkDevice CaptureReplayer::getDevice() const
+{
+	return device;
+}
+
+VkPhysicalDevice CaptureReplayer::getPhysicalDevice() const
+{
+	return physicalDevice;
+}
+
+uint32_t CaptureReplayer::getQueueFamily() const
+{
+	return queueFamily;
+}
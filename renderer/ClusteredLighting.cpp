@@ -0,0 +1,396 @@
+#include <ClusteredLighting.hpp>
+#include <vulkanUtils.hpp>
+#include <ShaderCache.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+
+static constexpr uint32_t SharedClusterLights = 256;	//matches the shared list in light_cluster.comp
+
+//Matches the push constant block in light_cluster.comp
+struct ClusterPushConstants {
+	float inverseViewProjection[16];
+	uint32_t lightCount;
+	uint32_t tilesX;
+	uint32_t tilesY;
+	uint32_t slices;
+	uint32_t indexCapacity;
+	uint32_t maxClusterLights;
+	uint32_t padding[2];
+};
+
+//Matches the push constant block in clustered.frag, which starts wherever the shading pipeline put it
+struct ClusterFragmentPushConstants {
+	float tileScale[2];		//tiles per pixel
+	uint32_t tilesX;
+	uint32_t tilesY;
+	uint32_t slices;
+	uint32_t padding[3];
+};
+
+uint32_t ClusterGrid::count() const
+{
+	return tilesX * tilesY * slices;
+}
+
+void ClusterGrid::bounds(const glm::mat4& _inverseViewProjection, uint32_t _x, uint32_t _y, uint32_t _z, glm::vec3& _min,
+	glm::vec3& _max) const
+{
+	glm::vec2 ndcMin = glm::vec2(_x, _y) / glm::vec2(tilesX, tilesY) * 2.0f - 1.0f;
+	glm::vec2 ndcMax = glm::vec2(_x + 1, _y + 1) / glm::vec2(tilesX, tilesY) * 2.0f - 1.0f;
+	glm::vec2 depth = glm::vec2(_z, _z + 1) / static_cast<float>(slices);
+
+	_min = glm::vec3(1e30f);
+	_max = glm::vec3(-1e30f);
+	for (uint32_t i = 0; i < 8; ++i)
+	{
+		glm::vec4 corner((i & 1) ? ndcMax.x : ndcMin.x, (i & 2) ? ndcMax.y : ndcMin.y, (i & 4) ? depth.y : depth.x, 1.0f);
+		glm::vec4 world = _inverseViewProjection * corner;
+		glm::vec3 position = glm::vec3(world) / world.w;
+		_min = glm::min(_min, position);
+		_max = glm::max(_max, position);
+	}
+}
+
+uint32_t ClusterGrid::find(const glm::vec2& _pixel, float _depth, const glm::vec2& _extent) const
+{
+	uint32_t x = std::min(static_cast<uint32_t>(_pixel.x * tilesX / _extent.x), tilesX - 1);
+	uint32_t y = std::min(static_cast<uint32_t>(_pixel.y * tilesY / _extent.y), tilesY - 1);
+	uint32_t z = std::min(static_cast<uint32_t>(_depth * slices), slices - 1);
+	return (z * tilesY + y) * tilesX + x;
+}
+
+bool sphereIntersectsBox(const glm::vec3& _center, float _radius, const glm::vec3& _min, const glm::vec3& _max)
+{
+	glm::vec3 offset = glm::clamp(_center, _min, _max) - _center;
+	return glm::dot(offset, offset) <= _radius * _radius;
+}
+
+bool ClusteredLighting::init(VkDevice _device, VkPhysicalDevice _physicalDevice, PipelineStateCache& _states,
+	const ClusteredLightingConfig& _config)
+{
+	if (_config.grid.count() == 0 || _config.maxLights == 0 || _config.framesInFlight == 0)
+	{
+		throw std::invalid_argument("[Lighting]: Cluster grid, light capacity and frames in flight must be positive!");
+	}
+	if (_config.maxClusterLights == 0 || _config.maxClusterLights > SharedClusterLights)
+	{
+		throw std::invalid_argument("[Lighting]: Lights per cluster must be between 1 and 256!");
+	}
+	std::filesystem::path shader = _config.shaderDir / "light_cluster.spv";
+	if (!std::filesystem::exists(shader) || !std::filesystem::exists(_config.shaderDir / "clustered.spv"))
+	{
+		std::cout << "[Lighting]: " << shader.string() << " or clustered.spv not found (run res/shaders/compile.bat), no lights.\n";
+		return false;
+	}
+
+	device = _device;
+	config = _config;
+	indexCapacity = config.grid.count() * std::max(config.averageClusterLights, 1u);
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	sliceSize = alignUp(static_cast<VkDeviceSize>(config.maxLights) * sizeof(PointLight),
+		properties.limits.minStorageBufferOffsetAlignment);
+
+	createBuffer(device, _physicalDevice, sliceSize * config.framesInFlight, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, config.queueFamilies, lightBuffer, lightMemory);
+	void* mapped = nullptr;
+	vkMapMemory(device, lightMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	lightMapped = static_cast<PointLight*>(mapped);
+
+	createBuffer(device, _physicalDevice, static_cast<VkDeviceSize>(config.grid.count()) * 2 * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, config.queueFamilies, clusterBuffer, clusterMemory);
+	createBuffer(device, _physicalDevice, static_cast<VkDeviceSize>(indexCapacity) * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, config.queueFamilies, indexBuffer, indexMemory);
+	createBuffer(device, _physicalDevice, sizeof(ClusterCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		config.queueFamilies, counterBuffer, counterMemory);
+	createBuffer(device, _physicalDevice, sizeof(ClusterCounters) * config.framesInFlight, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, config.queueFamilies,
+		readbackBuffer, readbackMemory);
+	vkMapMemory(device, readbackMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	readbackMapped = static_cast<ClusterCounters*>(mapped);
+	sliceRecorded.assign(config.framesInFlight, false);
+	//counts the last slot first, so the first frame lands in slice 0
+	frameSlot = config.framesInFlight - 1;
+
+	timed = !config.queueFamilies.empty() && binTimer.init(device, _physicalDevice, config.queueFamilies[0]);
+
+	const uint32_t bindingCount = 4;
+	VkDescriptorSetLayoutBinding bindings[bindingCount];
+	for (uint32_t i = 0; i < bindingCount; ++i)
+	{
+		bindings[i] = VkDescriptorSetLayoutBinding{
+			i,													//binding
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,					//descriptorType
+			1,													//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,	//stageFlags
+			nullptr												//pImmutableSamplers
+		};
+	}
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		bindingCount,											//bindingCount
+		bindings												//pBindings
+	};
+	descriptorSetLayout = _states.getDescriptorSetLayout(descriptorSetLayoutInfo);
+
+	VkDescriptorPoolSize poolSize{
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,		//type
+		bindingCount * config.framesInFlight	//descriptorCount
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		config.framesInFlight,							//maxSets
+		1,												//poolSizeCount
+		&poolSize										//pPoolSizes
+	};
+	if (vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Lighting]: Failed to create the cluster descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts(config.framesInFlight, descriptorSetLayout);
+	descriptorSets.resize(config.framesInFlight);
+	VkDescriptorSetAllocateInfo descriptorSetInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		descriptorPool,									//descriptorPool
+		config.framesInFlight,							//descriptorSetCount
+		setLayouts.data()								//pSetLayouts
+	};
+	if (vkAllocateDescriptorSets(device, &descriptorSetInfo, descriptorSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("[Lighting]: Failed to allocate the cluster descriptor sets!");
+	}
+
+	//the sets only differ in which slice of the lights they see
+	for (uint32_t slice = 0; slice < config.framesInFlight; ++slice)
+	{
+		VkDescriptorBufferInfo bufferInfos[bindingCount] = {
+			{ lightBuffer, slice * sliceSize, sliceSize },
+			{ clusterBuffer, 0, VK_WHOLE_SIZE },
+			{ indexBuffer, 0, VK_WHOLE_SIZE },
+			{ counterBuffer, 0, VK_WHOLE_SIZE }
+		};
+		VkWriteDescriptorSet writes[bindingCount];
+		for (uint32_t i = 0; i < bindingCount; ++i)
+		{
+			writes[i] = VkWriteDescriptorSet{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,	//sType
+				nullptr,								//pNext
+				descriptorSets[slice],					//dstSet
+				i,										//dstBinding
+				0,										//dstArrayElement
+				1,										//descriptorCount
+				VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,		//descriptorType
+				nullptr,								//pImageInfo
+				&bufferInfos[i],						//pBufferInfo
+				nullptr									//pTexelBufferView
+			};
+		}
+		vkUpdateDescriptorSets(device, bindingCount, writes, 0, nullptr);
+	}
+
+	VkPushConstantRange pushConstantRange{
+		VK_SHADER_STAGE_COMPUTE_BIT,	//stageFlags
+		0,								//offset
+		sizeof(ClusterPushConstants)	//size
+	};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//setLayoutCount
+		&descriptorSetLayout,							//pSetLayouts
+		1,												//pushConstantRangeCount
+		&pushConstantRange								//pPushConstantRanges
+	};
+	pipelineLayout = _states.getPipelineLayout(pipelineLayoutInfo);
+
+	std::vector<char> code = ShaderCache::get().read(shader);
+	VkShaderModuleCreateInfo moduleInfo{
+		VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,		//sType
+		nullptr,											//pNext
+		0,													//flags
+		code.size(),										//codeSize
+		reinterpret_cast<const uint32_t*>(code.data())		//pCode
+	};
+	VkComputePipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		VkPipelineShaderStageCreateInfo {				//stage
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			nullptr,
+			0,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			_states.getShaderModule(moduleInfo),
+			"main",
+			nullptr
+		},
+		pipelineLayout,									//layout
+		VK_NULL_HANDLE,									//basePipelineHandle
+		-1												//basePipelineIndex
+	};
+	pipeline = _states.getComputePipeline(pipelineInfo);
+
+	return true;
+}
+
+void ClusteredLighting::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	binTimer.destroy();
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkUnmapMemory(device, lightMemory);
+	vkUnmapMemory(device, readbackMemory);
+	const std::pair<VkBuffer, VkDeviceMemory> buffers[] = {
+		{ lightBuffer, lightMemory },
+		{ clusterBuffer, clusterMemory },
+		{ indexBuffer, indexMemory },
+		{ counterBuffer, counterMemory },
+		{ readbackBuffer, readbackMemory }
+	};
+	for (const auto& [buffer, memory] : buffers)
+	{
+		vkDestroyBuffer(device, buffer, nullptr);
+		vkFreeMemory(device, memory, nullptr);
+	}
+	device = VK_NULL_HANDLE;
+}
+
+VkDescriptorSetLayout ClusteredLighting::getDescriptorSetLayout() const
+{
+	return descriptorSetLayout;
+}
+
+uint32_t ClusteredLighting::getPushConstantSize()
+{
+	return sizeof(ClusterFragmentPushConstants);
+}
+
+void ClusteredLighting::beginFrame(const PointLight* _lights, uint32_t _count, const glm::mat4& _viewProjection)
+{
+	frameSlot = (frameSlot + 1) % config.framesInFlight;
+	if (sliceRecorded[frameSlot])
+	{
+		const ClusterCounters& last = readbackMapped[frameSlot];
+		stats.binnedFrames++;
+		stats.lightIndices += std::min(last.indexCount, indexCapacity);
+		stats.overflowClusters += last.overflowClusters;
+		sliceRecorded[frameSlot] = false;
+	}
+	double gpuTime = 0.0;
+	if (timed && binTimer.read(gpuTime))
+	{
+		stats.gpuBinTimeTotal += gpuTime;
+		stats.gpuTimedFrames++;
+	}
+
+	lightCount = std::min(_count, config.maxLights);
+	std::memcpy(reinterpret_cast<uint8_t*>(lightMapped) + frameSlot * sliceSize, _lights, lightCount * sizeof(PointLight));
+	inverseViewProjection = glm::inverse(_viewProjection);
+
+	stats.frames++;
+	stats.lights += lightCount;
+	stats.droppedLights += _count - lightCount;
+}
+
+void ClusteredLighting::recordBinning(VkCommandBuffer _commandBuffer)
+{
+	//the last frame's fragments are done with the lists before they're rebuilt
+	VkMemoryBarrier barrier{
+		VK_STRUCTURE_TYPE_MEMORY_BARRIER,	//sType
+		nullptr,							//pNext
+		0,									//srcAccessMask
+		0									//dstAccessMask
+	};
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	if (timed)
+	{
+		binTimer.begin(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	}
+
+	vkCmdFillBuffer(_commandBuffer, counterBuffer, 0, VK_WHOLE_SIZE, 0);
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier,
+		0, nullptr, 0, nullptr);
+
+	ClusterPushConstants pushConstants{};
+	std::memcpy(pushConstants.inverseViewProjection, glm::value_ptr(inverseViewProjection), sizeof(pushConstants.inverseViewProjection));
+	pushConstants.lightCount = lightCount;
+	pushConstants.tilesX = config.grid.tilesX;
+	pushConstants.tilesY = config.grid.tilesY;
+	pushConstants.slices = config.grid.slices;
+	pushConstants.indexCapacity = indexCapacity;
+	pushConstants.maxClusterLights = config.maxClusterLights;
+
+	//one workgroup per cluster, the cost is clusters times lights however few of them overlap
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[frameSlot], 0, nullptr);
+	vkCmdPushConstants(_commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ClusterPushConstants), &pushConstants);
+	vkCmdDispatch(_commandBuffer, config.grid.tilesX, config.grid.tilesY, config.grid.slices);
+
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	if (timed)
+	{
+		binTimer.end(_commandBuffer);
+	}
+
+	VkBufferCopy copy{
+		0,									//srcOffset
+		frameSlot * sizeof(ClusterCounters),	//dstOffset
+		sizeof(ClusterCounters)				//size
+	};
+	vkCmdCopyBuffer(_commandBuffer, counterBuffer, readbackBuffer, 1, &copy);
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr,
+		0, nullptr);
+	sliceRecorded[frameSlot] = true;
+}
+
+void ClusteredLighting::bind(VkCommandBuffer _commandBuffer, VkPipelineLayout _layout, uint32_t _pushOffset, VkExtent2D _renderExtent)
+{
+	ClusterFragmentPushConstants pushConstants{
+		{																//tileScale
+			static_cast<float>(config.grid.tilesX) / _renderExtent.width,
+			static_cast<float>(config.grid.tilesY) / _renderExtent.height
+		},
+		config.grid.tilesX,												//tilesX
+		config.grid.tilesY,												//tilesY
+		config.grid.slices,												//slices
+		{ 0, 0, 0 }														//padding
+	};
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _layout, 0, 1, &descriptorSets[frameSlot], 0, nullptr);
+	vkCmdPushConstants(_commandBuffer, _layout, VK_SHADER_STAGE_FRAGMENT_BIT, _pushOffset, sizeof(ClusterFragmentPushConstants),
+		&pushConstants);
+}
+
+const ClusterGrid& ClusteredLighting::getGrid() const
+{
+	return config.grid;
+}
+
+const ClusterStats& ClusteredLighting::getStats() const
+{
+	return stats;
+}
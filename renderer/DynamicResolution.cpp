@@ -0,0 +1,648 @@
+#include <DynamicResolution.hpp>
+#include <vulkanUtils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+	//the scale aims this far below the budget, so ordinary variation doesn't push the next frame straight over it
+	constexpr double BudgetHeadroom = 0.9;
+	//it only grows while the average stays this far below the budget, and by at most MaxGrowStep at a time
+	constexpr double GrowThreshold = 0.75;
+	constexpr float MaxGrowStep = 0.05f;
+	constexpr uint32_t GrowCooldown = 30;		//frames after a drop before growing again
+	constexpr float ScaleStep = 1.0f / 64.0f;
+
+	//Matches the push constant block in upscale.frag
+	struct UpscalePushConstants {
+		float uvScale[2];
+		float texelSize[2];
+		float uvMin[2];
+		float uvMax[2];
+		float sharpness;
+		uint32_t sharpen;
+	};
+
+	uint32_t scaleAxis(uint32_t _size, float _scale)
+	{
+		uint32_t scaled = static_cast<uint32_t>(_size * _scale) / 8 * 8;
+		return std::max(scaled, std::min(_size, 8u));
+	}
+}
+
+const char* upscaleFilterName(UpscaleFilter _filter)
+{
+	switch (_filter)
+	{
+	case UpscaleFilter::Bilinear:
+		return "bilinear";
+	case UpscaleFilter::Sharpen:
+		return "sharpen";
+	}
+	return "unknown";
+}
+
+VkExtent2D scaledExtent(VkExtent2D _extent, float _scale)
+{
+	return VkExtent2D{ scaleAxis(_extent.width, _scale), scaleAxis(_extent.height, _scale) };
+}
+
+void ResolutionController::init(const DynamicResolutionConfig& _config)
+{
+	config = _config;
+	scale = config.maxScale;
+	averageTime = 0.0;
+	measured = false;
+	cooldown = 0;
+	changes = 0;
+}
+
+bool ResolutionController::update(double _gpuTime)
+{
+	if (_gpuTime <= 0.0)
+	{
+		return false;
+	}
+
+	if (!measured)
+	{
+		averageTime = _gpuTime;
+		measured = true;
+	}
+	else {
+		double weight = _gpuTime > averageTime ? 0.5 : 0.1;
+		averageTime += (_gpuTime - averageTime) * weight;
+	}
+	cooldown = cooldown > 0 ? cooldown - 1 : 0;
+
+	float ideal = static_cast<float>(scale * std::sqrt(config.frameBudget * BudgetHeadroom / averageTime));
+	float target = scale;
+	if (averageTime > config.frameBudget)
+	{
+		target = ideal;
+	}
+	else if (averageTime < config.frameBudget * GrowThreshold && cooldown == 0) {
+		target = std::min(ideal, scale + MaxGrowStep);
+	}
+	target = std::clamp(std::floor(target / ScaleStep) * ScaleStep, config.minScale, config.maxScale);
+	if (target == scale)
+	{
+		return false;
+	}
+
+	if (target < scale)
+	{
+		cooldown = GrowCooldown;
+	}
+	//the average was measured at the old scale, predict it for the new one instead of waiting for it to catch up
+	averageTime *= (target / scale) * (target / scale);
+	scale = target;
+	changes++;
+	return true;
+}
+
+float ResolutionController::getScale() const
+{
+	return scale;
+}
+
+double ResolutionController::getAverageTime() const
+{
+	return averageTime;
+}
+
+uint64_t ResolutionController::getChanges() const
+{
+	return changes;
+}
+
+bool GpuFrameTimer::init(VkDevice _device, VkPhysicalDevice _physicalDevice, uint32_t _queueFamily)
+{
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(_physicalDevice, &familyCount, families.data());
+	uint32_t validBits = _queueFamily < familyCount ? families[_queueFamily].timestampValidBits : 0;
+	if (validBits == 0)
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_physicalDevice, &properties);
+	nanosecondsPerTick = properties.limits.timestampPeriod;
+	validMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo queryPoolInfo{
+		VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0,											//flags
+		VK_QUERY_TYPE_TIMESTAMP,					//queryType
+		2,											//queryCount
+		0											//pipelineStatistics
+	};
+	if (vkCreateQueryPool(_device, &queryPoolInfo, nullptr, &queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Resolution]: Failed to create the timestamp query pool!");
+	}
+
+	device = _device;
+	written = false;
+	return true;
+}
+
+void GpuFrameTimer::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDestroyQueryPool(device, queryPool, nullptr);
+	queryPool = VK_NULL_HANDLE;
+	device = VK_NULL_HANDLE;
+}
+
+void GpuFrameTimer::begin(VkCommandBuffer _commandBuffer, VkPipelineStageFlagBits _stage)
+{
+	vkCmdResetQueryPool(_commandBuffer, queryPool, 0, 2);
+	vkCmdWriteTimestamp(_commandBuffer, _stage, queryPool, 0);
+}
+
+void GpuFrameTimer::end(VkCommandBuffer _commandBuffer)
+{
+	vkCmdWriteTimestamp(_commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, 1);
+	written = true;
+}
+
+bool GpuFrameTimer::read(double& _seconds)
+{
+	if (!written)
+	{
+		return false;
+	}
+
+	uint64_t timestamps[2];
+	if (vkGetQueryPoolResults(device, queryPool, 0, 2, sizeof(timestamps), timestamps, sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+	{
+		return false;
+	}
+	written = false;
+
+	uint64_t ticks = (timestamps[1] - timestamps[0]) & validMask;
+	_seconds = static_cast<double>(ticks) * nanosecondsPerTick * 1e-9;
+	return true;
+}
+
+bool Upscaler::init(VkDevice _device, const UpscalerConfig& _config)
+{
+	for (const char* shader : { "fullscreen.spv", "upscale.spv" })
+	{
+		if (!std::filesystem::exists(_config.shaderDir / shader))
+		{
+			std::cout << "[Resolution]: " << (_config.shaderDir / shader).string()
+				<< " not found (run res/shaders/compile.bat), rendering at the swapchain resolution.\n";
+			return false;
+		}
+	}
+
+	device = _device;
+	sourceExtent = _config.sourceExtent;
+	filter = _config.filter;
+	sharpness = std::clamp(_config.sharpness, 0.0f, 1.0f);
+
+	createRenderPass(_config.outputFormat);
+	createDescriptors();
+	createPipeline(_config.shaderDir);
+	addOutput(_config.outputExtent, _config.outputViews);
+
+	return true;
+}
+
+uint32_t Upscaler::addOutput(VkExtent2D _extent, const std::vector<VkImageView>& _views)
+{
+	createFramebuffers(outputs.emplace_back(), _extent, _views);
+	return static_cast<uint32_t>(outputs.size() - 1);
+}
+
+void Upscaler::setOutput(uint32_t _output, VkExtent2D _extent, const std::vector<VkImageView>& _views)
+{
+	Output& output = outputs.at(_output);
+	destroyFramebuffers(output);
+	createFramebuffers(output, _extent, _views);
+}
+
+void Upscaler::setSource(VkImageView _sourceView)
+{
+	VkDescriptorImageInfo sourceInfo{
+		sampler,									//sampler
+		_sourceView,								//imageView
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL	//imageLayout
+	};
+	VkWriteDescriptorSet write{
+		VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,		//sType
+		nullptr,									//pNext
+		descriptorSet,								//dstSet
+		0,											//dstBinding
+		0,											//dstArrayElement
+		1,											//descriptorCount
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+		&sourceInfo,								//pImageInfo
+		nullptr,									//pBufferInfo
+		nullptr										//pTexelBufferView
+	};
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+void Upscaler::createFramebuffers(Output& _output, VkExtent2D _extent, const std::vector<VkImageView>& _views)
+{
+	_output.extent = _extent;
+	_output.framebuffers.resize(_views.size());
+	for (size_t i = 0; i < _views.size(); ++i)
+	{
+		VkFramebufferCreateInfo framebufferInfo{
+			VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,	//sType
+			nullptr,									//pNext
+			0,											//flags
+			renderPass,									//renderPass
+			1,											//attachmentCount
+			&_views[i],									//pAttachments
+			_extent.width,								//width
+			_extent.height,								//height
+			1,											//layers
+		};
+		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &_output.framebuffers[i]) != VK_SUCCESS) {
+			throw std::runtime_error("[Resolution]: Failed to create the upscale framebuffers!");
+		}
+	}
+}
+
+void Upscaler::destroyFramebuffers(Output& _output)
+{
+	for (VkFramebuffer framebuffer : _output.framebuffers)
+	{
+		vkDestroyFramebuffer(device, framebuffer, nullptr);
+	}
+	_output.framebuffers.clear();
+}
+
+void Upscaler::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (Output& output : outputs)
+	{
+		destroyFramebuffers(output);
+	}
+	outputs.clear();
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	vkDestroySampler(device, sampler, nullptr);
+	vkDestroyRenderPass(device, renderPass, nullptr);
+	device = VK_NULL_HANDLE;
+}
+
+void Upscaler::createRenderPass(VkFormat _format)
+{
+	VkAttachmentDescription attachment{
+		0,									//flags
+		_format,							//format
+		VK_SAMPLE_COUNT_1_BIT,				//samples
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,	//loadOp -> the triangle covers every pixel
+		VK_ATTACHMENT_STORE_OP_STORE,		//storeOp
+		VK_ATTACHMENT_LOAD_OP_DONT_CARE,	//stencilLoadOp
+		VK_ATTACHMENT_STORE_OP_DONT_CARE,	//stencilStoreOp
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,	//initialLayout -> the frame graph transitions the image around the pass
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL	//finalLayout
+	};
+
+	VkAttachmentReference colorAttachmentReference{
+		0,											//attachment
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL	//layout
+	};
+
+	VkSubpassDescription subpass{
+		0,									//flags
+		VK_PIPELINE_BIND_POINT_GRAPHICS,	//pipelineBindPoint
+		0,									//inputAttachmentCount
+		nullptr,							//pInputAttachments
+		1,									//colorAttachmentCount
+		&colorAttachmentReference,			//pColorAttachments
+		nullptr,							//pResolveAttachments
+		nullptr,							//pDepthStencilAttachment
+		0,									//preserveAttachmentCount
+		nullptr,							//pPreserveAttachments
+	};
+
+	VkRenderPassCreateInfo renderPassInfo{
+		VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0,											//flags
+		1,											//attachmentCount
+		&attachment,								//pAttachments
+		1,											//subpassCount
+		&subpass,									//pSubpasses
+		0,											//dependencyCount
+		nullptr										//pDependencies
+	};
+	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+		throw std::runtime_error("[Resolution]: Failed to create the upscale render pass!");
+	}
+}
+
+void Upscaler::createDescriptors()
+{
+	//bilinear, the shader keeps its taps inside the rendered part itself
+	VkSamplerCreateInfo samplerInfo{
+		VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,		//sType
+		nullptr,									//pNext
+		0,											//flags
+		VK_FILTER_LINEAR,							//magFilter
+		VK_FILTER_LINEAR,							//minFilter
+		VK_SAMPLER_MIPMAP_MODE_NEAREST,				//mipmapMode
+		VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,		//addressModeU
+		VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,		//addressModeV
+		VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,		//addressModeW
+		0.0f,										//mipLodBias
+		VK_FALSE,									//anisotropyEnable
+		1.0f,										//maxAnisotropy
+		VK_FALSE,									//compareEnable
+		VK_COMPARE_OP_ALWAYS,						//compareOp
+		0.0f,										//minLod
+		0.0f,										//maxLod
+		VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK,			//borderColor
+		VK_FALSE									//unnormalizedCoordinates
+	};
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("[Resolution]: Failed to create the upscale sampler!");
+	}
+
+	VkDescriptorSetLayoutBinding binding{
+		0,											//binding -> scene color
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+		1,											//descriptorCount
+		VK_SHADER_STAGE_FRAGMENT_BIT,				//stageFlags
+		nullptr										//pImmutableSamplers
+	};
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		1,														//bindingCount
+		&binding												//pBindings
+	};
+	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("[Resolution]: Failed to create the upscale descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 };	//type, descriptorCount
+	VkDescriptorPoolCreateInfo descriptorPoolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//maxSets
+		1,												//poolSizeCount
+		&poolSize										//pPoolSizes
+	};
+	if (vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Resolution]: Failed to create the upscale descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo descriptorSetInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		descriptorPool,									//descriptorPool
+		1,												//descriptorSetCount
+		&descriptorSetLayout							//pSetLayouts
+	};
+	if (vkAllocateDescriptorSets(device, &descriptorSetInfo, &descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("[Resolution]: Failed to allocate the upscale descriptor set!");
+	}
+
+	VkPushConstantRange pushConstantRange{
+		VK_SHADER_STAGE_FRAGMENT_BIT,	//stageFlags
+		0,								//offset
+		sizeof(UpscalePushConstants)	//size
+	};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//setLayoutCount
+		&descriptorSetLayout,							//pSetLayouts
+		1,												//pushConstantRangeCount
+		&pushConstantRange								//pPushConstantRanges
+	};
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("[Resolution]: Failed to create the upscale pipeline layout!");
+	}
+}
+
+void Upscaler::createPipeline(const std::filesystem::path& _shaderDir)
+{
+	VkShaderModule vertModule = loadShaderModule(device, _shaderDir / "fullscreen.spv");
+	VkShaderModule fragModule = loadShaderModule(device, _shaderDir / "upscale.spv");
+
+	VkPipelineShaderStageCreateInfo shaderStages[2];
+	VkShaderStageFlagBits stageBits[2] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+	VkShaderModule modules[2] = { vertModule, fragModule };
+	for (int i = 0; i < 2; ++i)
+	{
+		shaderStages[i] = VkPipelineShaderStageCreateInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			stageBits[i],											//stage
+			modules[i],												//module
+			"main",													//pName
+			nullptr													//pSpecializationInfo
+		};
+	}
+
+	//the triangle comes from gl_VertexIndex, nothing is bound
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		0,															//vertexBindingDescriptionCount
+		nullptr,													//pVertexBindingDescriptions
+		0,															//vertexAttributeDescriptionCount
+		nullptr														//pVertexAttributeDescriptions
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,	//sType
+		nullptr,														//pNext
+		0,																//flags
+		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,							//topology
+		VK_FALSE														//primitiveRestartEnable
+	};
+
+	//outputs differ in extent, record() sets it
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		2,														//dynamicStateCount
+		dynamicStates											//pDynamicStates
+	};
+	VkPipelineViewportStateCreateInfo viewportStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		1,														//viewportCount
+		nullptr,												//pViewports
+		1,														//scissorCount
+		nullptr													//pScissors
+	};
+
+	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_FALSE,													//depthClampEnable
+		VK_FALSE,													//rasterizerDiscardEnable
+		VK_POLYGON_MODE_FILL,										//polygonMode
+		VK_CULL_MODE_NONE,											//cullMode
+		VK_FRONT_FACE_CLOCKWISE,									//frontFace
+		VK_FALSE,													//depthBiasEnable
+		0.0f,														//depthBiasConstantFactor
+		0.0f,														//depthBiasClamp
+		0.0f,														//depthBiasSlopeFactor
+		1.0f,														//lineWidth
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_SAMPLE_COUNT_1_BIT,										//rasterizationSamples
+		VK_FALSE,													//sampleShadingEnable
+		1.0f,														//minSampleShading
+		nullptr,													//pSampleMask
+		VK_FALSE,													//alphaToCoverageEnable
+		VK_FALSE,													//alphaToOneEnable
+	};
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{
+		VK_FALSE,								//blendEnable
+		VK_BLEND_FACTOR_ONE,					//srcColorBlendFactor
+		VK_BLEND_FACTOR_ZERO,					//dstColorBlendFactor
+		VK_BLEND_OP_ADD,						//colorBlendOp
+		VK_BLEND_FACTOR_ONE,					//srcAlphaBlendFactor
+		VK_BLEND_FACTOR_ZERO,					//dstAlphaBlendFactor
+		VK_BLEND_OP_ADD,						//alphaBlendOp
+		VK_COLOR_COMPONENT_R_BIT |				//colorWriteMask
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlendInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_FALSE,													//logicOpEnable
+		VK_LOGIC_OP_COPY,											//logicOp
+		1,															//attachmentCount
+		&colorBlendAttachment,										//pAttachments
+		{ 0.0f, 0.0f, 0.0f, 0.0f }									//blendConstants[4]
+	};
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,	//sType
+		nullptr,											//pNext
+		0,													//flags
+		2,													//stageCount
+		shaderStages,										//pStages
+		&vertexInputInfo,									//pVertexInputState
+		&inputAssemblyInfo,									//pInputAssemblyState
+		nullptr,											//pTessellationState
+		&viewportStateInfo,									//pViewportState
+		&rasterizationStateInfo,							//pRasterizationState
+		&multisampleInfo,									//pMultisampleState
+		nullptr,											//pDepthStencilState
+		&colorBlendInfo,									//pColorBlendState
+		&dynamicStateInfo,									//pDynamicState
+		pipelineLayout,										//layout
+		renderPass,											//renderPass
+		0,													//subpass
+		VK_NULL_HANDLE,										//basePipelineHandle
+		-1													//basePipelineIndex
+	};
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("[Resolution]: Failed to create the upscale pipeline!");
+	}
+
+	vkDestroyShaderModule(device, vertModule, nullptr);
+	vkDestroyShaderModule(device, fragModule, nullptr);
+}
+
+void Upscaler::record(VkCommandBuffer _commandBuffer, uint32_t _output, uint32_t _imageIndex, VkExtent2D _renderExtent)
+{
+	const Output& output = outputs[_output];
+	VkRenderPassBeginInfo renderPassBeginInfo{
+		VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,	//sType
+		nullptr,									//pNext
+		renderPass,									//renderPass
+		output.framebuffers[_imageIndex],			//framebuffer
+		VkRect2D {									//renderArea
+			VkOffset2D { 0, 0 },
+			output.extent
+		},
+		0,											//clearValueCount
+		nullptr										//pClearValues
+	};
+	vkCmdBeginRenderPass(_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+	VkViewport viewport{
+		0.0f,										//x
+		0.0f,										//y
+		static_cast<float>(output.extent.width),	//width
+		static_cast<float>(output.extent.height),	//height
+		0.0f,										//minDepth
+		1.0f										//maxDepth
+	};
+	VkRect2D scissor{
+		VkOffset2D {0, 0},	//offset
+		output.extent		//extent
+	};
+	vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+
+	//taps stay half a texel inside the rendered part, bilinear filtering would blend in stale texels past it
+	float width = static_cast<float>(sourceExtent.width);
+	float height = static_cast<float>(sourceExtent.height);
+	UpscalePushConstants pushConstants{
+		{ _renderExtent.width / width, _renderExtent.height / height },					//uvScale
+		{ 1.0f / width, 1.0f / height },												//texelSize
+		{ 0.5f / width, 0.5f / height },												//uvMin
+		{ (_renderExtent.width - 0.5f) / width, (_renderExtent.height - 0.5f) / height },	//uvMax
+		sharpness,																		//sharpness
+		filter == UpscaleFilter::Sharpen ? 1u : 0u										//sharpen
+	};
+
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(_commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(UpscalePushConstants), &pushConstants);
+	vkCmdDraw(_commandBuffer, 3, 1, 0, 0);
+
+	vkCmdEndRenderPass(_commandBuffer);
+}
+
+UpscaleFilter Upscaler::getFilter() const
+{
+	return filter;
+}
@@ -10,77 +10,663 @@
 
 #include <limits>		//std::numeric_limits
 #include <algorithm>	//std::clamp
+#include <cmath>
+#include <cstddef>		//offsetof
+#include <numeric>		//std::iota
+#include <iomanip>		//std::setw for the startup report
 
-#include <fstream>		//for reading the shaders
+#include <fstream>		//for the pipeline cache file
+
+#include <thread>
+#include <chrono>
+
+#include <glm/gtc/type_ptr.hpp>
 
 #include <debugUtils.hpp>
+#include <vulkanUtils.hpp>
+#include <ShaderCache.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+const char* PipelineCacheFile = "pipeline_cache.bin";	//next to the executable
+
+//Matches the push constant block in cull.comp
+struct CullPushConstants {
+	float planes[6][4];
+	uint32_t objectCount;
+	uint32_t phase;		//CullPhase
+};
+
+//Every cooked texture in res/textures, sorted so the scene texture doesn't depend on directory order
+static std::vector<std::filesystem::path> findTextures()
+{
+	std::vector<std::filesystem::path> textureFiles;
+	std::filesystem::path textureDir = utils::getExecutableDir() / "res/textures";
+	if (std::filesystem::is_directory(textureDir))
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(textureDir))
+		{
+			if (entry.path().extension() == ".ktx2")
+			{
+				textureFiles.push_back(entry.path());
+			}
+		}
+	}
+	std::sort(textureFiles.begin(), textureFiles.end());
+	return textureFiles;
+}
+
+Engine::Engine(const EngineConfig& _config)
+	: config(_config)
+{
+	if (config.updateRate <= 0.0)
+	{
+		throw std::invalid_argument("[Engine]: Update rate must be positive!");
+	}
+	if (config.renderRate < 0.0)
+	{
+		throw std::invalid_argument("[Engine]: Render rate can't be negative!");
+	}
+	if (config.lodPixelError <= 0.0f)
+	{
+		throw std::invalid_argument("[Engine]: LOD pixel error must be positive!");
+	}
+	if (config.minRenderScale <= 0.0f || config.minRenderScale > config.maxRenderScale || config.maxRenderScale > 2.0f)
+	{
+		throw std::invalid_argument("[Engine]: Render scales must satisfy 0 < min <= max <= 2!");
+	}
+	if (config.gpuFrameBudgetMs < 0.0)
+	{
+		throw std::invalid_argument("[Engine]: GPU frame budget can't be negative!");
+	}
+	if (config.pacerSpinMs < 0.0)
+	{
+		throw std::invalid_argument("[Engine]: Pacer spin time can't be negative!");
+	}
+	if (config.windowCount == 0)
+	{
+		throw std::invalid_argument("[Engine]: There has to be at least one window!");
+	}
+	lodConfig.maxPixelError = config.lodPixelError;
+
+	//Until there is a real scene: one object drawing the scene mesh, seen through an identity camera
+	const float identity[16] = {
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, 1.0f, 0.0f,
+		0.0f, 0.0f, 0.0f, 1.0f
+	};
+	cameraFrustum = Frustum::fromViewProjection(identity);
+	cameraViewProjection = glm::mat4(1.0f);
+	//without the y flip of a real projection, clockwise front faces are counter-clockwise in mesh space seen from +z,
+	//so meshlet cones are tested as if the camera looked down -z
+	cameraPosition = glm::vec4(0.0f, 0.0f, -1.0f, 0.0f);
+
+	meshObject = scene.createEntity();
+	scene.setBoundingRadius(meshObject, 0.75f);
+}
 
 void Engine::run()
 {
-	initWindow();
-	initVulkan();
+	initialize();
 	mainLoop();
 	cleanUp();
 }
 
-void Engine::initWindow()
+//Startup as a graph of stages. Loading that doesn't need a device (shaders, the pipeline cache) runs on the job system
+//from the start, the instance is created on a worker while the main thread opens the window, and pipelines compile
+//next to the swapchain setup. Everything else depends on what came before it, so it stays in its old order.
+//GLFW windows and their size are main thread only.
+void Engine::initialize()
 {
-	glfwInit();
-	glfwSetErrorCallback(glfwErrorCallback);
+	using Stage = StartupGraph::StageId;
+	const std::filesystem::path shaderDir = utils::getExecutableDir() / "res/shaders";
+
+	Stage glfwStage = startup.addStage("glfw init", []() { glfwInit(); glfwSetErrorCallback(glfwErrorCallback); }, StageThread::Main);
+	Stage windowStage = startup.addStage("window", [this]() { initWindow(); }, StageThread::Main);
+	Stage shaderStage = startup.addStage("shader loading", [this, shaderDir]() { preloadedShaders = ShaderCache::get().preload(jobs, shaderDir); });
+	Stage cacheLoadStage = startup.addStage("pipeline cache loading", [this]() { loadPipelineCacheData(); });
+	Stage instanceStage = startup.addStage("instance", [this]() { createInstance(); setupDebugMessenger(); });
+	Stage surfaceStage = startup.addStage("surface", [this]() { createSurface(); });
+	Stage physicalDeviceStage = startup.addStage("physical device", [this]() { pickPhysicalDevice(); });
+	Stage deviceStage = startup.addStage("logical device", [this]() { createLogicalDevice(); });
+	Stage cacheStage = startup.addStage("pipeline cache", [this]() { createPipelineCache(); });
+	Stage swapchainStage = startup.addStage("swapchain", [this]() { createSwapchain(); }, StageThread::Main);
+	Stage sceneTargetStage = startup.addStage("scene target", [this]() { createSceneTarget(); });
+	Stage depthStage = startup.addStage("depth format", [this]() { createDepthResources(); });
+	Stage renderPassStage = startup.addStage("render pass", [this]() { createRenderPass(); });
+	Stage graphicsStage = startup.addStage("graphics pipeline", [this]() { createGraphicsPipeline(); });
+	Stage computeStage = startup.addStage("compute pipeline", [this]() { createComputePipeline(); });
+	Stage framebufferStage = startup.addStage("framebuffers", [this]() { createFramebuffers(); });
+	Stage commandStage = startup.addStage("command buffers", [this]() { createCommandPool(); createCommandBuffer(); });
+	Stage syncStage = startup.addStage("sync objects", [this]() { createSyncObjects(); createFramePacer(); });
+	Stage meshStage = startup.addStage("meshes", [this]() { createMeshes(); });
+	Stage occlusionStage = startup.addStage("occlusion culler", [this]() { createOcclusionCuller(); });
+	Stage computeResourceStage = startup.addStage("compute resources", [this]() { createComputeResources(); });
+	Stage meshletStage = startup.addStage("meshlet renderer", [this]() { createMeshletRenderer(); });
+	Stage textureStage = startup.addStage("texture streamer", [this]() { createTextureStreamer(); });
+	Stage frameGraphStage = startup.addStage("frame graph", [this]() { createFrameGraph(); });
+	Stage instancingStage = startup.addStage("instance renderer", [this]() { createInstanceRenderer(); });
+	Stage particleStage = startup.addStage("particle system", [this]() { createParticleSystem(); });
+	Stage lightingStage = startup.addStage("clustered lighting", [this]() { createClusteredLighting(); });
+	Stage outputStage = startup.addStage("output windows", [this]() { createOutputs(); }, StageThread::Main);
+
+	const std::pair<Stage, Stage> dependencies[] = {
+		{ glfwStage, windowStage },
+		{ glfwStage, instanceStage },		//only needs the extensions GLFW asks for
+		{ windowStage, surfaceStage },
+		{ instanceStage, surfaceStage },
+		{ surfaceStage, physicalDeviceStage },
+		{ physicalDeviceStage, deviceStage },
+		{ deviceStage, cacheStage },
+		{ cacheLoadStage, cacheStage },
+		{ deviceStage, swapchainStage },
+		{ swapchainStage, sceneTargetStage },
+		{ shaderStage, sceneTargetStage },	//the upscaler's pipeline
+		{ sceneTargetStage, depthStage },
+		{ depthStage, renderPassStage },
+		{ cacheStage, renderPassStage },	//render passes come from the state cache
+		{ renderPassStage, graphicsStage },
+		{ shaderStage, lightingStage },
+		{ cacheStage, lightingStage },
+		{ lightingStage, graphicsStage },	//the mesh pipeline shades with the clusters when there are lights
+		{ shaderStage, graphicsStage },
+		{ cacheStage, graphicsStage },
+		//culling only needs the device, it may turn GPU culling off, which everything from the command buffers on reads
+		{ shaderStage, computeStage },
+		{ cacheStage, computeStage },
+		{ graphicsStage, commandStage },
+		{ computeStage, commandStage },
+		{ commandStage, syncStage },
+		{ syncStage, meshStage },
+		{ meshStage, occlusionStage },
+		{ occlusionStage, computeResourceStage },
+		{ computeResourceStage, meshletStage },
+		{ meshletStage, textureStage },
+		{ textureStage, frameGraphStage },
+		{ meshStage, instancingStage },		//materials link against the render pass like the mesh pipeline
+		{ graphicsStage, particleStage },
+		{ particleStage, frameGraphStage },	//adds its simulation pass when there are particles
+		{ sceneTargetStage, outputStage },	//upscaled from the scene target, if there is one
+		{ outputStage, frameGraphStage },	//adds an upscale pass for each
+		{ frameGraphStage, framebufferStage }	//depth and the scene color are graph transients
+	};
+	for (const auto& [before, after] : dependencies)
+	{
+		startup.addDependency(before, after);
+	}
+
+	startup.execute(jobs);
+	//every pipeline has been created
+	ShaderCache::get().clear();
+}
 
+void Engine::initWindow()
+{
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
 
 	window = glfwCreateWindow(WIDTH, HEIGHT, "HAHAHA", nullptr, nullptr);
 }
 
-void Engine::initVulkan()
+const EngineStats& Engine::getStats() const
 {
-	createInstance();
-	setupDebugMessenger();
-	createSurface();
-	pickPhysicalDevice();
-	createLogicalDevice();
-	createSwapchain();
-	createRenderPass();
-	createGraphicsPipeline();
-	createFramebuffers();
-	createCommandPool();
-	createCommandBuffer();
-	createSyncObjects();
+	return stats;
 }
 
 void Engine::mainLoop()
 {
-	while (!glfwWindowShouldClose(window))
+	running = true;
+	lastInputPoll = Clock::now().time_since_epoch().count();
+	std::thread updateThread(&Engine::updateLoop, this);
+	std::thread renderThread(&Engine::renderLoop, this);
+
+	//GLFW only allows polling on the main thread, so input stays here while simulation and rendering run on their own
+	bool startupReported = false;
+	auto outputClosed = [this]()
+	{
+		return std::any_of(outputs.begin(), outputs.end(), [](const OutputTarget& _output) { return _output.shouldClose(); });
+	};
+	while (running && !glfwWindowShouldClose(window) && !outputClosed())
 	{
-		glfwPollEvents();
-		drawFrame();
+		//wakes immediately on input, the timeout only bounds how late we notice the other threads stopping
+		glfwWaitEventsTimeout(0.01);
+		lastInputPoll = Clock::now().time_since_epoch().count();
+		//the render thread sizes recreated swapchains from this, it can't ask GLFW itself
+		for (OutputTarget& output : outputs)
+		{
+			output.pollFramebufferSize();
+		}
+
+		if (config.startupReport && !startupReported && firstFramePresented.load(std::memory_order_acquire))
+		{
+			printStartupReport();
+			startupReported = true;
+		}
 	}
 
+	running = false;
+	updateThread.join();
+	renderThread.join();
+
 	vkDeviceWaitIdle(device);
+
+	if (updateError)
+	{
+		std::rethrow_exception(updateError);
+	}
+	if (renderError)
+	{
+		std::rethrow_exception(renderError);
+	}
+
+	printStats();
+}
+
+//Steps the simulation at a fixed rate and publishes a snapshot after every step.
+void Engine::updateLoop()
+{
+	try {
+		const double deltaTime = 1.0 / config.updateRate;
+		const Clock::duration stepInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(deltaTime));
+		Clock::time_point nextStep = Clock::now();
+
+		while (running)
+		{
+			updateSimulation(deltaTime);
+
+			Clock::time_point copyStart = Clock::now();
+			writeSnapshot(sceneSnapshots.writeSlot());
+			sceneSnapshots.publish();
+			double copyTime = std::chrono::duration<double>(Clock::now() - copyStart).count();
+
+			stats.simulationSteps++;
+			stats.snapshotCopyTotal += copyTime;
+			stats.snapshotCopyMax = std::max(stats.snapshotCopyMax, copyTime);
+
+			nextStep += stepInterval;
+			//if we fell behind, don't try to catch up with a burst of steps
+			if (nextStep < Clock::now())
+			{
+				nextStep = Clock::now();
+			}
+			std::this_thread::sleep_until(nextStep);
+		}
+	} catch (...) {
+		updateError = std::current_exception();
+		running = false;
+	}
+}
+
+//Draws the newest snapshot whenever the frame pacer lets a frame start.
+void Engine::renderLoop()
+{
+	try {
+		while (running)
+		{
+			//waiting before taking the snapshot rather than after presenting, so the frame shows the newest input
+			pacer.waitForFrameStart();
+			if (!sceneSnapshots.acquire())
+			{
+				stats.staleFrames++;
+			}
+
+			drawFrame(sceneSnapshots.readSlot());
+			stats.framesRendered++;
+		}
+	} catch (...) {
+		renderError = std::current_exception();
+		running = false;
+	}
+}
+
+void Engine::updateSimulation(double _deltaTime)
+{
+	simulationTick++;
+	simulationTime += _deltaTime;
+
+	scene.updateTransforms(&jobs);
+}
+
+//Copies everything the render thread needs out of the live simulation state.
+void Engine::writeSnapshot(SceneSnapshot& _snapshot)
+{
+	_snapshot.tick = simulationTick;
+	_snapshot.simulationTime = simulationTime;
+	_snapshot.inputTime = Clock::time_point(Clock::duration(lastInputPoll.load()));
+	_snapshot.cameraFrustum = cameraFrustum;
+	_snapshot.cameraPosition = cameraPosition;
+	_snapshot.cameraViewProjection = cameraViewProjection;
+	scene.gatherBounds(_snapshot.objectBounds);
+	_snapshot.objectTransforms = scene.getWorldMatrices();
+}
+
+void Engine::printStats()
+{
+	double averageCopy = stats.simulationSteps > 0 ? stats.snapshotCopyTotal / stats.simulationSteps : 0.0;
+
+	std::cout << "[Stats]: Simulation steps: " << stats.simulationSteps
+		<< ", Frames rendered: " << stats.framesRendered
+		<< " (" << stats.staleFrames << " without a new snapshot)\n";
+	std::cout << "[Stats]: Snapshot copy: avg " << averageCopy * 1e6 << " us, max "
+		<< stats.snapshotCopyMax * 1e6 << " us\n";
+
+	const TextureStreamingStats& streaming = textures.getStats();
+	std::cout << "[Stats]: Textures: " << (streaming.residentBytes >> 20) << " MiB resident of "
+		<< (streaming.budgetBytes >> 20) << " MiB budget (" << (streaming.requestedBytes >> 20) << " MiB requested), "
+		<< streaming.mipsStreamedIn << " mips streamed in (" << (streaming.bytesUploaded >> 20) << " MiB), "
+		<< streaming.mipsEvicted << " evicted, " << streaming.mipsGenerated << " generated, " << streaming.mipsRead << " read on jobs\n";
+	if (sceneTextured)
+	{
+		std::cout << "[Stats]: Scene texture: mip " << textures.getResidentMip(sceneTexture) << " resident\n";
+	}
+	std::cout << "[Stats]: Texture barriers: " << streaming.barriersRecorded << " recorded, "
+		<< streaming.transitionsElided << " redundant transitions elided\n";
+
+	const MeshStats& meshStats = meshes.getStats();
+	std::cout << "[Stats]: Meshes: " << meshStats.meshes << " (" << meshStats.triangles << " triangles, " << meshStats.meshlets
+		<< " meshlets), " << (meshStats.vertexBytes >> 10) << " KiB vertices, " << (meshStats.indexBytes >> 10) << " KiB indices, "
+		<< (meshStats.meshletBytes >> 10) << " KiB meshlets\n";
+	if (meshletCulling)
+	{
+		uint64_t perFrame = stats.framesRendered > 0 ? meshletRenderer.getMeshletsSubmitted() / stats.framesRendered : 0;
+		std::cout << "[Stats]: Meshlet culling (" << meshletPathName(meshletRenderer.getPath()) << "): " << perFrame
+			<< " meshlets tested per frame\n";
+	}
+	if (stats.framesRendered > 0)
+	{
+		std::cout << "[Stats]: Culling" << (occlusionCulling ? " (two phase Hi-Z)" : "") << ": "
+			<< stats.objectsSubmitted / stats.framesRendered << " objects per frame, "
+			<< stats.objectsFrustumCulled / stats.framesRendered << " outside the frustum, "
+			<< stats.objectsOcclusionCulled / stats.framesRendered << " occluded\n";
+		if (dynamicResolution)
+		{
+			double averageGpuTime = stats.gpuTimedFrames > 0 ? stats.gpuTimeTotal / stats.gpuTimedFrames : 0.0;
+			std::cout << "[Stats]: Dynamic resolution (" << upscaleFilterName(upscaler.getFilter()) << " upscale): avg scale "
+				<< stats.renderScaleTotal / stats.framesRendered << ", min " << stats.renderScaleMin << ", "
+				<< resolution.getChanges() << " changes, avg GPU time " << averageGpuTime * 1e3 << " ms\n";
+		}
+		double lodShare = stats.fullDetailTriangles > 0 ? 100.0 * stats.lodTriangles / stats.fullDetailTriangles : 100.0;
+		std::cout << "[Stats]: LOD (" << lodConfig.maxPixelError << " px error): " << stats.lodTriangles / stats.framesRendered
+			<< " of " << stats.fullDetailTriangles / stats.framesRendered << " triangles per frame (" << lodShare << "%), "
+			<< lodSelector.getSwitches() << " level switches\n";
+	}
+
+	const FramePacingStats& pacing = pacer.getStats();
+	if (pacing.presents > 0)
+	{
+		std::cout << "[Stats]: Presentation (" << presentModeName(presentMode) << ", " << swapchainImages.size() << " images): "
+			<< "input to present avg " << pacing.inputToPresentTotal / pacing.presents * 1e3 << " ms, max "
+			<< pacing.inputToPresentMax * 1e3 << " ms";
+		if (pacing.framesDisplayed > 0)
+		{
+			std::cout << ", to display avg " << pacing.inputToDisplayTotal / pacing.framesDisplayed * 1e3 << " ms, max "
+				<< pacing.inputToDisplayMax * 1e3 << " ms";
+		}
+		std::cout << ", paced " << pacing.waitTotal / pacing.presents * 1e3 << " ms per frame\n";
+	}
+	if (!outputs.empty())
+	{
+		size_t retiredOutputs = std::count_if(outputs.begin(), outputs.end(), [](const OutputTarget& _output) { return _output.isRetired(); });
+		std::cout << "[Stats]: Outputs: " << outputs.size() + 1 << " windows in one submit and one present per frame, "
+			<< stats.outputPresentsFailed << " frames of further windows skipped or not presented cleanly, "
+			<< retiredOutputs << " windows lost\n";
+	}
+
+	PipelineStateCacheStats states = stateCache.getStats();
+	std::cout << "[Stats]: Pipeline states: " << states.pipelines << " pipelines, " << states.renderPasses << " render passes, "
+		<< states.pipelineLayouts + states.descriptorSetLayouts << " layouts, " << states.samplers << " samplers, "
+		<< states.shaderModules << " shader modules, " << states.hits << " of " << states.lookups << " lookups hit\n";
+
+	PipelineCompilerStats compiles = pipelineCompiler.getStats();
+	std::cout << "[Stats]: Pipeline compiles (" << pipelineCompileModeName(pipelineCompiler.getMode()) << "): "
+		<< compiles.requested << " pipelines";
+	if (compiles.fastLinks > 0)
+	{
+		std::cout << ", fast link avg " << compiles.fastLinkTotal / compiles.fastLinks * 1e3 << " ms, max "
+			<< compiles.fastLinkMax * 1e3 << " ms, " << compiles.optimizedLinks << " optimized";
+	}
+	std::cout << ", " << compiles.backgroundTotal * 1e3 << " ms in the background\n";
+
+	const InstanceStats& instanceStats = instances.getStats();
+	if (instanceStats.frames > 0)
+	{
+		double recordTime = instanceStats.recordTotal / instanceStats.frames;
+		std::cout << "[Stats]: Instancing (" << (instances.getDrawPerInstance() ? "one draw each" : "grouped") << "): "
+			<< instanceStats.instances / instanceStats.frames << " instances in " << instanceStats.draws / instanceStats.frames
+			<< " draws per frame, " << recordTime * 1e3 << " ms packing and recording, "
+			<< (recordTime > 0.0 ? instanceStats.draws / instanceStats.recordTotal : 0.0) << " draws per second recorded";
+		if (instanceStats.dropped > 0 || instanceStats.skippedDraws > 0)
+		{
+			std::cout << ", " << instanceStats.dropped << " dropped, " << instanceStats.skippedDraws << " draws skipped while compiling";
+		}
+		if (instanceStats.skippedPushes > 0)
+		{
+			std::cout << ", " << instanceStats.skippedPushes << " of " << instanceStats.pushes + instanceStats.skippedPushes
+				<< " push constant updates left out";
+		}
+		std::cout << "\n";
+	}
+
+	const ParticleStats& particleStats = particles.getStats();
+	if (particleStats.frames > 0)
+	{
+		double emittedShare = particleStats.emitRequested > 0 ? 100.0 * particleStats.emitted / particleStats.emitRequested : 100.0;
+		std::cout << "[Stats]: Particles (" << (particles.isSorted() ? "sorted" : "unsorted") << "): avg "
+			<< particleStats.aliveTotal / particleStats.frames << " alive, max " << particleStats.aliveMax << " of "
+			<< particles.getCapacity() << ", " << emittedShare << "% of emits found a free particle, "
+			<< particleStats.recordTotal / particleStats.frames * 1e6 << " us CPU per frame\n";
+	}
+
+	const ClusterStats& lightStats = lighting.getStats();
+	if (lightStats.frames > 0)
+	{
+		const ClusterGrid& grid = lighting.getGrid();
+		double perCluster = lightStats.binnedFrames > 0 ? static_cast<double>(lightStats.lightIndices) / lightStats.binnedFrames / grid.count() : 0.0;
+		std::cout << "[Stats]: Clustered lighting (" << grid.tilesX << "x" << grid.tilesY << "x" << grid.slices << "): "
+			<< lightStats.lights / lightStats.frames << " lights, avg " << perCluster << " per cluster, "
+			<< lightStats.overflowClusters << " cluster lists overflowed";
+		if (lightStats.gpuTimedFrames > 0)
+		{
+			std::cout << ", binning " << lightStats.gpuBinTimeTotal / lightStats.gpuTimedFrames * 1e3 << " ms GPU";
+		}
+		if (shadingTimedFrames > 0)
+		{
+			std::cout << ", main pass " << shadingTimeTotal / shadingTimedFrames * 1e3 << " ms GPU";
+		}
+		std::cout << "\n";
+	}
+
+	const AssetStats& assets = textureLoader.getStats();
+	VkDeviceSize saved = assets.rgba8Bytes > assets.textureBytes ? assets.rgba8Bytes - assets.textureBytes : 0;
+	std::cout << "[Stats]: Assets: " << assets.texturesLoaded << " textures (" << assets.texturesDecoded << " decoded on the CPU), "
+		<< (assets.textureBytes >> 10) << " KiB vs " << (assets.rgba8Bytes >> 10) << " KiB as RGBA8, "
+		<< (saved >> 10) << " KiB saved\n";
+}
+
+//Stages in the order they started, with the thread they ran on. Stages running in parallel overlap, so the time
+//summed over them is more than the wall time.
+void Engine::printStartupReport()
+{
+	std::vector<StartupGraph::StageId> order(startup.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [this](StartupGraph::StageId _a, StartupGraph::StageId _b)
+	{
+		return startup.getTiming(_a).start < startup.getTiming(_b).start;
+	});
+
+	std::ios::fmtflags flags = std::cout.flags();
+	std::streamsize precision = std::cout.precision();
+	std::cout << std::fixed << std::setprecision(1);
+
+	double stageTotal = 0.0;
+	std::cout << "[Startup]:   start (ms)  took (ms)  thread  stage\n";
+	for (StartupGraph::StageId id : order)
+	{
+		const StageTiming& timing = startup.getTiming(id);
+		stageTotal += timing.duration;
+		std::cout << "[Startup]: " << std::setw(10) << timing.start * 1e3 << std::setw(11) << timing.duration * 1e3 << "  "
+			<< (startup.getThread(id) == StageThread::Main ? "main  " : "worker") << "  " << startup.getName(id) << "\n";
+	}
+	std::cout << "[Startup]: Initialization took " << startup.getTotalTime() * 1e3 << " ms (" << stageTotal * 1e3
+		<< " ms of stages), " << preloadedShaders << " shaders preloaded, " << (pipelineCacheLoadedBytes >> 10)
+		<< " KiB pipeline cache loaded\n";
+	std::cout << "[Startup]: First frame presented after " << timeToFirstFrame * 1e3 << " ms\n";
+
+	std::cout.flags(flags);
+	std::cout.precision(precision);
 }
 
-void Engine::drawFrame()
+void Engine::drawFrame(const SceneSnapshot& _snapshot)
 {
+	//graphics waits on the compute semaphore, so this fence also covers last frame's compute work
 	vkWaitForFences(device, 1, &inFlightFence, VK_TRUE, UINT32_MAX);
 	vkResetFences(device, 1, &inFlightFence);
 
+	renderExtent = swapchainImageExtent;
+	if (dynamicResolution)
+	{
+		//the timestamps were also written by the frame the fence just covered
+		double gpuTime = 0.0;
+		if (frameTimer.read(gpuTime))
+		{
+			resolution.update(gpuTime);
+			stats.gpuTimeTotal += gpuTime;
+			stats.gpuTimedFrames++;
+		}
+		float scale = resolution.getScale();
+		renderExtent = scaledExtent(swapchainImageExtent, scale);
+		stats.renderScaleTotal += scale;
+		stats.renderScaleMin = stats.framesRendered == 0 ? scale : std::min(stats.renderScaleMin, scale);
+	}
+
+	if (gpuCulling)
+	{
+		//the counters were written by the frame the fence just covered
+		OcclusionCounters counters = occlusion.takeCounters();
+		stats.objectsFrustumCulled += counters.frustumCulled;
+		stats.objectsOcclusionCulled += counters.occlusionCulled;
+	}
+
+	//last frame is done sampling, so evicted images can go and the new uploads land ahead of this frame's submit.
+	//Demand comes from this frame's objects at the extent they're rendered at.
+	if (sceneTextured)
+	{
+		requestSceneTexture(_snapshot);
+	}
+	textures.update();
+	if (sceneTextured && textures.getImageView(sceneTexture) != sceneTextureView)
+	{
+		updateSceneTextureSet();
+	}
+
+	//task shaders cull meshlets within the graphics submit, every other GPU path culls in a compute submit
+	bool meshShaderCulling = meshletCulling && meshletRenderer.getPath() == MeshletRenderer::Path::MeshShader;
+	bool computeCulling = gpuCulling && !meshShaderCulling;
+	selectLods(_snapshot);
+	frameViewProjection = _snapshot.cameraViewProjection;
+	capturingFrame = !config.capturePath.empty() && !captureWritten && stats.framesRendered >= config.captureFrame;
+	if (instanceRendering)
+	{
+		updateMarkers(_snapshot);
+	}
+	if (particleRendering)
+	{
+		//particles move with simulated time, stale frames don't advance them
+		float deltaTime = static_cast<float>(std::clamp(_snapshot.simulationTime - particleTime, 0.0, 0.1));
+		particleTime = _snapshot.simulationTime;
+		particles.beginFrame(deltaTime, _snapshot.cameraPosition);
+	}
+	if (clusteredLighting)
+	{
+		double shadingTime = 0.0;
+		if (shadingTimed && shadingTimer.read(shadingTime))
+		{
+			shadingTimeTotal += shadingTime;
+			shadingTimedFrames++;
+		}
+		updateLights(_snapshot);
+	}
+	if (gpuCulling)
+	{
+		uploadObjectBounds(_snapshot);
+		occlusion.beginFrame(_snapshot.cameraViewProjection, static_cast<float>(renderExtent.width) / sceneExtent.width,
+			static_cast<float>(renderExtent.height) / sceneExtent.height);
+		frameFrustum = _snapshot.cameraFrustum;
+		stats.objectsSubmitted += gpuObjectCount;
+		if (meshletCulling)
+		{
+			meshletRenderer.setFrame(_snapshot.cameraFrustum, glm::value_ptr(_snapshot.cameraPosition), gpuObjectCount);
+		}
+	}
+
+	if (computeCulling)
+	{
+		//submitted before acquiring so culling runs while we wait for a swapchain image
+		vkResetCommandBuffer(computeCommandBuffer, 0);
+		recordComputeCommandBuffer(computeCommandBuffer, _snapshot);
+
+		VkSubmitInfo computeSubmitInfo{
+			VK_STRUCTURE_TYPE_SUBMIT_INFO,	//sType
+			nullptr,						//pNext
+			0,								//waitSemaphoreCount
+			nullptr,						//pWaitSemaphores
+			nullptr,						//pWaitDstStageMask
+			1,								//commandBufferCount
+			&computeCommandBuffer,			//pCommandBuffers
+			1,								//signalSemaphoreCount
+			&computeFinishedSemaphore		//pSignalSemaphores
+		};
+		if (vkQueueSubmit(computeQueue, 1, &computeSubmitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+			throw std::runtime_error("[VK_Queue]: Could not submit command buffer to the compute queue!");
+		}
+	}
+	else if (!gpuCulling) {
+		cullSpheres(_snapshot.objectBounds, _snapshot.cameraFrustum, visibleObjects);
+		stats.objectsSubmitted += _snapshot.objectBounds.size();
+		stats.objectsFrustumCulled += _snapshot.objectBounds.size() - visibleObjects.size();
+	}
+
 	uint32_t imageIndex = 0;
 	vkAcquireNextImageKHR(device, swapchain, UINT32_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	//a further window's semaphore that isn't going to be signaled would hang the submit waiting on it, so a window
+	//that's minimized, out of date or gone sits the frame out instead: no wait, no upscale pass, no present
+	for (OutputTarget& output : outputs)
+	{
+		output.acquire();
+		if (!output.isAcquired())
+		{
+			stats.outputPresentsFailed++;
+		}
+	}
 
 	vkResetCommandBuffer(commandBuffer, 0);
 	recordCommandBuffer(commandBuffer, imageIndex);
 
-	VkSemaphore waitSemaphores[] = { imageAvailableSemaphore };
+	//only the indirect draws depend on compute, everything before DRAW_INDIRECT can overlap with it. Every window's
+	//image is waited for in the one submit, the upscale passes writing them run at COLOR_ATTACHMENT_OUTPUT.
+	frameWaitSemaphores.assign({ imageAvailableSemaphore });
+	frameWaitStages.assign({ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT });
+	if (computeCulling)
+	{
+		frameWaitSemaphores.push_back(computeFinishedSemaphore);
+		frameWaitStages.push_back(VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+	}
+	for (const OutputTarget& output : outputs)
+	{
+		if (output.isAcquired())
+		{
+			frameWaitSemaphores.push_back(output.getImageAvailableSemaphore());
+			frameWaitStages.push_back(VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+		}
+	}
 	VkSemaphore signalSemaphores[] = { renderFinishedSemaphore };
-	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 	VkSubmitInfo submitInfo{
 		VK_STRUCTURE_TYPE_SUBMIT_INFO,	//sType
 		nullptr,						//pNext
-		1,								//waitSemaphoreCount
-		waitSemaphores,					//pWaitSemaphores
-		waitStages,						//pWaitDstStageMask
+		static_cast<uint32_t>(frameWaitSemaphores.size()),	//waitSemaphoreCount
+		frameWaitSemaphores.data(),		//pWaitSemaphores
+		frameWaitStages.data(),			//pWaitDstStageMask
 		1,								//commandBufferCount
 		&commandBuffer,					//pCommandBuffers
 		1,								//signalSemaphoreCount
@@ -89,19 +675,72 @@ void Engine::drawFrame()
 	if (vkQueueSubmit(graphicsQueue, 1, &submitInfo, inFlightFence) != VK_SUCCESS) {
 		throw std::runtime_error("[VK_Queue]: Could not submit command buffer to the graphics queue!");
 	}
+	if (capturingFrame)
+	{
+		capture.write(config.capturePath, renderExtent, swapchainImageFormat, depthFormat, stats.framesRendered);
+		std::cout << "[Capture]: Wrote frame " << stats.framesRendered << " to " << config.capturePath.string() << " ("
+			<< capture.getCommandCount() << " commands), replay it with renderer_replay\n";
+		capturingFrame = false;
+		captureWritten = true;
+	}
 
-	VkSwapchainKHR swapchains[] = { swapchain };
+	//one present for every window, the pacer only waits on the main window's ids but every swapchain needs one
+	frameSwapchains.assign({ swapchain });
+	frameImageIndices.assign({ imageIndex });
+	framePresentOutputs.clear();
+	for (uint32_t i = 0; i < outputs.size(); ++i)
+	{
+		if (outputs[i].isAcquired())
+		{
+			frameSwapchains.push_back(outputs[i].getSwapchain());
+			frameImageIndices.push_back(outputs[i].getImageIndex());
+			framePresentOutputs.push_back(i);
+		}
+	}
+	uint32_t swapchainCount = static_cast<uint32_t>(frameSwapchains.size());
+	uint64_t presentId = pacer.nextPresentId();
+	framePresentIds.assign(swapchainCount, presentId);
+	framePresentResults.assign(swapchainCount, VK_SUCCESS);
+	VkPresentIdKHR presentIdInfo{
+		VK_STRUCTURE_TYPE_PRESENT_ID_KHR,	//sType
+		nullptr,							//pNext
+		swapchainCount,						//swapchainCount
+		framePresentIds.data()				//pPresentIds
+	};
 	VkPresentInfoKHR presentInfo{
 		VK_STRUCTURE_TYPE_PRESENT_INFO_KHR, //sType
-		nullptr,							//pNext
+		presentId != 0 ? &presentIdInfo : nullptr,	//pNext
 		1,									//waitSemaphoreCount
 		signalSemaphores,					//pWaitSemaphores
-		1,									//swapchainCount
-		swapchains,							//pSwapchains
-		&imageIndex,						//pImageIndices
-		nullptr 							//pResults
+		swapchainCount,						//swapchainCount
+		frameSwapchains.data(),				//pSwapchains
+		frameImageIndices.data(),			//pImageIndices
+		outputs.empty() ? nullptr : framePresentResults.data()	//pResults
 	};
 	vkQueuePresentKHR(graphicsQueue, &presentInfo);
+	pacer.presented(_snapshot.inputTime);
+	for (uint32_t i = 1; i < swapchainCount; ++i)
+	{
+		outputs[framePresentOutputs[i - 1]].presented(framePresentResults[i]);
+		if (framePresentResults[i] != VK_SUCCESS)
+		{
+			stats.outputPresentsFailed++;
+		}
+	}
+	//out of date or suboptimal windows get new swapchains, minimized ones stay skipped until they have an area again
+	for (uint32_t i = 0; i < outputs.size(); ++i)
+	{
+		if (outputs[i].isStale() && outputs[i].recreate())
+		{
+			upscaler.setOutput(i + 1, outputs[i].getExtent(), outputs[i].getImageViews());
+		}
+	}
+
+	if (stats.framesRendered == 0)
+	{
+		timeToFirstFrame = std::chrono::duration<double>(Clock::now() - startup.getStartTime()).count();
+		firstFramePresented.store(true, std::memory_order_release);
+	}
 
 }
 
@@ -111,15 +750,52 @@ void Engine::cleanUp()
 	vkDestroySemaphore(device, renderFinishedSemaphore, nullptr);
 	vkDestroyFence(device, inFlightFence, nullptr);
 
+	frameGraph.destroy();
+	vkDestroyDescriptorPool(device, sceneTexturePool, nullptr);
+	textures.destroy();
+	meshletRenderer.destroy();
+	occlusion.destroy();
+	instances.destroy();
+	particles.destroy();
+	lighting.destroy();
+	shadingTimer.destroy();
+	meshes.destroy();
+
+	vkDestroySemaphore(device, computeFinishedSemaphore, nullptr);
+	vkDestroyCommandPool(device, computeCommandPool, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	if (objectBoundsMapped)
+	{
+		vkUnmapMemory(device, objectBoundsMemory);
+	}
+	vkDestroyBuffer(device, objectBoundsBuffer, nullptr);
+	vkFreeMemory(device, objectBoundsMemory, nullptr);
+	if (objectLodMapped)
+	{
+		vkUnmapMemory(device, objectLodMemory);
+	}
+	vkDestroyBuffer(device, objectLodBuffer, nullptr);
+	vkFreeMemory(device, objectLodMemory, nullptr);
+	vkDestroyBuffer(device, drawCommandBuffer, nullptr);
+	vkFreeMemory(device, drawCommandMemory, nullptr);
+
 	vkDestroyCommandPool(device, commandPool, nullptr);
 	for (VkFramebuffer& framebuffer : swapchainFramebuffers)
 	{
 		vkDestroyFramebuffer(device, framebuffer, nullptr);
 	}
 
-	vkDestroyPipeline(device, graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
-	vkDestroyRenderPass(device, renderPass, nullptr);
+	pipelineCompiler.destroy();
+	stateCache.destroy();
+
+	upscaler.destroy();
+	frameTimer.destroy();
+	vkDestroyFramebuffer(device, sceneFramebuffer, nullptr);
+
+	for (OutputTarget& output : outputs)
+	{
+		output.destroy();
+	}
 
 	for (VkImageView& imageView : swapchainImageViews)
 	{
@@ -128,6 +804,9 @@ void Engine::cleanUp()
 
 	vkDestroySwapchainKHR(device, swapchain, nullptr);
 	vkDestroySurfaceKHR(instance, surface, nullptr);
+
+	savePipelineCache();
+	vkDestroyPipelineCache(device, pipelineCache, nullptr);
 	
 	vkDestroyDevice(device, nullptr);
 
@@ -144,6 +823,15 @@ void Engine::cleanUp()
 
 void Engine::createInstance()
 {
+	//1.1 brings vkGetPhysicalDeviceFeatures2 for the mesh shader queries, a 1.0 loader doesn't even have this function
+	auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+		vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+	uint32_t loaderVersion = VK_API_VERSION_1_0;
+	if (enumerateInstanceVersion && enumerateInstanceVersion(&loaderVersion) == VK_SUCCESS && loaderVersion >= VK_API_VERSION_1_1)
+	{
+		instanceApiVersion = VK_API_VERSION_1_1;
+	}
+
 	VkApplicationInfo appInfo{
 		VK_STRUCTURE_TYPE_APPLICATION_INFO,	//sType
 		nullptr,							//pNext
@@ -151,7 +839,7 @@ void Engine::createInstance()
 		VK_MAKE_API_VERSION(0, 1, 0, 0),	//applicationVersion
 		"NoEngine",							//pEngineName
 		VK_MAKE_API_VERSION(0, 1, 0, 0),	//engineVersion
-		VK_API_VERSION_1_0					//apiVersion
+		instanceApiVersion					//apiVersion
 	};
 
 	std::vector<const char*> extensions = getRequiredInstanceExtensions();
@@ -227,18 +915,34 @@ void Engine::pickPhysicalDevice()
 	{
 		throw std::runtime_error("[VK_Instance]: No Supported Graphics Devices found!");
 	}
+
+	memoryInfo = queryDeviceMemoryInfo(physicalDevice);
+	for (size_t i = 0; i < memoryInfo.heaps.size(); ++i)
+	{
+		std::cout << "[VK_Instance]: Memory heap " << i << ": " << (memoryInfo.heaps[i].size >> 20) << " MiB"
+			<< ((memoryInfo.heaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) ? " (device local)" : "") << "\n";
+	}
+
+	textureFormats = queryTextureFormatSupport(physicalDevice);
+	std::cout << "[VK_Instance]: Compressed textures:" << (textureFormats.bc ? " BC" : "") << (textureFormats.etc2 ? " ETC2" : "")
+		<< (textureFormats.astcLdr ? " ASTC" : "") << ", anything else is decoded on the CPU\n";
 }
 
 void Engine::createLogicalDevice()
 {
 	QueueFamilyIndices indices = queryQueueFamilyIndices(physicalDevice);
 
+	//without a separate family the same compute work is submitted to the graphics queue instead
+	asyncCompute = config.asyncCompute && indices.computeFamily.has_value();
+	computeFamily = asyncCompute ? indices.computeFamily.value() : indices.graphicsFamily.value();
+
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 
 	//sets don't allow duplicates
 	std::set<uint32_t> uniqueQueueFamilies = {
 		indices.graphicsFamily.value(),
-		indices.presentFamily.value()
+		indices.presentFamily.value(),
+		computeFamily
 	};
 
 	float queuePriority = 1.0f;
@@ -255,19 +959,100 @@ void Engine::createLogicalDevice()
 		queueCreateInfos.push_back(queueCreateInfo);
 	}
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	//GPU culling draws every object with a single indirect call, passing the object index as the first instance
+	gpuCulling = supportedFeatures.multiDrawIndirect && supportedFeatures.drawIndirectFirstInstance;
+
 	VkPhysicalDeviceFeatures deviceFeatures{};
+	deviceFeatures.multiDrawIndirect = gpuCulling ? VK_TRUE : VK_FALSE;
+	deviceFeatures.drawIndirectFirstInstance = gpuCulling ? VK_TRUE : VK_FALSE;
+	//compressed formats can only be sampled with their feature enabled
+	deviceFeatures.textureCompressionBC = textureFormats.bc ? VK_TRUE : VK_FALSE;
+	deviceFeatures.textureCompressionETC2 = textureFormats.etc2 ? VK_TRUE : VK_FALSE;
+	deviceFeatures.textureCompressionASTC_LDR = textureFormats.astcLdr ? VK_TRUE : VK_FALSE;
+
+	//memory budget queries go through vkGetPhysicalDeviceMemoryProperties2KHR, which needs the instance extension
+	std::vector<const char*> enabledExtensions(DeviceExtensions);
+	bool memoryBudget = memoryInfo.memoryBudget && physicalDeviceProperties2;
+	if (memoryBudget)
+	{
+		enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+	}
+
+	//meshlets are only drawn through mesh shaders when GPU culling could feed them the object bounds
+	meshShading = config.meshlets && config.meshShaders && gpuCulling && checkMeshShaderSupport(physicalDevice);
+	VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,	//sType
+		nullptr,													//pNext
+		VK_TRUE,													//taskShader
+		VK_TRUE,													//meshShader
+		VK_FALSE,													//multiviewMeshShader
+		VK_FALSE,													//primitiveFragmentShadingRateMeshShader
+		VK_FALSE													//meshShaderQueries
+	};
+
+	//presents are only waited on to limit how many are queued
+	presentWait = config.maxQueuedFrames > 0 && checkPresentWaitSupport(physicalDevice);
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,	//sType
+		nullptr,														//pNext
+		VK_TRUE															//presentWait
+	};
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,	//sType
+		&presentWaitFeatures,										//pNext
+		VK_TRUE														//presentId
+	};
+	void* featureChain = nullptr;
+	if (presentWait)
+	{
+		enabledExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+		featureChain = &presentIdFeatures;
+	}
+
+	pipelineLibraries = config.pipelineLibraries && checkPipelineLibrarySupport(physicalDevice);
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{
+		VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,	//sType
+		nullptr,																	//pNext
+		VK_TRUE																		//graphicsPipelineLibrary
+	};
+	if (pipelineLibraries)
+	{
+		pipelineLibraryFeatures.pNext = featureChain;
+		featureChain = &pipelineLibraryFeatures;
+		enabledExtensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+		enabledExtensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+	}
+
+	if (meshShading)
+	{
+		meshShaderFeatures.pNext = featureChain;
+		featureChain = &meshShaderFeatures;
+		enabledExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+		//mesh shaders are SPIR-V 1.4, which is core from 1.2 on
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+		if (properties.apiVersion < VK_API_VERSION_1_2)
+		{
+			enabledExtensions.push_back(VK_KHR_SPIRV_1_4_EXTENSION_NAME);
+			enabledExtensions.push_back(VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME);
+		}
+	}
 
 	VkDeviceCreateInfo deviceCreateInfo {
 		VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,						//sType;
-		nullptr,													//pNext;
+		featureChain,												//pNext;
 		0,															//flags;
 		static_cast<uint32_t>(queueCreateInfos.size()),				//queueCreateInfoCount;
 		queueCreateInfos.data(),									//pQueueCreateInfos;
 		static_cast<uint32_t>(enableValidationLayers ? ValidationLayers.size() : 0),
 																	//enabledLayerCount;
 		enableValidationLayers ? ValidationLayers.data() : nullptr,	//ppEnabledLayerNames;
-		static_cast<uint32_t>(DeviceExtensions.size()),				//enabledExtensionCount;
-		DeviceExtensions.data(),									//ppEnabledExtensionNames;
+		static_cast<uint32_t>(enabledExtensions.size()),			//enabledExtensionCount;
+		enabledExtensions.data(),									//ppEnabledExtensionNames;
 		&deviceFeatures												//pEnabledFeatures;
 	};
 
@@ -278,6 +1063,21 @@ void Engine::createLogicalDevice()
 
 	vkGetDeviceQueue(device, indices.graphicsFamily.value(), 0, &graphicsQueue);
 	vkGetDeviceQueue(device, indices.presentFamily.value(), 0, &presentQueue);
+	vkGetDeviceQueue(device, computeFamily, 0, &computeQueue);
+
+	if (memoryBudget)
+	{
+		getMemoryProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceMemoryProperties2KHR>(
+			vkGetInstanceProcAddr(instance, "vkGetPhysicalDeviceMemoryProperties2KHR"));
+	}
+	if (meshShading)
+	{
+		drawMeshTasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT"));
+	}
+	if (presentWait)
+	{
+		waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(vkGetDeviceProcAddr(device, "vkWaitForPresentKHR"));
+	}
 }
 
 void Engine::createSurface()
@@ -288,26 +1088,113 @@ void Engine::createSurface()
 	}
 }
 
-void Engine::createSwapchain()
+//Last run's pipeline cache, read while the device is still being created. There is none on the first run.
+void Engine::loadPipelineCacheData()
 {
-	SwapchainSupportDetails swapchainSupport = querySwapchainSupport(physicalDevice);
+	std::ifstream file(utils::getExecutableDir() / PipelineCacheFile, std::ios::ate | std::ios::binary);
+	if (!file.is_open())
+	{
+		return;
+	}
 
-	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapchainSupport.formats);
-	VkPresentModeKHR presentMode = choostSwapPresentMode(swapchainSupport.presentModes);
-	VkExtent2D extent = chooseSwapExtent(swapchainSupport.capabilities);
+	pipelineCacheData.resize(static_cast<size_t>(file.tellg()));
+	file.seekg(0);
+	file.read(pipelineCacheData.data(), pipelineCacheData.size());
+}
 
-	//minImageCount may mean waiting on the drivers thus +1
-	uint32_t minImageCount = swapchainSupport.capabilities.minImageCount + 1;
-	//If minImageCount + 1 is more than maxImageCount
-	if (minImageCount > swapchainSupport.capabilities.maxImageCount && swapchainSupport.capabilities.maxImageCount > 0)
+//A cache only fits the device and driver that wrote it, one written by anything else is dropped rather than handed to
+//a driver that might not check it.
+void Engine::createPipelineCache()
+{
+	if (!pipelineCacheData.empty())
 	{
-		minImageCount = swapchainSupport.capabilities.maxImageCount;
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+		VkPipelineCacheHeaderVersionOne header{};
+		bool matches = pipelineCacheData.size() >= sizeof(header);
+		if (matches)
+		{
+			memcpy(&header, pipelineCacheData.data(), sizeof(header));
+			matches = header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && header.vendorID == properties.vendorID &&
+				header.deviceID == properties.deviceID && memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+		}
+		if (!matches)
+		{
+			std::cout << "[PipelineCache]: " << PipelineCacheFile << " is from another device or driver, starting with an empty cache.\n";
+			pipelineCacheData.clear();
+		}
 	}
 
-	QueueFamilyIndices indices = queryQueueFamilyIndices(physicalDevice);
-	uint32_t queueFamilyIndices[2] = {
-		indices.graphicsFamily.value(),
-		indices.presentFamily.value()
+	VkPipelineCacheCreateInfo createInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		pipelineCacheData.size(),						//initialDataSize
+		pipelineCacheData.data()						//pInitialData
+	};
+	if (vkCreatePipelineCache(device, &createInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[VK_Device]: Failed to create pipeline cache!");
+	}
+
+	pipelineCacheLoadedBytes = pipelineCacheData.size();
+	pipelineCacheData.clear();
+	pipelineCacheData.shrink_to_fit();
+
+	stateCache.init(device, pipelineCache);
+	pipelineCompiler.init(stateCache, pipelineLibraries ? PipelineCompileMode::Libraries : PipelineCompileMode::Async);
+}
+
+void Engine::savePipelineCache()
+{
+	size_t size = 0;
+	if (pipelineCache == VK_NULL_HANDLE || vkGetPipelineCacheData(device, pipelineCache, &size, nullptr) != VK_SUCCESS)
+	{
+		return;
+	}
+	std::vector<char> data(size);
+	if (vkGetPipelineCacheData(device, pipelineCache, &size, data.data()) != VK_SUCCESS)
+	{
+		return;
+	}
+
+	std::filesystem::path path = utils::getExecutableDir() / PipelineCacheFile;
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		std::cout << "[PipelineCache]: Couldn't write " << path.string() << ", the next run compiles every pipeline again.\n";
+		return;
+	}
+	file.write(data.data(), size);
+}
+
+void Engine::createSwapchain()
+{
+	SwapchainSupportDetails swapchainSupport = querySwapchainSupport(physicalDevice);
+
+	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapchainSupport.formats);
+	presentMode = chooseSwapPresentMode(swapchainSupport.presentModes);
+	VkExtent2D extent = chooseSwapExtent(swapchainSupport.capabilities);
+
+	//minImageCount may mean waiting on the drivers thus +1 by default. Fewer images queue fewer frames, more of them
+	//keep MAILBOX and IMMEDIATE from waiting on the display.
+	const VkSurfaceCapabilitiesKHR& capabilities = swapchainSupport.capabilities;
+	uint32_t minImageCount = config.swapchainImageCount > 0 ? config.swapchainImageCount : capabilities.minImageCount + 1;
+	uint32_t imageCountLimit = capabilities.maxImageCount > 0 ? capabilities.maxImageCount : std::numeric_limits<uint32_t>::max();
+	uint32_t clampedImageCount = std::clamp(minImageCount, capabilities.minImageCount, imageCountLimit);
+	if (config.swapchainImageCount > 0 && clampedImageCount != minImageCount)
+	{
+		std::cout << "[Swapchain]: " << minImageCount << " images requested, the surface allows " << capabilities.minImageCount
+			<< " to " << (capabilities.maxImageCount > 0 ? std::to_string(capabilities.maxImageCount) : "any") << ", using "
+			<< clampedImageCount << ".\n";
+	}
+	minImageCount = clampedImageCount;
+
+	QueueFamilyIndices indices = queryQueueFamilyIndices(physicalDevice);
+	uint32_t queueFamilyIndices[2] = {
+		indices.graphicsFamily.value(),
+		indices.presentFamily.value()
 	};
 	bool exclusive = indices.graphicsFamily == indices.presentFamily;
 
@@ -345,6 +1232,7 @@ void Engine::createSwapchain()
 
 	swapchainImageFormat = surfaceFormat.format;
 	swapchainImageExtent = extent;
+	std::cout << "[Swapchain]: " << imageCount << " images, " << presentModeName(presentMode) << "\n";
 
 	//Create Image Views for Swapchain Images
 	swapchainImageViews.resize(swapchainImages.size());
@@ -378,18 +1266,142 @@ void Engine::createSwapchain()
 
 }
 
+//With dynamic resolution the scene renders into a frame graph transient allocated for the largest scale and is upscaled
+//into the swapchain image. Any of the config, missing timestamps, an unsuitable format or uncompiled shaders turn it off,
+//the scene then renders into the swapchain image at its full extent.
+void Engine::createSceneTarget()
+{
+	sceneExtent = swapchainImageExtent;
+	renderExtent = swapchainImageExtent;
+	if (!config.dynamicResolution)
+	{
+		return;
+	}
+
+	//the scene pipelines are built for the swapchain format, so the scene target has to use it too
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, swapchainImageFormat, &formatProperties);
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if ((formatProperties.optimalTilingFeatures & required) != required)
+	{
+		std::cout << "[Resolution]: Swapchain format can't be sampled linearly, rendering at the swapchain resolution.\n";
+		return;
+	}
+	if (!frameTimer.init(device, physicalDevice, queryQueueFamilyIndices(physicalDevice).graphicsFamily.value()))
+	{
+		std::cout << "[Resolution]: Graphics queue has no timestamps, rendering at the swapchain resolution.\n";
+		return;
+	}
+
+	sceneExtent = scaledExtent(swapchainImageExtent, config.maxRenderScale);
+
+	UpscalerConfig upscalerConfig;
+	upscalerConfig.shaderDir = utils::getExecutableDir() / "res/shaders";
+	upscalerConfig.outputFormat = swapchainImageFormat;
+	upscalerConfig.outputExtent = swapchainImageExtent;
+	upscalerConfig.outputViews = swapchainImageViews;
+	upscalerConfig.sourceExtent = sceneExtent;
+	upscalerConfig.filter = config.upscaleFilter;
+	if (!upscaler.init(device, upscalerConfig))
+	{
+		frameTimer.destroy();
+		sceneExtent = swapchainImageExtent;
+		return;
+	}
+
+	//without a budget a frame should fit the render rate's interval, or a 60 Hz display's when uncapped
+	DynamicResolutionConfig resolutionConfig;
+	resolutionConfig.minScale = config.minRenderScale;
+	resolutionConfig.maxScale = config.maxRenderScale;
+	double budgetMs = config.gpuFrameBudgetMs > 0.0 ? config.gpuFrameBudgetMs :
+		1000.0 / (config.renderRate > 0.0 ? config.renderRate : 60.0);
+	resolutionConfig.frameBudget = budgetMs * 1e-3;
+	resolution.init(resolutionConfig);
+
+	dynamicResolution = true;
+	std::cout << "[Resolution]: Rendering at " << config.minRenderScale << "x to " << config.maxRenderScale << "x of "
+		<< swapchainImageExtent.width << "x" << swapchainImageExtent.height << " within " << budgetMs << " ms of GPU time, "
+		<< upscaleFilterName(config.upscaleFilter) << " upscale\n";
+}
+
+//Windows past the first, placed one per monitor from the second monitor on. Their surfaces only have to offer the
+//main window's format, the scene target is upscaled into all of them by the same pipeline.
+void Engine::createOutputs()
+{
+	if (config.windowCount <= 1)
+	{
+		return;
+	}
+	if (!dynamicResolution)
+	{
+		std::cout << "[Output]: Further windows are upscaled from the scene target, which isn't there, only the main window is drawn.\n";
+		return;
+	}
+
+	int monitorCount = 0;
+	GLFWmonitor** monitors = glfwGetMonitors(&monitorCount);
+	outputs.resize(config.windowCount - 1);
+	for (uint32_t i = 0; i < outputs.size(); ++i)
+	{
+		OutputTargetConfig outputConfig;
+		outputConfig.width = WIDTH;
+		outputConfig.height = HEIGHT;
+		outputConfig.title = "Output " + std::to_string(i + 2);
+		outputConfig.monitor = static_cast<int>(i) + 1 < monitorCount ? monitors[i + 1] : nullptr;
+		outputConfig.format = swapchainImageFormat;
+		outputConfig.presentMode = presentMode;
+		outputConfig.imageCount = config.swapchainImageCount;
+		outputConfig.queueFamily = queryQueueFamilyIndices(physicalDevice).graphicsFamily.value();
+		outputs[i].init(instance, physicalDevice, device, outputConfig);
+		upscaler.addOutput(outputs[i].getExtent(), outputs[i].getImageViews());
+	}
+}
+
+void Engine::createFramePacer()
+{
+	FramePacerConfig pacerConfig;
+	pacerConfig.maxQueuedFrames = config.maxQueuedFrames;
+	pacerConfig.frameInterval = config.renderRate > 0.0 ? 1.0 / config.renderRate : 0.0;
+	pacerConfig.spinTime = config.pacerSpinMs * 1e-3;
+	pacer.init(device, swapchain, waitForPresent, pacerConfig);
+
+	if (config.maxQueuedFrames > 0 && !pacer.limitsQueue())
+	{
+		std::cout << "[Pacing]: VK_KHR_present_wait is unavailable, only the swapchain image count limits queued frames.\n";
+	}
+}
+
+//Only the format, the render pass needs it long before the frame graph creates depth itself.
+void Engine::createDepthResources()
+{
+	depthFormat = findDepthFormat();
+}
+
 void Engine::createRenderPass()
 {
-	VkAttachmentDescription colorAttachment{
-		0,									//flags
-		swapchainImageFormat,				//format
-		VK_SAMPLE_COUNT_1_BIT,				//samples
-		VK_ATTACHMENT_LOAD_OP_CLEAR,		//loadOp
-		VK_ATTACHMENT_STORE_OP_STORE,		//storeOp
-		VK_ATTACHMENT_LOAD_OP_DONT_CARE,	//stencilLoadOp
-		VK_ATTACHMENT_STORE_OP_DONT_CARE,	//stencilStoreOp
-		VK_IMAGE_LAYOUT_UNDEFINED,			//initialLayout
-		VK_IMAGE_LAYOUT_PRESENT_SRC_KHR		//finalLayout
+	VkAttachmentDescription attachments[] = {
+		{
+			0,									//flags
+			swapchainImageFormat,				//format
+			VK_SAMPLE_COUNT_1_BIT,				//samples
+			VK_ATTACHMENT_LOAD_OP_CLEAR,		//loadOp
+			VK_ATTACHMENT_STORE_OP_STORE,		//storeOp
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,	//stencilLoadOp
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,	//stencilStoreOp
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,	//initialLayout -> the frame graph transitions the image before the pass
+			VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL	//finalLayout -> and to PRESENT_SRC after it
+		},
+		{
+			0,									//flags
+			depthFormat,						//format
+			VK_SAMPLE_COUNT_1_BIT,				//samples
+			VK_ATTACHMENT_LOAD_OP_CLEAR,		//loadOp
+			VK_ATTACHMENT_STORE_OP_STORE,		//storeOp -> the Hi-Z pyramid is built from it
+			VK_ATTACHMENT_LOAD_OP_DONT_CARE,	//stencilLoadOp
+			VK_ATTACHMENT_STORE_OP_DONT_CARE,	//stencilStoreOp
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,	//initialLayout
+			VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL	//finalLayout
+		}
 	};
 
 	VkAttachmentReference colorAttachmentReference{
@@ -397,6 +1409,11 @@ void Engine::createRenderPass()
 		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL	//layout
 	};
 
+	VkAttachmentReference depthAttachmentReference{
+		1,												//attachment
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL	//layout
+	};
+
 	VkSubpassDescription subpass{
 		0,									//flags
 		VK_PIPELINE_BIND_POINT_GRAPHICS,	//pipelineBindPoint
@@ -405,42 +1422,38 @@ void Engine::createRenderPass()
 		1,									//colorAttachmentCount
 		&colorAttachmentReference,			//pColorAttachments
 		nullptr,							//pResolveAttachments
-		nullptr,							//pDepthStencilAttachment
+		&depthAttachmentReference,			//pDepthStencilAttachment
 		0,									//preserveAttachmentCount
 		nullptr,							//pPreserveAttachments
 	};
 
-	VkSubpassDependency subpassDependency{
-		VK_SUBPASS_EXTERNAL,							//srcSubpass
-		0,												//dstSubpass
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,	//srcStageMask
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,	//dstStageMask
-		0,												//srcAccessMask
-		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,			//dstAccessMask
-		0												//dependencyFlags
-	};
-
 	VkRenderPassCreateInfo renderPassInfo{
 		VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,	//sType
 		0,											//pNext
 		0,											//flags
-		1,											//attachmentCount
-		&colorAttachment,							//pAttachments
+		2,											//attachmentCount
+		attachments,								//pAttachments
 		1,											//subpassCount
 		&subpass,									//pSubpasses
-		1,											//dependencyCount
-		&subpassDependency							//pDependencies
+		0,											//dependencyCount
+		nullptr										//pDependencies
 	};
 
-	if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-		throw std::runtime_error("[VK_Device]: Failed to create render pass!");
-	}
+	renderPass = stateCache.getRenderPass(renderPassInfo);
+
+	//the late occlusion phase draws on top of the early one, only the load ops differ so pipelines and framebuffers stay compatible
+	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	loadRenderPass = stateCache.getRenderPass(renderPassInfo);
 }
 
 void Engine::createGraphicsPipeline()
 {
-	std::vector<char> vertexShaderCode = readFile(utils::getExecutableDir() / "res/shaders/vert.spv");
-	std::vector<char> fragmentShaderCode = readFile(utils::getExecutableDir() / "res/shaders/frag.spv");
+	//the clustered shader's lighting takes set 0, so only the unlit path samples the scene texture
+	sceneTextured = !clusteredLighting && !findTextures().empty();
+	const char* fragmentShader = clusteredLighting ? "clustered.spv" : sceneTextured ? "textured.spv" : "frag.spv";
+	std::vector<char> vertexShaderCode = readFile(utils::getExecutableDir() / "res/shaders/mesh.spv");
+	std::vector<char> fragmentShaderCode = readFile(utils::getExecutableDir() / "res/shaders" / fragmentShader);
 
 	VkShaderModule vertShaderModule = createShaderModule(vertexShaderCode);
 	VkShaderModule fragShaderModule = createShaderModule(fragmentShaderCode);
@@ -470,14 +1483,27 @@ void Engine::createGraphicsPipeline()
 		fragShaderStageInfo
 	};
 
+	//cooked PackedVertex, the vertex shader unpacks positions with the mesh's push constants
+	VkVertexInputBindingDescription vertexBinding{
+		0,								//binding
+		sizeof(PackedVertex),			//stride
+		VK_VERTEX_INPUT_RATE_VERTEX		//inputRate
+	};
+
+	VkVertexInputAttributeDescription vertexAttributes[] = {
+		{ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) },	//location, binding, format, offset
+		{ 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) },
+		{ 2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, texcoord) }
+	};
+
 	VkPipelineVertexInputStateCreateInfo vertexInputInfo {
 		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,	//sType
 		nullptr,										//pNext;
 		0,												//flags;
-		0,												//vertexBindingDescriptionCount;
-		nullptr,										//pVertexBindingDescriptions;
-		0,												//vertexAttributeDescriptionCount;
-		nullptr											//pVertexAttributeDescriptions;
+		1,												//vertexBindingDescriptionCount;
+		&vertexBinding,									//pVertexBindingDescriptions;
+		3,												//vertexAttributeDescriptionCount;
+		vertexAttributes								//pVertexAttributeDescriptions;
 	};
 
 	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo {
@@ -555,6 +1581,22 @@ void Engine::createGraphicsPipeline()
 	};
 	// I'm not sure what the colorWriteMask should be so check everything once
 
+	//reversed depth: cleared to 0, nearer fragments are larger
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_TRUE,													//depthTestEnable
+		VK_TRUE,													//depthWriteEnable
+		VK_COMPARE_OP_GREATER_OR_EQUAL,								//depthCompareOp
+		VK_FALSE,													//depthBoundsTestEnable
+		VK_FALSE,													//stencilTestEnable
+		VkStencilOpState{},											//front
+		VkStencilOpState{},											//back
+		0.0f,														//minDepthBounds
+		1.0f														//maxDepthBounds
+	};
+
 	VkPipelineColorBlendStateCreateInfo colorBlendInfo{
 		VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,	//sType
 		nullptr,													//pNext
@@ -571,20 +1613,47 @@ void Engine::createGraphicsPipeline()
 		}
 	};
 
+	//lit, the fragment shader reads the cluster lists from set 0 and the grid from behind the mesh's constants
+	VkPushConstantRange pushConstantRanges[] = {
+		MeshConstantBlock::range(),
+		{
+			VK_SHADER_STAGE_FRAGMENT_BIT,				//stageFlags
+			sizeof(MeshPushConstants),					//offset
+			ClusteredLighting::getPushConstantSize()	//size
+		}
+	};
+	if (sceneTextured)
+	{
+		VkDescriptorSetLayoutBinding textureBinding{
+			0,											//binding -> scene texture
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+			1,											//descriptorCount
+			VK_SHADER_STAGE_FRAGMENT_BIT,				//stageFlags
+			nullptr										//pImmutableSamplers
+		};
+		VkDescriptorSetLayoutCreateInfo textureSetLayoutInfo{
+			VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			1,														//bindingCount
+			&textureBinding											//pBindings
+		};
+		sceneTextureSetLayout = stateCache.getDescriptorSetLayout(textureSetLayoutInfo);
+	}
+	VkDescriptorSetLayout meshSetLayout = clusteredLighting ? lighting.getDescriptorSetLayout() : sceneTextureSetLayout;
+	bool meshSet = meshSetLayout != VK_NULL_HANDLE;
+
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
 		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
 		nullptr,										//pNext
 		0,												//flags
-		0,												//setLayoutCount
-		nullptr,										//pSetLayouts
-		0,												//pushConstantRangeCount
-		nullptr,										//pPushConstantRanges
+		meshSet ? 1u : 0u,								//setLayoutCount
+		meshSet ? &meshSetLayout : nullptr,				//pSetLayouts
+		clusteredLighting ? 2u : 1u,					//pushConstantRangeCount
+		pushConstantRanges,								//pPushConstantRanges
 	};
 
-	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout))
-	{
-		throw std::runtime_error("[VK_Device]: Failed to Create Pipeline Layout.");
-	}
+	pipelineLayout = stateCache.getPipelineLayout(pipelineLayoutInfo);
 
 	VkGraphicsPipelineCreateInfo pipelineInfo{
 		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,	//sType
@@ -598,7 +1667,7 @@ void Engine::createGraphicsPipeline()
 		&viewportStateInfo,									//pViewportState
 		&rasterizationStateInfo,							//pRasterizationState
 		&multisampleInfo,									//pMultisampleState
-		nullptr,											//pDepthStencilState
+		&depthStencilInfo,									//pDepthStencilState
 		&colorBlendInfo,									//pColorBlendState
 		&dynamicStateCreateInfo,							//pDynamicState
 		pipelineLayout,										//layout
@@ -608,29 +1677,179 @@ void Engine::createGraphicsPipeline()
 		-1													//basePipelineIndex
 	};
 
-	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS) 
+	//what a replay rebuilds this pipeline from, it finds the shaders under the names they were loaded from
+	std::strncpy(meshPipelineKey.vertexShader, "mesh.spv", sizeof(meshPipelineKey.vertexShader) - 1);
+	std::strncpy(meshPipelineKey.fragmentShader, fragmentShader, sizeof(meshPipelineKey.fragmentShader) - 1);
+	meshPipelineKey.stateHash = stateCache.getGraphicsPipelineKey(pipelineInfo).hash;
+	meshPipelineKey.vertexStride = vertexBinding.stride;
+	meshPipelineKey.cullMode = rasterizationStateInfo.cullMode;
+	meshPipelineKey.frontFace = rasterizationStateInfo.frontFace;
+	meshPipelineKey.depthCompareOp = depthStencilInfo.depthCompareOp;
+	meshPipelineKey.depthWrite = depthStencilInfo.depthWriteEnable;
+	meshPipelineKey.blendEnable = colorBlendAttachment.blendEnable;
+	meshPipelineKey.pushConstantStages = pushConstantRanges[0].stageFlags;
+	meshPipelineKey.pushConstantSize = pushConstantRanges[0].size;
+	meshPipelineKey.setLayoutCount = pipelineLayoutInfo.setLayoutCount;
+
+	//nothing can be drawn without it, with pipeline libraries this only waits for the parts and the fast link
+	meshPipeline = pipelineCompiler.request(pipelineInfo);
+	pipelineCompiler.wait(meshPipeline);
+}
+
+void Engine::createComputePipeline()
+{
+	if (!gpuCulling)
 	{
-		throw std::runtime_error("[VK_Device]: Failed to create graphics pipeline!");
+		std::cout << "[Compute]: Device can't draw indirect with a first instance, culling on the CPU.\n";
+		return;
 	}
 
-	vkDestroyShaderModule(device, vertShaderModule, nullptr);
-	vkDestroyShaderModule(device, fragShaderModule, nullptr);
+	std::filesystem::path shaderPath = utils::getExecutableDir() / "res/shaders/cull.spv";
+	if (!std::filesystem::exists(shaderPath))
+	{
+		std::cout << "[Compute]: " << shaderPath.string() << " not found (run res/shaders/compile.bat), culling on the CPU.\n";
+		gpuCulling = false;
+		return;
+	}
+
+	std::vector<char> computeShaderCode = readFile(shaderPath);
+	VkShaderModule computeShaderModule = createShaderModule(computeShaderCode);
+
+	VkDescriptorSetLayoutBinding bindings[] = {
+		{
+			0,									//binding -> object bounds
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		},
+		{
+			1,									//binding -> draw commands
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		},
+		{
+			2,									//binding -> visibility flags
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		},
+		{
+			3,									//binding -> occlusion camera
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		},
+		{
+			4,									//binding -> culling counters
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		},
+		{
+			5,											//binding -> Hi-Z pyramid
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+			1,											//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,				//stageFlags
+			nullptr										//pImmutableSamplers
+		},
+		{
+			6,									//binding -> object levels of detail
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		}
+	};
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		7,														//bindingCount
+		bindings												//pBindings
+	};
+	cullDescriptorSetLayout = stateCache.getDescriptorSetLayout(descriptorSetLayoutInfo);
+
+	VkPushConstantRange pushConstantRange{
+		VK_SHADER_STAGE_COMPUTE_BIT,	//stageFlags
+		0,								//offset
+		sizeof(CullPushConstants)		//size
+	};
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//setLayoutCount
+		&cullDescriptorSetLayout,						//pSetLayouts
+		1,												//pushConstantRangeCount
+		&pushConstantRange								//pPushConstantRanges
+	};
+	cullPipelineLayout = stateCache.getPipelineLayout(pipelineLayoutInfo);
+
+	VkComputePipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		VkPipelineShaderStageCreateInfo {				//stage
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			nullptr,
+			0,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			computeShaderModule,
+			"main",
+			nullptr
+		},
+		cullPipelineLayout,								//layout
+		VK_NULL_HANDLE,									//basePipelineHandle
+		-1												//basePipelineIndex
+	};
+	cullPipeline = stateCache.getComputePipeline(pipelineInfo);
 }
 
 void Engine::createFramebuffers()
 {
+	if (dynamicResolution)
+	{
+		VkImageView attachments[] = { frameGraph.getImageView(sceneTarget), frameGraph.getImageView(depthBuffer) };
+
+		VkFramebufferCreateInfo framebufferInfo{
+			VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,	//sType
+			nullptr,									//pNext
+			0,											//flags
+			renderPass,									//renderPass
+			2,											//attachmentCount
+			attachments,								//pAttachments
+			sceneExtent.width,							//width
+			sceneExtent.height,							//height
+			1,											//layers
+		};
+
+		if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &sceneFramebuffer) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to create Framebuffer!");
+		}
+		return;
+	}
+
 	swapchainFramebuffers.resize(swapchainImages.size());
 
 	for (size_t i = 0; i < swapchainImageViews.size(); ++i)
 	{
-		VkImageView attachments[] = { swapchainImageViews[i] };
+		VkImageView attachments[] = { swapchainImageViews[i], frameGraph.getImageView(depthBuffer) };
 
 		VkFramebufferCreateInfo framebufferInfo{
 			VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,	//sType
 			nullptr,									//pNext
 			0,											//flags
 			renderPass,									//renderPass
-			1,											//attachmentCount
+			2,											//attachmentCount
 			attachments,								//pAttachments
 			swapchainImageExtent.width,					//width
 			swapchainImageExtent.height,				//height
@@ -655,47 +1874,810 @@ void Engine::createCommandPool()
 		queueFamilyIndices.graphicsFamily.value()			//queueFamilyIndex
 	};
 
-	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS) {
-		throw std::runtime_error("[VK_Device]: Unable to create Command Pool!");
+	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Device]: Unable to create Command Pool!");
+	}
+}
+
+void Engine::createCommandBuffer()
+{
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, //sType
+		nullptr,										//pNext
+		commandPool,									//commandPool
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY,				//level
+		1												//commandBufferCount
+	};
+
+	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Device]: Couldn't allocate Command Buffer!");
+	}
+}
+
+void Engine::createSyncObjects()
+{
+	VkSemaphoreCreateInfo semaphoreCreateInfo{
+		VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0											//flags
+	};
+
+	VkFenceCreateInfo fenceCreateInfo{
+		VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,		//sType
+		nullptr,									//pNext
+		VK_FENCE_CREATE_SIGNALED_BIT				//flags	-> first frame waits for a signaled fence
+	};
+
+	if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
+		vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
+		vkCreateFence(device, &fenceCreateInfo, nullptr, &inFlightFence) != VK_SUCCESS) 
+	{
+		throw std::runtime_error("[VK_Device]: Couldn't create necessary Synchronization Objects!");
+	}
+
+}
+
+void Engine::createComputeResources()
+{
+	if (!gpuCulling)
+	{
+		return;
+	}
+
+	std::vector<uint32_t> families = getSharedQueueFamilies();
+
+	VkDeviceSize boundsSize = MaxGpuObjects * sizeof(float) * 4;
+	VkDeviceSize drawsSize = MaxGpuObjects * sizeof(VkDrawIndexedIndirectCommand);
+
+	createBuffer(device, physicalDevice, boundsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, families, objectBoundsBuffer, objectBoundsMemory);
+	vkMapMemory(device, objectBoundsMemory, 0, VK_WHOLE_SIZE, 0, &objectBoundsMapped);
+
+	createBuffer(device, physicalDevice, MaxGpuObjects * sizeof(uint32_t) * 4, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, families, objectLodBuffer, objectLodMemory);
+	vkMapMemory(device, objectLodMemory, 0, VK_WHOLE_SIZE, 0, &objectLodMapped);
+
+	createBuffer(device, physicalDevice, drawsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, families, drawCommandBuffer, drawCommandMemory);
+
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 5 },			//type, descriptorCount
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//maxSets
+		3,												//poolSizeCount
+		poolSizes										//pPoolSizes
+	};
+	if (vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Device]: Failed to create descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo descriptorSetInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		descriptorPool,									//descriptorPool
+		1,												//descriptorSetCount
+		&cullDescriptorSetLayout						//pSetLayouts
+	};
+	if (vkAllocateDescriptorSets(device, &descriptorSetInfo, &cullDescriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Device]: Failed to allocate the culling descriptor set!");
+	}
+
+	VkDescriptorBufferInfo bufferInfos[] = {
+		{ objectBoundsBuffer, 0, VK_WHOLE_SIZE },
+		{ drawCommandBuffer, 0, VK_WHOLE_SIZE },
+		{ occlusion.getVisibilityBuffer(), 0, VK_WHOLE_SIZE },
+		{ occlusion.getCameraBuffer(), 0, VK_WHOLE_SIZE },
+		{ occlusion.getCounterBuffer(), 0, VK_WHOLE_SIZE },
+		{ objectLodBuffer, 0, VK_WHOLE_SIZE }
+	};
+	//buffers go to bindings 0-4 and 6, the pyramid sits in between
+	const uint32_t bufferBindings[] = { 0, 1, 2, 3, 4, 6 };
+	VkWriteDescriptorSet writes[7];
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		writes[i] = VkWriteDescriptorSet{
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,	//sType
+			nullptr,								//pNext
+			cullDescriptorSet,						//dstSet
+			bufferBindings[i],						//dstBinding
+			0,										//dstArrayElement
+			1,										//descriptorCount
+			i == 3 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+													//descriptorType
+			nullptr,								//pImageInfo
+			&bufferInfos[i],						//pBufferInfo
+			nullptr									//pTexelBufferView
+		};
+	}
+	VkDescriptorImageInfo pyramidInfo = occlusion.getPyramidInfo();
+	writes[6] = VkWriteDescriptorSet{
+		VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,		//sType
+		nullptr,									//pNext
+		cullDescriptorSet,							//dstSet
+		5,											//dstBinding
+		0,											//dstArrayElement
+		1,											//descriptorCount
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+		&pyramidInfo,								//pImageInfo
+		nullptr,									//pBufferInfo
+		nullptr										//pTexelBufferView
+	};
+	vkUpdateDescriptorSets(device, 7, writes, 0, nullptr);
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,			//sType
+		nullptr,											//pNext
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,	//flags
+		computeFamily										//queueFamilyIndex
+	};
+	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &computeCommandPool) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Device]: Unable to create the compute Command Pool!");
+	}
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, //sType
+		nullptr,										//pNext
+		computeCommandPool,								//commandPool
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY,				//level
+		1												//commandBufferCount
+	};
+	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &computeCommandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Device]: Couldn't allocate the compute Command Buffer!");
+	}
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo{
+		VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0											//flags
+	};
+	if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &computeFinishedSemaphore) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Device]: Couldn't create the compute semaphore!");
+	}
+
+	if (asyncCompute)
+	{
+		std::cout << "[Compute]: Culling on the async compute queue (family " << computeFamily << ")\n";
+	}
+	else {
+		std::cout << "[Compute]: Culling on the graphics queue\n";
+	}
+}
+
+void Engine::createTextureStreamer()
+{
+	TextureStreamingConfig streamingConfig;
+	streamingConfig.budgetBytes = static_cast<VkDeviceSize>(config.textureBudgetMiB) << 20;
+	streamingConfig.downsampleShader = utils::getExecutableDir() / "res/shaders/downsample.spv";
+
+	//uploads go through the graphics queue so they're ordered before the frame that samples them
+	textures.init(device, physicalDevice, graphicsQueue, queryQueueFamilyIndices(physicalDevice).graphicsFamily.value(),
+		getMemoryProperties2, &jobs, streamingConfig);
+
+	std::cout << "[Streaming]: Texture budget " << (textures.currentBudget() >> 20) << " MiB"
+		<< (getMemoryProperties2 ? " (VK_EXT_memory_budget)" : "") << "\n";
+
+	textureLoader.init(physicalDevice, textureFormats, textures);
+
+	std::vector<std::filesystem::path> textureFiles = findTextures();
+	for (const std::filesystem::path& path : textureFiles)
+	{
+		TextureHandle texture = textureLoader.loadKtx2(path);
+		if (sceneTexture == InvalidTexture)
+		{
+			sceneTexture = texture;
+		}
+	}
+	if (!sceneTextured)
+	{
+		return;
+	}
+
+	//trilinear over whatever is resident, the view's level 0 is always the finest resident mip
+	VkSamplerCreateInfo samplerInfo{
+		VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,		//sType
+		nullptr,									//pNext
+		0,											//flags
+		VK_FILTER_LINEAR,							//magFilter
+		VK_FILTER_LINEAR,							//minFilter
+		VK_SAMPLER_MIPMAP_MODE_LINEAR,				//mipmapMode
+		VK_SAMPLER_ADDRESS_MODE_REPEAT,				//addressModeU
+		VK_SAMPLER_ADDRESS_MODE_REPEAT,				//addressModeV
+		VK_SAMPLER_ADDRESS_MODE_REPEAT,				//addressModeW
+		0.0f,										//mipLodBias
+		VK_FALSE,									//anisotropyEnable
+		1.0f,										//maxAnisotropy
+		VK_FALSE,									//compareEnable
+		VK_COMPARE_OP_ALWAYS,						//compareOp
+		0.0f,										//minLod
+		VK_LOD_CLAMP_NONE,							//maxLod
+		VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK,			//borderColor
+		VK_FALSE									//unnormalizedCoordinates
+	};
+	sceneTextureSampler = stateCache.getSampler(samplerInfo);
+
+	VkDescriptorPoolSize poolSize{
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//type
+		1											//descriptorCount
+	};
+	VkDescriptorPoolCreateInfo poolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//maxSets
+		1,												//poolSizeCount
+		&poolSize										//pPoolSizes
+	};
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &sceneTexturePool) != VK_SUCCESS) {
+		throw std::runtime_error("[Streaming]: Failed to create the scene texture descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo allocateInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		sceneTexturePool,								//descriptorPool
+		1,												//descriptorSetCount
+		&sceneTextureSetLayout							//pSetLayouts
+	};
+	if (vkAllocateDescriptorSets(device, &allocateInfo, &sceneTextureSet) != VK_SUCCESS) {
+		throw std::runtime_error("[Streaming]: Failed to allocate the scene texture descriptor set!");
+	}
+	updateSceneTextureSet();
+
+	VkExtent2D extent = textures.getExtent(sceneTexture);
+	std::cout << "[Streaming]: Objects sample " << textureFiles.front().filename().string() << " (" << extent.width << "x"
+		<< extent.height << "), its mips follow their size on screen\n";
+}
+
+//Points the scene texture's descriptor at its current view, nothing may be using the set.
+void Engine::updateSceneTextureSet()
+{
+	sceneTextureView = textures.getImageView(sceneTexture);
+	VkDescriptorImageInfo imageInfo{
+		sceneTextureSampler,						//sampler
+		sceneTextureView,							//imageView
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL	//imageLayout
+	};
+	VkWriteDescriptorSet write{
+		VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,		//sType
+		nullptr,									//pNext
+		sceneTextureSet,							//dstSet
+		0,											//dstBinding
+		0,											//dstArrayElement
+		1,											//descriptorCount
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+		&imageInfo,									//pImageInfo
+		nullptr,									//pBufferInfo
+		nullptr										//pTexelBufferView
+	};
+	vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+}
+
+//Uploads the first cooked mesh in res/meshes, or the built-in triangle when there is none.
+void Engine::createMeshes()
+{
+	meshes.init(device, physicalDevice, getSharedQueueFamilies());
+
+	std::vector<std::filesystem::path> meshFiles;
+	std::filesystem::path meshDir = utils::getExecutableDir() / "res/meshes";
+	if (std::filesystem::is_directory(meshDir))
+	{
+		for (const auto& entry : std::filesystem::directory_iterator(meshDir))
+		{
+			if (entry.path().extension() == ".vmesh")
+			{
+				meshFiles.push_back(entry.path());
+			}
+		}
+	}
+	std::sort(meshFiles.begin(), meshFiles.end());
+
+	std::string meshName;
+	CookedMesh cooked;
+	if (!meshFiles.empty())
+	{
+		cooked = readCookedMesh(meshFiles.front());
+		meshName = meshFiles.front().filename().string();
+	}
+	else {
+		//the triangle the vertex shader used to hardcode, facing the camera
+		std::vector<MeshVertex> vertices = {
+			{ { 0.0f, -0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.0f } },
+			{ { 0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 1.0f } },
+			{ { -0.5f, 0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f } }
+		};
+		cooked = packMesh(vertices, { 0, 1, 2 });
+		meshName = "built-in triangle";
+	}
+	if (!config.capturePath.empty())
+	{
+		//a replay gets the scene mesh in buffers of its own, bound from offset 0
+		size_t vertexBytes = cooked.vertices.size() * sizeof(PackedVertex);
+		captureVertexBuffer = capture.createBuffer(VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, vertexBytes);
+		capture.uploadBuffer(captureVertexBuffer, 0, cooked.vertices.data(), vertexBytes);
+		captureIndexBuffer = capture.createBuffer(VK_BUFFER_USAGE_INDEX_BUFFER_BIT, cooked.indices.size());
+		capture.uploadBuffer(captureIndexBuffer, 0, cooked.indices.data(), cooked.indices.size());
+	}
+	sceneMesh = meshes.add(std::move(cooked));
+
+	meshes.upload(graphicsQueue, queryQueueFamilyIndices(physicalDevice).graphicsFamily.value());
+
+	//the object's sphere is around its origin, so it has to reach the far side of the mesh's own sphere
+	const GpuMesh& mesh = meshes.get(sceneMesh);
+	float centerDistance = std::sqrt(mesh.center[0] * mesh.center[0] + mesh.center[1] * mesh.center[1] + mesh.center[2] * mesh.center[2]);
+	scene.setBoundingRadius(meshObject, centerDistance + mesh.radius);
+
+	std::cout << "[Mesh]: Drawing " << meshName << " (" << mesh.lods[0].indexCount / 3 << " triangles, "
+		<< mesh.vertexCount << " vertices, " << mesh.lods[0].meshletCount << " meshlets)\n";
+	if (mesh.lodCount > 1)
+	{
+		std::cout << "[Mesh]: " << mesh.lodCount << " levels of detail:";
+		for (uint32_t lod = 0; lod < mesh.lodCount; ++lod)
+		{
+			std::cout << " " << mesh.lods[lod].indexCount / 3 << (lod + 1 < mesh.lodCount ? "," : " triangles\n");
+		}
+	}
+}
+
+//Every GPU culling path binds the occlusion state, so it exists whenever culling runs on the GPU,
+//even if the pyramid can't be built and only the All phase is used.
+void Engine::createOcclusionCuller()
+{
+	if (!gpuCulling)
+	{
+		return;
+	}
+
+	OcclusionConfig occlusionConfig;
+	occlusionConfig.reduceShader = utils::getExecutableDir() / "res/shaders/hiz_reduce.spv";
+	occlusionConfig.depthExtent = sceneExtent;
+	occlusionConfig.maxObjects = MaxGpuObjects;
+	occlusionConfig.queueFamilies = getSharedQueueFamilies();
+	//task shaders test meshlets against the pyramid themselves
+	occlusionConfig.readerStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | (meshShading ? VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT : 0);
+
+	occlusion.init(device, physicalDevice, graphicsQueue, queryQueueFamilyIndices(physicalDevice).graphicsFamily.value(),
+		occlusionConfig);
+
+	occlusionCulling = config.occlusionCulling && occlusion.canBuild();
+	if (occlusionCulling)
+	{
+		VkExtent2D pyramidExtent = occlusion.getPyramidExtent();
+		std::cout << "[Occlusion]: Two phase culling against a " << pyramidExtent.width << "x" << pyramidExtent.height
+			<< " Hi-Z pyramid\n";
+	}
+	else if (config.occlusionCulling) {
+		std::cout << "[Occlusion]: " << occlusionConfig.reduceShader.string()
+			<< " not found (run res/shaders/compile.bat), frustum culling only.\n";
+	}
+}
+
+void Engine::createMeshletRenderer()
+{
+	if (!config.meshlets)
+	{
+		return;
+	}
+	if (!gpuCulling)
+	{
+		std::cout << "[Meshlets]: Meshlet culling needs GPU culling, drawing whole meshes.\n";
+		return;
+	}
+
+	MeshletRendererConfig meshletConfig;
+	meshletConfig.shaderDir = utils::getExecutableDir() / "res/shaders";
+	meshletConfig.renderPass = renderPass;
+	meshletConfig.objectBounds = objectBoundsBuffer;
+	meshletConfig.objectLods = objectLodBuffer;
+	meshletConfig.maxObjects = MaxGpuObjects;
+	meshletConfig.queueFamilies = getSharedQueueFamilies();
+	meshletConfig.drawMeshTasks = drawMeshTasks;
+	meshletConfig.meshShaderProperties = meshShaderProperties;
+	meshletConfig.occlusion = &occlusion;
+
+	MeshletRenderer::Path path = meshShading ? MeshletRenderer::Path::MeshShader : MeshletRenderer::Path::ComputeExpand;
+	meshletCulling = meshletRenderer.init(device, physicalDevice, path, meshes, meshletConfig);
+	if (meshletCulling)
+	{
+		std::cout << "[Meshlets]: Culling up to " << meshes.get(sceneMesh).lods[0].meshletCount << " meshlets per object with "
+			<< meshletPathName(path) << "\n";
+	}
+}
+
+void Engine::createInstanceRenderer()
+{
+	if (config.markerCount == 0)
+	{
+		return;
+	}
+
+	InstanceRendererConfig instanceConfig;
+	instanceConfig.shaderDir = utils::getExecutableDir() / "res/shaders";
+	instanceConfig.renderPass = renderPass;
+	instanceConfig.maxInstances = config.markerCount;
+	instanceConfig.framesInFlight = 1;	//drawFrame waits for the previous frame before packing the next one
+	instanceConfig.drawPerInstance = !config.instancing;
+	instanceConfig.queueFamilies = { queryQueueFamilyIndices(physicalDevice).graphicsFamily.value() };
+
+	instanceRendering = instances.init(device, physicalDevice, stateCache, pipelineCompiler, meshes, instanceConfig);
+	if (!instanceRendering)
+	{
+		return;
+	}
+
+	InstanceMaterialInfo doubleSided;
+	doubleSided.cullMode = VK_CULL_MODE_NONE;
+	markerMaterials[0] = instances.createMaterial(InstanceMaterialInfo{});
+	markerMaterials[1] = instances.createMaterial(doubleSided);
+
+	std::cout << "[Instancing]: Drawing " << config.markerCount << " markers with "
+		<< (config.instancing ? "one draw per mesh and material" : "one draw each") << "\n";
+}
+
+void Engine::createClusteredLighting()
+{
+	if (config.lightCount == 0)
+	{
+		return;
+	}
+
+	uint32_t graphicsFamily = queryQueueFamilyIndices(physicalDevice).graphicsFamily.value();
+	ClusteredLightingConfig lightingConfig;
+	lightingConfig.shaderDir = utils::getExecutableDir() / "res/shaders";
+	lightingConfig.maxLights = config.lightCount;
+	lightingConfig.framesInFlight = 1;	//drawFrame waits for the previous frame before writing the next one's lights
+	lightingConfig.queueFamilies = { graphicsFamily };
+
+	clusteredLighting = lighting.init(device, physicalDevice, stateCache, lightingConfig);
+	if (!clusteredLighting)
+	{
+		return;
+	}
+	shadingTimed = shadingTimer.init(device, physicalDevice, graphicsFamily);
+
+	const ClusterGrid& grid = lighting.getGrid();
+	std::cout << "[Lighting]: " << config.lightCount << " point lights binned into " << grid.tilesX << "x" << grid.tilesY
+		<< "x" << grid.slices << " clusters\n";
+}
+
+void Engine::createParticleSystem()
+{
+	if (config.particleCount == 0)
+	{
+		return;
+	}
+
+	//a fountain rising from the bottom of the screen, depth is reversed so it's in front of the scene at 0
+	ParticleConfig particleConfig;
+	particleConfig.shaderDir = utils::getExecutableDir() / "res/shaders";
+	particleConfig.renderPass = renderPass;
+	particleConfig.maxParticles = config.particleCount;
+	particleConfig.sort = config.particleSort;
+	particleConfig.emitterPosition = glm::vec3(0.0f, 0.9f, 0.5f);
+	particleConfig.emitterRadius = 0.02f;
+	particleConfig.lifetime = 2.0f;
+	particleConfig.speed = 1.6f;
+	particleConfig.gravity = 1.2f;
+	particleConfig.particleSize = 0.004f;
+	particleConfig.queueFamilies = { queryQueueFamilyIndices(physicalDevice).graphicsFamily.value() };
+
+	particleRendering = particles.init(device, physicalDevice, stateCache, pipelineCompiler, particleConfig);
+	if (particleRendering)
+	{
+		std::cout << "[Particles]: Up to " << config.particleCount << " particles simulated in compute, "
+			<< (config.particleSort ? "sorted and alpha blended" : "unsorted and additive") << "\n";
+	}
+}
+
+//Picks every object's level of detail for this frame, before culling so the CPU and GPU paths draw the same levels.
+void Engine::selectLods(const SceneSnapshot& _snapshot)
+{
+	const GpuMesh& mesh = meshes.get(sceneMesh);
+	size_t objectCount = _snapshot.objectBounds.size();
+	//the identity view projection maps [-1, 1] onto the viewport, so a unit of error covers half its height in pixels
+	float pixelsPerUnit = renderExtent.height * 0.5f;
+	lodSelector.select(_snapshot.objectBounds, objectCount, glm::value_ptr(_snapshot.cameraPosition), pixelsPerUnit,
+		mesh.lods, mesh.lodCount, lodConfig);
+
+	const std::vector<uint8_t>& levels = lodSelector.getLevels();
+	for (size_t i = 0; i < objectCount; ++i)
+	{
+		stats.lodTriangles += mesh.lods[levels[i]].indexCount / 3;
+	}
+	stats.fullDetailTriangles += static_cast<uint64_t>(objectCount) * (mesh.lods[0].indexCount / 3);
+}
+
+//Every visible object draws with the scene texture, the largest one on screen decides the finest mip it needs.
+//Projected like selectLods does, the bounding sphere's diameter stands in for the texture's extent on screen.
+void Engine::requestSceneTexture(const SceneSnapshot& _snapshot)
+{
+	cullSpheres(_snapshot.objectBounds, _snapshot.cameraFrustum, textureDemandVisible);
+	if (textureDemandVisible.empty())
+	{
+		return;
+	}
+
+	const BoundingSpheres& bounds = _snapshot.objectBounds;
+	const glm::vec4& camera = _snapshot.cameraPosition;
+	float pixelsPerUnit = renderExtent.height * 0.5f;
+	float screenPixels = 0.0f;
+	for (uint32_t object : textureDemandVisible)
+	{
+		float radius = bounds.radius[object];
+		float scale = pixelsPerUnit;
+		if (camera.w != 0.0f)
+		{
+			//perspective: the sphere's near side is where its texels are the largest
+			glm::vec3 offset = glm::vec3(bounds.centerX[object], bounds.centerY[object], bounds.centerZ[object]) - glm::vec3(camera);
+			scale /= std::max(glm::length(offset) - radius, 1e-4f);
+		}
+		screenPixels = std::max(screenPixels, 2.0f * radius * scale);
+	}
+
+	VkExtent2D extent = textures.getExtent(sceneTexture);
+	textures.requestMip(sceneTexture, mipForScreenSize(extent.width, extent.height, screenPixels));
+}
+
+//Markers on a grid in front of the scene, each spinning and in one of two materials, so they make two groups.
+void Engine::updateMarkers(const SceneSnapshot& _snapshot)
+{
+	uint32_t markerCount = config.markerCount;
+	InstanceBatcher& batcher = instances.beginFrame();
+	InstanceData* runs[2] = {
+		batcher.allocate(sceneMesh, markerMaterials[0], (markerCount + 1) / 2),
+		batcher.allocate(sceneMesh, markerMaterials[1], markerCount / 2)
+	};
+
+	uint32_t columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(markerCount))));
+	float spacing = 2.0f / columns;
+	float scale = spacing * 0.4f;
+	float time = static_cast<float>(_snapshot.simulationTime);
+	jobs.parallelFor(0, markerCount, 4096, [&](uint32_t _first, uint32_t _last)
+	{
+		for (uint32_t i = _first; i < _last; ++i)
+		{
+			float x = -1.0f + spacing * (i % columns + 0.5f);
+			float y = -1.0f + spacing * (i / columns + 0.5f);
+			float angle = time + i * 0.01f;
+			float c = std::cos(angle) * scale;
+			float s = std::sin(angle) * scale;
+
+			//depth is reversed, 0.5 is in front of the scene at 0
+			InstanceData& marker = runs[i & 1][i >> 1];
+			marker.transform[0] = glm::vec4(c, -s, 0.0f, x);
+			marker.transform[1] = glm::vec4(s, c, 0.0f, y);
+			marker.transform[2] = glm::vec4(0.0f, 0.0f, scale, 0.5f);
+			marker.color = 0xff000000u | ((i * 2654435761u >> 8) & 0x00ffffffu);
+			marker.custom[0] = marker.custom[1] = marker.custom[2] = 0.0f;
+		}
+	});
+
+	instances.endFrame();
+}
+
+//The lighting benchmark scene: every light drifts through the view volume on a curve of its own. Radii shrink as
+//lights are added so about as many of them overlap any point whatever the count, the case clustering is built for.
+void Engine::updateLights(const SceneSnapshot& _snapshot)
+{
+	uint32_t lightCount = config.lightCount;
+	frameLights.resize(lightCount);
+	float radius = 0.6f * std::cbrt(16.0f / lightCount);
+	float time = static_cast<float>(_snapshot.simulationTime);
+	for (uint32_t i = 0; i < lightCount; ++i)
+	{
+		uint32_t hash = i * 2654435761u;
+		float phase = (hash & 0xffffu) / 65535.0f * 6.2831853f;
+		float speed = 0.2f + ((hash >> 16) & 0xffu) / 255.0f * 0.3f;
+
+		PointLight& light = frameLights[i];
+		light.position = glm::vec3(
+			0.9f * std::sin(time * speed + phase),
+			0.9f * std::cos(time * speed * 1.3f + phase * 2.0f),
+			0.5f + 0.45f * std::sin(time * speed * 0.7f + phase * 3.0f));
+		light.radius = radius;
+		light.color = 2.0f * glm::vec3(((hash >> 8) & 0xffu) / 255.0f, ((hash >> 16) & 0xffu) / 255.0f, (hash >> 24) / 255.0f);
+	}
+	lighting.beginFrame(frameLights.data(), lightCount, _snapshot.cameraViewProjection);
+}
+
+void Engine::uploadObjectBounds(const SceneSnapshot& _snapshot)
+{
+	//objects past the capacity aren't drawn at all
+	gpuObjectCount = static_cast<uint32_t>(std::min<size_t>(_snapshot.objectBounds.size(), MaxGpuObjects));
+
+	float* spheres = static_cast<float*>(objectBoundsMapped);
+	for (uint32_t i = 0; i < gpuObjectCount; ++i)
+	{
+		spheres[i * 4 + 0] = _snapshot.objectBounds.centerX[i];
+		spheres[i * 4 + 1] = _snapshot.objectBounds.centerY[i];
+		spheres[i * 4 + 2] = _snapshot.objectBounds.centerZ[i];
+		spheres[i * 4 + 3] = _snapshot.objectBounds.radius[i];
+	}
+
+	//matches ObjectLods in the culling shaders
+	const GpuMesh& mesh = meshes.get(sceneMesh);
+	const std::vector<uint8_t>& levels = lodSelector.getLevels();
+	uint32_t* lods = static_cast<uint32_t*>(objectLodMapped);
+	for (uint32_t i = 0; i < gpuObjectCount; ++i)
+	{
+		const MeshLod& lod = mesh.lods[levels[i]];
+		lods[i * 4 + 0] = lod.firstIndex;
+		lods[i * 4 + 1] = lod.indexCount;
+		lods[i * 4 + 2] = lod.firstMeshlet;
+		lods[i * 4 + 3] = lod.meshletCount;
+	}
+}
+
+//Records the culling dispatch for the bounds uploadObjectBounds wrote. The same command buffer is used
+//whether it ends up on the async compute queue or the graphics queue, so both paths give identical draws.
+void Engine::recordComputeCommandBuffer(VkCommandBuffer _commandBuffer, const SceneSnapshot& _snapshot)
+{
+	VkCommandBufferBeginInfo commandBufferBeginInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,	//sType
+		nullptr,										//pNext
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,	//flags
+		nullptr											//pInheritanceInfo
+	};
+	if (vkBeginCommandBuffer(_commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_CommandBuffer]: Couldn't begin recording the compute Command Buffer!");
+	}
+
+	//with occlusion culling this is only the early phase, the late one runs in the graphics submit once the pyramid is built
+	CullPhase phase = occlusionCulling ? CullPhase::Early : CullPhase::All;
+	if (meshletCulling)
+	{
+		meshletRenderer.recordCulling(_commandBuffer, sceneMesh, phase);
+	}
+	else {
+		recordCulling(_commandBuffer, _snapshot.cameraFrustum, phase);
+	}
+
+	if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_CommandBuffer]: Couldn't end recording the compute Command Buffer!");
 	}
 }
 
-void Engine::createCommandBuffer()
+void Engine::recordCulling(VkCommandBuffer _commandBuffer, const Frustum& _frustum, CullPhase _phase)
 {
-	VkCommandBufferAllocateInfo commandBufferAllocateInfo{
-		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, //sType
-		nullptr,										//pNext
-		commandPool,									//commandPool
-		VK_COMMAND_BUFFER_LEVEL_PRIMARY,				//level
-		1												//commandBufferCount
-	};
+	CullPushConstants pushConstants;
+	std::memcpy(pushConstants.planes, _frustum.planes, sizeof(pushConstants.planes));
+	pushConstants.objectCount = gpuObjectCount;
+	pushConstants.phase = static_cast<uint32_t>(_phase);
+
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipeline);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cullPipelineLayout, 0, 1, &cullDescriptorSet, 0, nullptr);
+	vkCmdPushConstants(_commandBuffer, cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPushConstants), &pushConstants);
+	vkCmdDispatch(_commandBuffer, (gpuObjectCount + 63) / 64, 1, 1);
+}
 
-	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("[VK_Device]: Couldn't allocate Command Buffer!");
+//Rewrites the draws the early phase just consumed, so the late pass can reuse the same indirect buffers.
+void Engine::recordLateCulling(VkCommandBuffer _commandBuffer)
+{
+	//the early draws have to be read before they're overwritten, an execution dependency is enough for that
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 0, nullptr);
+
+	if (meshletCulling)
+	{
+		meshletRenderer.recordCulling(_commandBuffer, sceneMesh, CullPhase::Late);
+	}
+	else {
+		recordCulling(_commandBuffer, frameFrustum, CullPhase::Late);
 	}
+
+	VkMemoryBarrier drawsWritten{
+		VK_STRUCTURE_TYPE_MEMORY_BARRIER,		//sType
+		nullptr,								//pNext
+		VK_ACCESS_SHADER_WRITE_BIT,				//srcAccessMask
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT		//dstAccessMask
+	};
+	vkCmdPipelineBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		0, 1, &drawsWritten, 0, nullptr, 0, nullptr);
 }
 
-void Engine::createSyncObjects()
+void Engine::createFrameGraph()
 {
-	VkSemaphoreCreateInfo semaphoreCreateInfo{
-		VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,	//sType
-		nullptr,									//pNext
-		0											//flags
-	};
+	//the swapchain image arrives through the acquire semaphore, which the submit waits on at COLOR_ATTACHMENT_OUTPUT
+	backbuffer = frameGraph.importImage("backbuffer", VK_IMAGE_ASPECT_COLOR_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
 
-	VkFenceCreateInfo fenceCreateInfo{
-		VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,		//sType
-		nullptr,									//pNext
-		VK_FENCE_CREATE_SIGNALED_BIT				//flags	-> first frame waits for a signaled fence
-	};
+	//with dynamic resolution the scene renders offscreen and is upscaled into the backbuffer, nothing reads it after that
+	sceneTarget = backbuffer;
+	if (dynamicResolution)
+	{
+		TransientImageDesc sceneDesc;
+		sceneDesc.format = swapchainImageFormat;
+		sceneDesc.extent = sceneExtent;
+		sceneTarget = frameGraph.createTransientImage("scene color", sceneDesc);
+	}
 
-	if (vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(device, &semaphoreCreateInfo, nullptr, &renderFinishedSemaphore) != VK_SUCCESS ||
-		vkCreateFence(device, &fenceCreateInfo, nullptr, &inFlightFence) != VK_SUCCESS) 
+	//nothing needs depth from the previous frame, every frame starts by clearing it
+	TransientImageDesc depthDesc;
+	depthDesc.format = depthFormat;
+	depthDesc.extent = sceneExtent;
+	depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+	depthBuffer = frameGraph.createTransientImage("depth", depthDesc);
+
+	//the particle buffers aren't graph resources, the simulation leaves them readable by the draw itself
+	if (particleRendering)
 	{
-		throw std::runtime_error("[VK_Device]: Couldn't create necessary Synchronization Objects!");
+		frameGraph.addPass("particles", [this](VkCommandBuffer _commandBuffer) { particles.recordSimulation(_commandBuffer); })
+			.keepAlive();
+	}
+	//neither are the cluster lists, binning leaves them readable by fragment shaders
+	if (clusteredLighting)
+	{
+		frameGraph.addPass("lights", [this](VkCommandBuffer _commandBuffer) { lighting.recordBinning(_commandBuffer); })
+			.keepAlive();
+	}
+
+	if (occlusionCulling)
+	{
+		//early: what was visible last frame, then the pyramid from its depth, then whatever that reveals on top
+		frameGraph.addPass("early", [this](VkCommandBuffer _commandBuffer) { recordMainPass(_commandBuffer, CullPhase::Early); })
+			.use(sceneTarget, ImageUsage::ColorAttachmentWrite)
+			.use(depthBuffer, ImageUsage::DepthAttachmentWrite);
+		//the pyramid and visibility flags aren't graph resources, so neither of these may be culled
+		frameGraph.addPass("hiz", [this](VkCommandBuffer _commandBuffer) { occlusion.build(_commandBuffer); })
+			.use(depthBuffer, ImageUsage::SampledCompute)
+			.keepAlive();
+		//task shaders cull the late phase while drawing it
+		if (!(meshletCulling && meshletRenderer.getPath() == MeshletRenderer::Path::MeshShader))
+		{
+			frameGraph.addPass("cull late", [this](VkCommandBuffer _commandBuffer) { recordLateCulling(_commandBuffer); })
+				.keepAlive();
+		}
+		frameGraph.addPass("late", [this](VkCommandBuffer _commandBuffer) { recordMainPass(_commandBuffer, CullPhase::Late); })
+			.use(sceneTarget, ImageUsage::ColorAttachmentReadWrite)
+			.use(depthBuffer, ImageUsage::DepthAttachmentReadWrite);
 	}
+	else {
+		frameGraph.addPass("main", [this](VkCommandBuffer _commandBuffer) { recordMainPass(_commandBuffer, CullPhase::All); })
+			.use(sceneTarget, ImageUsage::ColorAttachmentWrite)
+			.use(depthBuffer, ImageUsage::DepthAttachmentWrite);
+	}
+
+	if (dynamicResolution)
+	{
+		frameGraph.addPass("upscale", [this](VkCommandBuffer _commandBuffer) { upscaler.record(_commandBuffer, 0, currentImageIndex, renderExtent); })
+			.use(sceneTarget, ImageUsage::SampledFragment)
+			.use(backbuffer, ImageUsage::ColorAttachmentWrite);
+	}
+
+	frameGraph.markOutput(backbuffer);
+
+	for (uint32_t i = 0; i < outputs.size(); ++i)
+	{
+		outputBackbuffers.push_back(frameGraph.importImage("output " + std::to_string(i + 2), VK_IMAGE_ASPECT_COLOR_BIT,
+			VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR));
+		frameGraph.addPass("upscale " + std::to_string(i + 2), [this, i](VkCommandBuffer _commandBuffer)
+			{
+				if (outputs[i].isAcquired())
+				{
+					upscaler.record(_commandBuffer, i + 1, outputs[i].getImageIndex(), renderExtent);
+				}
+			})
+			.use(sceneTarget, ImageUsage::SampledFragment)
+			.use(outputBackbuffers[i], ImageUsage::ColorAttachmentWrite);
+		frameGraph.markOutput(outputBackbuffers[i]);
+	}
+	frameGraph.compile(device, physicalDevice);
+	frameGraph.printSummary();
 
+	//the transients only exist from here on, the framebuffers are created from them right after
+	if (occlusionCulling)
+	{
+		occlusion.setDepthView(frameGraph.getImageView(depthBuffer));
+	}
+	if (dynamicResolution)
+	{
+		upscaler.setSource(frameGraph.getImageView(sceneTarget));
+	}
 }
 
 void Engine::recordCommandBuffer(VkCommandBuffer _commandBuffer, uint32_t _imageIndex)
@@ -706,56 +2688,211 @@ void Engine::recordCommandBuffer(VkCommandBuffer _commandBuffer, uint32_t _image
 		0,												//flags
 		nullptr											//pInheritanceInfo
 	};
-	if (vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
+	if (vkBeginCommandBuffer(_commandBuffer, &commandBufferBeginInfo) != VK_SUCCESS) {
 		throw std::runtime_error("[VK_CommandBuffer]: Couldn't begin recording Command Buffer!");
 	}
-	
-	VkClearValue clearColorValue = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+
+	//push constants don't carry over between command buffers
+	meshConstants.reset();
+	currentImageIndex = _imageIndex;
+	frameGraph.setImportedImage(backbuffer, swapchainImages[_imageIndex], swapchainImageViews[_imageIndex]);
+	for (size_t i = 0; i < outputs.size(); ++i)
+	{
+		if (!outputs[i].isAcquired())
+		{
+			frameGraph.skipImportedImage(outputBackbuffers[i]);
+			continue;
+		}
+		uint32_t outputImage = outputs[i].getImageIndex();
+		frameGraph.setImportedImage(outputBackbuffers[i], outputs[i].getImages()[outputImage], outputs[i].getImageViews()[outputImage]);
+	}
+	if (dynamicResolution)
+	{
+		//starts once the acquire wait is over, so time spent waiting for the swapchain doesn't lower the resolution
+		frameTimer.begin(_commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+	}
+	frameGraph.execute(_commandBuffer);
+	if (dynamicResolution)
+	{
+		frameTimer.end(_commandBuffer);
+	}
+
+	if (vkEndCommandBuffer(_commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_CommandBuffer]: Couldn't end recording Command Buffer!");
+	}
+}
+
+void Engine::recordMainPass(VkCommandBuffer _commandBuffer, CullPhase _phase)
+{
+	VkClearValue clearValues[2];
+	clearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
+	clearValues[1].depthStencil = { 0.0f, 0 };	//reversed depth, 0 is the far plane
 	VkRenderPassBeginInfo renderPassBeginInfo{
 		VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,	//sType
 		nullptr,									//pNext
-		renderPass,									//renderPass
-		swapchainFramebuffers[_imageIndex],			//framebuffer
+		_phase == CullPhase::Late ? loadRenderPass : renderPass,	//renderPass
+		dynamicResolution ? sceneFramebuffer : swapchainFramebuffers[currentImageIndex],	//framebuffer
 		VkRect2D {									//renderArea
 			VkOffset2D { 0, 0 },
-			swapchainImageExtent 
+			renderExtent
 		},
-		1,											//clearValueCount
-		&clearColorValue							//pClearValues
+		2,											//clearValueCount
+		clearValues									//pClearValues
 	};
-	vkCmdBeginRenderPass(commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
+	//queries are reset outside of render passes, the timer covers both occlusion phases and what runs between them
+	bool meshShading = meshletCulling && meshletRenderer.getPath() == MeshletRenderer::Path::MeshShader;
+	bool timeShading = clusteredLighting && shadingTimed && !meshShading;
+	if (timeShading && _phase != CullPhase::Late)
+	{
+		shadingTimer.begin(_commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+	}
+	vkCmdBeginRenderPass(_commandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 	VkViewport viewport{
 		0.0f,											//x
 		0.0f,											//y
-		static_cast<float>(swapchainImageExtent.width), //width
-		static_cast<float>(swapchainImageExtent.height),//height
+		static_cast<float>(renderExtent.width),		//width
+		static_cast<float>(renderExtent.height),	//height
 		0.0f,											//minDepth
 		1.0f											//maxDepth
 	};
-	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetViewport(_commandBuffer, 0, 1, &viewport);
 
 	VkRect2D scissor{
-		VkOffset2D {0, 0},		//offset
-		swapchainImageExtent	//extent
+		VkOffset2D {0, 0},	//offset
+		renderExtent		//extent
 	};
-	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	vkCmdSetScissor(_commandBuffer, 0, 1, &scissor);
+	if (capturingFrame)
+	{
+		captureMainPass(_phase);
+	}
 
-	vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+	if (meshShading)
+	{
+		//task shaders cull every object's meshlets, nothing goes through the vertex pipeline
+		meshletRenderer.recordDraw(_commandBuffer, sceneMesh, _phase);
+		recordOverlays(_commandBuffer, _phase);
+		vkCmdEndRenderPass(_commandBuffer);
+		return;
+	}
 
-	vkCmdEndRenderPass(commandBuffer);
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, meshPipeline->pipeline.load(std::memory_order_acquire));
 
-	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
-		throw std::runtime_error("[VK_CommandBuffer]: Couldn't end recording Command Buffer!");
+	const GpuMesh& mesh = meshes.get(sceneMesh);
+	MeshPushConstants pushConstants{
+		{ mesh.positionOffset[0], mesh.positionOffset[1], mesh.positionOffset[2], 0.0f },	//positionOffset
+		{ mesh.positionScale[0], mesh.positionScale[1], mesh.positionScale[2], 0.0f }		//positionScale
+	};
+	meshConstants.push(_commandBuffer, pipelineLayout, pushConstants);
+	if (clusteredLighting)
+	{
+		lighting.bind(_commandBuffer, pipelineLayout, sizeof(MeshPushConstants), renderExtent);
+	}
+	else if (sceneTextured)
+	{
+		vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &sceneTextureSet, 0, nullptr);
+	}
+	meshes.bind(_commandBuffer, sceneMesh);
+
+	//the object index goes in as the instance index so shaders can look up per-object data with gl_InstanceIndex
+	if (meshletCulling)
+	{
+		//one draw per meshlet of every object, culled ones have an instance count of 0
+		meshletRenderer.recordDraw(_commandBuffer, sceneMesh, _phase);
+	}
+	else if (gpuCulling)
+	{
+		//one draw per object, culled ones (and in the late phase the ones the early phase drew) have an instance count of 0
+		vkCmdDrawIndexedIndirect(_commandBuffer, drawCommandBuffer, 0, gpuObjectCount, sizeof(VkDrawIndexedIndirectCommand));
+	}
+	else {
+		const std::vector<uint8_t>& levels = lodSelector.getLevels();
+		for (uint32_t objectIndex : visibleObjects)
+		{
+			const MeshLod& lod = mesh.lods[levels[objectIndex]];
+			vkCmdDrawIndexed(_commandBuffer, lod.indexCount, 1, lod.firstIndex, 0, objectIndex);
+		}
+	}
+
+	recordOverlays(_commandBuffer, _phase);
+	//overlays and the culling between the occlusion phases push through layouts of their own
+	meshConstants.reset();
+
+	vkCmdEndRenderPass(_commandBuffer);
+	if (timeShading && _phase != CullPhase::Early)
+	{
+		shadingTimer.end(_commandBuffer);
+	}
+}
+
+//The main pass as the vertex pipeline draws it without culling on the GPU: every object at its level of detail, or
+//the visible ones when culling on the CPU. GPU culled frames record the objects handed to culling, since which of them
+//survive is only known once the frame ran, and the two occlusion phases become one pass.
+void Engine::captureMainPass(CullPhase _phase)
+{
+	if (_phase != CullPhase::Late)
+	{
+		const float clearColor[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		capture.beginPass(clearColor, 0.0f);
+
+		const GpuMesh& mesh = meshes.get(sceneMesh);
+		MeshPushConstants pushConstants{
+			{ mesh.positionOffset[0], mesh.positionOffset[1], mesh.positionOffset[2], 0.0f },	//positionOffset
+			{ mesh.positionScale[0], mesh.positionScale[1], mesh.positionScale[2], 0.0f }		//positionScale
+		};
+		capture.bindPipeline(meshPipelineKey);
+		capture.pushConstants(VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(MeshPushConstants), &pushConstants);
+		capture.bindVertexBuffer(captureVertexBuffer, 0);
+		capture.bindIndexBuffer(captureIndexBuffer, 0, mesh.indexType);
+
+		const std::vector<uint8_t>& levels = lodSelector.getLevels();
+		auto drawObject = [&](uint32_t _objectIndex)
+		{
+			const MeshLod& lod = mesh.lods[levels[_objectIndex]];
+			capture.drawIndexed(lod.indexCount, 1, lod.firstIndex, 0, _objectIndex);
+		};
+		if (gpuCulling)
+		{
+			for (uint32_t objectIndex = 0; objectIndex < gpuObjectCount; ++objectIndex)
+			{
+				drawObject(objectIndex);
+			}
+		}
+		else {
+			for (uint32_t objectIndex : visibleObjects)
+			{
+				drawObject(objectIndex);
+			}
+		}
+	}
+	if (_phase != CullPhase::Early)
+	{
+		capture.endPass();
+	}
+}
+
+//What's drawn on top of the culled objects, in whichever main pass phase it belongs to.
+void Engine::recordOverlays(VkCommandBuffer _commandBuffer, CullPhase _phase)
+{
+	//instances aren't culled, the late phase would draw them twice
+	if (instanceRendering && _phase != CullPhase::Late)
+	{
+		instances.record(_commandBuffer, frameViewProjection);
+	}
+	//particles don't write depth, so they go after every opaque draw or opaque objects behind them would cover them
+	if (particleRendering && _phase != CullPhase::Early)
+	{
+		particles.recordDraw(_commandBuffer, frameViewProjection,
+			static_cast<float>(renderExtent.width) / static_cast<float>(renderExtent.height));
 	}
 }
 
 int Engine::rateDeviceSuitability(VkPhysicalDevice _device)
 {
 	//if all required queue families aren't found, don't use the device
-	if (!queryQueueFamilyIndices(_device).isComplete())
+	QueueFamilyIndices indices = queryQueueFamilyIndices(_device);
+	if (!indices.isComplete())
 	{
 		return -1;
 	}
@@ -783,19 +2920,28 @@ int Engine::rateDeviceSuitability(VkPhysicalDevice _device)
 	{
 		score += 1000;
 	}
-	if (queryQueueFamilyIndices(_device).graphicsFamily == queryQueueFamilyIndices(_device).presentFamily)
+	if (indices.graphicsFamily == indices.presentFamily)
 	{
 		//better performance if graphics and presentation is done on the same queue
 		score += 50;
 		//Note: It may actually be faster with multiple queues running concurrently but that would require manual tranfer of ownership. Look into it later.
 	}
 
+	//between otherwise equal devices, more VRAM means fewer textures have to drop mips
+	score += static_cast<int>(std::min<VkDeviceSize>(queryDeviceMemoryInfo(_device).deviceLocalBytes >> 30, 64));
+
 	return score;
 }
 
 //Returns the indices of all required Queue Families supported by the device.
 Engine::QueueFamilyIndices Engine::queryQueueFamilyIndices(VkPhysicalDevice _device)
 {
+	auto cached = queueFamilyCache.find(_device);
+	if (cached != queueFamilyCache.end())
+	{
+		return cached->second;
+	}
+
 	QueueFamilyIndices indices;
 
 	uint32_t queueFamilyCount = 0;
@@ -824,6 +2970,18 @@ Engine::QueueFamilyIndices Engine::queryQueueFamilyIndices(VkPhysicalDevice _dev
 		}
 	}
 
+	//a family with compute but no graphics runs independently of the graphics queue
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		VkQueueFlags flags = queueFamilyProperties.at(i).queueFlags;
+		if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+		{
+			indices.computeFamily = i;
+			break;
+		}
+	}
+
+	queueFamilyCache[_device] = indices;
 	return indices;
 }
 
@@ -857,11 +3015,7 @@ Engine::SwapchainSupportDetails Engine::querySwapchainSupport(VkPhysicalDevice _
 bool Engine::checkDeviceExtensionSupport(VkPhysicalDevice _device)
 {
 	//Get all extensions supported by the device
-	uint32_t extensionCount = 0;
-	vkEnumerateDeviceExtensionProperties(_device, nullptr, &extensionCount, nullptr);
-
-	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-	vkEnumerateDeviceExtensionProperties(_device, nullptr, &extensionCount, availableExtensions.data());
+	const std::vector<VkExtensionProperties>& availableExtensions = getDeviceExtensions(_device);
 
 	//Make a set of all required extensions and remove them from the set if they're found. If all required extensions are found, the set is empty.
 	std::set<std::string> requiredExtensions(DeviceExtensions.begin(), DeviceExtensions.end());
@@ -873,6 +3027,179 @@ bool Engine::checkDeviceExtensionSupport(VkPhysicalDevice _device)
 	return requiredExtensions.empty();
 }
 
+//Enumerated once per device, the first time any of its extensions is asked about.
+const std::vector<VkExtensionProperties>& Engine::getDeviceExtensions(VkPhysicalDevice _device)
+{
+	auto cached = deviceExtensionCache.find(_device);
+	if (cached != deviceExtensionCache.end())
+	{
+		return cached->second;
+	}
+
+	uint32_t extensionCount = 0;
+	vkEnumerateDeviceExtensionProperties(_device, nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateDeviceExtensionProperties(_device, nullptr, &extensionCount, availableExtensions.data());
+	return deviceExtensionCache[_device] = std::move(availableExtensions);
+}
+
+bool Engine::hasDeviceExtension(VkPhysicalDevice _device, const char* _extension)
+{
+	for (const auto& extension : getDeviceExtensions(_device))
+	{
+		if (strcmp(extension.extensionName, _extension) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+//Heap sizes and whether the driver can report how much of them we may use.
+Engine::DeviceMemoryInfo Engine::queryDeviceMemoryInfo(VkPhysicalDevice _device)
+{
+	DeviceMemoryInfo info;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(_device, &memoryProperties);
+	info.heaps.assign(memoryProperties.memoryHeaps, memoryProperties.memoryHeaps + memoryProperties.memoryHeapCount);
+	for (const VkMemoryHeap& heap : info.heaps)
+	{
+		if (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+		{
+			info.deviceLocalBytes = std::max(info.deviceLocalBytes, heap.size);
+		}
+	}
+
+	info.memoryBudget = hasDeviceExtension(_device, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+	return info;
+}
+
+//VK_EXT_mesh_shader with task shaders, and SPIR-V 1.4 through extensions on devices older than 1.2. Fills meshShaderProperties.
+bool Engine::checkMeshShaderSupport(VkPhysicalDevice _device)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device, &properties);
+	//the features and properties below are only reachable through the 1.1 queries
+	if (instanceApiVersion < VK_API_VERSION_1_1 || properties.apiVersion < VK_API_VERSION_1_1)
+	{
+		return false;
+	}
+
+	if (!hasDeviceExtension(_device, VK_EXT_MESH_SHADER_EXTENSION_NAME))
+	{
+		return false;
+	}
+	if (properties.apiVersion < VK_API_VERSION_1_2 &&
+		(!hasDeviceExtension(_device, VK_KHR_SPIRV_1_4_EXTENSION_NAME) ||
+			!hasDeviceExtension(_device, VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME)))
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+	meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &meshShaderFeatures;
+	vkGetPhysicalDeviceFeatures2(_device, &features);
+	if (!meshShaderFeatures.taskShader || !meshShaderFeatures.meshShader)
+	{
+		return false;
+	}
+
+	meshShaderProperties = VkPhysicalDeviceMeshShaderPropertiesEXT{};
+	meshShaderProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_PROPERTIES_EXT;
+	VkPhysicalDeviceProperties2 properties2{};
+	properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	properties2.pNext = &meshShaderProperties;
+	vkGetPhysicalDeviceProperties2(_device, &properties2);
+
+	//meshlet.mesh writes up to MeshletMaxVertices and MeshletMaxTriangles, the task shader emits up to 32 groups
+	return meshShaderProperties.maxMeshOutputVertices >= MeshletMaxVertices &&
+		meshShaderProperties.maxMeshOutputPrimitives >= MeshletMaxTriangles;
+}
+
+//Present ids and waiting on them, the latter has to be checked through the 1.1 feature query.
+bool Engine::checkPresentWaitSupport(VkPhysicalDevice _device)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device, &properties);
+	if (instanceApiVersion < VK_API_VERSION_1_1 || properties.apiVersion < VK_API_VERSION_1_1)
+	{
+		return false;
+	}
+
+	if (!hasDeviceExtension(_device, VK_KHR_PRESENT_ID_EXTENSION_NAME) || !hasDeviceExtension(_device, VK_KHR_PRESENT_WAIT_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+	presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+	VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+	presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+	presentIdFeatures.pNext = &presentWaitFeatures;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &presentIdFeatures;
+	vkGetPhysicalDeviceFeatures2(_device, &features);
+	return presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+}
+
+bool Engine::checkPipelineLibrarySupport(VkPhysicalDevice _device)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(_device, &properties);
+	if (instanceApiVersion < VK_API_VERSION_1_1 || properties.apiVersion < VK_API_VERSION_1_1)
+	{
+		return false;
+	}
+
+	if (!hasDeviceExtension(_device, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) || !hasDeviceExtension(_device, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME))
+	{
+		return false;
+	}
+
+	VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+	pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+	VkPhysicalDeviceFeatures2 features{};
+	features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	features.pNext = &pipelineLibraryFeatures;
+	vkGetPhysicalDeviceFeatures2(_device, &features);
+	return pipelineLibraryFeatures.graphicsPipelineLibrary;
+}
+
+//Families that share buffers between graphics and compute, just the graphics family without async compute.
+std::vector<uint32_t> Engine::getSharedQueueFamilies()
+{
+	QueueFamilyIndices indices = queryQueueFamilyIndices(physicalDevice);
+	std::vector<uint32_t> families = { indices.graphicsFamily.value() };
+	if (computeFamily != indices.graphicsFamily.value())
+	{
+		families.push_back(computeFamily);
+	}
+	return families;
+}
+
+//D32 keeps reversed depth precise, D16 is the one format every device has to support as a depth attachment.
+VkFormat Engine::findDepthFormat()
+{
+	for (VkFormat format : { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM })
+	{
+		VkFormatProperties properties;
+		vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &properties);
+		VkFormatFeatureFlags required = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+		if ((properties.optimalTilingFeatures & required) == required)
+		{
+			return format;
+		}
+	}
+
+	throw std::runtime_error("[VK_Device]: No depth format that can also be sampled!");
+}
+
 //Returns the Surface Format to be used by the Swapchain.
 VkSurfaceFormatKHR Engine::chooseSwapSurfaceFormat(std::vector<VkSurfaceFormatKHR> _surfaceFormats)
 {
@@ -887,19 +3214,20 @@ VkSurfaceFormatKHR Engine::chooseSwapSurfaceFormat(std::vector<VkSurfaceFormatKH
 	return _surfaceFormats[0];
 }
 
-//Returns the way in which the Swapchain present images to the screen (Vsync, Triple Buffering etc.)
-VkPresentModeKHR Engine::choostSwapPresentMode(std::vector<VkPresentModeKHR> _presentModes)
+//Returns the way in which the Swapchain present images to the screen: the configured mode (IMMEDIATE doesn't wait for
+//vertical blanks and tears, FIFO_RELAXED only tears when a frame is late, MAILBOX replaces queued images, FIFO queues them)
+VkPresentModeKHR Engine::chooseSwapPresentMode(std::vector<VkPresentModeKHR> _presentModes)
 {
 	for (const VkPresentModeKHR& presentMode : _presentModes)
 	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (presentMode == config.presentMode)
 		{
-			//if Triple Buffering is supported, use it.
 			return presentMode;
 		}
 	}
 
 	//VSync (is required to be supported by Vulkan)
+	std::cout << "[Swapchain]: " << presentModeName(config.presentMode) << " isn't supported by the surface, using FIFO.\n";
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -933,15 +3261,15 @@ std::vector<const char*> Engine::getRequiredInstanceExtensions()
 	const char** glfwExtensions;
 	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
 
+	//Enumerated once, every extension below is checked against the same list
+	uint32_t extensionCount = 0;
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
+	std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+	vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
+
 	//Lambda to check if the required instance extension is supported by the Vulkan implementation.
-	auto checkInstanceExtensionSupport = [](const char* pExtension)
+	auto checkInstanceExtensionSupport = [&availableExtensions](const char* pExtension)
 	{
-		uint32_t extensionCount = 0;
-		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
-
-		std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-		vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, availableExtensions.data());
-
 		for (const auto& avail : availableExtensions) {
 			if (strcmp(pExtension, avail.extensionName) == 0) {
 				return true;
@@ -967,17 +3295,18 @@ std::vector<const char*> Engine::getRequiredInstanceExtensions()
 			throw std::runtime_error("[VK_Instance]: VK_EXT_debug_utils not available!");
 		}
 		extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+	}
 
-		if (checkInstanceExtensionSupport(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
-		{
-			extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
-		}
-		else {
-			std::cout << "[VK_Instance]: VK_KHR_get_physical_device_properties2 couldn't be loaded. Find stack trace to this function lol.";
-		}
-		//need to include this extension to prevent this warning(possibly wrong):
-		//[Validation Layer]: vkGetPhysicalDeviceProperties2KHR: Emulation found unrecognized structure type in pProperties->pNext - this struct will be ignored
-		//Genuinely think this is a bug with the vulkanSDK cuz it throws on the vkCreateDevice call which then calls vkGetPhysicalDeviceProperties
+	//needed for the memory budget queries, validation also warns without it(possibly wrong):
+	//[Validation Layer]: vkGetPhysicalDeviceProperties2KHR: Emulation found unrecognized structure type in pProperties->pNext - this struct will be ignored
+	//Genuinely think this is a bug with the vulkanSDK cuz it throws on the vkCreateDevice call which then calls vkGetPhysicalDeviceProperties
+	physicalDeviceProperties2 = checkInstanceExtensionSupport(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	if (physicalDeviceProperties2)
+	{
+		extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+	}
+	else {
+		std::cout << "[VK_Instance]: VK_KHR_get_physical_device_properties2 couldn't be loaded, texture budget falls back to heap sizes.\n";
 	}
 
 	return extensions;
@@ -1021,25 +3350,13 @@ void Engine::setupDebugMessenger()
 	}
 }
 
+//Shaders preloaded at startup come from the ShaderCache, it throws like opening the file would if it's missing.
 std::vector<char> Engine::readFile(const std::filesystem::path& filename) {
-	std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-	if (!file.is_open()) {
-		throw std::runtime_error(std::string("[CPU]: Failed to open file at: ") + filename.string());
-	}
-
 	std::cout << "[CPU]: Reading: " + filename.string() << "\n";
-	size_t fileSize = static_cast<size_t>(file.tellg());
-	std::vector<char> buffer(fileSize);
-
-	file.seekg(0);
-	file.read(buffer.data(), fileSize);
-
-	file.close();
-
-	return buffer;
+	return ShaderCache::get().read(filename);
 }
 
+//Modules are deduplicated by their code and live as long as the state cache, pipelines are keyed by them.
 VkShaderModule Engine::createShaderModule(std::vector<char>& code)
 {
 	VkShaderModuleCreateInfo createInfo {
@@ -1050,12 +3367,5 @@ VkShaderModule Engine::createShaderModule(std::vector<char>& code)
 		reinterpret_cast<const uint32_t*>(code.data())			//pCode
 	};
 
-	VkShaderModule shaderModule;
-
-	if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-	{
-		throw std::runtime_error("[VK_Device]: Failed to Create Shader Module.");
-	}
-
-	return shaderModule;
+	return stateCache.getShaderModule(createInfo);
 }
@@ -0,0 +1,304 @@
+#include <FrameCapture.hpp>
+
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint64_t alignOffset(uint64_t _offset)
+{
+	return (_offset + 15) & ~static_cast<uint64_t>(15);
+}
+
+static uint32_t lowWord(uint64_t _value)
+{
+	return static_cast<uint32_t>(_value);
+}
+
+static uint32_t highWord(uint64_t _value)
+{
+	return static_cast<uint32_t>(_value >> 32);
+}
+
+static uint32_t floatBits(float _value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &_value, sizeof(bits));
+	return bits;
+}
+
+void FrameCapture::push(CaptureOp _op, std::initializer_list<uint32_t> _args)
+{
+	CaptureCommand command{};
+	command.op = _op;
+	std::memcpy(command.args, _args.begin(), _args.size() * sizeof(uint32_t));
+	commands.push_back(command);
+}
+
+uint64_t FrameCapture::addData(const void* _data, size_t _size)
+{
+	uint64_t offset = alignOffset(data.size());
+	data.resize(offset + _size);
+	std::memcpy(data.data() + offset, _data, _size);
+	return offset;
+}
+
+uint32_t FrameCapture::createBuffer(VkBufferUsageFlags _usage, VkDeviceSize _size)
+{
+	uint32_t buffer = bufferCount++;
+	push(CaptureOp::CreateBuffer, { buffer, _usage, lowWord(_size), highWord(_size) });
+	return buffer;
+}
+
+void FrameCapture::uploadBuffer(uint32_t _buffer, VkDeviceSize _offset, const void* _data, size_t _size)
+{
+	uint64_t dataOffset = addData(_data, _size);
+	push(CaptureOp::UploadBuffer, { _buffer, lowWord(_offset), highWord(_offset), lowWord(dataOffset), highWord(dataOffset),
+		static_cast<uint32_t>(_size) });
+}
+
+void FrameCapture::beginPass(const float _clearColor[4], float _clearDepth)
+{
+	push(CaptureOp::BeginPass, { floatBits(_clearColor[0]), floatBits(_clearColor[1]), floatBits(_clearColor[2]),
+		floatBits(_clearColor[3]), floatBits(_clearDepth) });
+}
+
+void FrameCapture::endPass()
+{
+	push(CaptureOp::EndPass, {});
+}
+
+void FrameCapture::bindPipeline(const CapturePipelineKey& _key)
+{
+	uint32_t index = 0;
+	while (index < pipelines.size() && std::memcmp(&pipelines[index], &_key, sizeof(_key)) != 0)
+	{
+		index++;
+	}
+	if (index == pipelines.size())
+	{
+		pipelines.push_back(_key);
+	}
+	push(CaptureOp::BindPipeline, { index });
+}
+
+void FrameCapture::bindVertexBuffer(uint32_t _buffer, VkDeviceSize _offset)
+{
+	push(CaptureOp::BindVertexBuffer, { _buffer, lowWord(_offset), highWord(_offset) });
+}
+
+void FrameCapture::bindIndexBuffer(uint32_t _buffer, VkDeviceSize _offset, VkIndexType _indexType)
+{
+	push(CaptureOp::BindIndexBuffer, { _buffer, lowWord(_offset), highWord(_offset), static_cast<uint32_t>(_indexType) });
+}
+
+void FrameCapture::pushConstants(VkShaderStageFlags _stages, uint32_t _offset, uint32_t _size, const void* _values)
+{
+	uint64_t dataOffset = addData(_values, _size);
+	push(CaptureOp::PushConstants, { _stages, _offset, _size, lowWord(dataOffset), highWord(dataOffset) });
+}
+
+void FrameCapture::drawIndexed(uint32_t _indexCount, uint32_t _instanceCount, uint32_t _firstIndex, int32_t _vertexOffset,
+	uint32_t _firstInstance)
+{
+	push(CaptureOp::DrawIndexed, { _indexCount, _instanceCount, _firstIndex, static_cast<uint32_t>(_vertexOffset), _firstInstance });
+}
+
+void FrameCapture::draw(uint32_t _vertexCount, uint32_t _instanceCount, uint32_t _firstVertex, uint32_t _firstInstance)
+{
+	push(CaptureOp::Draw, { _vertexCount, _instanceCount, _firstVertex, _firstInstance });
+}
+
+void FrameCapture::write(const std::filesystem::path& _path, VkExtent2D _extent, VkFormat _colorFormat, VkFormat _depthFormat,
+	uint64_t _frame) const
+{
+	CaptureHeader header{};
+	std::memcpy(header.magic, CaptureMagic, sizeof(header.magic));
+	header.version = CaptureVersion;
+	header.width = _extent.width;
+	header.height = _extent.height;
+	header.colorFormat = static_cast<uint32_t>(_colorFormat);
+	header.depthFormat = static_cast<uint32_t>(_depthFormat);
+	header.commandCount = static_cast<uint32_t>(commands.size());
+	header.pipelineCount = static_cast<uint32_t>(pipelines.size());
+	header.commandOffset = sizeof(CaptureHeader);
+	header.pipelineOffset = alignOffset(header.commandOffset + commands.size() * sizeof(CaptureCommand));
+	header.dataOffset = alignOffset(header.pipelineOffset + pipelines.size() * sizeof(CapturePipelineKey));
+	header.dataSize = data.size();
+	header.frame = _frame;
+
+	std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[Capture]: Couldn't create " + _path.string());
+	}
+
+	//commands are 32 bytes, so only the end of the pipelines could need padding
+	const char padding[16] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(commands.data()), commands.size() * sizeof(CaptureCommand));
+	file.write(reinterpret_cast<const char*>(pipelines.data()), pipelines.size() * sizeof(CapturePipelineKey));
+	file.write(padding, header.dataOffset - header.pipelineOffset - pipelines.size() * sizeof(CapturePipelineKey));
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	if (!file)
+	{
+		throw std::runtime_error("[Capture]: Failed writing " + _path.string());
+	}
+}
+
+size_t FrameCapture::getCommandCount() const
+{
+	return commands.size();
+}
+
+CaptureFile::~CaptureFile()
+{
+	close();
+}
+
+void CaptureFile::close()
+{
+#ifdef _WIN32
+	if (bytes)
+	{
+		UnmapViewOfFile(bytes);
+	}
+	if (mapping)
+	{
+		CloseHandle(mapping);
+	}
+	if (file)
+	{
+		CloseHandle(file);
+	}
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (bytes)
+	{
+		munmap(const_cast<uint8_t*>(bytes), size);
+	}
+#endif
+	bytes = nullptr;
+	size = 0;
+}
+
+void CaptureFile::open(const std::filesystem::path& _path)
+{
+	close();
+
+#ifdef _WIN32
+	HANDLE handle = CreateFileW(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		throw std::runtime_error("[Capture]: Couldn't open " + _path.string());
+	}
+	file = handle;
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(handle, &fileSize) || fileSize.QuadPart < static_cast<LONGLONG>(sizeof(CaptureHeader)))
+	{
+		close();
+		throw std::runtime_error("[Capture]: " + _path.string() + " isn't a capture!");
+	}
+	size = static_cast<size_t>(fileSize.QuadPart);
+	mapping = CreateFileMappingW(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mapping)
+	{
+		bytes = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	}
+	if (!bytes)
+	{
+		close();
+		throw std::runtime_error("[Capture]: Couldn't map " + _path.string());
+	}
+#else
+	int descriptor = ::open(_path.c_str(), O_RDONLY);
+	if (descriptor < 0)
+	{
+		throw std::runtime_error("[Capture]: Couldn't open " + _path.string());
+	}
+	struct stat status;
+	if (fstat(descriptor, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(CaptureHeader)))
+	{
+		::close(descriptor);
+		throw std::runtime_error("[Capture]: " + _path.string() + " isn't a capture!");
+	}
+	//the mapping keeps the file referenced, the descriptor isn't needed past this
+	void* mapped = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+	::close(descriptor);
+	if (mapped == MAP_FAILED)
+	{
+		throw std::runtime_error("[Capture]: Couldn't map " + _path.string());
+	}
+	bytes = static_cast<const uint8_t*>(mapped);
+	size = static_cast<size_t>(status.st_size);
+#endif
+
+	const CaptureHeader& header = getHeader();
+	if (std::memcmp(header.magic, CaptureMagic, sizeof(header.magic)) != 0)
+	{
+		close();
+		throw std::runtime_error("[Capture]: " + _path.string() + " isn't a capture!");
+	}
+	if (header.version != CaptureVersion)
+	{
+		uint32_t version = header.version;
+		close();
+		throw std::runtime_error("[Capture]: " + _path.string() + " was written for format version " + std::to_string(version) +
+			", capture it again!");
+	}
+	//sections may not overlap the header or each other and have to stay aligned for the in place reads
+	uint64_t commandEnd = header.commandOffset + static_cast<uint64_t>(header.commandCount) * sizeof(CaptureCommand);
+	uint64_t pipelineEnd = header.pipelineOffset + static_cast<uint64_t>(header.pipelineCount) * sizeof(CapturePipelineKey);
+	if (header.commandOffset < sizeof(CaptureHeader) || header.commandOffset % 16 != 0 || header.pipelineOffset % 16 != 0 ||
+		header.dataOffset % 16 != 0 || header.pipelineOffset < commandEnd || header.dataOffset < pipelineEnd ||
+		header.dataOffset > size || header.dataSize > size - header.dataOffset)
+	{
+		close();
+		throw std::runtime_error("[Capture]: " + _path.string() + " is truncated or has sections out of place!");
+	}
+	for (uint32_t i = 0; i < header.commandCount; ++i)
+	{
+		if (getCommands()[i].op >= CaptureOp::OpCount)
+		{
+			close();
+			throw std::runtime_error("[Capture]: " + _path.string() + " has an unknown command!");
+		}
+	}
+}
+
+const CaptureHeader& CaptureFile::getHeader() const
+{
+	return *reinterpret_cast<const CaptureHeader*>(bytes);
+}
+
+const CaptureCommand* CaptureFile::getCommands() const
+{
+	return reinterpret_cast<const CaptureCommand*>(bytes + getHeader().commandOffset);
+}
+
+const CapturePipelineKey* CaptureFile::getPipelines() const
+{
+	return reinterpret_cast<const CapturePipelineKey*>(bytes + getHeader().pipelineOffset);
+}
+
+const uint8_t* CaptureFile::getData(uint64_t _offset, uint64_t _size) const
+{
+	const CaptureHeader& header = getHeader();
+	if (_offset > header.dataSize || _size > header.dataSize - _offset)
+	{
+		throw std::runtime_error("[Capture]: A command reads past the capture's data!");
+	}
+	return bytes + header.dataOffset + _offset;
+}
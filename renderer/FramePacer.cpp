@@ -0,0 +1,130 @@
+#include <FramePacer.hpp>
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+	//a present that takes longer than this to reach the display (a minimized window, a lost surface) isn't waited
+	//for any longer, the frame starts anyway
+	constexpr uint64_t PresentWaitTimeout = 100'000'000;	//ns
+
+	double seconds(FramePacer::Clock::duration _duration)
+	{
+		return std::chrono::duration<double>(_duration).count();
+	}
+}
+
+const char* presentModeName(VkPresentModeKHR _mode)
+{
+	switch (_mode)
+	{
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "IMMEDIATE";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "MAILBOX";
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "FIFO";
+	case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+		return "FIFO_RELAXED";
+	default:
+		return "unknown";
+	}
+}
+
+void FramePacer::init(VkDevice _device, VkSwapchainKHR _swapchain, PFN_vkWaitForPresentKHR _waitForPresent,
+	const FramePacerConfig& _config)
+{
+	device = _device;
+	swapchain = _swapchain;
+	config = _config;
+	waitForPresent = config.maxQueuedFrames > 0 ? _waitForPresent : nullptr;
+	//the oldest present waited on is maxQueuedFrames behind the newest one
+	inputTimes.assign(config.maxQueuedFrames + 1, Clock::time_point());
+	presentId = 0;
+	displayedId = 0;
+	started = false;
+	stats = FramePacingStats{};
+}
+
+void FramePacer::waitUntil(Clock::time_point _deadline)
+{
+	const Clock::duration spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.spinTime));
+	if (_deadline - spin > Clock::now())
+	{
+		std::this_thread::sleep_until(_deadline - spin);
+	}
+	while (Clock::now() < _deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void FramePacer::waitForFrameStart()
+{
+	Clock::time_point waitStart = Clock::now();
+
+	//after this frame's present there may be maxQueuedFrames waiting for the display, so the one that many behind it
+	//has to be on screen first
+	if (waitForPresent && presentId + 1 > config.maxQueuedFrames)
+	{
+		uint64_t target = presentId + 1 - config.maxQueuedFrames;
+		if (target > displayedId && waitForPresent(device, swapchain, target, PresentWaitTimeout) == VK_SUCCESS)
+		{
+			displayedId = target;
+			//after a timeout newer presents may have taken its slot
+			if (presentId - target < inputTimes.size())
+			{
+				double latency = seconds(Clock::now() - inputTimes[target % inputTimes.size()]);
+				stats.framesDisplayed++;
+				stats.inputToDisplayTotal += latency;
+				stats.inputToDisplayMax = std::max(stats.inputToDisplayMax, latency);
+			}
+		}
+	}
+
+	if (config.frameInterval > 0.0)
+	{
+		if (started)
+		{
+			nextFrame += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(config.frameInterval));
+			//if we fell behind, don't try to catch up with a burst of frames
+			if (nextFrame < Clock::now())
+			{
+				nextFrame = Clock::now();
+			}
+			waitUntil(nextFrame);
+		} else {
+			nextFrame = Clock::now();
+		}
+	}
+	started = true;
+
+	stats.waitTotal += seconds(Clock::now() - waitStart);
+}
+
+uint64_t FramePacer::nextPresentId() const
+{
+	return waitForPresent ? presentId + 1 : 0;
+}
+
+void FramePacer::presented(Clock::time_point _inputTime)
+{
+	presentId++;
+	inputTimes[presentId % inputTimes.size()] = _inputTime;
+
+	double latency = seconds(Clock::now() - _inputTime);
+	stats.presents++;
+	stats.inputToPresentTotal += latency;
+	stats.inputToPresentMax = std::max(stats.inputToPresentMax, latency);
+}
+
+bool FramePacer::limitsQueue() const
+{
+	return waitForPresent != nullptr;
+}
+
+const FramePacingStats& FramePacer::getStats() const
+{
+	return stats;
+}
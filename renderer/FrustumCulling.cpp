@@ -0,0 +1,301 @@
+#include <FrustumCulling.hpp>
+
+#include <array>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define CULLING_X86 1
+	#include <immintrin.h>
+	#if defined(_MSC_VER) && !defined(__clang__)
+		#include <intrin.h>
+		//MSVC emits any intrinsic regardless of the target flags
+		#define CULLING_TARGET_AVX2
+	#else
+		#define CULLING_TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+	#endif
+#else
+	#define CULLING_X86 0
+#endif
+
+void BoundingSpheres::resize(size_t _count)
+{
+	count = _count;
+	size_t padded = paddedSize();
+
+	centerX.resize(padded, 0.0f);
+	centerY.resize(padded, 0.0f);
+	centerZ.resize(padded, 0.0f);
+	radius.resize(padded, 0.0f);
+
+	//a radius of -inf fails every plane test, so the kernels can run over the padding without a scalar tail
+	for (size_t i = count; i < padded; ++i)
+	{
+		centerX[i] = centerY[i] = centerZ[i] = 0.0f;
+		radius[i] = -std::numeric_limits<float>::infinity();
+	}
+}
+
+void BoundingSpheres::set(size_t _index, float _x, float _y, float _z, float _radius)
+{
+	centerX[_index] = _x;
+	centerY[_index] = _y;
+	centerZ[_index] = _z;
+	radius[_index] = _radius;
+}
+
+size_t BoundingSpheres::size() const
+{
+	return count;
+}
+
+size_t BoundingSpheres::paddedSize() const
+{
+	return (count + SimdWidth - 1) / SimdWidth * SimdWidth;
+}
+
+Frustum Frustum::fromViewProjection(const float* _matrix)
+{
+	//row i of a column-major matrix
+	auto row = [_matrix](int _i, int _column) { return _matrix[_column * 4 + _i]; };
+
+	//Vulkan clip space: -w <= x <= w, -w <= y <= w, 0 <= z <= w
+	const int   rowIndex[6] = { 0, 0, 1, 1, 2, 2 };
+	const float rowSign[6] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+	const bool  addW[6] = { true, true, true, true, false, true };
+
+	Frustum frustum;
+	for (int p = 0; p < 6; ++p)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			frustum.planes[p][c] = (addW[p] ? row(3, c) : 0.0f) + rowSign[p] * row(rowIndex[p], c);
+		}
+
+		float length = std::sqrt(
+			frustum.planes[p][0] * frustum.planes[p][0] +
+			frustum.planes[p][1] * frustum.planes[p][1] +
+			frustum.planes[p][2] * frustum.planes[p][2]);
+		if (length > 0.0f)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				frustum.planes[p][c] /= length;
+			}
+		}
+	}
+
+	return frustum;
+}
+
+//Reference implementation, the SIMD kernels must produce exactly the same list.
+static uint32_t cullScalar(const BoundingSpheres& _spheres, const Frustum& _frustum, uint32_t* _out)
+{
+	uint32_t visibleCount = 0;
+
+	for (size_t i = 0; i < _spheres.size(); ++i)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6 && inside; ++p)
+		{
+			const float* plane = _frustum.planes[p];
+			//same association as the SIMD kernels so results match bit for bit
+			float distance = (plane[0] * _spheres.centerX[i] + plane[1] * _spheres.centerY[i]) + (plane[2] * _spheres.centerZ[i] + plane[3]);
+			inside = distance + _spheres.radius[i] >= 0.0f;
+		}
+
+		if (inside)
+		{
+			_out[visibleCount++] = static_cast<uint32_t>(i);
+		}
+	}
+
+	return visibleCount;
+}
+
+#if CULLING_X86
+
+static uint32_t cullSSE2(const BoundingSpheres& _spheres, const Frustum& _frustum, uint32_t* _out)
+{
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm_set1_ps(_frustum.planes[p][0]);
+		planeY[p] = _mm_set1_ps(_frustum.planes[p][1]);
+		planeZ[p] = _mm_set1_ps(_frustum.planes[p][2]);
+		planeW[p] = _mm_set1_ps(_frustum.planes[p][3]);
+	}
+	const __m128 zero = _mm_setzero_ps();
+
+	uint32_t visibleCount = 0;
+	const size_t padded = _spheres.paddedSize();
+
+	for (size_t i = 0; i < padded; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&_spheres.centerX[i]);
+		__m128 y = _mm_loadu_ps(&_spheres.centerY[i]);
+		__m128 z = _mm_loadu_ps(&_spheres.centerZ[i]);
+		__m128 r = _mm_loadu_ps(&_spheres.radius[i]);
+
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, r), zero));
+		}
+
+		//branchless compaction: always write the index, only advance past it if it was visible
+		int mask = _mm_movemask_ps(inside);
+		uint32_t base = static_cast<uint32_t>(i);
+		_out[visibleCount] = base;		visibleCount += mask & 1;
+		_out[visibleCount] = base + 1;	visibleCount += (mask >> 1) & 1;
+		_out[visibleCount] = base + 2;	visibleCount += (mask >> 2) & 1;
+		_out[visibleCount] = base + 3;	visibleCount += (mask >> 3) & 1;
+	}
+
+	return visibleCount;
+}
+
+//For every 8-bit visibility mask, the lane indices of the set bits packed into nibbles, lowest first.
+static const std::array<uint32_t, 256> compactionTable = []()
+{
+	std::array<uint32_t, 256> table{};
+	for (uint32_t mask = 0; mask < 256; ++mask)
+	{
+		uint32_t packed = 0;
+		uint32_t slot = 0;
+		for (uint32_t lane = 0; lane < 8; ++lane)
+		{
+			if (mask & (1u << lane))
+			{
+				packed |= lane << (4 * slot++);
+			}
+		}
+		table[mask] = packed;
+	}
+	return table;
+}();
+
+CULLING_TARGET_AVX2
+static uint32_t cullAVX2(const BoundingSpheres& _spheres, const Frustum& _frustum, uint32_t* _out)
+{
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; ++p)
+	{
+		planeX[p] = _mm256_set1_ps(_frustum.planes[p][0]);
+		planeY[p] = _mm256_set1_ps(_frustum.planes[p][1]);
+		planeZ[p] = _mm256_set1_ps(_frustum.planes[p][2]);
+		planeW[p] = _mm256_set1_ps(_frustum.planes[p][3]);
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256i nibbleShifts = _mm256_setr_epi32(0, 4, 8, 12, 16, 20, 24, 28);
+	const __m256i nibbleMask = _mm256_set1_epi32(0xF);
+
+	uint32_t visibleCount = 0;
+	const size_t padded = _spheres.paddedSize();
+
+	for (size_t i = 0; i < padded; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&_spheres.centerX[i]);
+		__m256 y = _mm256_loadu_ps(&_spheres.centerY[i]);
+		__m256 z = _mm256_loadu_ps(&_spheres.centerZ[i]);
+		__m256 r = _mm256_loadu_ps(&_spheres.radius[i]);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; ++p)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+				_mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, r), zero, _CMP_GE_OQ));
+		}
+
+		//expand the packed lane list for this mask, offset by the base index and store all 8 lanes;
+		//lanes past the popcount are scratch and get overwritten by the next group
+		uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(inside));
+		__m256i lanes = _mm256_and_si256(_mm256_srlv_epi32(_mm256_set1_epi32(static_cast<int>(compactionTable[mask])), nibbleShifts), nibbleMask);
+		__m256i indices = _mm256_add_epi32(lanes, _mm256_set1_epi32(static_cast<int>(i)));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(_out + visibleCount), indices);
+
+	#if defined(_MSC_VER) && !defined(__clang__)
+		visibleCount += __popcnt(mask);
+	#else
+		visibleCount += static_cast<uint32_t>(__builtin_popcount(mask));
+	#endif
+	}
+
+	return visibleCount;
+}
+
+static bool cpuSupportsAVX2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+	int info[4];
+	__cpuid(info, 1);
+	bool osSavesYmm = (info[2] & (1 << 27)) && ((_xgetbv(0) & 0x6) == 0x6);
+	__cpuidex(info, 7, 0);
+	return osSavesYmm && (info[1] & (1 << 5));
+#else
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+}
+
+#endif // CULLING_X86
+
+CullingPath bestCullingPath()
+{
+#if CULLING_X86
+	static const CullingPath best = cpuSupportsAVX2() ? CullingPath::AVX2 : CullingPath::SSE2;
+	return best;
+#else
+	return CullingPath::Scalar;
+#endif
+}
+
+const char* cullingPathName(CullingPath _path)
+{
+	switch (_path)
+	{
+	case CullingPath::SSE2: return "SSE2";
+	case CullingPath::AVX2: return "AVX2";
+	default:				return "Scalar";
+	}
+}
+
+void cullSpheres(const BoundingSpheres& _spheres, const Frustum& _frustum, std::vector<uint32_t>& _visible)
+{
+	cullSpheres(_spheres, _frustum, _visible, bestCullingPath());
+}
+
+void cullSpheres(const BoundingSpheres& _spheres, const Frustum& _frustum, std::vector<uint32_t>& _visible, CullingPath _path)
+{
+	_visible.resize(cullingOutputCapacity(_spheres));
+	uint32_t visibleCount = cullSpheres(_spheres, _frustum, _visible.data(), _path);
+	_visible.resize(visibleCount);
+}
+
+uint32_t cullSpheres(const BoundingSpheres& _spheres, const Frustum& _frustum, uint32_t* _visible, CullingPath _path)
+{
+	if (static_cast<int>(_path) > static_cast<int>(bestCullingPath()))
+	{
+		_path = bestCullingPath();
+	}
+
+	switch (_path)
+	{
+#if CULLING_X86
+	case CullingPath::AVX2:
+		return cullAVX2(_spheres, _frustum, _visible);
+	case CullingPath::SSE2:
+		return cullSSE2(_spheres, _frustum, _visible);
+#endif
+	default:
+		return cullScalar(_spheres, _frustum, _visible);
+	}
+}
+
+//kernels write whole SIMD groups past the visible count, leave them room
+size_t cullingOutputCapacity(const BoundingSpheres& _spheres)
+{
+	return _spheres.paddedSize() + BoundingSpheres::SimdWidth;
+}
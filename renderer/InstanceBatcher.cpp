@@ -0,0 +1,86 @@
+#include <InstanceBatcher.hpp>
+
+#include <algorithm>
+#include <cstring>
+
+InstanceBatcher::Bucket& InstanceBatcher::findBucket(uint32_t _mesh, InstanceMaterial _material)
+{
+	if (_material >= bucketIndex.size())
+	{
+		bucketIndex.resize(_material + 1);
+	}
+	std::vector<uint32_t>& meshBuckets = bucketIndex[_material];
+	if (_mesh >= meshBuckets.size())
+	{
+		meshBuckets.resize(_mesh + 1, 0);
+	}
+	if (meshBuckets[_mesh] == 0)
+	{
+		buckets.push_back(Bucket{ _mesh, _material, {} });
+		meshBuckets[_mesh] = static_cast<uint32_t>(buckets.size());
+	}
+	return buckets[meshBuckets[_mesh] - 1];
+}
+
+void InstanceBatcher::clear()
+{
+	for (Bucket& bucket : buckets)
+	{
+		bucket.instances.clear();
+	}
+	instanceCount = 0;
+}
+
+void InstanceBatcher::add(uint32_t _mesh, InstanceMaterial _material, const InstanceData& _instance)
+{
+	findBucket(_mesh, _material).instances.push_back(_instance);
+	instanceCount++;
+}
+
+InstanceData* InstanceBatcher::allocate(uint32_t _mesh, InstanceMaterial _material, uint32_t _count)
+{
+	std::vector<InstanceData>& instances = findBucket(_mesh, _material).instances;
+	size_t first = instances.size();
+	instances.resize(first + _count);
+	instanceCount += _count;
+	return instances.data() + first;
+}
+
+const std::vector<InstanceGroup>& InstanceBatcher::pack(InstanceData* _destination, size_t _capacity)
+{
+	order.clear();
+	for (uint32_t i = 0; i < buckets.size(); ++i)
+	{
+		if (!buckets[i].instances.empty())
+		{
+			order.push_back(i);
+		}
+	}
+	std::sort(order.begin(), order.end(), [this](uint32_t _a, uint32_t _b)
+	{
+		const Bucket& a = buckets[_a];
+		const Bucket& b = buckets[_b];
+		return a.material != b.material ? a.material < b.material : a.mesh < b.mesh;
+	});
+
+	groups.clear();
+	size_t packed = 0;
+	for (uint32_t i : order)
+	{
+		const Bucket& bucket = buckets[i];
+		size_t count = std::min(bucket.instances.size(), _capacity - packed);
+		if (count == 0)
+		{
+			break;
+		}
+		std::memcpy(_destination + packed, bucket.instances.data(), count * sizeof(InstanceData));
+		groups.push_back(InstanceGroup{ bucket.mesh, bucket.material, static_cast<uint32_t>(packed), static_cast<uint32_t>(count) });
+		packed += count;
+	}
+	return groups;
+}
+
+size_t InstanceBatcher::size() const
+{
+	return instanceCount;
+}
@@ -0,0 +1,378 @@
+#include <InstanceRenderer.hpp>
+#include <vulkanUtils.hpp>
+#include <ShaderCache.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+
+bool InstanceRenderer::init(VkDevice _device, VkPhysicalDevice _physicalDevice, PipelineStateCache& _states,
+	PipelineCompiler& _compiler, const MeshLibrary& _meshes, const InstanceRendererConfig& _config)
+{
+	if (_config.maxInstances == 0 || _config.framesInFlight == 0)
+	{
+		throw std::invalid_argument("[Instancing]: Instance capacity and frames in flight must be positive!");
+	}
+	const std::filesystem::path shaders[] = { _config.shaderDir / "instanced.spv", _config.shaderDir / "frag.spv" };
+	for (const std::filesystem::path& shader : shaders)
+	{
+		if (!std::filesystem::exists(shader))
+		{
+			std::cout << "[Instancing]: " << shader.string() << " not found (run res/shaders/compile.bat), instances aren't drawn.\n";
+			return false;
+		}
+	}
+
+	device = _device;
+	states = &_states;
+	compiler = &_compiler;
+	meshes = &_meshes;
+	renderPass = _config.renderPass;
+	drawPerInstance = _config.drawPerInstance;
+	maxInstances = _config.maxInstances;
+	framesInFlight = _config.framesInFlight;
+
+	VkShaderModule* modules[] = { &vertexModule, &fragmentModule };
+	for (size_t i = 0; i < 2; ++i)
+	{
+		std::vector<char> code = ShaderCache::get().read(shaders[i]);
+		VkShaderModuleCreateInfo moduleInfo{
+			VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,		//sType
+			nullptr,											//pNext
+			0,													//flags
+			code.size(),										//codeSize
+			reinterpret_cast<const uint32_t*>(code.data())		//pCode
+		};
+		*modules[i] = states->getShaderModule(moduleInfo);
+	}
+
+	VkPushConstantRange pushConstantRange = decltype(pushConstants)::range();
+
+	VkPipelineLayoutCreateInfo layoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		0,												//setLayoutCount
+		nullptr,										//pSetLayouts
+		1,												//pushConstantRangeCount
+		&pushConstantRange								//pPushConstantRanges
+	};
+	pipelineLayout = states->getPipelineLayout(layoutInfo);
+
+	//written by the CPU once per frame and read once by the GPU, not worth a copy to device local memory
+	createBuffer(device, _physicalDevice, static_cast<VkDeviceSize>(maxInstances) * framesInFlight * sizeof(InstanceData),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		_config.queueFamilies, instanceBuffer, instanceMemory);
+	void* mapped = nullptr;
+	vkMapMemory(device, instanceMemory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	instanceMapped = static_cast<InstanceData*>(mapped);
+
+	return true;
+}
+
+void InstanceRenderer::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkUnmapMemory(device, instanceMemory);
+	vkDestroyBuffer(device, instanceBuffer, nullptr);
+	vkFreeMemory(device, instanceMemory, nullptr);
+	materials.clear();
+	device = VK_NULL_HANDLE;
+}
+
+InstanceMaterial InstanceRenderer::createMaterial(const InstanceMaterialInfo& _info)
+{
+	VkPipelineShaderStageCreateInfo shaderStages[] = {
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			VK_SHADER_STAGE_VERTEX_BIT,								//stage
+			vertexModule,											//module
+			"main",													//pName
+			nullptr													//pSpecializationInfo
+		},
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			VK_SHADER_STAGE_FRAGMENT_BIT,							//stage
+			fragmentModule,											//module
+			"main",													//pName
+			nullptr													//pSpecializationInfo
+		}
+	};
+
+	//cooked PackedVertex per vertex, InstanceData per instance
+	VkVertexInputBindingDescription vertexBindings[] = {
+		{ 0, sizeof(PackedVertex), VK_VERTEX_INPUT_RATE_VERTEX },		//binding, stride, inputRate
+		{ 1, sizeof(InstanceData), VK_VERTEX_INPUT_RATE_INSTANCE }
+	};
+
+	VkVertexInputAttributeDescription vertexAttributes[] = {
+		{ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(PackedVertex, position) },	//location, binding, format, offset
+		{ 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(PackedVertex, normal) },
+		{ 2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(PackedVertex, texcoord) },
+		{ 3, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, transform) },
+		{ 4, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, transform) + sizeof(glm::vec4) },
+		{ 5, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(InstanceData, transform) + 2 * sizeof(glm::vec4) },
+		{ 6, 1, VK_FORMAT_R8G8B8A8_UNORM, offsetof(InstanceData, color) },
+		{ 7, 1, VK_FORMAT_R32G32B32_SFLOAT, offsetof(InstanceData, custom) }
+	};
+
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		2,															//vertexBindingDescriptionCount
+		vertexBindings,												//pVertexBindingDescriptions
+		8,															//vertexAttributeDescriptionCount
+		vertexAttributes											//pVertexAttributeDescriptions
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,	//sType
+		nullptr,														//pNext
+		0,																//flags
+		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,							//topology
+		VK_FALSE														//primitiveRestartEnable
+	};
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		2,														//dynamicStateCount
+		dynamicStates											//pDynamicStates
+	};
+
+	VkPipelineViewportStateCreateInfo viewportStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		1,														//viewportCount
+		nullptr,												//pViewports
+		1,														//scissorCount
+		nullptr													//pScissors
+	};
+
+	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_FALSE,													//depthClampEnable
+		VK_FALSE,													//rasterizerDiscardEnable
+		VK_POLYGON_MODE_FILL,										//polygonMode
+		_info.cullMode,												//cullMode
+		VK_FRONT_FACE_CLOCKWISE,									//frontFace
+		VK_FALSE,													//depthBiasEnable
+		0.0f,														//depthBiasConstantFactor
+		0.0f,														//depthBiasClamp
+		0.0f,														//depthBiasSlopeFactor
+		1.0f														//lineWidth
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_SAMPLE_COUNT_1_BIT,										//rasterizationSamples
+		VK_FALSE,													//sampleShadingEnable
+		1.0f,														//minSampleShading
+		nullptr,													//pSampleMask
+		VK_FALSE,													//alphaToCoverageEnable
+		VK_FALSE													//alphaToOneEnable
+	};
+
+	//reversed depth like the main pass
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_TRUE,													//depthTestEnable
+		_info.depthWrite ? VK_TRUE : VK_FALSE,						//depthWriteEnable
+		VK_COMPARE_OP_GREATER_OR_EQUAL,								//depthCompareOp
+		VK_FALSE,													//depthBoundsTestEnable
+		VK_FALSE,													//stencilTestEnable
+		VkStencilOpState{},											//front
+		VkStencilOpState{},											//back
+		0.0f,														//minDepthBounds
+		1.0f														//maxDepthBounds
+	};
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{
+		_info.alphaBlend ? VK_TRUE : VK_FALSE,	//blendEnable
+		VK_BLEND_FACTOR_SRC_ALPHA,				//srcColorBlendFactor
+		VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,	//dstColorBlendFactor
+		VK_BLEND_OP_ADD,						//colorBlendOp
+		VK_BLEND_FACTOR_ONE,					//srcAlphaBlendFactor
+		VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,	//dstAlphaBlendFactor
+		VK_BLEND_OP_ADD,						//alphaBlendOp
+		VK_COLOR_COMPONENT_R_BIT |				//colorWriteMask
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlendInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_FALSE,													//logicOpEnable
+		VK_LOGIC_OP_COPY,											//logicOp
+		1,															//attachmentCount
+		&colorBlendAttachment,										//pAttachments
+		{ 0.0f, 0.0f, 0.0f, 0.0f }									//blendConstants[4]
+	};
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,	//sType
+		nullptr,											//pNext
+		0,													//flags
+		2,													//stageCount
+		shaderStages,										//pStages
+		&vertexInputInfo,									//pVertexInputState
+		&inputAssemblyInfo,									//pInputAssemblyState
+		nullptr,											//pTessellationState
+		&viewportStateInfo,									//pViewportState
+		&rasterizationStateInfo,							//pRasterizationState
+		&multisampleInfo,									//pMultisampleState
+		&depthStencilInfo,									//pDepthStencilState
+		&colorBlendInfo,									//pColorBlendState
+		&dynamicStateInfo,									//pDynamicState
+		pipelineLayout,										//layout
+		renderPass,											//renderPass
+		0,													//subpass
+		VK_NULL_HANDLE,										//basePipelineHandle
+		-1													//basePipelineIndex
+	};
+
+	materials.push_back(compiler->request(pipelineInfo));
+	return static_cast<InstanceMaterial>(materials.size() - 1);
+}
+
+InstanceBatcher& InstanceRenderer::beginFrame()
+{
+	frameSlot = (frameSlot + 1) % framesInFlight;
+	batcher.clear();
+	groups = nullptr;
+	return batcher;
+}
+
+void InstanceRenderer::endFrame()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	groups = &batcher.pack(instanceMapped + static_cast<size_t>(frameSlot) * maxInstances, maxInstances);
+	if (batcher.size() > maxInstances)
+	{
+		stats.dropped += batcher.size() - maxInstances;
+	}
+	stats.frames++;
+
+	stats.recordTotal += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void InstanceRenderer::record(VkCommandBuffer _commandBuffer, const glm::mat4& _viewProjection)
+{
+	if (groups == nullptr || groups->empty())
+	{
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	VkDeviceSize offset = 0;
+	vkCmdBindVertexBuffers(_commandBuffer, 1, 1, &instanceBuffer, &offset);
+
+	//the engine's passes push through layouts of their own in between
+	pushConstants.reset();
+	InstancePushConstants values;
+	std::memcpy(values.viewProjection, glm::value_ptr(_viewProjection), sizeof(values.viewProjection));
+
+	uint32_t sliceStart = frameSlot * maxInstances;
+	InstanceMaterial boundMaterial = UINT32_MAX;
+	uint32_t boundMesh = UINT32_MAX;
+	for (const InstanceGroup& group : *groups)
+	{
+		if (group.material >= materials.size())
+		{
+			throw std::out_of_range("[Instancing]: Instances use a material that wasn't created!");
+		}
+		VkPipeline pipeline = materials[group.material]->pipeline.load(std::memory_order_acquire);
+		if (pipeline == VK_NULL_HANDLE)
+		{
+			stats.skippedDraws += drawPerInstance ? group.instanceCount : 1;
+			continue;
+		}
+		if (group.material != boundMaterial)
+		{
+			vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+			boundMaterial = group.material;
+		}
+
+		const GpuMesh& mesh = meshes->get(group.mesh);
+		if (group.mesh != boundMesh)
+		{
+			//every material shares the layout, so the push constants survive pipeline changes. Meshes quantized to
+			//the same bounds don't need new ones.
+			for (int i = 0; i < 3; ++i)
+			{
+				values.positionOffset[i] = mesh.positionOffset[i];
+				values.positionScale[i] = mesh.positionScale[i];
+			}
+			values.positionOffset[3] = 0.0f;
+			values.positionScale[3] = 0.0f;
+			if (pushConstants.push(_commandBuffer, pipelineLayout, values))
+			{
+				stats.pushes++;
+			}
+			else {
+				stats.skippedPushes++;
+			}
+			meshes->bind(_commandBuffer, group.mesh);
+			boundMesh = group.mesh;
+		}
+
+		//instances don't pick levels of detail yet, they draw the finest
+		const MeshLod& lod = mesh.lods[0];
+		uint32_t firstInstance = sliceStart + group.firstInstance;
+		if (drawPerInstance)
+		{
+			for (uint32_t i = 0; i < group.instanceCount; ++i)
+			{
+				vkCmdDrawIndexed(_commandBuffer, lod.indexCount, 1, lod.firstIndex, 0, firstInstance + i);
+			}
+			stats.draws += group.instanceCount;
+		}
+		else {
+			vkCmdDrawIndexed(_commandBuffer, lod.indexCount, group.instanceCount, lod.firstIndex, 0, firstInstance);
+			stats.draws++;
+		}
+		stats.instances += group.instanceCount;
+	}
+
+	stats.recordTotal += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool InstanceRenderer::getDrawPerInstance() const
+{
+	return drawPerInstance;
+}
+
+const InstanceStats& InstanceRenderer::getStats() const
+{
+	return stats;
+}
@@ -0,0 +1,363 @@
+#include <JobSystem.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <stdexcept>
+
+namespace jobs_detail {
+	WorkerIdentity& currentWorker()
+	{
+		thread_local WorkerIdentity identity;
+		return identity;
+	}
+}
+
+JobSystem::JobSystem(uint32_t _workerCount)
+{
+	if (_workerCount == 0)
+	{
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		_workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	workers.reserve(_workerCount);
+	for (uint32_t i = 0; i < _workerCount; ++i)
+	{
+		workers.push_back(std::make_unique<Worker>());
+		workers.back()->stealSeed = 0x9E3779B9u * (i + 1);
+	}
+
+	threads.reserve(_workerCount);
+	for (uint32_t i = 0; i < _workerCount; ++i)
+	{
+		threads.emplace_back(&JobSystem::workerLoop, this, i);
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	stopping = true;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_all();
+
+	for (std::thread& thread : threads)
+	{
+		thread.join();
+	}
+}
+
+uint32_t JobSystem::getWorkerCount() const
+{
+	return static_cast<uint32_t>(workers.size());
+}
+
+void JobSystem::wait(JobCounter& _counter)
+{
+	while (!_counter.done())
+	{
+		if (Job* job = findJob())
+		{
+			execute(job);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	if (_counter.failed.load(std::memory_order_relaxed))
+	{
+		std::exception_ptr exception = std::move(_counter.exception);
+		_counter.exception = nullptr;
+		_counter.failed.store(false, std::memory_order_relaxed);
+		std::rethrow_exception(exception);
+	}
+}
+
+void JobSystem::workerLoop(uint32_t _index)
+{
+	jobs_detail::currentWorker() = { this, static_cast<int32_t>(_index) };
+
+	//spin briefly before sleeping, fork/join latency suffers badly if every wakeup goes through the OS
+	const uint32_t spinLimit = 256;
+	uint32_t idleSpins = 0;
+
+	while (!stopping.load(std::memory_order_relaxed))
+	{
+		if (Job* job = findJob())
+		{
+			execute(job);
+			idleSpins = 0;
+			continue;
+		}
+
+		if (++idleSpins < spinLimit)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		bool pendingWork = injectedCount.load(std::memory_order_relaxed) > 0;
+		for (const auto& worker : workers)
+		{
+			pendingWork = pendingWork || !worker->deque.empty();
+		}
+
+		if (!pendingWork && !stopping.load(std::memory_order_relaxed))
+		{
+			//the timeout only guards against a missed wakeup, submit() notifies under the same mutex
+			sleepCondition.wait_for(lock, std::chrono::milliseconds(10));
+		}
+		sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+		idleSpins = 0;
+	}
+
+	jobs_detail::currentWorker() = {};
+}
+
+JobSystem::Job* JobSystem::allocateJob()
+{
+	jobs_detail::WorkerIdentity& identity = jobs_detail::currentWorker();
+	if (identity.owner != this)
+	{
+		Job* job = new Job;
+		job->heapAllocated = true;
+		job->inUse.store(true, std::memory_order_relaxed);
+		return job;
+	}
+
+	Worker& worker = *workers[identity.index];
+	Job* job = &worker.pool[worker.nextJob];
+	worker.nextJob = (worker.nextJob + 1) & (JobPoolSize - 1);
+
+	//the slot's previous job can still be queued or running elsewhere, help out until it's done
+	while (job->inUse.load(std::memory_order_acquire))
+	{
+		if (Job* other = findJob())
+		{
+			execute(other);
+		}
+		else {
+			std::this_thread::yield();
+		}
+	}
+
+	job->inUse.store(true, std::memory_order_relaxed);
+	return job;
+}
+
+void JobSystem::submit(Job* _job)
+{
+	jobs_detail::WorkerIdentity& identity = jobs_detail::currentWorker();
+	if (identity.owner == this)
+	{
+		if (!workers[identity.index]->deque.push(_job))
+		{
+			//deque is full, the cheapest way to make progress is doing the work right here
+			execute(_job);
+			return;
+		}
+	}
+	else {
+		std::lock_guard<std::mutex> lock(injectionMutex);
+		injectionQueue.push_back(_job);
+		injectedCount.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	wakeWorkers();
+}
+
+JobSystem::Job* JobSystem::findJob()
+{
+	jobs_detail::WorkerIdentity& identity = jobs_detail::currentWorker();
+	bool isWorker = identity.owner == this;
+
+	if (isWorker)
+	{
+		if (Job* job = workers[identity.index]->deque.pop())
+		{
+			return job;
+		}
+	}
+
+	if (injectedCount.load(std::memory_order_relaxed) > 0)
+	{
+		std::lock_guard<std::mutex> lock(injectionMutex);
+		if (!injectionQueue.empty())
+		{
+			Job* job = injectionQueue.front();
+			injectionQueue.pop_front();
+			injectedCount.fetch_sub(1, std::memory_order_relaxed);
+			return job;
+		}
+	}
+
+	//pick a pseudo-random victim so thieves don't all hammer the same deque
+	uint32_t workerCount = static_cast<uint32_t>(workers.size());
+	uint32_t start = 0;
+	if (isWorker)
+	{
+		uint32_t& seed = workers[identity.index]->stealSeed;
+		seed ^= seed << 13;
+		seed ^= seed >> 17;
+		seed ^= seed << 5;
+		start = seed % workerCount;
+	}
+
+	for (uint32_t i = 0; i < workerCount; ++i)
+	{
+		uint32_t victim = (start + i) % workerCount;
+		if (isWorker && victim == static_cast<uint32_t>(identity.index))
+		{
+			continue;
+		}
+		if (Job* job = workers[victim]->deque.steal())
+		{
+			return job;
+		}
+	}
+
+	return nullptr;
+}
+
+//Never throws: workers would terminate, and the job's slot and counter have to be released either way.
+void JobSystem::execute(Job* _job)
+{
+	JobCounter* counter = _job->counter;
+	try {
+		_job->invoke(*_job);
+	} catch (...) {
+		counter->fail(std::current_exception());
+	}
+	_job->destroy(*_job);
+
+	if (_job->heapAllocated)
+	{
+		delete _job;
+	}
+	else {
+		_job->inUse.store(false, std::memory_order_release);
+	}
+
+	counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::wakeWorkers()
+{
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (sleepingWorkers.load(std::memory_order_seq_cst) == 0)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+	}
+	sleepCondition.notify_one();
+}
+
+TaskGraph::TaskId TaskGraph::addTask(std::function<void()> _function)
+{
+	tasks.push_back(Task{ std::move(_function), {}, 0 });
+	validated = false;
+	return static_cast<TaskId>(tasks.size() - 1);
+}
+
+void TaskGraph::addDependency(TaskId _before, TaskId _after)
+{
+	if (_before >= tasks.size() || _after >= tasks.size() || _before == _after)
+	{
+		throw std::invalid_argument("[TaskGraph]: Invalid dependency!");
+	}
+
+	tasks[_before].successors.push_back(_after);
+	tasks[_after].dependencyCount++;
+	validated = false;
+}
+
+size_t TaskGraph::size() const
+{
+	return tasks.size();
+}
+
+//Kahn's algorithm, if it can't visit every task there is a cycle somewhere.
+void TaskGraph::validate()
+{
+	std::vector<uint32_t> remaining(tasks.size());
+	std::vector<TaskId> ready;
+	for (TaskId i = 0; i < tasks.size(); ++i)
+	{
+		remaining[i] = tasks[i].dependencyCount;
+		if (remaining[i] == 0)
+		{
+			ready.push_back(i);
+		}
+	}
+
+	size_t visited = 0;
+	while (!ready.empty())
+	{
+		TaskId id = ready.back();
+		ready.pop_back();
+		visited++;
+
+		for (TaskId successor : tasks[id].successors)
+		{
+			if (--remaining[successor] == 0)
+			{
+				ready.push_back(successor);
+			}
+		}
+	}
+
+	if (visited != tasks.size())
+	{
+		throw std::logic_error("[TaskGraph]: Task dependencies contain a cycle!");
+	}
+
+	remainingDependencies.reset(new std::atomic<uint32_t>[tasks.size()]);
+	validated = true;
+}
+
+void TaskGraph::execute(JobSystem& _jobs)
+{
+	if (!validated)
+	{
+		validate();
+	}
+
+	for (TaskId i = 0; i < tasks.size(); ++i)
+	{
+		remainingDependencies[i].store(tasks[i].dependencyCount, std::memory_order_relaxed);
+	}
+
+	JobCounter counter;
+	for (TaskId i = 0; i < tasks.size(); ++i)
+	{
+		if (tasks[i].dependencyCount == 0)
+		{
+			_jobs.run(counter, [this, &_jobs, &counter, i]() { runTask(_jobs, counter, i); });
+		}
+	}
+	_jobs.wait(counter);
+}
+
+void TaskGraph::runTask(JobSystem& _jobs, JobCounter& _counter, TaskId _id)
+{
+	tasks[_id].function();
+
+	//successors are queued before this job retires, so the counter can't hit zero early
+	for (TaskId successor : tasks[_id].successors)
+	{
+		if (remainingDependencies[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			_jobs.run(_counter, [this, &_jobs, &_counter, successor]() { runTask(_jobs, _counter, successor); });
+		}
+	}
+}
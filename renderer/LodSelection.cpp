@@ -0,0 +1,56 @@
+#include <LodSelection.hpp>
+
+#include <algorithm>
+#include <cmath>
+
+void LodSelector::select(const BoundingSpheres& _bounds, size_t _count, const float* _camera, float _pixelsPerUnit,
+	const MeshLod* _lods, uint32_t _lodCount, const LodSelectionConfig& _config)
+{
+	levels.resize(_count, 0);
+	if (_lodCount <= 1)
+	{
+		std::fill(levels.begin(), levels.end(), 0);
+		return;
+	}
+
+	const bool perspective = _camera[3] != 0.0f;
+	const float coarsenThreshold = _config.maxPixelError * (1.0f - _config.hysteresis);
+	for (size_t i = 0; i < _count; ++i)
+	{
+		//pixels per unit of error at the nearest point of the bounding sphere, so no part of the object is drawn
+		//coarser than allowed
+		float scale = _pixelsPerUnit;
+		if (perspective)
+		{
+			float dx = _bounds.centerX[i] - _camera[0];
+			float dy = _bounds.centerY[i] - _camera[1];
+			float dz = _bounds.centerZ[i] - _camera[2];
+			float distance = std::sqrt(dx * dx + dy * dy + dz * dz) - _bounds.radius[i];
+			scale /= std::max(distance, 1e-4f);
+		}
+
+		uint32_t level = std::min<uint32_t>(levels[i], _lodCount - 1);
+		uint32_t previous = level;
+		while (level > 0 && _lods[level].error * scale > _config.maxPixelError)
+		{
+			level--;
+		}
+		while (level + 1 < _lodCount && _lods[level + 1].error * scale <= coarsenThreshold)
+		{
+			level++;
+		}
+
+		switches += level != previous ? 1 : 0;
+		levels[i] = static_cast<uint8_t>(level);
+	}
+}
+
+const std::vector<uint8_t>& LodSelector::getLevels() const
+{
+	return levels;
+}
+
+uint64_t LodSelector::getSwitches() const
+{
+	return switches;
+}
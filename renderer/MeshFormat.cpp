@@ -0,0 +1,296 @@
+#include <MeshFormat.hpp>
+#include <MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+uint16_t floatToHalf(float _value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &_value, sizeof(bits));
+
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t floatExponent = (bits >> 23) & 0xff;
+	uint32_t mantissa = bits & 0x7fffff;
+	int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+
+	if (floatExponent == 0xff)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));	//inf or nan
+	}
+	if (exponent >= 31)
+	{
+		return static_cast<uint16_t>(sign | 0x7c00);
+	}
+	if (exponent <= 0)
+	{
+		//subnormal half, or zero when even that is too small
+		if (exponent < -10)
+		{
+			return static_cast<uint16_t>(sign);
+		}
+		mantissa |= 0x800000;
+		uint32_t shift = static_cast<uint32_t>(14 - exponent);
+		uint32_t half = mantissa >> shift;
+		half += (mantissa >> (shift - 1)) & 1;
+		return static_cast<uint16_t>(sign | half);
+	}
+
+	//rounding may carry into the exponent, which is still the right result
+	uint32_t half = sign | (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+	half += (mantissa >> 12) & 1;
+	return static_cast<uint16_t>(half);
+}
+
+void encodeOctahedral(const float _normal[3], int16_t _encoded[2])
+{
+	float length = std::abs(_normal[0]) + std::abs(_normal[1]) + std::abs(_normal[2]);
+	if (length == 0.0f)
+	{
+		_encoded[0] = 0;
+		_encoded[1] = 0;
+		return;
+	}
+
+	float u = _normal[0] / length;
+	float v = _normal[1] / length;
+	if (_normal[2] < 0.0f)
+	{
+		//fold the lower hemisphere over the diagonals
+		float foldedU = (1.0f - std::abs(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+		float foldedV = (1.0f - std::abs(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+		u = foldedU;
+		v = foldedV;
+	}
+
+	_encoded[0] = static_cast<int16_t>(std::lround(std::clamp(u, -1.0f, 1.0f) * 32767.0f));
+	_encoded[1] = static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+CookedMesh packMesh(const std::vector<MeshVertex>& _vertices, const std::vector<uint32_t>& _indices)
+{
+	return packMesh(_vertices, std::vector<std::vector<uint32_t>>{ _indices }, std::vector<float>{ 0.0f });
+}
+
+CookedMesh packMesh(const std::vector<MeshVertex>& _vertices, const std::vector<std::vector<uint32_t>>& _lodIndices,
+	const std::vector<float>& _lodErrors)
+{
+	if (_lodIndices.empty() || _lodIndices.size() > MeshMaxLods || _lodErrors.size() != _lodIndices.size())
+	{
+		throw std::invalid_argument("[Mesh]: A mesh needs between 1 and " + std::to_string(MeshMaxLods) +
+			" levels of detail, each with its error!");
+	}
+
+	std::vector<uint32_t> indices;
+	for (const std::vector<uint32_t>& lodIndices : _lodIndices)
+	{
+		if (lodIndices.size() % 3 != 0)
+		{
+			throw std::invalid_argument("[Mesh]: Index count has to be a multiple of 3!");
+		}
+		indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+	}
+
+	CookedMesh mesh;
+	mesh.header.vertexCount = static_cast<uint32_t>(_vertices.size());
+	mesh.header.indexCount = static_cast<uint32_t>(indices.size());
+	mesh.header.indexSize = _vertices.size() <= 0x10000 ? 2 : 4;
+	mesh.header.lodCount = static_cast<uint32_t>(_lodIndices.size());
+
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+	if (!_vertices.empty())
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = _vertices[0].position[axis];
+			boundsMax[axis] = _vertices[0].position[axis];
+		}
+	}
+	for (const MeshVertex& vertex : _vertices)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], vertex.position[axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], vertex.position[axis]);
+		}
+	}
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		mesh.header.positionOffset[axis] = boundsMin[axis];
+		mesh.header.positionScale[axis] = boundsMax[axis] - boundsMin[axis];
+		mesh.header.center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+	}
+
+	mesh.vertices.resize(_vertices.size());
+	float radiusSquared = 0.0f;
+	for (size_t i = 0; i < _vertices.size(); ++i)
+	{
+		const MeshVertex& vertex = _vertices[i];
+		PackedVertex& packed = mesh.vertices[i];
+
+		float distanceSquared = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float extent = mesh.header.positionScale[axis];
+			float normalized = extent > 0.0f ? (vertex.position[axis] - boundsMin[axis]) / extent : 0.0f;
+			packed.position[axis] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+
+			float offset = vertex.position[axis] - mesh.header.center[axis];
+			distanceSquared += offset * offset;
+		}
+		packed.position[3] = 0;
+		radiusSquared = std::max(radiusSquared, distanceSquared);
+
+		encodeOctahedral(vertex.normal, packed.normal);
+		packed.texcoord[0] = floatToHalf(vertex.texcoord[0]);
+		packed.texcoord[1] = floatToHalf(vertex.texcoord[1]);
+	}
+	mesh.header.radius = std::sqrt(radiusSquared);
+
+	mesh.indices.resize(indices.size() * mesh.header.indexSize);
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		if (indices[i] >= _vertices.size())
+		{
+			throw std::out_of_range("[Mesh]: Index " + std::to_string(indices[i]) + " is past the last vertex!");
+		}
+
+		if (mesh.header.indexSize == 2)
+		{
+			uint16_t index = static_cast<uint16_t>(indices[i]);
+			std::memcpy(mesh.indices.data() + i * 2, &index, 2);
+		} else {
+			std::memcpy(mesh.indices.data() + i * 4, &indices[i], 4);
+		}
+	}
+
+	//each level gets meshlets of its own, offset to where its indices and the meshlet lists continue
+	uint32_t firstIndex = 0;
+	for (size_t lod = 0; lod < _lodIndices.size(); ++lod)
+	{
+		std::vector<Meshlet> meshlets;
+		std::vector<uint32_t> meshletVertices;
+		std::vector<uint32_t> meshletTriangles;
+		buildMeshlets(_vertices, _lodIndices[lod], meshlets, meshletVertices, meshletTriangles);
+
+		MeshLod level{
+			firstIndex,												//firstIndex
+			static_cast<uint32_t>(_lodIndices[lod].size()),			//indexCount
+			static_cast<uint32_t>(mesh.meshlets.size()),			//firstMeshlet
+			static_cast<uint32_t>(meshlets.size()),					//meshletCount
+			_lodErrors[lod]											//error
+		};
+		mesh.lods.push_back(level);
+
+		for (Meshlet& meshlet : meshlets)
+		{
+			meshlet.vertexOffset += static_cast<uint32_t>(mesh.meshletVertices.size());
+			meshlet.triangleOffset += firstIndex / 3;
+		}
+		mesh.meshlets.insert(mesh.meshlets.end(), meshlets.begin(), meshlets.end());
+		mesh.meshletVertices.insert(mesh.meshletVertices.end(), meshletVertices.begin(), meshletVertices.end());
+		mesh.meshletTriangles.insert(mesh.meshletTriangles.end(), meshletTriangles.begin(), meshletTriangles.end());
+		firstIndex += level.indexCount;
+	}
+	mesh.header.meshletCount = static_cast<uint32_t>(mesh.meshlets.size());
+	mesh.header.meshletVertexCount = static_cast<uint32_t>(mesh.meshletVertices.size());
+
+	//the spheres are culled against the quantized positions, which are off by up to half a step on each axis
+	float quantizationError = 0.0f;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		float halfStep = mesh.header.positionScale[axis] / 65535.0f * 0.5f;
+		quantizationError += halfStep * halfStep;
+	}
+	quantizationError = std::sqrt(quantizationError);
+	for (Meshlet& meshlet : mesh.meshlets)
+	{
+		meshlet.radius += quantizationError;
+	}
+
+	return mesh;
+}
+
+CookedMesh readCookedMesh(const std::filesystem::path& _path)
+{
+	std::ifstream file(_path, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[Mesh]: Couldn't open " + _path.string());
+	}
+
+	CookedMesh mesh;
+	if (!file.read(reinterpret_cast<char*>(&mesh.header), sizeof(mesh.header)) || mesh.header.magic != MeshFileMagic)
+	{
+		throw std::runtime_error("[Mesh]: " + _path.string() + " isn't a cooked mesh!");
+	}
+	if (mesh.header.version != MeshFileVersion)
+	{
+		throw std::runtime_error("[Mesh]: " + _path.string() + " was cooked for format version " +
+			std::to_string(mesh.header.version) + ", recook it!");
+	}
+	if (mesh.header.indexSize != 2 && mesh.header.indexSize != 4)
+	{
+		throw std::runtime_error("[Mesh]: " + _path.string() + " has an invalid index size!");
+	}
+	if (mesh.header.lodCount == 0 || mesh.header.lodCount > MeshMaxLods)
+	{
+		throw std::runtime_error("[Mesh]: " + _path.string() + " has an invalid number of levels of detail!");
+	}
+
+	mesh.lods.resize(mesh.header.lodCount);
+	mesh.vertices.resize(mesh.header.vertexCount);
+	mesh.indices.resize(static_cast<size_t>(mesh.header.indexCount) * mesh.header.indexSize);
+	mesh.meshlets.resize(mesh.header.meshletCount);
+	mesh.meshletVertices.resize(mesh.header.meshletVertexCount);
+	mesh.meshletTriangles.resize(mesh.header.indexCount / 3);
+	file.read(reinterpret_cast<char*>(mesh.lods.data()), mesh.lods.size() * sizeof(MeshLod));
+	file.read(reinterpret_cast<char*>(mesh.vertices.data()), mesh.vertices.size() * sizeof(PackedVertex));
+	file.read(reinterpret_cast<char*>(mesh.indices.data()), mesh.indices.size());
+	file.ignore((4 - mesh.indices.size() % 4) % 4);
+	file.read(reinterpret_cast<char*>(mesh.meshlets.data()), mesh.meshlets.size() * sizeof(Meshlet));
+	file.read(reinterpret_cast<char*>(mesh.meshletVertices.data()), mesh.meshletVertices.size() * sizeof(uint32_t));
+	file.read(reinterpret_cast<char*>(mesh.meshletTriangles.data()), mesh.meshletTriangles.size() * sizeof(uint32_t));
+	if (!file)
+	{
+		throw std::runtime_error("[Mesh]: " + _path.string() + " is truncated!");
+	}
+	for (const MeshLod& lod : mesh.lods)
+	{
+		if (lod.firstIndex + static_cast<uint64_t>(lod.indexCount) > mesh.header.indexCount ||
+			lod.firstMeshlet + static_cast<uint64_t>(lod.meshletCount) > mesh.header.meshletCount)
+		{
+			throw std::runtime_error("[Mesh]: " + _path.string() + " has a level of detail past its indices or meshlets!");
+		}
+	}
+
+	return mesh;
+}
+
+void writeCookedMesh(const std::filesystem::path& _path, const CookedMesh& _mesh)
+{
+	std::ofstream file(_path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[Mesh]: Couldn't create " + _path.string());
+	}
+
+	const char padding[4] = {};
+	file.write(reinterpret_cast<const char*>(&_mesh.header), sizeof(_mesh.header));
+	file.write(reinterpret_cast<const char*>(_mesh.lods.data()), _mesh.lods.size() * sizeof(MeshLod));
+	file.write(reinterpret_cast<const char*>(_mesh.vertices.data()), _mesh.vertices.size() * sizeof(PackedVertex));
+	file.write(reinterpret_cast<const char*>(_mesh.indices.data()), _mesh.indices.size());
+	file.write(padding, (4 - _mesh.indices.size() % 4) % 4);
+	file.write(reinterpret_cast<const char*>(_mesh.meshlets.data()), _mesh.meshlets.size() * sizeof(Meshlet));
+	file.write(reinterpret_cast<const char*>(_mesh.meshletVertices.data()), _mesh.meshletVertices.size() * sizeof(uint32_t));
+	file.write(reinterpret_cast<const char*>(_mesh.meshletTriangles.data()), _mesh.meshletTriangles.size() * sizeof(uint32_t));
+	if (!file)
+	{
+		throw std::runtime_error("[Mesh]: Failed writing " + _path.string());
+	}
+}
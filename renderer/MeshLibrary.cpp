@@ -0,0 +1,248 @@
+#include <MeshLibrary.hpp>
+#include <vulkanUtils.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+void MeshLibrary::init(VkDevice _device, VkPhysicalDevice _physicalDevice, const std::vector<uint32_t>& _queueFamilies)
+{
+	device = _device;
+	physicalDevice = _physicalDevice;
+	queueFamilies = _queueFamilies;
+}
+
+void MeshLibrary::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDestroyBuffer(device, vertexBuffer, nullptr);
+	vkFreeMemory(device, vertexMemory, nullptr);
+	vkDestroyBuffer(device, indexBuffer, nullptr);
+	vkFreeMemory(device, indexMemory, nullptr);
+	vkDestroyBuffer(device, meshletBuffer, nullptr);
+	vkFreeMemory(device, meshletMemory, nullptr);
+	vkDestroyBuffer(device, meshletVertexBuffer, nullptr);
+	vkFreeMemory(device, meshletVertexMemory, nullptr);
+	vkDestroyBuffer(device, meshletTriangleBuffer, nullptr);
+	vkFreeMemory(device, meshletTriangleMemory, nullptr);
+	vertexBuffer = VK_NULL_HANDLE;
+	indexBuffer = VK_NULL_HANDLE;
+	meshletBuffer = VK_NULL_HANDLE;
+	meshletVertexBuffer = VK_NULL_HANDLE;
+	meshletTriangleBuffer = VK_NULL_HANDLE;
+
+	meshes.clear();
+	pending.clear();
+	device = VK_NULL_HANDLE;
+}
+
+MeshHandle MeshLibrary::add(CookedMesh _mesh)
+{
+	if (vertexBuffer != VK_NULL_HANDLE)
+	{
+		throw std::logic_error("[Mesh]: Meshes have to be added before the upload!");
+	}
+
+	//vertices stay 16 byte aligned, index offsets only have to be a multiple of the index size
+	GpuMesh mesh;
+	if (!meshes.empty())
+	{
+		const GpuMesh& last = meshes.back();
+		mesh.vertexOffset = last.vertexOffset + last.vertexCount * sizeof(PackedVertex);
+		mesh.indexOffset = alignUp(last.indexOffset + last.indexCount * (last.indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4), 4);
+		mesh.meshletOffset = last.meshletOffset + last.meshletCount;
+		mesh.meshletVertexOffset = last.meshletVertexOffset + last.meshletVertexCount;
+		mesh.meshletTriangleOffset = last.meshletTriangleOffset + last.indexCount / 3;
+	}
+
+	mesh.vertexCount = _mesh.header.vertexCount;
+	mesh.indexCount = _mesh.header.indexCount;
+	mesh.indexType = _mesh.header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		mesh.positionOffset[axis] = _mesh.header.positionOffset[axis];
+		mesh.positionScale[axis] = _mesh.header.positionScale[axis];
+		mesh.center[axis] = _mesh.header.center[axis];
+	}
+	mesh.radius = _mesh.header.radius;
+	mesh.meshletCount = _mesh.header.meshletCount;
+	mesh.meshletVertexCount = _mesh.header.meshletVertexCount;
+	mesh.lodCount = static_cast<uint32_t>(_mesh.lods.size());
+	std::copy(_mesh.lods.begin(), _mesh.lods.end(), mesh.lods);
+
+	stats.meshes++;
+	stats.triangles += mesh.lods[0].indexCount / 3;
+	stats.lodTriangles += (mesh.indexCount - mesh.lods[0].indexCount) / 3;
+	stats.meshlets += mesh.meshletCount;
+
+	meshes.push_back(mesh);
+	pending.push_back(std::move(_mesh));
+	return static_cast<MeshHandle>(meshes.size() - 1);
+}
+
+void MeshLibrary::upload(VkQueue _queue, uint32_t _queueFamily)
+{
+	if (meshes.empty())
+	{
+		return;
+	}
+
+	const GpuMesh& last = meshes.back();
+	VkDeviceSize vertexBytes = last.vertexOffset + last.vertexCount * sizeof(PackedVertex);
+	VkDeviceSize indexBytes = alignUp(last.indexOffset + last.indexCount * (last.indexType == VK_INDEX_TYPE_UINT16 ? 2 : 4), 4);
+	//empty meshlet buffers still get an element so their descriptors stay valid
+	VkDeviceSize meshletBytes = std::max<VkDeviceSize>(last.meshletOffset + last.meshletCount, 1) * sizeof(Meshlet);
+	VkDeviceSize meshletVertexBytes = std::max<VkDeviceSize>(last.meshletVertexOffset + last.meshletVertexCount, 1) * sizeof(uint32_t);
+	VkDeviceSize meshletTriangleBytes = std::max<VkDeviceSize>(last.meshletTriangleOffset + last.indexCount / 3, 1) * sizeof(uint32_t);
+	stats.vertexBytes = vertexBytes;
+	stats.indexBytes = indexBytes;
+	stats.meshletBytes = meshletBytes + meshletVertexBytes + meshletTriangleBytes;
+
+	//shaders fetching vertices themselves read the vertex buffer as storage
+	createBuffer(device, physicalDevice, vertexBytes,
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, queueFamilies, vertexBuffer, vertexMemory);
+	createBuffer(device, physicalDevice, indexBytes, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, {}, indexBuffer, indexMemory);
+	createBuffer(device, physicalDevice, meshletBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, queueFamilies, meshletBuffer, meshletMemory);
+	createBuffer(device, physicalDevice, meshletVertexBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, queueFamilies, meshletVertexBuffer, meshletVertexMemory);
+	createBuffer(device, physicalDevice, meshletTriangleBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, queueFamilies, meshletTriangleBuffer, meshletTriangleMemory);
+
+	//vertices first, then indices, meshlets, meshlet vertices and meshlet triangles
+	VkDeviceSize indexStart = vertexBytes;
+	VkDeviceSize meshletStart = indexStart + indexBytes;
+	VkDeviceSize meshletVertexStart = meshletStart + meshletBytes;
+	VkDeviceSize meshletTriangleStart = meshletVertexStart + meshletVertexBytes;
+
+	VkBuffer stagingBuffer;
+	VkDeviceMemory stagingMemory;
+	createBuffer(device, physicalDevice, meshletTriangleStart + meshletTriangleBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, {}, stagingBuffer, stagingMemory);
+
+	uint8_t* mapped;
+	vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&mapped));
+	for (size_t i = 0; i < meshes.size(); ++i)
+	{
+		const GpuMesh& mesh = meshes[i];
+		const CookedMesh& cooked = pending[i];
+		std::memcpy(mapped + mesh.vertexOffset, cooked.vertices.data(), cooked.vertices.size() * sizeof(PackedVertex));
+		std::memcpy(mapped + indexStart + mesh.indexOffset, cooked.indices.data(), cooked.indices.size());
+		std::memcpy(mapped + meshletStart + mesh.meshletOffset * sizeof(Meshlet), cooked.meshlets.data(),
+			cooked.meshlets.size() * sizeof(Meshlet));
+		std::memcpy(mapped + meshletVertexStart + mesh.meshletVertexOffset * sizeof(uint32_t), cooked.meshletVertices.data(),
+			cooked.meshletVertices.size() * sizeof(uint32_t));
+		std::memcpy(mapped + meshletTriangleStart + mesh.meshletTriangleOffset * sizeof(uint32_t), cooked.meshletTriangles.data(),
+			cooked.meshletTriangles.size() * sizeof(uint32_t));
+	}
+	vkUnmapMemory(device, stagingMemory);
+	pending.clear();
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,		//flags
+		_queueFamily								//queueFamilyIndex
+	};
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Mesh]: Unable to create Command Pool!");
+	}
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, //sType
+		nullptr,										//pNext
+		commandPool,									//commandPool
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY,				//level
+		1												//commandBufferCount
+	};
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[Mesh]: Couldn't allocate Command Buffer!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,	//sType
+		nullptr,										//pNext
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,	//flags
+		nullptr											//pInheritanceInfo
+	};
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	VkBufferCopy vertexCopy{ 0, 0, vertexBytes };
+	VkBufferCopy indexCopy{ indexStart, 0, indexBytes };
+	VkBufferCopy meshletCopy{ meshletStart, 0, meshletBytes };
+	VkBufferCopy meshletVertexCopy{ meshletVertexStart, 0, meshletVertexBytes };
+	VkBufferCopy meshletTriangleCopy{ meshletTriangleStart, 0, meshletTriangleBytes };
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, vertexBuffer, 1, &vertexCopy);
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, indexBuffer, 1, &indexCopy);
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, meshletBuffer, 1, &meshletCopy);
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, meshletVertexBuffer, 1, &meshletVertexCopy);
+	vkCmdCopyBuffer(commandBuffer, stagingBuffer, meshletTriangleBuffer, 1, &meshletTriangleCopy);
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,	//sType
+		nullptr,						//pNext
+		0,								//waitSemaphoreCount
+		nullptr,						//pWaitSemaphores
+		nullptr,						//pWaitDstStageMask
+		1,								//commandBufferCount
+		&commandBuffer,					//pCommandBuffers
+		0,								//signalSemaphoreCount
+		nullptr							//pSignalSemaphores
+	};
+	//startup only, the queue idling makes the copies visible to every later submit
+	if (vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("[Mesh]: Could not submit the mesh upload!");
+	}
+	vkQueueWaitIdle(_queue);
+
+	vkDestroyCommandPool(device, commandPool, nullptr);
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingMemory, nullptr);
+}
+
+void MeshLibrary::bind(VkCommandBuffer _commandBuffer, MeshHandle _mesh) const
+{
+	const GpuMesh& mesh = meshes[_mesh];
+	vkCmdBindVertexBuffers(_commandBuffer, 0, 1, &vertexBuffer, &mesh.vertexOffset);
+	vkCmdBindIndexBuffer(_commandBuffer, indexBuffer, mesh.indexOffset, mesh.indexType);
+}
+
+const GpuMesh& MeshLibrary::get(MeshHandle _mesh) const
+{
+	return meshes[_mesh];
+}
+
+const MeshStats& MeshLibrary::getStats() const
+{
+	return stats;
+}
+
+VkBuffer MeshLibrary::getVertexBuffer() const
+{
+	return vertexBuffer;
+}
+
+VkBuffer MeshLibrary::getMeshletBuffer() const
+{
+	return meshletBuffer;
+}
+
+VkBuffer MeshLibrary::getMeshletVertexBuffer() const
+{
+	return meshletVertexBuffer;
+}
+
+VkBuffer MeshLibrary::getMeshletTriangleBuffer() const
+{
+	return meshletTriangleBuffer;
+}
@@ -0,0 +1,860 @@
+#include <MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+	struct VertexBytesHash {
+		size_t operator()(const MeshVertex& _vertex) const
+		{
+			//FNV-1a
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&_vertex);
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(MeshVertex); ++i)
+			{
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	struct VertexBytesEqual {
+		bool operator()(const MeshVertex& _a, const MeshVertex& _b) const
+		{
+			return std::memcmp(&_a, &_b, sizeof(MeshVertex)) == 0;
+		}
+	};
+
+	//Scoring from Forsyth's paper. The cache is only a model, the result works for any real cache size.
+	constexpr int ScoringCacheSize = 32;
+
+	float vertexScore(int _cachePosition, uint32_t _liveTriangles)
+	{
+		if (_liveTriangles == 0)
+		{
+			return -1.0f;
+		}
+
+		float score = 0.0f;
+		if (_cachePosition >= 0)
+		{
+			//the triangle just emitted is scored a bit lower so strips don't run in one direction only
+			score = _cachePosition < 3 ? 0.75f :
+				std::pow(1.0f - static_cast<float>(_cachePosition - 3) / (ScoringCacheSize - 3), 1.5f);
+		}
+		//vertices with few triangles left are finished off first so they don't have to come back later
+		return score + 2.0f / std::sqrt(static_cast<float>(_liveTriangles));
+	}
+
+	//Cache model used while splitting clusters, the same FIFO analyzeVertexCache simulates.
+	constexpr uint32_t ClusterCacheSize = 16;
+
+	struct FifoCache {
+		std::vector<uint32_t> timestamps;
+		uint32_t time = ClusterCacheSize + 1;
+
+		explicit FifoCache(size_t _vertexCount) : timestamps(_vertexCount, 0) {}
+
+		uint32_t misses(const uint32_t* _triangle)
+		{
+			uint32_t count = 0;
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				if (time - timestamps[_triangle[corner]] > ClusterCacheSize)
+				{
+					timestamps[_triangle[corner]] = time++;
+					count++;
+				}
+			}
+			return count;
+		}
+
+		void flush()
+		{
+			time += ClusterCacheSize + 1;
+		}
+	};
+
+	//Bounding sphere around the meshlet's vertices and the cone its triangle normals fall in (meshoptimizer's
+	//meshopt_computeMeshletBounds). Cones wider than about 84 degrees can hardly ever be culled and are left degenerate.
+	void computeMeshletBounds(Meshlet& _meshlet, const std::vector<MeshVertex>& _vertices,
+		const std::vector<uint32_t>& _meshletVertices, const std::vector<uint32_t>& _meshletTriangles)
+	{
+		const uint32_t* vertexIndices = &_meshletVertices[_meshlet.vertexOffset];
+
+		float boundsMin[3];
+		float boundsMax[3];
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = _vertices[vertexIndices[0]].position[axis];
+			boundsMax[axis] = boundsMin[axis];
+		}
+		for (uint32_t i = 1; i < _meshlet.vertexCount; ++i)
+		{
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				boundsMin[axis] = std::min(boundsMin[axis], _vertices[vertexIndices[i]].position[axis]);
+				boundsMax[axis] = std::max(boundsMax[axis], _vertices[vertexIndices[i]].position[axis]);
+			}
+		}
+
+		float radiusSquared = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			_meshlet.center[axis] = (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+		}
+		for (uint32_t i = 0; i < _meshlet.vertexCount; ++i)
+		{
+			float distanceSquared = 0.0f;
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float offset = _vertices[vertexIndices[i]].position[axis] - _meshlet.center[axis];
+				distanceSquared += offset * offset;
+			}
+			radiusSquared = std::max(radiusSquared, distanceSquared);
+		}
+		_meshlet.radius = std::sqrt(radiusSquared);
+
+		std::vector<std::array<float, 3>> normals;
+		normals.reserve(_meshlet.triangleCount);
+		float axisSum[3] = { 0.0f, 0.0f, 0.0f };
+		for (uint32_t t = 0; t < _meshlet.triangleCount; ++t)
+		{
+			uint32_t packed = _meshletTriangles[_meshlet.triangleOffset + t];
+			const float* p0 = _vertices[vertexIndices[packed & 0xff]].position;
+			const float* p1 = _vertices[vertexIndices[(packed >> 8) & 0xff]].position;
+			const float* p2 = _vertices[vertexIndices[(packed >> 16) & 0xff]].position;
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			std::array<float, 3> normal = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+			float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length == 0.0f)
+			{
+				continue;	//degenerate triangles never face anywhere
+			}
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				normal[axis] /= length;
+				axisSum[axis] += normal[axis];
+			}
+			normals.push_back(normal);
+		}
+
+		//a zero axis with a cutoff of 1 fails every culling test
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			_meshlet.coneAxis[axis] = 0.0f;
+		}
+		_meshlet.coneCutoff = 1.0f;
+
+		float axisLength = std::sqrt(axisSum[0] * axisSum[0] + axisSum[1] * axisSum[1] + axisSum[2] * axisSum[2]);
+		if (normals.empty() || axisLength == 0.0f)
+		{
+			return;
+		}
+
+		float minDot = 1.0f;
+		for (const std::array<float, 3>& normal : normals)
+		{
+			float dot = (normal[0] * axisSum[0] + normal[1] * axisSum[1] + normal[2] * axisSum[2]) / axisLength;
+			minDot = std::min(minDot, dot);
+		}
+		if (minDot <= 0.1f)
+		{
+			return;
+		}
+
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			_meshlet.coneAxis[axis] = axisSum[axis] / axisLength;
+		}
+		//the cone of view directions all triangles face away from is the normal cone's complement, hence the sine
+		_meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+	}
+
+	struct PositionHash {
+		size_t operator()(const std::array<float, 3>& _position) const
+		{
+			//FNV-1a
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(_position.data());
+			uint64_t hash = 14695981039346656037ull;
+			for (size_t i = 0; i < sizeof(float) * 3; ++i)
+			{
+				hash = (hash ^ bytes[i]) * 1099511628211ull;
+			}
+			return static_cast<size_t>(hash);
+		}
+	};
+
+	//Sum of squared distances to a set of planes, weighted by the area of the triangles they came from. Stored as the
+	//upper half of the symmetric 4x4 matrix Q, the error at p is (p, 1)^T Q (p, 1).
+	struct Quadric {
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+		double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+		double a22 = 0.0, a23 = 0.0;
+		double a33 = 0.0;
+		double weight = 0.0;
+
+		void addPlane(const double _normal[3], double _distance, double _weight)
+		{
+			a00 += _weight * _normal[0] * _normal[0];
+			a01 += _weight * _normal[0] * _normal[1];
+			a02 += _weight * _normal[0] * _normal[2];
+			a03 += _weight * _normal[0] * _distance;
+			a11 += _weight * _normal[1] * _normal[1];
+			a12 += _weight * _normal[1] * _normal[2];
+			a13 += _weight * _normal[1] * _distance;
+			a22 += _weight * _normal[2] * _normal[2];
+			a23 += _weight * _normal[2] * _distance;
+			a33 += _weight * _distance * _distance;
+			weight += _weight;
+		}
+
+		void add(const Quadric& _other)
+		{
+			a00 += _other.a00; a01 += _other.a01; a02 += _other.a02; a03 += _other.a03;
+			a11 += _other.a11; a12 += _other.a12; a13 += _other.a13;
+			a22 += _other.a22; a23 += _other.a23;
+			a33 += _other.a33;
+			weight += _other.weight;
+		}
+
+		//Squared distance, weighted sum divided by total weight, so it stays in squared mesh units.
+		double error(const float _position[3]) const
+		{
+			double x = _position[0];
+			double y = _position[1];
+			double z = _position[2];
+			double sum = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x +
+				a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y +
+				a22 * z * z + 2.0 * a23 * z +
+				a33;
+			return weight > 0.0 ? std::max(sum, 0.0) / weight : 0.0;
+		}
+	};
+
+	void triangleNormal(const float* _p0, const float* _p1, const float* _p2, double _normal[3])
+	{
+		double e1[3] = { double(_p1[0]) - _p0[0], double(_p1[1]) - _p0[1], double(_p1[2]) - _p0[2] };
+		double e2[3] = { double(_p2[0]) - _p0[0], double(_p2[1]) - _p0[1], double(_p2[2]) - _p0[2] };
+		_normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		_normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		_normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	}
+}
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& _indices, size_t _vertexCount, uint32_t _cacheSize)
+{
+	VertexCacheStats stats;
+
+	//a vertex is in the FIFO when it was one of the last _cacheSize vertices pushed
+	std::vector<uint32_t> timestamps(_vertexCount, 0);
+	uint32_t time = _cacheSize + 1;
+	for (uint32_t index : _indices)
+	{
+		if (time - timestamps[index] > _cacheSize)
+		{
+			timestamps[index] = time++;
+			stats.misses++;
+		}
+	}
+
+	size_t triangleCount = _indices.size() / 3;
+	stats.acmr = triangleCount > 0 ? static_cast<float>(stats.misses) / triangleCount : 0.0f;
+	stats.atvr = _vertexCount > 0 ? static_cast<float>(stats.misses) / _vertexCount : 0.0f;
+	return stats;
+}
+
+size_t deduplicateVertices(std::vector<MeshVertex>& _vertices, std::vector<uint32_t>& _indices)
+{
+	std::unordered_map<MeshVertex, uint32_t, VertexBytesHash, VertexBytesEqual> unique;
+	unique.reserve(_vertices.size());
+
+	std::vector<uint32_t> remap(_vertices.size());
+	std::vector<MeshVertex> result;
+	result.reserve(_vertices.size());
+	for (size_t i = 0; i < _vertices.size(); ++i)
+	{
+		auto [it, inserted] = unique.try_emplace(_vertices[i], static_cast<uint32_t>(result.size()));
+		if (inserted)
+		{
+			result.push_back(_vertices[i]);
+		}
+		remap[i] = it->second;
+	}
+
+	for (uint32_t& index : _indices)
+	{
+		index = remap[index];
+	}
+
+	size_t removed = _vertices.size() - result.size();
+	_vertices.swap(result);
+	return removed;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& _indices, size_t _vertexCount)
+{
+	size_t triangleCount = _indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	//triangles using each vertex, the first liveTriangles[v] entries of a vertex's range are the ones not emitted yet
+	std::vector<uint32_t> liveTriangles(_vertexCount, 0);
+	for (uint32_t index : _indices)
+	{
+		liveTriangles[index]++;
+	}
+	std::vector<uint32_t> adjacencyOffsets(_vertexCount + 1, 0);
+	for (size_t v = 0; v < _vertexCount; ++v)
+	{
+		adjacencyOffsets[v + 1] = adjacencyOffsets[v] + liveTriangles[v];
+	}
+	std::vector<uint32_t> adjacency(_indices.size());
+	std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < _indices.size(); ++i)
+	{
+		adjacency[fill[_indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<int> cachePosition(_vertexCount, -1);
+	std::vector<float> vertexScores(_vertexCount);
+	for (size_t v = 0; v < _vertexCount; ++v)
+	{
+		vertexScores[v] = vertexScore(-1, liveTriangles[v]);
+	}
+	std::vector<float> triangleScores(triangleCount);
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleScores[t] = vertexScores[_indices[t * 3]] + vertexScores[_indices[t * 3 + 1]] + vertexScores[_indices[t * 3 + 2]];
+	}
+	std::vector<uint8_t> emitted(triangleCount, 0);
+
+	std::vector<uint32_t> result;
+	result.reserve(_indices.size());
+
+	uint32_t cache[ScoringCacheSize + 3];
+	size_t cacheCount = 0;
+	size_t scanCursor = 0;
+	int64_t bestTriangle = 0;
+
+	while (result.size() < _indices.size())
+	{
+		if (bestTriangle < 0)
+		{
+			//nothing in the cache touches a live triangle any more, continue with the next one in input order
+			while (emitted[scanCursor])
+			{
+				scanCursor++;
+			}
+			bestTriangle = static_cast<int64_t>(scanCursor);
+		}
+
+		const uint32_t* triangle = &_indices[static_cast<size_t>(bestTriangle) * 3];
+		result.insert(result.end(), triangle, triangle + 3);
+		emitted[bestTriangle] = 1;
+
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			uint32_t v = triangle[corner];
+			uint32_t* first = &adjacency[adjacencyOffsets[v]];
+			uint32_t* last = first + liveTriangles[v];
+			uint32_t* found = std::find(first, last, static_cast<uint32_t>(bestTriangle));
+			std::swap(*found, *(last - 1));
+			liveTriangles[v]--;
+		}
+
+		//the emitted triangle's vertices move to the front, everything else shifts back
+		uint32_t newCache[ScoringCacheSize + 3];
+		size_t newCount = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			if (std::find(newCache, newCache + newCount, triangle[corner]) == newCache + newCount)
+			{
+				newCache[newCount++] = triangle[corner];
+			}
+		}
+		size_t triangleVertices = newCount;
+		for (size_t i = 0; i < cacheCount; ++i)
+		{
+			if (std::find(newCache, newCache + triangleVertices, cache[i]) == newCache + triangleVertices)
+			{
+				newCache[newCount++] = cache[i];
+			}
+		}
+
+		//rescore every vertex whose position changed, including the ones that just fell out
+		for (size_t i = 0; i < newCount; ++i)
+		{
+			uint32_t v = newCache[i];
+			cachePosition[v] = i < ScoringCacheSize ? static_cast<int>(i) : -1;
+
+			float score = vertexScore(cachePosition[v], liveTriangles[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+			for (uint32_t a = 0; a < liveTriangles[v]; ++a)
+			{
+				triangleScores[adjacency[adjacencyOffsets[v] + a]] += delta;
+			}
+		}
+
+		cacheCount = std::min<size_t>(newCount, ScoringCacheSize);
+		std::copy(newCache, newCache + cacheCount, cache);
+
+		//the next triangle comes from the cache, Forsyth shows that finding it anywhere else is rarely worth it
+		bestTriangle = -1;
+		float bestScore = -std::numeric_limits<float>::max();
+		for (size_t i = 0; i < cacheCount; ++i)
+		{
+			uint32_t v = cache[i];
+			for (uint32_t a = 0; a < liveTriangles[v]; ++a)
+			{
+				uint32_t t = adjacency[adjacencyOffsets[v] + a];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+	}
+
+	_indices.swap(result);
+}
+
+void optimizeOverdraw(std::vector<uint32_t>& _indices, const std::vector<MeshVertex>& _vertices, float _threshold)
+{
+	size_t triangleCount = _indices.size() / 3;
+	if (triangleCount == 0)
+	{
+		return;
+	}
+
+	//hard boundaries: triangles that miss all three vertices start with a cold cache anyway
+	std::vector<uint32_t> hardStarts;
+	std::vector<uint32_t> triangleMisses(triangleCount);
+	FifoCache cache(_vertices.size());
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		triangleMisses[t] = cache.misses(&_indices[t * 3]);
+		if (t == 0 || triangleMisses[t] == 3)
+		{
+			hardStarts.push_back(static_cast<uint32_t>(t));
+		}
+	}
+	hardStarts.push_back(static_cast<uint32_t>(triangleCount));
+
+	//soft boundaries: split a hard cluster as soon as the part so far is within the threshold of its ACMR
+	std::vector<uint32_t> clusterStarts;
+	for (size_t h = 0; h + 1 < hardStarts.size(); ++h)
+	{
+		uint32_t start = hardStarts[h];
+		uint32_t end = hardStarts[h + 1];
+		uint32_t hardMisses = std::accumulate(triangleMisses.begin() + start, triangleMisses.begin() + end, 0u);
+		float limit = _threshold * static_cast<float>(hardMisses) / (end - start);
+
+		clusterStarts.push_back(start);
+		cache.flush();
+		uint32_t softStart = start;
+		uint32_t softMisses = 0;
+		for (uint32_t t = start; t < end; ++t)
+		{
+			softMisses += cache.misses(&_indices[t * 3]);
+			if (t + 1 < end && static_cast<float>(softMisses) / (t + 1 - softStart) <= limit)
+			{
+				clusterStarts.push_back(t + 1);
+				softStart = t + 1;
+				softMisses = 0;
+				cache.flush();
+			}
+		}
+	}
+	clusterStarts.push_back(static_cast<uint32_t>(triangleCount));
+	size_t clusterCount = clusterStarts.size() - 1;
+
+	//area weighted centroids and normals, per cluster and for the whole mesh
+	struct ClusterShape {
+		float centroid[3] = { 0.0f, 0.0f, 0.0f };
+		float normal[3] = { 0.0f, 0.0f, 0.0f };
+		float area = 0.0f;
+	};
+	std::vector<ClusterShape> shapes(clusterCount);
+	ClusterShape mesh;
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		ClusterShape& shape = shapes[c];
+		for (uint32_t t = clusterStarts[c]; t < clusterStarts[c + 1]; ++t)
+		{
+			const float* p0 = _vertices[_indices[t * 3]].position;
+			const float* p1 = _vertices[_indices[t * 3 + 1]].position;
+			const float* p2 = _vertices[_indices[t * 3 + 2]].position;
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float normal[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+			float area = 0.5f * std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			for (int axis = 0; axis < 3; ++axis)
+			{
+				float centroid = (p0[axis] + p1[axis] + p2[axis]) / 3.0f;
+				shape.centroid[axis] += centroid * area;
+				shape.normal[axis] += normal[axis];
+				mesh.centroid[axis] += centroid * area;
+			}
+			shape.area += area;
+			mesh.area += area;
+		}
+	}
+	if (mesh.area > 0.0f)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			mesh.centroid[axis] /= mesh.area;
+		}
+	}
+
+	//clusters facing away from the centre are in front of the rest from most directions
+	std::vector<float> sortKeys(clusterCount, 0.0f);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		ClusterShape& shape = shapes[c];
+		if (shape.area == 0.0f)
+		{
+			continue;
+		}
+
+		float length = std::sqrt(shape.normal[0] * shape.normal[0] + shape.normal[1] * shape.normal[1] + shape.normal[2] * shape.normal[2]);
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float outward = shape.centroid[axis] / shape.area - mesh.centroid[axis];
+			sortKeys[c] += outward * shape.normal[axis] / length;
+		}
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t _a, uint32_t _b) { return sortKeys[_a] > sortKeys[_b]; });
+
+	std::vector<uint32_t> result;
+	result.reserve(_indices.size());
+	for (uint32_t c : order)
+	{
+		result.insert(result.end(), _indices.begin() + clusterStarts[c] * 3, _indices.begin() + clusterStarts[c + 1] * 3);
+	}
+	_indices.swap(result);
+}
+
+size_t optimizeVertexFetch(std::vector<MeshVertex>& _vertices, std::vector<uint32_t>& _indices)
+{
+	const uint32_t Unused = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> remap(_vertices.size(), Unused);
+
+	std::vector<MeshVertex> result;
+	result.reserve(_vertices.size());
+	for (uint32_t& index : _indices)
+	{
+		if (remap[index] == Unused)
+		{
+			remap[index] = static_cast<uint32_t>(result.size());
+			result.push_back(_vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	_vertices.swap(result);
+	return _vertices.size();
+}
+
+std::vector<uint32_t> simplifyMesh(const std::vector<MeshVertex>& _vertices, const std::vector<uint32_t>& _indices,
+	size_t _targetIndexCount, float _targetError, float* _resultError)
+{
+	std::vector<uint32_t> indices = _indices;
+	size_t vertexCount = _vertices.size();
+
+	//vertices sharing a position are one point of the surface that only differs in normal or texcoord
+	std::vector<uint32_t> positionOf(vertexCount);
+	std::vector<uint32_t> verticesAtPosition;
+	{
+		std::unordered_map<std::array<float, 3>, uint32_t, PositionHash> unique;
+		for (size_t v = 0; v < vertexCount; ++v)
+		{
+			const float* position = _vertices[v].position;
+			auto inserted = unique.emplace(std::array<float, 3>{ position[0], position[1], position[2] },
+				static_cast<uint32_t>(unique.size()));
+			positionOf[v] = inserted.first->second;
+			if (inserted.second)
+			{
+				verticesAtPosition.push_back(0);
+			}
+			verticesAtPosition[positionOf[v]]++;
+		}
+	}
+	size_t positionCount = verticesAtPosition.size();
+
+	//an edge that isn't shared by exactly two triangles is a border (or worse), moving its ends would open the mesh
+	std::vector<bool> lockedPosition(positionCount, false);
+	{
+		std::unordered_map<uint64_t, uint32_t> edgeUses;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			for (int corner = 0; corner < 3; ++corner)
+			{
+				uint64_t a = positionOf[indices[i + corner]];
+				uint64_t b = positionOf[indices[i + (corner + 1) % 3]];
+				edgeUses[std::min(a, b) << 32 | std::max(a, b)]++;
+			}
+		}
+		for (const auto& edge : edgeUses)
+		{
+			if (edge.second != 2)
+			{
+				lockedPosition[edge.first >> 32] = true;
+				lockedPosition[edge.first & 0xffffffffu] = true;
+			}
+		}
+	}
+	//seams split a position into several vertices, collapsing one of them would tear the others off
+	for (size_t p = 0; p < positionCount; ++p)
+	{
+		lockedPosition[p] = lockedPosition[p] || verticesAtPosition[p] > 1;
+	}
+
+	std::vector<Quadric> quadrics(positionCount);
+	for (size_t i = 0; i < indices.size(); i += 3)
+	{
+		const float* p0 = _vertices[indices[i]].position;
+		double normal[3];
+		triangleNormal(p0, _vertices[indices[i + 1]].position, _vertices[indices[i + 2]].position, normal);
+		double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		if (length == 0.0)
+		{
+			continue;
+		}
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			normal[axis] /= length;
+		}
+		double distance = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			quadrics[positionOf[indices[i + corner]]].addPlane(normal, distance, length * 0.5);
+		}
+	}
+
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		double error;
+	};
+
+	double errorLimit = static_cast<double>(_targetError) * _targetError;
+	double resultError = 0.0;
+	std::vector<uint32_t> remap(vertexCount);
+	std::vector<uint32_t> triangleOffsets(vertexCount + 1);
+	std::vector<uint32_t> vertexTriangles;
+	std::vector<bool> touched(vertexCount);
+	std::vector<Collapse> collapses;
+
+	//each pass collapses a set of edges far enough apart that none of them changes what the others were checked against
+	while (indices.size() > _targetIndexCount)
+	{
+		size_t triangleCount = indices.size() / 3;
+
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32_t index : indices)
+		{
+			triangleOffsets[index + 1]++;
+		}
+		std::partial_sum(triangleOffsets.begin(), triangleOffsets.end(), triangleOffsets.begin());
+		vertexTriangles.resize(indices.size());
+		std::vector<uint32_t> filled(triangleOffsets.begin(), triangleOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			vertexTriangles[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+
+		collapses.clear();
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			uint32_t from = indices[i];
+			uint32_t to = indices[i - i % 3 + (i + 1) % 3];
+			for (int direction = 0; direction < 2; ++direction)
+			{
+				if (!lockedPosition[positionOf[from]] && positionOf[from] != positionOf[to])
+				{
+					Quadric combined = quadrics[positionOf[from]];
+					combined.add(quadrics[positionOf[to]]);
+					collapses.push_back({ from, to, combined.error(_vertices[to].position) });
+				}
+				std::swap(from, to);
+			}
+		}
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& _a, const Collapse& _b) { return _a.error < _b.error; });
+
+		std::iota(remap.begin(), remap.end(), 0);
+		std::fill(touched.begin(), touched.end(), false);
+		size_t collapsed = 0;
+		for (const Collapse& collapse : collapses)
+		{
+			if (collapse.error > errorLimit || triangleCount * 3 <= _targetIndexCount)
+			{
+				break;
+			}
+			if (touched[collapse.from] || touched[collapse.to])
+			{
+				continue;
+			}
+
+			//triangles that keep their area after the collapse mustn't turn over
+			const float* target = _vertices[collapse.to].position;
+			bool flips = false;
+			size_t removed = 0;
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1] && !flips; ++t)
+			{
+				const uint32_t* triangle = &indices[vertexTriangles[t] * 3];
+				const float* before[3];
+				const float* after[3];
+				bool degenerate = false;
+				for (int corner = 0; corner < 3; ++corner)
+				{
+					before[corner] = _vertices[triangle[corner]].position;
+					after[corner] = triangle[corner] == collapse.from ? target : before[corner];
+					degenerate = degenerate || positionOf[triangle[corner]] == positionOf[collapse.to];
+				}
+				if (degenerate)
+				{
+					removed++;
+					continue;
+				}
+
+				double normalBefore[3];
+				double normalAfter[3];
+				triangleNormal(before[0], before[1], before[2], normalBefore);
+				triangleNormal(after[0], after[1], after[2], normalAfter);
+				flips = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2] <= 0.0;
+			}
+			if (flips)
+			{
+				continue;
+			}
+
+			remap[collapse.from] = collapse.to;
+			quadrics[positionOf[collapse.to]].add(quadrics[positionOf[collapse.from]]);
+			resultError = std::max(resultError, collapse.error);
+			triangleCount -= removed;
+			collapsed++;
+
+			touched[collapse.to] = true;
+			for (uint32_t t = triangleOffsets[collapse.from]; t < triangleOffsets[collapse.from + 1]; ++t)
+			{
+				const uint32_t* triangle = &indices[vertexTriangles[t] * 3];
+				touched[triangle[0]] = true;
+				touched[triangle[1]] = true;
+				touched[triangle[2]] = true;
+			}
+		}
+
+		if (collapsed == 0)
+		{
+			break;
+		}
+
+		//drop the triangles that lost their area
+		size_t write = 0;
+		for (size_t i = 0; i < indices.size(); i += 3)
+		{
+			uint32_t a = remap[indices[i]];
+			uint32_t b = remap[indices[i + 1]];
+			uint32_t c = remap[indices[i + 2]];
+			if (positionOf[a] != positionOf[b] && positionOf[b] != positionOf[c] && positionOf[a] != positionOf[c])
+			{
+				indices[write++] = a;
+				indices[write++] = b;
+				indices[write++] = c;
+			}
+		}
+		indices.resize(write);
+	}
+
+	if (_resultError)
+	{
+		*_resultError = static_cast<float>(std::sqrt(resultError));
+	}
+	return indices;
+}
+
+void buildMeshlets(const std::vector<MeshVertex>& _vertices, const std::vector<uint32_t>& _indices, std::vector<Meshlet>& _meshlets,
+	std::vector<uint32_t>& _meshletVertices, std::vector<uint32_t>& _meshletTriangles)
+{
+	_meshlets.clear();
+	_meshletVertices.clear();
+	_meshletTriangles.clear();
+
+	//a vertex's slot in the meshlet being built, valid while its stamp is that meshlet's index
+	const uint32_t NotInMeshlet = std::numeric_limits<uint32_t>::max();
+	std::vector<uint32_t> localIndex(_vertices.size());
+	std::vector<uint32_t> stamp(_vertices.size(), NotInMeshlet);
+
+	Meshlet meshlet{};
+	size_t triangleCount = _indices.size() / 3;
+	for (size_t t = 0; t < triangleCount; ++t)
+	{
+		const uint32_t* triangle = &_indices[t * 3];
+		uint32_t current = static_cast<uint32_t>(_meshlets.size());
+
+		uint32_t newVertices = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			//a repeated corner is counted twice, which only ever closes a meshlet one triangle early
+			newVertices += stamp[triangle[corner]] != current ? 1 : 0;
+		}
+
+		if (meshlet.triangleCount == MeshletMaxTriangles || meshlet.vertexCount + newVertices > MeshletMaxVertices)
+		{
+			computeMeshletBounds(meshlet, _vertices, _meshletVertices, _meshletTriangles);
+			_meshlets.push_back(meshlet);
+			current++;
+
+			meshlet = Meshlet{};
+			meshlet.vertexOffset = static_cast<uint32_t>(_meshletVertices.size());
+			meshlet.triangleOffset = static_cast<uint32_t>(t);
+		}
+
+		uint32_t packed = 0;
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			uint32_t vertex = triangle[corner];
+			if (stamp[vertex] != current)
+			{
+				stamp[vertex] = current;
+				localIndex[vertex] = meshlet.vertexCount++;
+				_meshletVertices.push_back(vertex);
+			}
+			packed |= localIndex[vertex] << (corner * 8);
+		}
+		_meshletTriangles.push_back(packed);
+		meshlet.triangleCount++;
+	}
+
+	if (meshlet.triangleCount > 0)
+	{
+		computeMeshletBounds(meshlet, _vertices, _meshletVertices, _meshletTriangles);
+		_meshlets.push_back(meshlet);
+	}
+}
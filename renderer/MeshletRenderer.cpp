@@ -0,0 +1,555 @@
+#include <MeshletRenderer.hpp>
+#include <vulkanUtils.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+static constexpr uint32_t TaskGroupSize = 32;		//matches local_size in meshlet_cull.task
+static constexpr uint32_t ExpandGroupSize = 64;		//matches local_size in meshlet_expand.comp
+static constexpr uint32_t MaxClusterDraws = 1u << 20;	//20 MiB of indirect draws
+
+//Matches the Frame uniform block in meshlet_cull.task and meshlet_expand.comp
+struct MeshletFrameData {
+	float planes[6][4];
+	float camera[4];
+	uint32_t objectCount;
+	uint32_t padding[3];
+};
+
+//Matches the push constant block in the meshlet shaders
+struct MeshletPushConstants {
+	float positionOffset[4];
+	float positionScale[4];
+	uint32_t meshletOffset;
+	uint32_t meshletCount;
+	uint32_t meshletVertexOffset;
+	uint32_t meshletTriangleOffset;
+	uint32_t vertexOffset;		//in vertices, not bytes
+	uint32_t firstObject;
+	uint32_t phase;				//CullPhase
+};
+
+const char* meshletPathName(MeshletRenderer::Path _path)
+{
+	switch (_path)
+	{
+	case MeshletRenderer::Path::MeshShader:
+		return "mesh shaders";
+	case MeshletRenderer::Path::ComputeExpand:
+		return "compute expand";
+	}
+	return "unknown";
+}
+
+bool MeshletRenderer::init(VkDevice _device, VkPhysicalDevice _physicalDevice, Path _path, const MeshLibrary& _meshes,
+	const MeshletRendererConfig& _config)
+{
+	std::vector<std::filesystem::path> shaders;
+	if (_path == Path::MeshShader)
+	{
+		shaders = { _config.shaderDir / "meshlet_cull.spv", _config.shaderDir / "meshlet.spv", _config.shaderDir / "frag.spv" };
+	}
+	else {
+		shaders = { _config.shaderDir / "meshlet_expand.spv" };
+	}
+	for (const std::filesystem::path& shader : shaders)
+	{
+		if (!std::filesystem::exists(shader))
+		{
+			std::cout << "[Meshlets]: " << shader.string() << " not found (run res/shaders/compile.bat), drawing whole meshes.\n";
+			return false;
+		}
+	}
+
+	device = _device;
+	physicalDevice = _physicalDevice;
+	meshes = &_meshes;
+	path = _path;
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	maxDrawIndirectCount = properties.limits.maxDrawIndirectCount;
+	maxComputeGroupCount[0] = properties.limits.maxComputeWorkGroupCount[0];
+	maxComputeGroupCount[1] = properties.limits.maxComputeWorkGroupCount[1];
+
+	createBuffer(device, physicalDevice, sizeof(MeshletFrameData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _config.queueFamilies, frameBuffer, frameMemory);
+	vkMapMemory(device, frameMemory, 0, VK_WHOLE_SIZE, 0, &frameMapped);
+
+	if (path == Path::ComputeExpand)
+	{
+		clusterDrawCapacity = MaxClusterDraws;
+		createBuffer(device, physicalDevice, static_cast<VkDeviceSize>(clusterDrawCapacity) * sizeof(VkDrawIndexedIndirectCommand),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			_config.queueFamilies, clusterDrawBuffer, clusterDrawMemory);
+	}
+	else {
+		drawMeshTasks = _config.drawMeshTasks;
+		maxTaskGroupCount[0] = _config.meshShaderProperties.maxTaskWorkGroupCount[0];
+		maxTaskGroupCount[1] = _config.meshShaderProperties.maxTaskWorkGroupCount[1];
+		maxTaskGroupTotalCount = _config.meshShaderProperties.maxTaskWorkGroupTotalCount;
+	}
+
+	createDescriptors(_config);
+	if (path == Path::MeshShader)
+	{
+		createMeshShaderPipeline(_config);
+	}
+	else {
+		createExpandPipeline(_config);
+	}
+
+	return true;
+}
+
+void MeshletRenderer::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+
+	vkUnmapMemory(device, frameMemory);
+	vkDestroyBuffer(device, frameBuffer, nullptr);
+	vkFreeMemory(device, frameMemory, nullptr);
+	vkDestroyBuffer(device, clusterDrawBuffer, nullptr);
+	vkFreeMemory(device, clusterDrawMemory, nullptr);
+	device = VK_NULL_HANDLE;
+}
+
+//Binding numbers are shared by all meshlet shaders, each path only declares the ones it reads:
+//0 object spheres, 1 meshlets, 2 meshlet vertices, 3 meshlet triangles, 4 vertices, 5 frame data, 6 cluster draws,
+//7 visibility flags, 8 occlusion camera, 9 culling counters, 10 Hi-Z pyramid, 11 object levels of detail
+void MeshletRenderer::createDescriptors(const MeshletRendererConfig& _config)
+{
+	struct Binding {
+		uint32_t binding;
+		VkDescriptorType type;
+		VkBuffer buffer;
+	};
+	std::vector<Binding> used = {
+		{ 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _config.objectBounds },
+		{ 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshes->getMeshletBuffer() },
+		{ 5, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameBuffer },
+		{ 7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _config.occlusion->getVisibilityBuffer() },
+		{ 8, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, _config.occlusion->getCameraBuffer() },
+		{ 9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _config.occlusion->getCounterBuffer() },
+		{ 11, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _config.objectLods }
+	};
+	const uint32_t pyramidBinding = 10;
+	VkShaderStageFlags stages = VK_SHADER_STAGE_COMPUTE_BIT;
+	if (path == Path::MeshShader)
+	{
+		used.push_back({ 2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshes->getMeshletVertexBuffer() });
+		used.push_back({ 3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshes->getMeshletTriangleBuffer() });
+		used.push_back({ 4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, meshes->getVertexBuffer() });
+		stages = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+	}
+	else {
+		used.push_back({ 6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, clusterDrawBuffer });
+	}
+
+	std::vector<VkDescriptorSetLayoutBinding> bindings;
+	uint32_t storageCount = 0;
+	for (const Binding& binding : used)
+	{
+		bindings.push_back(VkDescriptorSetLayoutBinding{
+			binding.binding,	//binding
+			binding.type,		//descriptorType
+			1,					//descriptorCount
+			stages,				//stageFlags
+			nullptr				//pImmutableSamplers
+		});
+		storageCount += binding.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ? 1 : 0;
+	}
+	bindings.push_back(VkDescriptorSetLayoutBinding{
+		pyramidBinding,								//binding
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+		1,											//descriptorCount
+		stages,										//stageFlags
+		nullptr										//pImmutableSamplers
+	});
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		static_cast<uint32_t>(bindings.size()),					//bindingCount
+		bindings.data()											//pBindings
+	};
+	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("[Meshlets]: Failed to create the meshlet descriptor set layout!");
+	}
+
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, storageCount },	//type, descriptorCount
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//maxSets
+		3,												//poolSizeCount
+		poolSizes										//pPoolSizes
+	};
+	if (vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Meshlets]: Failed to create the meshlet descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo descriptorSetInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		descriptorPool,									//descriptorPool
+		1,												//descriptorSetCount
+		&descriptorSetLayout							//pSetLayouts
+	};
+	if (vkAllocateDescriptorSets(device, &descriptorSetInfo, &descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("[Meshlets]: Failed to allocate the meshlet descriptor set!");
+	}
+
+	std::vector<VkDescriptorBufferInfo> bufferInfos(used.size());
+	std::vector<VkWriteDescriptorSet> writes(used.size() + 1);
+	for (size_t i = 0; i < used.size(); ++i)
+	{
+		bufferInfos[i] = { used[i].buffer, 0, VK_WHOLE_SIZE };
+		writes[i] = VkWriteDescriptorSet{
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,	//sType
+			nullptr,								//pNext
+			descriptorSet,							//dstSet
+			used[i].binding,						//dstBinding
+			0,										//dstArrayElement
+			1,										//descriptorCount
+			used[i].type,							//descriptorType
+			nullptr,								//pImageInfo
+			&bufferInfos[i],						//pBufferInfo
+			nullptr									//pTexelBufferView
+		};
+	}
+	VkDescriptorImageInfo pyramidInfo = _config.occlusion->getPyramidInfo();
+	writes.back() = VkWriteDescriptorSet{
+		VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,		//sType
+		nullptr,									//pNext
+		descriptorSet,								//dstSet
+		pyramidBinding,								//dstBinding
+		0,											//dstArrayElement
+		1,											//descriptorCount
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+		&pyramidInfo,								//pImageInfo
+		nullptr,									//pBufferInfo
+		nullptr										//pTexelBufferView
+	};
+	vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+	VkPushConstantRange pushConstantRange{
+		stages,							//stageFlags
+		0,								//offset
+		sizeof(MeshletPushConstants)	//size
+	};
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//setLayoutCount
+		&descriptorSetLayout,							//pSetLayouts
+		1,												//pushConstantRangeCount
+		&pushConstantRange								//pPushConstantRanges
+	};
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("[Meshlets]: Failed to create the meshlet pipeline layout!");
+	}
+}
+
+void MeshletRenderer::createMeshShaderPipeline(const MeshletRendererConfig& _config)
+{
+	VkShaderModule taskModule = loadShaderModule(device, _config.shaderDir / "meshlet_cull.spv");
+	VkShaderModule meshModule = loadShaderModule(device, _config.shaderDir / "meshlet.spv");
+	VkShaderModule fragModule = loadShaderModule(device, _config.shaderDir / "frag.spv");
+
+	VkPipelineShaderStageCreateInfo shaderStages[3];
+	VkShaderStageFlagBits stageBits[3] = { VK_SHADER_STAGE_TASK_BIT_EXT, VK_SHADER_STAGE_MESH_BIT_EXT, VK_SHADER_STAGE_FRAGMENT_BIT };
+	VkShaderModule modules[3] = { taskModule, meshModule, fragModule };
+	for (int i = 0; i < 3; ++i)
+	{
+		shaderStages[i] = VkPipelineShaderStageCreateInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			stageBits[i],											//stage
+			modules[i],												//module
+			"main",													//pName
+			nullptr													//pSpecializationInfo
+		};
+	}
+
+	//same fixed function state as the vertex pipeline, minus vertex input and assembly which mesh pipelines don't have
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+	VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		2,														//dynamicStateCount
+		dynamicStates											//pDynamicStates
+	};
+
+	VkPipelineViewportStateCreateInfo viewportStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		1,														//viewportCount
+		nullptr,												//pViewports
+		1,														//scissorCount
+		nullptr													//pScissors
+	};
+
+	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_FALSE,													//depthClampEnable
+		VK_FALSE,													//rasterizerDiscardEnable
+		VK_POLYGON_MODE_FILL,										//polygonMode
+		VK_CULL_MODE_BACK_BIT,										//cullMode -> cones only catch whole meshlets
+		VK_FRONT_FACE_CLOCKWISE,									//frontFace
+		VK_FALSE,													//depthBiasEnable
+		0.0f,														//depthBiasConstantFactor
+		0.0f,														//depthBiasClamp
+		0.0f,														//depthBiasSlopeFactor
+		1.0f,														//lineWidth
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_SAMPLE_COUNT_1_BIT,										//rasterizationSamples
+		VK_FALSE,													//sampleShadingEnable
+		1.0f,														//minSampleShading
+		nullptr,													//pSampleMask
+		VK_FALSE,													//alphaToCoverageEnable
+		VK_FALSE,													//alphaToOneEnable
+	};
+
+	//reversed depth like the vertex pipeline, nearer is larger
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_TRUE,													//depthTestEnable
+		VK_TRUE,													//depthWriteEnable
+		VK_COMPARE_OP_GREATER_OR_EQUAL,								//depthCompareOp
+		VK_FALSE,													//depthBoundsTestEnable
+		VK_FALSE,													//stencilTestEnable
+		VkStencilOpState{},											//front
+		VkStencilOpState{},											//back
+		0.0f,														//minDepthBounds
+		1.0f														//maxDepthBounds
+	};
+
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{
+		VK_FALSE,								//blendEnable
+		VK_BLEND_FACTOR_ONE,					//srcColorBlendFactor
+		VK_BLEND_FACTOR_ZERO,					//dstColorBlendFactor
+		VK_BLEND_OP_ADD,						//colorBlendOp
+		VK_BLEND_FACTOR_ONE,					//srcAlphaBlendFactor
+		VK_BLEND_FACTOR_ZERO,					//dstAlphaBlendFactor
+		VK_BLEND_OP_ADD,						//alphaBlendOp
+		VK_COLOR_COMPONENT_R_BIT |				//colorWriteMask
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlendInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_FALSE,													//logicOpEnable
+		VK_LOGIC_OP_COPY,											//logicOp
+		1,															//attachmentCount
+		&colorBlendAttachment,										//pAttachments
+		{ 0.0f, 0.0f, 0.0f, 0.0f }									//blendConstants[4]
+	};
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,	//sType
+		nullptr,											//pNext
+		0,													//flags
+		3,													//stageCount
+		shaderStages,										//pStages
+		nullptr,											//pVertexInputState
+		nullptr,											//pInputAssemblyState
+		nullptr,											//pTessellationState
+		&viewportStateInfo,									//pViewportState
+		&rasterizationStateInfo,							//pRasterizationState
+		&multisampleInfo,									//pMultisampleState
+		&depthStencilInfo,									//pDepthStencilState
+		&colorBlendInfo,									//pColorBlendState
+		&dynamicStateCreateInfo,							//pDynamicState
+		pipelineLayout,										//layout
+		_config.renderPass,									//renderPass
+		0,													//subpass
+		VK_NULL_HANDLE,										//basePipelineHandle
+		-1													//basePipelineIndex
+	};
+	if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("[Meshlets]: Failed to create the mesh shader pipeline!");
+	}
+
+	vkDestroyShaderModule(device, taskModule, nullptr);
+	vkDestroyShaderModule(device, meshModule, nullptr);
+	vkDestroyShaderModule(device, fragModule, nullptr);
+}
+
+void MeshletRenderer::createExpandPipeline(const MeshletRendererConfig& _config)
+{
+	VkShaderModule shaderModule = loadShaderModule(device, _config.shaderDir / "meshlet_expand.spv");
+
+	VkComputePipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		VkPipelineShaderStageCreateInfo {				//stage
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			nullptr,
+			0,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			shaderModule,
+			"main",
+			nullptr
+		},
+		pipelineLayout,									//layout
+		VK_NULL_HANDLE,									//basePipelineHandle
+		-1												//basePipelineIndex
+	};
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("[Meshlets]: Failed to create the meshlet expand pipeline!");
+	}
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+}
+
+MeshletRenderer::Path MeshletRenderer::getPath() const
+{
+	return path;
+}
+
+uint64_t MeshletRenderer::getMeshletsSubmitted() const
+{
+	return meshletsSubmitted;
+}
+
+void MeshletRenderer::setFrame(const Frustum& _frustum, const float _camera[4], uint32_t _objectCount)
+{
+	objectCount = _objectCount;
+
+	MeshletFrameData frame{};
+	std::memcpy(frame.planes, _frustum.planes, sizeof(frame.planes));
+	std::memcpy(frame.camera, _camera, sizeof(frame.camera));
+	frame.objectCount = _objectCount;
+	std::memcpy(frameMapped, &frame, sizeof(frame));
+}
+
+static MeshletPushConstants meshPushConstants(const GpuMesh& _mesh, CullPhase _phase)
+{
+	return MeshletPushConstants{
+		{ _mesh.positionOffset[0], _mesh.positionOffset[1], _mesh.positionOffset[2], 0.0f },	//positionOffset
+		{ _mesh.positionScale[0], _mesh.positionScale[1], _mesh.positionScale[2], 0.0f },	//positionScale
+		_mesh.meshletOffset,																//meshletOffset
+		_mesh.lods[0].meshletCount,															//meshletCount
+		_mesh.meshletVertexOffset,															//meshletVertexOffset
+		_mesh.meshletTriangleOffset,														//meshletTriangleOffset
+		static_cast<uint32_t>(_mesh.vertexOffset / sizeof(PackedVertex)),					//vertexOffset
+		0,																					//firstObject
+		static_cast<uint32_t>(_phase)														//phase
+	};
+}
+
+void MeshletRenderer::recordCulling(VkCommandBuffer _commandBuffer, MeshHandle _mesh, CullPhase _phase)
+{
+	const GpuMesh& mesh = meshes->get(_mesh);
+	//every object's row is as wide as the full mesh's meshlets, coarser levels leave the rest of it empty
+	const uint32_t meshletCount = mesh.lods[0].meshletCount;
+	expandedObjects = 0;
+	if (meshletCount == 0)
+	{
+		return;
+	}
+
+	uint32_t groupsX = (meshletCount + ExpandGroupSize - 1) / ExpandGroupSize;
+	if (groupsX > maxComputeGroupCount[0])
+	{
+		throw std::runtime_error("[Meshlets]: Mesh has more meshlets than one dispatch can expand!");
+	}
+
+	//objects past the draw buffer's capacity aren't drawn at all
+	expandedObjects = std::min({ objectCount, clusterDrawCapacity / meshletCount, maxComputeGroupCount[1] });
+	meshletsSubmitted += static_cast<uint64_t>(expandedObjects) * meshletCount;
+	if (expandedObjects == 0)
+	{
+		return;
+	}
+
+	MeshletPushConstants pushConstants = meshPushConstants(mesh, _phase);
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(_commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(MeshletPushConstants), &pushConstants);
+	//one row of groups per object, so no invocation has to divide to find its object
+	vkCmdDispatch(_commandBuffer, groupsX, expandedObjects, 1);
+}
+
+void MeshletRenderer::recordDraw(VkCommandBuffer _commandBuffer, MeshHandle _mesh, CullPhase _phase)
+{
+	const GpuMesh& mesh = meshes->get(_mesh);
+	const uint32_t meshletCount = mesh.lods[0].meshletCount;
+	if (meshletCount == 0)
+	{
+		return;
+	}
+
+	if (path == Path::ComputeExpand)
+	{
+		//maxDrawIndirectCount may be as low as 65535, more draws than that are split into several calls
+		uint64_t drawCount = static_cast<uint64_t>(expandedObjects) * meshletCount;
+		for (uint64_t first = 0; first < drawCount; first += maxDrawIndirectCount)
+		{
+			uint32_t count = static_cast<uint32_t>(std::min<uint64_t>(drawCount - first, maxDrawIndirectCount));
+			vkCmdDrawIndexedIndirect(_commandBuffer, clusterDrawBuffer, first * sizeof(VkDrawIndexedIndirectCommand), count,
+				sizeof(VkDrawIndexedIndirectCommand));
+		}
+		return;
+	}
+
+	uint32_t groupsX = (meshletCount + TaskGroupSize - 1) / TaskGroupSize;
+	if (groupsX > maxTaskGroupCount[0] || groupsX > maxTaskGroupTotalCount)
+	{
+		throw std::runtime_error("[Meshlets]: Mesh has more meshlets than one task dispatch can cull!");
+	}
+	uint32_t objectsPerDraw = std::min(maxTaskGroupCount[1], maxTaskGroupTotalCount / groupsX);
+
+	MeshletPushConstants pushConstants = meshPushConstants(mesh, _phase);
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+	//one row of task groups per object, split where the device's total group limit would be crossed
+	for (uint32_t first = 0; first < objectCount; first += objectsPerDraw)
+	{
+		pushConstants.firstObject = first;
+		vkCmdPushConstants(_commandBuffer, pipelineLayout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, 0,
+			sizeof(MeshletPushConstants), &pushConstants);
+		drawMeshTasks(_commandBuffer, groupsX, std::min(objectsPerDraw, objectCount - first), 1);
+	}
+	meshletsSubmitted += static_cast<uint64_t>(objectCount) * meshletCount;
+}
@@ -0,0 +1,271 @@
+#include <MipGenerator.hpp>
+#include <vulkanUtils.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+static constexpr uint32_t SetsPerPool = 64;
+static constexpr uint32_t DownsampleGroupSize = 8;	//matches local_size in downsample.comp
+
+void MipGenerator::init(VkDevice _device, VkPhysicalDevice _physicalDevice, const std::filesystem::path& _downsampleShader)
+{
+	device = _device;
+	physicalDevice = _physicalDevice;
+
+	if (!std::filesystem::exists(_downsampleShader))
+	{
+		std::cout << "[MipGen]: " << _downsampleShader.string() << " not found, formats without linear blits use nearest filtering.\n";
+		return;
+	}
+
+	VkShaderModule shaderModule = loadShaderModule(device, _downsampleShader);
+
+	VkDescriptorSetLayoutBinding bindings[] = {
+		{
+			0,									//binding -> source level
+			VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		},
+		{
+			1,									//binding -> destination level
+			VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		}
+	};
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		2,														//bindingCount
+		bindings												//pBindings
+	};
+	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("[MipGen]: Failed to create the downsample descriptor set layout!");
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//setLayoutCount
+		&descriptorSetLayout,							//pSetLayouts
+		0,												//pushConstantRangeCount
+		nullptr											//pPushConstantRanges
+	};
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("[MipGen]: Failed to create the downsample pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		VkPipelineShaderStageCreateInfo {				//stage
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			nullptr,
+			0,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			shaderModule,
+			"main",
+			nullptr
+		},
+		pipelineLayout,									//layout
+		VK_NULL_HANDLE,									//basePipelineHandle
+		-1												//basePipelineIndex
+	};
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("[MipGen]: Failed to create the downsample pipeline!");
+	}
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	createDescriptorPool();
+}
+
+void MipGenerator::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	releaseTransient();
+	for (VkDescriptorPool pool : descriptorPools)
+	{
+		vkDestroyDescriptorPool(device, pool, nullptr);
+	}
+	descriptorPools.clear();
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+	device = VK_NULL_HANDLE;
+}
+
+MipGenerator::Method MipGenerator::chooseMethod(VkFormat _format) const
+{
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, _format, &properties);
+	VkFormatFeatureFlags features = properties.optimalTilingFeatures;
+
+	bool blit = (features & VK_FORMAT_FEATURE_BLIT_SRC_BIT) && (features & VK_FORMAT_FEATURE_BLIT_DST_BIT);
+	if (blit && (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT))
+	{
+		return Method::LinearBlit;
+	}
+	//downsample.comp declares its images rgba8
+	if (pipeline != VK_NULL_HANDLE && _format == VK_FORMAT_R8G8B8A8_UNORM && (features & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT))
+	{
+		return Method::Compute;
+	}
+	if (blit)
+	{
+		return Method::NearestBlit;
+	}
+
+	throw std::runtime_error("[MipGen]: Format can neither be blitted nor downsampled in a compute shader!");
+}
+
+VkImageUsageFlags MipGenerator::getRequiredUsage(VkFormat _format) const
+{
+	return chooseMethod(_format) == Method::Compute ? VK_IMAGE_USAGE_STORAGE_BIT
+		: VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+}
+
+void MipGenerator::generate(VkCommandBuffer _commandBuffer, TrackedImage& _image, BarrierBatch& _barriers)
+{
+	Method method = chooseMethod(_image.getFormat());
+
+	if (method == Method::Compute)
+	{
+		vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+	}
+
+	//each level is read back as the source of the next one, so every step waits on the previous
+	for (uint32_t mip = 1; mip < _image.getMipLevels(); ++mip)
+	{
+		VkExtent2D source = _image.getExtent(mip - 1);
+		VkExtent2D destination = _image.getExtent(mip);
+
+		if (method == Method::Compute)
+		{
+			_barriers.transition(_image, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, mip - 1, 1);
+			_barriers.transition(_image, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, mip, 1);
+			_barriers.flush(_commandBuffer);
+
+			VkImageView views[2] = { _image.createView(device, mip - 1, 1), _image.createView(device, mip, 1) };
+			transientViews.insert(transientViews.end(), views, views + 2);
+
+			VkDescriptorImageInfo imageInfos[2] = {
+				{ VK_NULL_HANDLE, views[0], VK_IMAGE_LAYOUT_GENERAL },
+				{ VK_NULL_HANDLE, views[1], VK_IMAGE_LAYOUT_GENERAL }
+			};
+			VkDescriptorSet descriptorSet = allocateDescriptorSet();
+			VkWriteDescriptorSet write{
+				VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,	//sType
+				nullptr,								//pNext
+				descriptorSet,							//dstSet
+				0,										//dstBinding
+				0,										//dstArrayElement
+				2,										//descriptorCount -> both bindings
+				VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,		//descriptorType
+				imageInfos,								//pImageInfo
+				nullptr,								//pBufferInfo
+				nullptr									//pTexelBufferView
+			};
+			vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+			vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+			vkCmdDispatch(_commandBuffer,
+				(destination.width + DownsampleGroupSize - 1) / DownsampleGroupSize,
+				(destination.height + DownsampleGroupSize - 1) / DownsampleGroupSize, 1);
+		} else {
+			_barriers.transition(_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, mip - 1, 1);
+			_barriers.transition(_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, mip, 1);
+			_barriers.flush(_commandBuffer);
+
+			VkImageBlit blit{
+				VkImageSubresourceLayers { VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, 1 },		//srcSubresource
+				{ VkOffset3D { 0, 0, 0 }, VkOffset3D { static_cast<int32_t>(source.width), static_cast<int32_t>(source.height), 1 } },	//srcOffsets
+				VkImageSubresourceLayers { VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 1 },			//dstSubresource
+				{ VkOffset3D { 0, 0, 0 }, VkOffset3D { static_cast<int32_t>(destination.width), static_cast<int32_t>(destination.height), 1 } }	//dstOffsets
+			};
+			vkCmdBlitImage(_commandBuffer,
+				_image.getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+				_image.getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				1, &blit, method == Method::LinearBlit ? VK_FILTER_LINEAR : VK_FILTER_NEAREST);
+		}
+	}
+}
+
+void MipGenerator::releaseTransient()
+{
+	for (VkImageView view : transientViews)
+	{
+		vkDestroyImageView(device, view, nullptr);
+	}
+	transientViews.clear();
+
+	for (VkDescriptorPool pool : descriptorPools)
+	{
+		vkResetDescriptorPool(device, pool, 0);
+	}
+	currentPool = 0;
+}
+
+void MipGenerator::createDescriptorPool()
+{
+	VkDescriptorPoolSize poolSize{
+		VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,	//type
+		SetsPerPool * 2						//descriptorCount
+	};
+	VkDescriptorPoolCreateInfo poolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		SetsPerPool,									//maxSets
+		1,												//poolSizeCount
+		&poolSize										//pPoolSizes
+	};
+
+	VkDescriptorPool pool;
+	if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+		throw std::runtime_error("[MipGen]: Failed to create descriptor pool!");
+	}
+	descriptorPools.push_back(pool);
+}
+
+//Takes sets from the current pool and moves on to another one, new if needed, once it runs out.
+VkDescriptorSet MipGenerator::allocateDescriptorSet()
+{
+	VkDescriptorSetAllocateInfo allocateInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		descriptorPools[currentPool],					//descriptorPool
+		1,												//descriptorSetCount
+		&descriptorSetLayout							//pSetLayouts
+	};
+
+	VkDescriptorSet descriptorSet;
+	if (vkAllocateDescriptorSets(device, &allocateInfo, &descriptorSet) == VK_SUCCESS)
+	{
+		return descriptorSet;
+	}
+
+	currentPool++;
+	if (currentPool == descriptorPools.size())
+	{
+		createDescriptorPool();
+	}
+	allocateInfo.descriptorPool = descriptorPools[currentPool];
+	if (vkAllocateDescriptorSets(device, &allocateInfo, &descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("[MipGen]: Failed to allocate a downsample descriptor set!");
+	}
+	return descriptorSet;
+}
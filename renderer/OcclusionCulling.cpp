@@ -0,0 +1,424 @@
+#include <OcclusionCulling.hpp>
+#include <vulkanUtils.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+
+static constexpr uint32_t ReduceGroupSize = 8;	//matches local_size in hiz_reduce.comp
+
+//Matches the Camera uniform block in the culling shaders
+struct OcclusionCameraData {
+	float viewProjection[16];
+	float pyramidSize[2];
+	uint32_t pyramidLevels;
+	uint32_t visibilityBit;
+	float viewportScale[2];
+	float padding[2];
+};
+
+static uint32_t previousPowerOfTwo(uint32_t _value)
+{
+	uint32_t result = 1;
+	while (result <= _value / 2)
+	{
+		result *= 2;
+	}
+	return result;
+}
+
+void OcclusionCuller::init(VkDevice _device, VkPhysicalDevice _physicalDevice, VkQueue _queue, uint32_t _queueFamily,
+	const OcclusionConfig& _config)
+{
+	device = _device;
+	physicalDevice = _physicalDevice;
+	depthExtent = _config.depthExtent;
+	readerStages = _config.readerStages | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+	createPyramid();
+
+	VkDeviceSize visibilitySize = std::max(_config.maxObjects, 1u) * sizeof(uint32_t);
+	createBuffer(device, physicalDevice, visibilitySize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _config.queueFamilies, visibilityBuffer, visibilityMemory);
+
+	createBuffer(device, physicalDevice, sizeof(OcclusionCameraData), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _config.queueFamilies, cameraBuffer, cameraMemory);
+	vkMapMemory(device, cameraMemory, 0, VK_WHOLE_SIZE, 0, &cameraMapped);
+
+	//read back on the host after every frame, so they live in host memory instead of being copied out
+	createBuffer(device, physicalDevice, sizeof(OcclusionCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, _config.queueFamilies, counterBuffer, counterMemory);
+	vkMapMemory(device, counterMemory, 0, VK_WHOLE_SIZE, 0, &counterMapped);
+	std::memset(counterMapped, 0, sizeof(OcclusionCounters));
+
+	beginFrame(glm::mat4(1.0f), 1.0f, 1.0f);
+
+	if (std::filesystem::exists(_config.reduceShader))
+	{
+		createReducePipeline(_config);
+	}
+	else {
+		std::cout << "[Occlusion]: " << _config.reduceShader.string() << " not found (run res/shaders/compile.bat), "
+			"culling against the frustum only.\n";
+	}
+
+	clearState(_queue, _queueFamily);
+}
+
+void OcclusionCuller::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDestroyPipeline(device, pipeline, nullptr);
+	vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+
+	vkDestroySampler(device, sampler, nullptr);
+	for (VkImageView view : levelViews)
+	{
+		vkDestroyImageView(device, view, nullptr);
+	}
+	levelViews.clear();
+	vkDestroyImageView(device, pyramidView, nullptr);
+	pyramid.destroy(device);
+
+	vkDestroyBuffer(device, visibilityBuffer, nullptr);
+	vkFreeMemory(device, visibilityMemory, nullptr);
+	vkUnmapMemory(device, cameraMemory);
+	vkDestroyBuffer(device, cameraBuffer, nullptr);
+	vkFreeMemory(device, cameraMemory, nullptr);
+	vkUnmapMemory(device, counterMemory);
+	vkDestroyBuffer(device, counterBuffer, nullptr);
+	vkFreeMemory(device, counterMemory, nullptr);
+	device = VK_NULL_HANDLE;
+}
+
+void OcclusionCuller::createPyramid()
+{
+	VkExtent2D extent{ previousPowerOfTwo(depthExtent.width), previousPowerOfTwo(depthExtent.height) };
+	uint32_t levels = 1;
+	while ((std::max(extent.width, extent.height) >> levels) > 0)
+	{
+		levels++;
+	}
+
+	//R32_SFLOAT storage images are required everywhere, unlike min/max sampler reduction which would do this in one fetch
+	pyramid.create(device, physicalDevice, VK_FORMAT_R32_SFLOAT, extent, levels,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+	pyramidView = pyramid.createView(device);
+	for (uint32_t level = 0; level < levels; ++level)
+	{
+		levelViews.push_back(pyramid.createView(device, level, 1));
+	}
+
+	//every read is a texelFetch, the sampler only has to exist
+	VkSamplerCreateInfo samplerInfo{
+		VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,		//sType
+		nullptr,									//pNext
+		0,											//flags
+		VK_FILTER_NEAREST,							//magFilter
+		VK_FILTER_NEAREST,							//minFilter
+		VK_SAMPLER_MIPMAP_MODE_NEAREST,				//mipmapMode
+		VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,		//addressModeU
+		VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,		//addressModeV
+		VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,		//addressModeW
+		0.0f,										//mipLodBias
+		VK_FALSE,									//anisotropyEnable
+		1.0f,										//maxAnisotropy
+		VK_FALSE,									//compareEnable
+		VK_COMPARE_OP_ALWAYS,						//compareOp
+		0.0f,										//minLod
+		VK_LOD_CLAMP_NONE,							//maxLod
+		VK_BORDER_COLOR_FLOAT_OPAQUE_BLACK,			//borderColor
+		VK_FALSE									//unnormalizedCoordinates
+	};
+	if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Failed to create the pyramid sampler!");
+	}
+}
+
+void OcclusionCuller::createReducePipeline(const OcclusionConfig& _config)
+{
+	VkShaderModule shaderModule = loadShaderModule(device, _config.reduceShader);
+
+	VkDescriptorSetLayoutBinding bindings[] = {
+		{
+			0,											//binding -> source, depth or the level above
+			VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+			1,											//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,				//stageFlags
+			nullptr										//pImmutableSamplers
+		},
+		{
+			1,									//binding -> destination level
+			VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,	//descriptorType
+			1,									//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT,		//stageFlags
+			nullptr								//pImmutableSamplers
+		}
+	};
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		2,														//bindingCount
+		bindings												//pBindings
+	};
+	if (vkCreateDescriptorSetLayout(device, &descriptorSetLayoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Failed to create the reduce descriptor set layout!");
+	}
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//setLayoutCount
+		&descriptorSetLayout,							//pSetLayouts
+		0,												//pushConstantRangeCount
+		nullptr											//pPushConstantRanges
+	};
+	if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Failed to create the reduce pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		VkPipelineShaderStageCreateInfo {				//stage
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+			nullptr,
+			0,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			shaderModule,
+			"main",
+			nullptr
+		},
+		pipelineLayout,									//layout
+		VK_NULL_HANDLE,									//basePipelineHandle
+		-1												//basePipelineIndex
+	};
+	if (vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Failed to create the reduce pipeline!");
+	}
+
+	vkDestroyShaderModule(device, shaderModule, nullptr);
+
+	//the views never change, so every level gets its set once
+	uint32_t levels = pyramid.getMipLevels();
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, levels },	//type, descriptorCount
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, levels }
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		levels,											//maxSets
+		2,												//poolSizeCount
+		poolSizes										//pPoolSizes
+	};
+	if (vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Failed to create the reduce descriptor pool!");
+	}
+
+	std::vector<VkDescriptorSetLayout> layouts(levels, descriptorSetLayout);
+	levelSets.resize(levels);
+	VkDescriptorSetAllocateInfo descriptorSetInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		descriptorPool,									//descriptorPool
+		levels,											//descriptorSetCount
+		layouts.data()									//pSetLayouts
+	};
+	if (vkAllocateDescriptorSets(device, &descriptorSetInfo, levelSets.data()) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Failed to allocate the reduce descriptor sets!");
+	}
+
+	//level 0 reads depth, which setDepthView() points it at
+	for (uint32_t level = 1; level < levels; ++level)
+	{
+		writeLevelSet(level, levelViews[level - 1]);
+	}
+}
+
+void OcclusionCuller::writeLevelSet(uint32_t _level, VkImageView _source)
+{
+	VkDescriptorImageInfo sourceInfo{
+		sampler,									//sampler
+		_source,									//imageView
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL	//imageLayout
+	};
+	VkDescriptorImageInfo destinationInfo{ VK_NULL_HANDLE, levelViews[_level], VK_IMAGE_LAYOUT_GENERAL };
+
+	VkWriteDescriptorSet writes[2];
+	writes[0] = VkWriteDescriptorSet{
+		VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,		//sType
+		nullptr,									//pNext
+		levelSets[_level],							//dstSet
+		0,											//dstBinding
+		0,											//dstArrayElement
+		1,											//descriptorCount
+		VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,	//descriptorType
+		&sourceInfo,								//pImageInfo
+		nullptr,									//pBufferInfo
+		nullptr										//pTexelBufferView
+	};
+	writes[1] = writes[0];
+	writes[1].dstBinding = 1;
+	writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	writes[1].pImageInfo = &destinationInfo;
+	vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+}
+
+//Leaves the pyramid readable and every object invisible, so descriptors are valid before the first build.
+void OcclusionCuller::clearState(VkQueue _queue, uint32_t _queueFamily)
+{
+	VkCommandPoolCreateInfo commandPoolCreateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,		//flags
+		_queueFamily								//queueFamilyIndex
+	};
+	VkCommandPool commandPool;
+	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Unable to create Command Pool!");
+	}
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, //sType
+		nullptr,										//pNext
+		commandPool,									//commandPool
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY,				//level
+		1												//commandBufferCount
+	};
+	VkCommandBuffer commandBuffer;
+	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Couldn't allocate Command Buffer!");
+	}
+
+	VkCommandBufferBeginInfo beginInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,	//sType
+		nullptr,										//pNext
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,	//flags
+		nullptr											//pInheritanceInfo
+	};
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+	vkCmdFillBuffer(commandBuffer, visibilityBuffer, 0, VK_WHOLE_SIZE, 0);
+	BarrierBatch barriers;
+	barriers.transition(pyramid, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, readerStages, VK_ACCESS_SHADER_READ_BIT);
+	barriers.flush(commandBuffer);
+
+	vkEndCommandBuffer(commandBuffer);
+
+	VkSubmitInfo submitInfo{
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,	//sType
+		nullptr,						//pNext
+		0,								//waitSemaphoreCount
+		nullptr,						//pWaitSemaphores
+		nullptr,						//pWaitDstStageMask
+		1,								//commandBufferCount
+		&commandBuffer,					//pCommandBuffers
+		0,								//signalSemaphoreCount
+		nullptr							//pSignalSemaphores
+	};
+	if (vkQueueSubmit(_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+		throw std::runtime_error("[Occlusion]: Could not submit the clear!");
+	}
+	vkQueueWaitIdle(_queue);
+
+	vkDestroyCommandPool(device, commandPool, nullptr);
+}
+
+bool OcclusionCuller::canBuild() const
+{
+	return pipeline != VK_NULL_HANDLE;
+}
+
+void OcclusionCuller::setDepthView(VkImageView _depthView)
+{
+	if (canBuild())
+	{
+		writeLevelSet(0, _depthView);
+	}
+}
+
+void OcclusionCuller::beginFrame(const glm::mat4& _viewProjection, float _viewportScaleX, float _viewportScaleY)
+{
+	VkExtent2D extent = pyramid.getExtent();
+	visibilityBit ^= 1;
+
+	OcclusionCameraData camera{};
+	std::memcpy(camera.viewProjection, glm::value_ptr(_viewProjection), sizeof(camera.viewProjection));
+	camera.pyramidSize[0] = static_cast<float>(extent.width);
+	camera.pyramidSize[1] = static_cast<float>(extent.height);
+	camera.pyramidLevels = pyramid.getMipLevels();
+	camera.visibilityBit = visibilityBit;
+	camera.viewportScale[0] = _viewportScaleX;
+	camera.viewportScale[1] = _viewportScaleY;
+	std::memcpy(cameraMapped, &camera, sizeof(camera));
+}
+
+OcclusionCounters OcclusionCuller::takeCounters()
+{
+	OcclusionCounters counters;
+	std::memcpy(&counters, counterMapped, sizeof(counters));
+	std::memset(counterMapped, 0, sizeof(counters));
+	return counters;
+}
+
+void OcclusionCuller::build(VkCommandBuffer _commandBuffer)
+{
+	BarrierBatch barriers;
+	barriers.transition(pyramid, VK_IMAGE_LAYOUT_GENERAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+	barriers.flush(_commandBuffer);
+
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
+
+	//each level is the source of the next one, so every step waits on the previous
+	for (uint32_t level = 0; level < pyramid.getMipLevels(); ++level)
+	{
+		VkExtent2D extent = pyramid.getExtent(level);
+		vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &levelSets[level], 0, nullptr);
+		vkCmdDispatch(_commandBuffer,
+			(extent.width + ReduceGroupSize - 1) / ReduceGroupSize,
+			(extent.height + ReduceGroupSize - 1) / ReduceGroupSize, 1);
+
+		barriers.transition(pyramid, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, readerStages, VK_ACCESS_SHADER_READ_BIT, level, 1);
+		barriers.flush(_commandBuffer);
+	}
+}
+
+VkDescriptorImageInfo OcclusionCuller::getPyramidInfo() const
+{
+	return { sampler, pyramidView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL };
+}
+
+VkBuffer OcclusionCuller::getVisibilityBuffer() const
+{
+	return visibilityBuffer;
+}
+
+VkBuffer OcclusionCuller::getCameraBuffer() const
+{
+	return cameraBuffer;
+}
+
+VkBuffer OcclusionCuller::getCounterBuffer() const
+{
+	return counterBuffer;
+}
+
+VkExtent2D OcclusionCuller::getPyramidExtent() const
+{
+	return pyramid.getExtent();
+}
@@ -0,0 +1,341 @@
+#include <OutputTarget.hpp>
+#include <FramePacer.hpp>	//presentModeName
+
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+void OutputTarget::init(VkInstance _instance, VkPhysicalDevice _physicalDevice, VkDevice _device, const OutputTargetConfig& _config)
+{
+	config = _config;
+	instance = _instance;
+	physicalDevice = _physicalDevice;
+	device = _device;
+
+	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	window = glfwCreateWindow(static_cast<int>(_config.width), static_cast<int>(_config.height), _config.title.c_str(), nullptr, nullptr);
+	if (window == nullptr)
+	{
+		throw std::runtime_error("[Output]: Couldn't open the window " + _config.title + "!");
+	}
+	if (_config.monitor)
+	{
+		int x = 0;
+		int y = 0;
+		glfwGetMonitorPos(_config.monitor, &x, &y);
+		glfwSetWindowPos(window, x, y);
+	}
+
+	if (glfwCreateWindowSurface(instance, window, nullptr, &surface) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[Output]: Couldn't create a surface for " + _config.title + "!");
+	}
+	VkBool32 presentSupport = VK_FALSE;
+	vkGetPhysicalDeviceSurfaceSupportKHR(_physicalDevice, _config.queueFamily, surface, &presentSupport);
+	if (!presentSupport)
+	{
+		throw std::runtime_error("[Output]: " + _config.title + " can't be presented to from the graphics queue!");
+	}
+
+	pollFramebufferSize();
+	createSwapchain();
+
+	VkSemaphoreCreateInfo semaphoreInfo{
+		VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0											//flags
+	};
+	if (vkCreateSemaphore(device, &semaphoreInfo, nullptr, &imageAvailableSemaphore) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[Output]: Couldn't create the acquire semaphore!");
+	}
+
+	std::cout << "[Output]: " << _config.title << ": " << extent.width << "x" << extent.height << ", " << images.size()
+		<< " images, " << presentModeName(presentMode) << "\n";
+}
+
+VkExtent2D OutputTarget::chooseExtent(const VkSurfaceCapabilitiesKHR& _capabilities) const
+{
+	VkExtent2D surfaceExtent = _capabilities.currentExtent;
+	if (surfaceExtent.width == std::numeric_limits<uint32_t>::max())
+	{
+		//a minimized window has a zero sized framebuffer, which stays zero instead of being clamped up
+		uint64_t size = framebufferSize->load(std::memory_order_relaxed);
+		uint32_t width = static_cast<uint32_t>(size >> 32);
+		uint32_t height = static_cast<uint32_t>(size);
+		if (width == 0 || height == 0)
+		{
+			return VkExtent2D{ 0, 0 };
+		}
+		surfaceExtent.width = std::clamp(width, _capabilities.minImageExtent.width, _capabilities.maxImageExtent.width);
+		surfaceExtent.height = std::clamp(height, _capabilities.minImageExtent.height, _capabilities.maxImageExtent.height);
+	}
+	return surfaceExtent;
+}
+
+//Like the engine's own swapchain, but the format is given: the scene and the upscale pass were created for it
+void OutputTarget::createSwapchain()
+{
+	VkSurfaceCapabilitiesKHR capabilities;
+	vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &capabilities);
+
+	uint32_t formatCount = 0;
+	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, nullptr);
+	std::vector<VkSurfaceFormatKHR> formats(formatCount);
+	vkGetPhysicalDeviceSurfaceFormatsKHR(physicalDevice, surface, &formatCount, formats.data());
+	auto format = std::find_if(formats.begin(), formats.end(),
+		[&](const VkSurfaceFormatKHR& _format) { return _format.format == config.format; });
+	if (format == formats.end())
+	{
+		throw std::runtime_error("[Output]: " + config.title + " doesn't offer the main window's swapchain format!");
+	}
+
+	uint32_t modeCount = 0;
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &modeCount, nullptr);
+	std::vector<VkPresentModeKHR> presentModes(modeCount);
+	vkGetPhysicalDeviceSurfacePresentModesKHR(physicalDevice, surface, &modeCount, presentModes.data());
+	presentMode = std::find(presentModes.begin(), presentModes.end(), config.presentMode) != presentModes.end() ?
+		config.presentMode : VK_PRESENT_MODE_FIFO_KHR;
+
+	extent = chooseExtent(capabilities);
+	if (extent.width == 0 || extent.height == 0)
+	{
+		throw std::runtime_error("[Output]: " + config.title + " has no area to present to!");
+	}
+
+	uint32_t minImageCount = config.imageCount > 0 ? config.imageCount : capabilities.minImageCount + 1;
+	uint32_t imageCountLimit = capabilities.maxImageCount > 0 ? capabilities.maxImageCount : std::numeric_limits<uint32_t>::max();
+	minImageCount = std::clamp(minImageCount, capabilities.minImageCount, imageCountLimit);
+
+	//only the graphics queue touches the images, it also presents them
+	VkSwapchainCreateInfoKHR createInfo{
+		VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		surface,										//surface
+		minImageCount,									//minImageCount
+		format->format,									//imageFormat
+		format->colorSpace,								//imageColorSpace
+		extent,											//imageExtent
+		1,												//imageArrayLayers
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,			//imageUsage
+		VK_SHARING_MODE_EXCLUSIVE,						//imageSharingMode
+		0,												//queueFamilyIndexCount
+		nullptr,										//pQueueFamilyIndices
+		capabilities.currentTransform,					//preTransform
+		VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,				//compositeAlpha
+		presentMode,									//presentMode
+		VK_TRUE,										//clipped
+		VK_NULL_HANDLE									//oldSwapchain
+	};
+	if (vkCreateSwapchainKHR(device, &createInfo, nullptr, &swapchain) != VK_SUCCESS)
+	{
+		throw std::runtime_error("[Output]: Swapchain for " + config.title + " could not be created!");
+	}
+
+	uint32_t imageCount = 0;
+	vkGetSwapchainImagesKHR(device, swapchain, &imageCount, nullptr);
+	images.resize(imageCount);
+	vkGetSwapchainImagesKHR(device, swapchain, &imageCount, images.data());
+
+	imageViews.resize(images.size());
+	for (size_t i = 0; i < images.size(); ++i)
+	{
+		VkImageViewCreateInfo viewInfo{
+			VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,	//sType
+			nullptr,									//pNext
+			0,											//flags
+			images[i],									//image
+			VK_IMAGE_VIEW_TYPE_2D,						//viewType
+			format->format,								//format
+			VkComponentMapping {						//components
+				VK_COMPONENT_SWIZZLE_IDENTITY,	//r
+				VK_COMPONENT_SWIZZLE_IDENTITY,	//g
+				VK_COMPONENT_SWIZZLE_IDENTITY,	//b
+				VK_COMPONENT_SWIZZLE_IDENTITY	//a
+			},
+			VkImageSubresourceRange {					//subresourceRange
+				VK_IMAGE_ASPECT_COLOR_BIT,		//aspectMask
+				0,								//baseMipLevel
+				1,								//levelCount
+				0,								//baseArrayLayer
+				1,								//layerCount
+			}
+		};
+		if (vkCreateImageView(device, &viewInfo, nullptr, &imageViews[i]) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[Output]: Failed to create the swapchain image views of " + config.title + "!");
+		}
+	}
+}
+
+void OutputTarget::destroySwapchain()
+{
+	for (VkImageView imageView : imageViews)
+	{
+		vkDestroyImageView(device, imageView, nullptr);
+	}
+	vkDestroySwapchainKHR(device, swapchain, nullptr);
+	imageViews.clear();
+	images.clear();
+	swapchain = VK_NULL_HANDLE;
+}
+
+void OutputTarget::destroy()
+{
+	if (device != VK_NULL_HANDLE)
+	{
+		vkDestroySemaphore(device, imageAvailableSemaphore, nullptr);
+		destroySwapchain();
+	}
+	if (instance != VK_NULL_HANDLE)
+	{
+		vkDestroySurfaceKHR(instance, surface, nullptr);
+	}
+	if (window)
+	{
+		glfwDestroyWindow(window);
+	}
+	imageAvailableSemaphore = VK_NULL_HANDLE;
+	surface = VK_NULL_HANDLE;
+	window = nullptr;
+	device = VK_NULL_HANDLE;
+	physicalDevice = VK_NULL_HANDLE;
+	instance = VK_NULL_HANDLE;
+	acquired = false;
+	stale = false;
+	retired = false;
+}
+
+VkResult OutputTarget::acquire()
+{
+	acquired = false;
+	if (retired)
+	{
+		return VK_ERROR_SURFACE_LOST_KHR;
+	}
+	if (stale)
+	{
+		return VK_ERROR_OUT_OF_DATE_KHR;
+	}
+
+	VkResult result = vkAcquireNextImageKHR(device, swapchain, UINT64_MAX, imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	acquired = result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR;
+	onResult(result);
+	return result;
+}
+
+void OutputTarget::presented(VkResult _result)
+{
+	acquired = false;
+	onResult(_result);
+}
+
+void OutputTarget::onResult(VkResult _result)
+{
+	if (_result == VK_ERROR_SURFACE_LOST_KHR && !retired)
+	{
+		std::cout << "[Output]: " << config.title << " lost its surface, it isn't presented to anymore\n";
+		retired = true;
+	}
+	else if (_result == VK_ERROR_OUT_OF_DATE_KHR || _result == VK_SUBOPTIMAL_KHR)
+	{
+		stale = true;
+	}
+}
+
+bool OutputTarget::recreate()
+{
+	if (retired || !stale)
+	{
+		return false;
+	}
+
+	VkSurfaceCapabilitiesKHR capabilities;
+	if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(physicalDevice, surface, &capabilities) == VK_ERROR_SURFACE_LOST_KHR)
+	{
+		onResult(VK_ERROR_SURFACE_LOST_KHR);
+		return false;
+	}
+	VkExtent2D surfaceExtent = chooseExtent(capabilities);
+	if (surfaceExtent.width == 0 || surfaceExtent.height == 0)
+	{
+		return false;
+	}
+
+	//the views are still referenced by whatever was last recorded into them
+	vkDeviceWaitIdle(device);
+	destroySwapchain();
+	createSwapchain();
+	stale = false;
+
+	std::cout << "[Output]: " << config.title << " recreated: " << extent.width << "x" << extent.height << ", "
+		<< images.size() << " images\n";
+	return true;
+}
+
+void OutputTarget::pollFramebufferSize()
+{
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	framebufferSize->store((static_cast<uint64_t>(width) << 32) | static_cast<uint32_t>(height), std::memory_order_relaxed);
+}
+
+bool OutputTarget::shouldClose() const
+{
+	return glfwWindowShouldClose(window);
+}
+
+VkSwapchainKHR OutputTarget::getSwapchain() const
+{
+	return swapchain;
+}
+
+const std::vector<VkImage>& OutputTarget::getImages() const
+{
+	return images;
+}
+
+const std::vector<VkImageView>& OutputTarget::getImageViews() const
+{
+	return imageViews;
+}
+
+VkExtent2D OutputTarget::getExtent() const
+{
+	return extent;
+}
+
+VkPresentModeKHR OutputTarget::getPresentMode() const
+{
+	return presentMode;
+}
+
+VkSemaphore OutputTarget::getImageAvailableSemaphore() const
+{
+	return imageAvailableSemaphore;
+}
+
+uint32_t OutputTarget::getImageIndex() const
+{
+	return imageIndex;
+}
+
+bool OutputTarget::isAcquired() const
+{
+	return acquired;
+}
+
+bool OutputTarget::isStale() const
+{
+	return stale;
+}
+
+bool OutputTarget::isRetired() const
+{
+	return retired;
+}
@@ -0,0 +1,624 @@
+#include <ParticleSystem.hpp>
+#include <vulkanUtils.hpp>
+#include <ShaderCache.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include <glm/gtc/type_ptr.hpp>
+
+static constexpr uint32_t ParticleGroupSize = 64;	//matches local_size in particle_reset, _emit and _simulate.comp
+static constexpr uint32_t SortGroupSize = 256;		//matches local_size in particle_sort.comp
+static constexpr uint32_t SortBlock = 2 * SortGroupSize;	//keys a sort workgroup orders in shared memory
+
+static_assert(offsetof(ParticleCounters, simulate) == 16 && offsetof(ParticleCounters, draw) == 32,
+	"ParticleCounters has to match the Counters block in the particle shaders");
+
+//Matches the push constant block in the particle compute shaders
+struct ParticlePushConstants {
+	float emitter[4];		//position, radius
+	float camera[4];
+	float deltaTime;
+	float lifetime;
+	float speed;
+	float gravity;
+	uint32_t emitCount;
+	uint32_t current;		//alive list emitted into and simulated from
+	uint32_t maxParticles;
+	uint32_t seed;
+	uint32_t mode;			//particle_args: 0 sizes the simulation, 1 the draw. particle_sort: 0 sorts blocks, 1 one global step, 2 merges blocks
+	uint32_t sortK;
+	uint32_t sortJ;
+	uint32_t padding;
+};
+
+//Matches the push constant block in particle.vert
+struct ParticleDrawPushConstants {
+	float viewProjection[16];
+	float size;
+	float aspect;
+	float padding[2];
+};
+
+namespace
+{
+	const char* StageShaders[] = { "particle_reset.spv", "particle_emit.spv", "particle_args.spv", "particle_simulate.spv",
+		"particle_sort.spv" };
+
+	//Everything the particle shaders write is only read by other particle shaders, the draw and the counters copy
+	void memoryBarrier(VkCommandBuffer _commandBuffer, VkPipelineStageFlags _srcStages, VkAccessFlags _srcAccess,
+		VkPipelineStageFlags _dstStages, VkAccessFlags _dstAccess)
+	{
+		VkMemoryBarrier barrier{
+			VK_STRUCTURE_TYPE_MEMORY_BARRIER,	//sType
+			nullptr,							//pNext
+			_srcAccess,							//srcAccessMask
+			_dstAccess							//dstAccessMask
+		};
+		vkCmdPipelineBarrier(_commandBuffer, _srcStages, _dstStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+	}
+
+	void computeBarrier(VkCommandBuffer _commandBuffer, VkPipelineStageFlags _dstStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VkAccessFlags _dstAccess = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT)
+	{
+		memoryBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, _dstStages, _dstAccess);
+	}
+
+	uint32_t groupCount(uint32_t _count, uint32_t _groupSize)
+	{
+		return (_count + _groupSize - 1) / _groupSize;
+	}
+}
+
+bool ParticleSystem::init(VkDevice _device, VkPhysicalDevice _physicalDevice, PipelineStateCache& _states,
+	PipelineCompiler& _compiler, const ParticleConfig& _config)
+{
+	if (_config.maxParticles == 0 || _config.lifetime <= 0.0f)
+	{
+		throw std::invalid_argument("[Particles]: Particle capacity and lifetime must be positive!");
+	}
+	std::vector<std::filesystem::path> shaders = { _config.shaderDir / "particle.spv", _config.shaderDir / "particle_sprite.spv" };
+	for (const char* shader : StageShaders)
+	{
+		shaders.push_back(_config.shaderDir / shader);
+	}
+	for (const std::filesystem::path& shader : shaders)
+	{
+		if (!std::filesystem::exists(shader))
+		{
+			std::cout << "[Particles]: " << shader.string() << " not found (run res/shaders/compile.bat), no particles.\n";
+			return false;
+		}
+	}
+
+	device = _device;
+	compiler = &_compiler;
+	config = _config;
+	if (config.emitRate <= 0.0f)
+	{
+		//lifetimes are spread evenly over half to all of the configured one
+		config.emitRate = config.maxParticles / (0.75f * config.lifetime);
+	}
+	sortCapacity = SortBlock;
+	while (sortCapacity < config.maxParticles)
+	{
+		sortCapacity <<= 1;
+	}
+
+	VkDeviceSize particles = config.maxParticles;
+	const std::pair<StateBuffer*, VkDeviceSize> buffers[] = {
+		{ &positions, particles * 4 * sizeof(float) },
+		{ &velocities, particles * 4 * sizeof(float) },
+		{ &colors, particles * sizeof(uint32_t) },
+		{ &deadList, particles * sizeof(uint32_t) },
+		{ &aliveLists, 2 * particles * sizeof(uint32_t) },
+		{ &sortKeys, static_cast<VkDeviceSize>(sortCapacity) * 2 * sizeof(uint32_t) }
+	};
+	for (const auto& [buffer, size] : buffers)
+	{
+		createBuffer(device, _physicalDevice, size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, config.queueFamilies, buffer->buffer, buffer->memory);
+	}
+	createBuffer(device, _physicalDevice, sizeof(ParticleCounters), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+		VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, config.queueFamilies, counters.buffer, counters.memory);
+	createBuffer(device, _physicalDevice, sizeof(ParticleCounters), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, config.queueFamilies,
+		readbackBuffer, readbackMemory);
+	vkMapMemory(device, readbackMemory, 0, VK_WHOLE_SIZE, 0, &readbackMapped);
+
+	createDescriptors(_states);
+	createPipelines(_states);
+
+	return true;
+}
+
+void ParticleSystem::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+	StateBuffer* buffers[] = { &positions, &velocities, &colors, &deadList, &aliveLists, &sortKeys, &counters };
+	for (StateBuffer* buffer : buffers)
+	{
+		vkDestroyBuffer(device, buffer->buffer, nullptr);
+		vkFreeMemory(device, buffer->memory, nullptr);
+	}
+	vkUnmapMemory(device, readbackMemory);
+	vkDestroyBuffer(device, readbackBuffer, nullptr);
+	vkFreeMemory(device, readbackMemory, nullptr);
+	device = VK_NULL_HANDLE;
+}
+
+void ParticleSystem::createDescriptors(PipelineStateCache& _states)
+{
+	const VkBuffer used[] = { positions.buffer, velocities.buffer, colors.buffer, deadList.buffer, aliveLists.buffer,
+		counters.buffer, sortKeys.buffer };
+	const uint32_t bindingCount = 7;
+
+	//the draw reads the same buffers to find each particle
+	VkDescriptorSetLayoutBinding bindings[bindingCount];
+	for (uint32_t i = 0; i < bindingCount; ++i)
+	{
+		bindings[i] = VkDescriptorSetLayoutBinding{
+			i,													//binding
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,					//descriptorType
+			1,													//descriptorCount
+			VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,	//stageFlags
+			nullptr												//pImmutableSamplers
+		};
+	}
+
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		bindingCount,											//bindingCount
+		bindings												//pBindings
+	};
+	descriptorSetLayout = _states.getDescriptorSetLayout(descriptorSetLayoutInfo);
+
+	VkDescriptorPoolSize poolSize{
+		VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,	//type
+		bindingCount						//descriptorCount
+	};
+	VkDescriptorPoolCreateInfo descriptorPoolInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//maxSets
+		1,												//poolSizeCount
+		&poolSize										//pPoolSizes
+	};
+	if (vkCreateDescriptorPool(device, &descriptorPoolInfo, nullptr, &descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Particles]: Failed to create the particle descriptor pool!");
+	}
+
+	VkDescriptorSetAllocateInfo descriptorSetInfo{
+		VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,	//sType
+		nullptr,										//pNext
+		descriptorPool,									//descriptorPool
+		1,												//descriptorSetCount
+		&descriptorSetLayout							//pSetLayouts
+	};
+	if (vkAllocateDescriptorSets(device, &descriptorSetInfo, &descriptorSet) != VK_SUCCESS) {
+		throw std::runtime_error("[Particles]: Failed to allocate the particle descriptor set!");
+	}
+
+	VkDescriptorBufferInfo bufferInfos[bindingCount];
+	VkWriteDescriptorSet writes[bindingCount];
+	for (uint32_t i = 0; i < bindingCount; ++i)
+	{
+		bufferInfos[i] = { used[i], 0, VK_WHOLE_SIZE };
+		writes[i] = VkWriteDescriptorSet{
+			VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,	//sType
+			nullptr,								//pNext
+			descriptorSet,							//dstSet
+			i,										//dstBinding
+			0,										//dstArrayElement
+			1,										//descriptorCount
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,		//descriptorType
+			nullptr,								//pImageInfo
+			&bufferInfos[i],						//pBufferInfo
+			nullptr									//pTexelBufferView
+		};
+	}
+	vkUpdateDescriptorSets(device, bindingCount, writes, 0, nullptr);
+}
+
+void ParticleSystem::createPipelines(PipelineStateCache& _states)
+{
+	auto loadModule = [this, &_states](const char* _name)
+	{
+		std::vector<char> code = ShaderCache::get().read(config.shaderDir / _name);
+		VkShaderModuleCreateInfo moduleInfo{
+			VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,		//sType
+			nullptr,											//pNext
+			0,													//flags
+			code.size(),										//codeSize
+			reinterpret_cast<const uint32_t*>(code.data())		//pCode
+		};
+		return _states.getShaderModule(moduleInfo);
+	};
+
+	VkPushConstantRange computeRange{
+		VK_SHADER_STAGE_COMPUTE_BIT,	//stageFlags
+		0,								//offset
+		sizeof(ParticlePushConstants)	//size
+	};
+	VkPipelineLayoutCreateInfo computeLayoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//setLayoutCount
+		&descriptorSetLayout,							//pSetLayouts
+		1,												//pushConstantRangeCount
+		&computeRange									//pPushConstantRanges
+	};
+	computeLayout = _states.getPipelineLayout(computeLayoutInfo);
+
+	//the stages are needed by the first frame, they're few and small enough to compile right away
+	for (uint32_t stage = 0; stage < StageCount; ++stage)
+	{
+		VkComputePipelineCreateInfo pipelineInfo{
+			VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,	//sType
+			nullptr,										//pNext
+			0,												//flags
+			VkPipelineShaderStageCreateInfo {				//stage
+				VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+				nullptr,
+				0,
+				VK_SHADER_STAGE_COMPUTE_BIT,
+				loadModule(StageShaders[stage]),
+				"main",
+				nullptr
+			},
+			computeLayout,									//layout
+			VK_NULL_HANDLE,									//basePipelineHandle
+			-1												//basePipelineIndex
+		};
+		pipelines[stage] = _states.getComputePipeline(pipelineInfo);
+	}
+
+	VkPushConstantRange drawRange{
+		VK_SHADER_STAGE_VERTEX_BIT,			//stageFlags
+		0,									//offset
+		sizeof(ParticleDrawPushConstants)	//size
+	};
+	VkPipelineLayoutCreateInfo drawLayoutInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,	//sType
+		nullptr,										//pNext
+		0,												//flags
+		1,												//setLayoutCount
+		&descriptorSetLayout,							//pSetLayouts
+		1,												//pushConstantRangeCount
+		&drawRange										//pPushConstantRanges
+	};
+	drawLayout = _states.getPipelineLayout(drawLayoutInfo);
+
+	VkPipelineShaderStageCreateInfo shaderStages[] = {
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			VK_SHADER_STAGE_VERTEX_BIT,								//stage
+			loadModule("particle.spv"),								//module
+			"main",													//pName
+			nullptr													//pSpecializationInfo
+		},
+		{
+			VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,	//sType
+			nullptr,												//pNext
+			0,														//flags
+			VK_SHADER_STAGE_FRAGMENT_BIT,							//stage
+			loadModule("particle_sprite.spv"),						//module
+			"main",													//pName
+			nullptr													//pSpecializationInfo
+		}
+	};
+
+	//quads are expanded from gl_VertexIndex and particles fetched by gl_InstanceIndex, there are no vertex buffers
+	VkPipelineVertexInputStateCreateInfo vertexInputInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		0,															//vertexBindingDescriptionCount
+		nullptr,													//pVertexBindingDescriptions
+		0,															//vertexAttributeDescriptionCount
+		nullptr														//pVertexAttributeDescriptions
+	};
+
+	VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,	//sType
+		nullptr,														//pNext
+		0,																//flags
+		VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,							//topology
+		VK_FALSE														//primitiveRestartEnable
+	};
+
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
+
+	VkPipelineDynamicStateCreateInfo dynamicStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		2,														//dynamicStateCount
+		dynamicStates											//pDynamicStates
+	};
+
+	VkPipelineViewportStateCreateInfo viewportStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,	//sType
+		nullptr,												//pNext
+		0,														//flags
+		1,														//viewportCount
+		nullptr,												//pViewports
+		1,														//scissorCount
+		nullptr													//pScissors
+	};
+
+	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_FALSE,													//depthClampEnable
+		VK_FALSE,													//rasterizerDiscardEnable
+		VK_POLYGON_MODE_FILL,										//polygonMode
+		VK_CULL_MODE_NONE,											//cullMode
+		VK_FRONT_FACE_CLOCKWISE,									//frontFace
+		VK_FALSE,													//depthBiasEnable
+		0.0f,														//depthBiasConstantFactor
+		0.0f,														//depthBiasClamp
+		0.0f,														//depthBiasSlopeFactor
+		1.0f														//lineWidth
+	};
+
+	VkPipelineMultisampleStateCreateInfo multisampleInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_SAMPLE_COUNT_1_BIT,										//rasterizationSamples
+		VK_FALSE,													//sampleShadingEnable
+		1.0f,														//minSampleShading
+		nullptr,													//pSampleMask
+		VK_FALSE,													//alphaToCoverageEnable
+		VK_FALSE													//alphaToOneEnable
+	};
+
+	//tested against the scene's reversed depth, but transparent, so nothing behind them is hidden
+	VkPipelineDepthStencilStateCreateInfo depthStencilInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_TRUE,													//depthTestEnable
+		VK_FALSE,													//depthWriteEnable
+		VK_COMPARE_OP_GREATER_OR_EQUAL,								//depthCompareOp
+		VK_FALSE,													//depthBoundsTestEnable
+		VK_FALSE,													//stencilTestEnable
+		VkStencilOpState{},											//front
+		VkStencilOpState{},											//back
+		0.0f,														//minDepthBounds
+		1.0f														//maxDepthBounds
+	};
+
+	//sorted particles blend over each other back to front, unsorted ones add up so their order doesn't matter
+	VkPipelineColorBlendAttachmentState colorBlendAttachment{
+		VK_TRUE,																//blendEnable
+		VK_BLEND_FACTOR_SRC_ALPHA,												//srcColorBlendFactor
+		config.sort ? VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA : VK_BLEND_FACTOR_ONE,	//dstColorBlendFactor
+		VK_BLEND_OP_ADD,														//colorBlendOp
+		VK_BLEND_FACTOR_ZERO,													//srcAlphaBlendFactor
+		VK_BLEND_FACTOR_ONE,													//dstAlphaBlendFactor
+		VK_BLEND_OP_ADD,														//alphaBlendOp
+		VK_COLOR_COMPONENT_R_BIT |												//colorWriteMask
+		VK_COLOR_COMPONENT_G_BIT |
+		VK_COLOR_COMPONENT_B_BIT |
+		VK_COLOR_COMPONENT_A_BIT
+	};
+
+	VkPipelineColorBlendStateCreateInfo colorBlendInfo{
+		VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,	//sType
+		nullptr,													//pNext
+		0,															//flags
+		VK_FALSE,													//logicOpEnable
+		VK_LOGIC_OP_COPY,											//logicOp
+		1,															//attachmentCount
+		&colorBlendAttachment,										//pAttachments
+		{ 0.0f, 0.0f, 0.0f, 0.0f }									//blendConstants[4]
+	};
+
+	VkGraphicsPipelineCreateInfo pipelineInfo{
+		VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,	//sType
+		nullptr,											//pNext
+		0,													//flags
+		2,													//stageCount
+		shaderStages,										//pStages
+		&vertexInputInfo,									//pVertexInputState
+		&inputAssemblyInfo,									//pInputAssemblyState
+		nullptr,											//pTessellationState
+		&viewportStateInfo,									//pViewportState
+		&rasterizationStateInfo,							//pRasterizationState
+		&multisampleInfo,									//pMultisampleState
+		&depthStencilInfo,									//pDepthStencilState
+		&colorBlendInfo,									//pColorBlendState
+		&dynamicStateInfo,									//pDynamicState
+		drawLayout,											//layout
+		config.renderPass,									//renderPass
+		0,													//subpass
+		VK_NULL_HANDLE,										//basePipelineHandle
+		-1													//basePipelineIndex
+	};
+	drawPipeline = compiler->request(pipelineInfo);
+}
+
+void ParticleSystem::dispatch(VkCommandBuffer _commandBuffer, Stage _stage, uint32_t _groups, uint32_t _mode, uint32_t _sortK,
+	uint32_t _sortJ)
+{
+	ParticlePushConstants pushConstants{
+		{ config.emitterPosition.x, config.emitterPosition.y, config.emitterPosition.z, config.emitterRadius },	//emitter
+		{ camera.x, camera.y, camera.z, camera.w },	//camera
+		deltaTime,					//deltaTime
+		config.lifetime,			//lifetime
+		config.speed,				//speed
+		config.gravity,				//gravity
+		emitCount,					//emitCount
+		current,					//current
+		config.maxParticles,		//maxParticles
+		seed,						//seed
+		_mode,						//mode
+		_sortK,						//sortK
+		_sortJ,						//sortJ
+		0							//padding
+	};
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines[_stage]);
+	vkCmdPushConstants(_commandBuffer, computeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ParticlePushConstants), &pushConstants);
+	if (_groups > 0)
+	{
+		vkCmdDispatch(_commandBuffer, _groups, 1, 1);
+	}
+	else {
+		//sized by the GPU
+		vkCmdDispatchIndirect(_commandBuffer, counters.buffer, offsetof(ParticleCounters, simulate));
+	}
+}
+
+void ParticleSystem::beginFrame(float _deltaTime, const glm::vec4& _camera)
+{
+	if (recorded)
+	{
+		ParticleCounters last;
+		std::memcpy(&last, readbackMapped, sizeof(last));
+		stats.aliveTotal += last.draw.instanceCount;
+		stats.aliveMax = std::max(stats.aliveMax, last.draw.instanceCount);
+		stats.emitted += last.emitted;
+	}
+
+	deltaTime = _deltaTime;
+	camera = _camera;
+	seed = seed * 1664525u + 1013904223u;
+
+	float emit = config.emitRate * _deltaTime + emitRemainder;
+	emitCount = static_cast<uint32_t>(std::min(emit, static_cast<float>(config.maxParticles)));
+	emitRemainder = std::min(emit - emitCount, 1.0f);
+	stats.emitRequested += emitCount;
+}
+
+void ParticleSystem::recordSimulation(VkCommandBuffer _commandBuffer)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, computeLayout, 0, 1, &descriptorSet, 0, nullptr);
+
+	//the previous frame finished before this one was recorded, its draw and copy are done with every buffer
+	vkCmdFillBuffer(_commandBuffer, counters.buffer, offsetof(ParticleCounters, emitted), sizeof(uint32_t), 0);
+	if (config.sort)
+	{
+		//keys past the alive count sort to the end
+		vkCmdFillBuffer(_commandBuffer, sortKeys.buffer, 0, VK_WHOLE_SIZE, 0xffffffffu);
+	}
+	if (reset)
+	{
+		//leaves emitted to the fill above
+		dispatch(_commandBuffer, Reset, groupCount(config.maxParticles, ParticleGroupSize), 0, 0, 0);
+		reset = false;
+	}
+	memoryBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+	if (emitCount > 0)
+	{
+		dispatch(_commandBuffer, Emit, groupCount(emitCount, ParticleGroupSize), 0, 0, 0);
+		computeBarrier(_commandBuffer);
+	}
+
+	dispatch(_commandBuffer, Args, 1, 0, 0, 0);
+	computeBarrier(_commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT,
+		VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+	dispatch(_commandBuffer, Simulate, 0, 0, 0, 0);
+	computeBarrier(_commandBuffer);
+	dispatch(_commandBuffer, Args, 1, 1, 0, 0);
+
+	if (config.sort)
+	{
+		//bitonic: blocks are sorted in shared memory, then every merge runs its wide steps over the whole buffer and
+		//finishes the steps that stay within a block in shared memory again
+		uint32_t sortGroups = sortCapacity / SortBlock;
+		computeBarrier(_commandBuffer);
+		dispatch(_commandBuffer, Sort, sortGroups, 0, 0, 0);
+		for (uint32_t k = 2 * SortBlock; k <= sortCapacity; k <<= 1)
+		{
+			for (uint32_t j = k / 2; j >= SortBlock; j >>= 1)
+			{
+				computeBarrier(_commandBuffer);
+				dispatch(_commandBuffer, Sort, sortGroups, 1, k, j);
+			}
+			computeBarrier(_commandBuffer);
+			dispatch(_commandBuffer, Sort, sortGroups, 2, k, SortBlock / 2);
+		}
+	}
+
+	computeBarrier(_commandBuffer, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT);
+	VkBufferCopy copy{
+		0,							//srcOffset
+		0,							//dstOffset
+		sizeof(ParticleCounters)	//size
+	};
+	vkCmdCopyBuffer(_commandBuffer, counters.buffer, readbackBuffer, 1, &copy);
+	memoryBarrier(_commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+		VK_ACCESS_HOST_READ_BIT);
+
+	current = 1 - current;
+	recorded = true;
+	stats.frames++;
+	stats.recordTotal += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void ParticleSystem::recordDraw(VkCommandBuffer _commandBuffer, const glm::mat4& _viewProjection, float _aspect)
+{
+	VkPipeline pipeline = drawPipeline->pipeline.load(std::memory_order_acquire);
+	if (pipeline == VK_NULL_HANDLE)
+	{
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+
+	ParticleDrawPushConstants pushConstants;
+	std::memcpy(pushConstants.viewProjection, glm::value_ptr(_viewProjection), sizeof(pushConstants.viewProjection));
+	pushConstants.size = config.particleSize;
+	pushConstants.aspect = _aspect;
+	pushConstants.padding[0] = pushConstants.padding[1] = 0.0f;
+
+	vkCmdBindPipeline(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+	vkCmdBindDescriptorSets(_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, drawLayout, 0, 1, &descriptorSet, 0, nullptr);
+	vkCmdPushConstants(_commandBuffer, drawLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ParticleDrawPushConstants), &pushConstants);
+	vkCmdDrawIndirect(_commandBuffer, counters.buffer, offsetof(ParticleCounters, draw), 1, sizeof(VkDrawIndirectCommand));
+
+	stats.recordTotal += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool ParticleSystem::isSorted() const
+{
+	return config.sort;
+}
+
+uint32_t ParticleSystem::getCapacity() const
+{
+	return config.maxParticles;
+}
+
+const ParticleStats& ParticleSystem::getStats() const
+{
+	return stats;
+}
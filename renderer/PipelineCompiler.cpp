@@ -0,0 +1,374 @@
+#include <PipelineCompiler.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	constexpr VkGraphicsPipelineLibraryFlagBitsEXT LibraryParts[] = {
+		VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+		VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT
+	};
+	constexpr uint32_t LibraryPartCount = sizeof(LibraryParts) / sizeof(LibraryParts[0]);
+
+	template <typename T>
+	const T* copyOptional(const T* _source, T& _destination)
+	{
+		if (!_source)
+		{
+			return nullptr;
+		}
+		_destination = *_source;
+		return &_destination;
+	}
+
+	template <typename T>
+	const T* copyArray(const T* _source, size_t _count, std::vector<T>& _destination)
+	{
+		if (!_source)
+		{
+			return nullptr;
+		}
+		_destination.assign(_source, _source + _count);
+		return _destination.data();
+	}
+
+	//Deep copy of a graphics pipeline create info, so it can be compiled after the caller's structs are gone.
+	//Pointers point into the copy itself, it can't be copied or moved.
+	class PipelineInfoCopy
+	{
+	private:
+		std::vector<VkPipelineShaderStageCreateInfo> stages;
+		std::vector<std::string> names;
+		std::vector<VkSpecializationInfo> specializations;
+		std::vector<std::vector<VkSpecializationMapEntry>> mapEntries;
+		std::vector<std::vector<uint8_t>> specializationData;
+
+		VkPipelineVertexInputStateCreateInfo vertexInput{};
+		std::vector<VkVertexInputBindingDescription> vertexBindings;
+		std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+		VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+		VkPipelineTessellationStateCreateInfo tessellation{};
+		VkPipelineViewportStateCreateInfo viewport{};
+		std::vector<VkViewport> viewports;
+		std::vector<VkRect2D> scissors;
+		VkPipelineRasterizationStateCreateInfo rasterization{};
+		VkPipelineMultisampleStateCreateInfo multisample{};
+		std::vector<VkSampleMask> sampleMask;
+		VkPipelineDepthStencilStateCreateInfo depthStencil{};
+		VkPipelineColorBlendStateCreateInfo colorBlend{};
+		std::vector<VkPipelineColorBlendAttachmentState> blendAttachments;
+		VkPipelineDynamicStateCreateInfo dynamicState{};
+		std::vector<VkDynamicState> dynamicStates;
+
+		VkGraphicsPipelineCreateInfo info;
+
+	public:
+		explicit PipelineInfoCopy(const VkGraphicsPipelineCreateInfo& _createInfo)
+			: info(_createInfo)
+		{
+			//reserved up front, the stages point into these
+			stages.assign(_createInfo.pStages, _createInfo.pStages + _createInfo.stageCount);
+			names.reserve(stages.size());
+			specializations.reserve(stages.size());
+			mapEntries.reserve(stages.size());
+			specializationData.reserve(stages.size());
+			for (VkPipelineShaderStageCreateInfo& stage : stages)
+			{
+				names.emplace_back(stage.pName ? stage.pName : "");
+				stage.pName = names.back().c_str();
+				if (stage.pSpecializationInfo)
+				{
+					const VkSpecializationInfo& source = *stage.pSpecializationInfo;
+					mapEntries.emplace_back(source.pMapEntries, source.pMapEntries + source.mapEntryCount);
+					const uint8_t* data = static_cast<const uint8_t*>(source.pData);
+					specializationData.emplace_back(data, data + source.dataSize);
+					specializations.push_back(VkSpecializationInfo{
+						source.mapEntryCount,				//mapEntryCount
+						mapEntries.back().data(),			//pMapEntries
+						source.dataSize,					//dataSize
+						specializationData.back().data()	//pData
+					});
+					stage.pSpecializationInfo = &specializations.back();
+				}
+			}
+			info.pStages = stages.data();
+
+			if ((info.pVertexInputState = copyOptional(_createInfo.pVertexInputState, vertexInput)))
+			{
+				vertexInput.pVertexBindingDescriptions = copyArray(vertexInput.pVertexBindingDescriptions, vertexInput.vertexBindingDescriptionCount, vertexBindings);
+				vertexInput.pVertexAttributeDescriptions = copyArray(vertexInput.pVertexAttributeDescriptions, vertexInput.vertexAttributeDescriptionCount, vertexAttributes);
+			}
+			info.pInputAssemblyState = copyOptional(_createInfo.pInputAssemblyState, inputAssembly);
+			info.pTessellationState = copyOptional(_createInfo.pTessellationState, tessellation);
+			if ((info.pViewportState = copyOptional(_createInfo.pViewportState, viewport)))
+			{
+				viewport.pViewports = copyArray(viewport.pViewports, viewport.viewportCount, viewports);
+				viewport.pScissors = copyArray(viewport.pScissors, viewport.scissorCount, scissors);
+			}
+			info.pRasterizationState = copyOptional(_createInfo.pRasterizationState, rasterization);
+			if ((info.pMultisampleState = copyOptional(_createInfo.pMultisampleState, multisample)))
+			{
+				multisample.pSampleMask = copyArray(multisample.pSampleMask, (static_cast<uint32_t>(multisample.rasterizationSamples) + 31) / 32, sampleMask);
+			}
+			info.pDepthStencilState = copyOptional(_createInfo.pDepthStencilState, depthStencil);
+			if ((info.pColorBlendState = copyOptional(_createInfo.pColorBlendState, colorBlend)))
+			{
+				colorBlend.pAttachments = copyArray(colorBlend.pAttachments, colorBlend.attachmentCount, blendAttachments);
+			}
+			if ((info.pDynamicState = copyOptional(_createInfo.pDynamicState, dynamicState)))
+			{
+				dynamicState.pDynamicStates = copyArray(dynamicState.pDynamicStates, dynamicState.dynamicStateCount, dynamicStates);
+			}
+		}
+
+		PipelineInfoCopy(const PipelineInfoCopy&) = delete;
+		PipelineInfoCopy& operator=(const PipelineInfoCopy&) = delete;
+
+		const VkGraphicsPipelineCreateInfo& get() const
+		{
+			return info;
+		}
+	};
+}
+
+struct PipelineCompiler::Request {
+	CompiledPipeline compiled;
+	PipelineInfoCopy info;
+	VkPipeline libraries[LibraryPartCount] = {};
+
+	explicit Request(const VkGraphicsPipelineCreateInfo& _createInfo)
+		: info(_createInfo)
+	{
+	}
+};
+
+const char* pipelineCompileModeName(PipelineCompileMode _mode)
+{
+	switch (_mode)
+	{
+	case PipelineCompileMode::Libraries:
+		return "pipeline libraries";
+	case PipelineCompileMode::Async:
+		return "async compile";
+	}
+	return "unknown";
+}
+
+PipelineCompiler::PipelineCompiler() = default;
+
+PipelineCompiler::~PipelineCompiler()
+{
+	destroy();
+}
+
+void PipelineCompiler::init(PipelineStateCache& _states, PipelineCompileMode _mode)
+{
+	states = &_states;
+	mode = _mode;
+	stopping = false;
+	thread = std::thread(&PipelineCompiler::compileLoop, this);
+}
+
+void PipelineCompiler::destroy()
+{
+	if (!thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+		queue.clear();
+	}
+	workCondition.notify_all();
+	thread.join();
+
+	requests.clear();
+	owned.clear();
+	states = nullptr;
+}
+
+const CompiledPipeline* PipelineCompiler::request(const VkGraphicsPipelineCreateInfo& _createInfo)
+{
+	PipelineStateKey key = states->getGraphicsPipelineKey(_createInfo);
+	if (const ConcurrentHandleMap::Entry* entry = requests.find(key.hash, key.bytes))
+	{
+		return &reinterpret_cast<Request*>(static_cast<uintptr_t>(entry->value))->compiled;
+	}
+
+	auto created = std::make_unique<Request>(_createInfo);
+	Request* request = created.get();
+	const ConcurrentHandleMap::Entry* entry = requests.insert(key.hash, std::move(key.bytes), reinterpret_cast<uintptr_t>(request));
+	if (entry->value != reinterpret_cast<uintptr_t>(request))
+	{
+		//another thread requested the same pipeline at the same time
+		return &reinterpret_cast<Request*>(static_cast<uintptr_t>(entry->value))->compiled;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		owned.push_back(std::move(created));
+		stats.requested++;
+	}
+
+	bool partsReady = mode == PipelineCompileMode::Libraries;
+	for (uint32_t i = 0; i < LibraryPartCount && partsReady; ++i)
+	{
+		request->libraries[i] = states->findPipelineLibrary(request->info.get(), LibraryParts[i]);
+		partsReady = request->libraries[i] != VK_NULL_HANDLE;
+	}
+	if (!partsReady)
+	{
+		enqueue(Task{ request, false });
+		return &request->compiled;
+	}
+
+	try {
+		linkFast(*request);
+	} catch (...) {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			request->compiled.error = std::current_exception();
+			request->compiled.failed = true;
+		}
+		readyCondition.notify_all();
+		throw;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.linkedOnRequest++;
+	}
+	readyCondition.notify_all();
+	enqueue(Task{ request, true });
+	return &request->compiled;
+}
+
+void PipelineCompiler::wait(const CompiledPipeline* _pipeline)
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	readyCondition.wait(lock, [_pipeline]()
+	{
+		return _pipeline->pipeline.load(std::memory_order_acquire) != VK_NULL_HANDLE || _pipeline->failed.load(std::memory_order_acquire);
+	});
+	if (_pipeline->failed)
+	{
+		std::rethrow_exception(_pipeline->error);
+	}
+}
+
+void PipelineCompiler::enqueue(Task _task)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		queue.push_back(_task);
+	}
+	workCondition.notify_one();
+}
+
+void PipelineCompiler::compileLoop()
+{
+	while (true)
+	{
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workCondition.wait(lock, [this]() { return stopping || !queue.empty(); });
+			if (stopping)
+			{
+				return;
+			}
+			task = queue.front();
+			queue.pop_front();
+		}
+
+		Clock::time_point start = Clock::now();
+		std::exception_ptr error;
+		try {
+			if (task.optimize)
+			{
+				optimize(*task.request);
+			} else {
+				build(*task.request);
+			}
+		} catch (...) {
+			error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			stats.backgroundTotal += std::chrono::duration<double>(Clock::now() - start).count();
+			//a failed optimized link leaves the fast one in place
+			if (error && !task.optimize)
+			{
+				task.request->compiled.error = error;
+				task.request->compiled.failed = true;
+			}
+		}
+		if (error && task.optimize)
+		{
+			std::cout << "[PipelineCompiler]: Optimized link failed, keeping the fast linked pipeline.\n";
+		}
+		readyCondition.notify_all();
+	}
+}
+
+//Compile thread. Parts another pipeline already compiled are shared, only the missing ones are built.
+void PipelineCompiler::build(Request& _request)
+{
+	if (mode == PipelineCompileMode::Libraries)
+	{
+		for (uint32_t i = 0; i < LibraryPartCount; ++i)
+		{
+			_request.libraries[i] = states->getPipelineLibrary(_request.info.get(), LibraryParts[i]);
+		}
+		linkFast(_request);
+		enqueue(Task{ &_request, true });
+		return;
+	}
+
+	_request.compiled.pipeline.store(states->getGraphicsPipeline(_request.info.get()), std::memory_order_release);
+	_request.compiled.optimized.store(true, std::memory_order_release);
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.asyncCompiles++;
+}
+
+void PipelineCompiler::linkFast(Request& _request)
+{
+	Clock::time_point start = Clock::now();
+	VkPipeline pipeline = states->getLinkedPipeline(_request.libraries, LibraryPartCount, _request.info.get().layout, false);
+	double duration = std::chrono::duration<double>(Clock::now() - start).count();
+
+	_request.compiled.pipeline.store(pipeline, std::memory_order_release);
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.fastLinks++;
+	stats.fastLinkTotal += duration;
+	stats.fastLinkMax = std::max(stats.fastLinkMax, duration);
+}
+
+void PipelineCompiler::optimize(Request& _request)
+{
+	VkPipeline pipeline = states->getLinkedPipeline(_request.libraries, LibraryPartCount, _request.info.get().layout, true);
+	_request.compiled.pipeline.store(pipeline, std::memory_order_release);
+	_request.compiled.optimized.store(true, std::memory_order_release);
+	std::lock_guard<std::mutex> lock(mutex);
+	stats.optimizedLinks++;
+}
+
+PipelineCompileMode PipelineCompiler::getMode() const
+{
+	return mode;
+}
+
+PipelineCompilerStats PipelineCompiler::getStats() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return stats;
+}
@@ -0,0 +1,940 @@
+#include <PipelineStateCache.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+namespace
+{
+	constexpr size_t InitialSlots = 64;
+
+	//Handles are pointers or 64 bit integers depending on the platform
+	template <typename Handle>
+	uint64_t handleValue(Handle _handle)
+	{
+		if constexpr (std::is_pointer_v<Handle>)
+		{
+			return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(_handle));
+		} else {
+			return static_cast<uint64_t>(_handle);
+		}
+	}
+
+	template <typename Handle>
+	Handle toHandle(uint64_t _value)
+	{
+		if constexpr (std::is_pointer_v<Handle>)
+		{
+			return reinterpret_cast<Handle>(static_cast<uintptr_t>(_value));
+		} else {
+			return static_cast<Handle>(_value);
+		}
+	}
+
+	void requireNoChain(const void* _pNext)
+	{
+		if (_pNext)
+		{
+			throw std::invalid_argument("[PipelineStateCache]: pNext chains aren't part of the key!");
+		}
+	}
+
+	//Canonical bytes of a create info, every field is written on its own
+	class KeyWriter
+	{
+	public:
+		std::vector<uint8_t> bytes;
+
+		template <typename T>
+		void add(T _value)
+		{
+			static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "Write handles with addHandle");
+			const uint8_t* data = reinterpret_cast<const uint8_t*>(&_value);
+			bytes.insert(bytes.end(), data, data + sizeof(T));
+		}
+
+		template <typename Handle>
+		void addHandle(Handle _handle)
+		{
+			add(handleValue(_handle));
+		}
+
+		void addBytes(const void* _data, size_t _size)
+		{
+			add(static_cast<uint64_t>(_size));
+			const uint8_t* data = static_cast<const uint8_t*>(_data);
+			bytes.insert(bytes.end(), data, data + _size);
+		}
+
+		void addString(const char* _string)
+		{
+			addBytes(_string, _string ? strlen(_string) : 0);
+		}
+
+		//Optional structs are written as a flag and then their fields, so a missing struct can't look like a present one
+		bool addPresent(const void* _pointer)
+		{
+			add(static_cast<uint8_t>(_pointer != nullptr));
+			return _pointer != nullptr;
+		}
+
+		//FNV-1a
+		uint64_t hash() const
+		{
+			uint64_t hash = 14695981039346656037ull;
+			for (uint8_t byte : bytes)
+			{
+				hash = (hash ^ byte) * 1099511628211ull;
+			}
+			return hash;
+		}
+	};
+
+	void addStencilOp(KeyWriter& _key, const VkStencilOpState& _state)
+	{
+		_key.add(_state.failOp);
+		_key.add(_state.passOp);
+		_key.add(_state.depthFailOp);
+		_key.add(_state.compareOp);
+		_key.add(_state.compareMask);
+		_key.add(_state.writeMask);
+		_key.add(_state.reference);
+	}
+
+	void addAttachmentReference(KeyWriter& _key, const VkAttachmentReference& _reference)
+	{
+		_key.add(_reference.attachment);
+		_key.add(_reference.layout);
+	}
+
+	//Keys of different kinds of pipelines share a table, they start with the kind so they can't collide
+	enum class PipelineKind : uint8_t {
+		Graphics,
+		Compute,
+		Library,
+		Linked
+	};
+
+	uint64_t moduleHash(const ConcurrentHandleMap& _moduleHashes, VkShaderModule _module)
+	{
+		KeyWriter key;
+		key.addHandle(_module);
+		const ConcurrentHandleMap::Entry* entry = _moduleHashes.find(key.hash(), key.bytes);
+		if (!entry)
+		{
+			throw std::invalid_argument("[PipelineStateCache]: Shader stages have to use modules from getShaderModule!");
+		}
+		return entry->value;
+	}
+
+	void addStage(KeyWriter& _key, const ConcurrentHandleMap& _moduleHashes, const VkPipelineShaderStageCreateInfo& _stage)
+	{
+		requireNoChain(_stage.pNext);
+		_key.add(_stage.flags);
+		_key.add(_stage.stage);
+		_key.add(moduleHash(_moduleHashes, _stage.module));
+		_key.addString(_stage.pName);
+		if (_key.addPresent(_stage.pSpecializationInfo))
+		{
+			const VkSpecializationInfo& specialization = *_stage.pSpecializationInfo;
+			_key.add(specialization.mapEntryCount);
+			for (uint32_t i = 0; i < specialization.mapEntryCount; ++i)
+			{
+				_key.add(specialization.pMapEntries[i].constantID);
+				_key.add(specialization.pMapEntries[i].offset);
+				_key.add(static_cast<uint64_t>(specialization.pMapEntries[i].size));
+			}
+			_key.addBytes(specialization.pData, specialization.dataSize);
+		}
+	}
+
+	//The fragment stage belongs to the fragment shader library, every other stage to pre-rasterization
+	void addStages(KeyWriter& _key, const ConcurrentHandleMap& _moduleHashes, const VkGraphicsPipelineCreateInfo& _createInfo, bool _fragment)
+	{
+		uint32_t count = 0;
+		for (uint32_t i = 0; i < _createInfo.stageCount; ++i)
+		{
+			if ((_createInfo.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT) == _fragment)
+			{
+				addStage(_key, _moduleHashes, _createInfo.pStages[i]);
+				count++;
+			}
+		}
+		_key.add(count);
+	}
+
+	//Written first, it decides which of the fixed states are ignored. Returned sorted.
+	std::vector<VkDynamicState> addDynamicState(KeyWriter& _key, const VkGraphicsPipelineCreateInfo& _createInfo)
+	{
+		std::vector<VkDynamicState> dynamicStates;
+		if (_key.addPresent(_createInfo.pDynamicState))
+		{
+			requireNoChain(_createInfo.pDynamicState->pNext);
+			dynamicStates.assign(_createInfo.pDynamicState->pDynamicStates,
+				_createInfo.pDynamicState->pDynamicStates + _createInfo.pDynamicState->dynamicStateCount);
+			std::sort(dynamicStates.begin(), dynamicStates.end());
+			_key.add(static_cast<uint32_t>(dynamicStates.size()));
+			for (VkDynamicState state : dynamicStates)
+			{
+				_key.add(state);
+			}
+		}
+		return dynamicStates;
+	}
+
+	void addVertexInputState(KeyWriter& _key, const VkGraphicsPipelineCreateInfo& _createInfo)
+	{
+		if (_key.addPresent(_createInfo.pVertexInputState))
+		{
+			const VkPipelineVertexInputStateCreateInfo& vertexInput = *_createInfo.pVertexInputState;
+			requireNoChain(vertexInput.pNext);
+			_key.add(vertexInput.flags);
+			_key.add(vertexInput.vertexBindingDescriptionCount);
+			for (uint32_t i = 0; i < vertexInput.vertexBindingDescriptionCount; ++i)
+			{
+				_key.add(vertexInput.pVertexBindingDescriptions[i].binding);
+				_key.add(vertexInput.pVertexBindingDescriptions[i].stride);
+				_key.add(vertexInput.pVertexBindingDescriptions[i].inputRate);
+			}
+			_key.add(vertexInput.vertexAttributeDescriptionCount);
+			for (uint32_t i = 0; i < vertexInput.vertexAttributeDescriptionCount; ++i)
+			{
+				_key.add(vertexInput.pVertexAttributeDescriptions[i].location);
+				_key.add(vertexInput.pVertexAttributeDescriptions[i].binding);
+				_key.add(vertexInput.pVertexAttributeDescriptions[i].format);
+				_key.add(vertexInput.pVertexAttributeDescriptions[i].offset);
+			}
+		}
+
+		if (_key.addPresent(_createInfo.pInputAssemblyState))
+		{
+			requireNoChain(_createInfo.pInputAssemblyState->pNext);
+			_key.add(_createInfo.pInputAssemblyState->flags);
+			_key.add(_createInfo.pInputAssemblyState->topology);
+			_key.add(_createInfo.pInputAssemblyState->primitiveRestartEnable);
+		}
+	}
+
+	//Tessellation, viewport and rasterization, the shaders are written on their own
+	void addPreRasterizationState(KeyWriter& _key, const VkGraphicsPipelineCreateInfo& _createInfo, const std::vector<VkDynamicState>& _dynamicStates)
+	{
+		auto isDynamic = [&_dynamicStates](VkDynamicState _state)
+		{
+			return std::binary_search(_dynamicStates.begin(), _dynamicStates.end(), _state);
+		};
+
+		if (_key.addPresent(_createInfo.pTessellationState))
+		{
+			requireNoChain(_createInfo.pTessellationState->pNext);
+			_key.add(_createInfo.pTessellationState->flags);
+			_key.add(_createInfo.pTessellationState->patchControlPoints);
+		}
+
+		if (_key.addPresent(_createInfo.pViewportState))
+		{
+			const VkPipelineViewportStateCreateInfo& viewport = *_createInfo.pViewportState;
+			requireNoChain(viewport.pNext);
+			_key.add(viewport.flags);
+			_key.add(viewport.viewportCount);
+			if (!isDynamic(VK_DYNAMIC_STATE_VIEWPORT) && _key.addPresent(viewport.pViewports))
+			{
+				for (uint32_t i = 0; i < viewport.viewportCount; ++i)
+				{
+					_key.add(viewport.pViewports[i].x);
+					_key.add(viewport.pViewports[i].y);
+					_key.add(viewport.pViewports[i].width);
+					_key.add(viewport.pViewports[i].height);
+					_key.add(viewport.pViewports[i].minDepth);
+					_key.add(viewport.pViewports[i].maxDepth);
+				}
+			}
+			_key.add(viewport.scissorCount);
+			if (!isDynamic(VK_DYNAMIC_STATE_SCISSOR) && _key.addPresent(viewport.pScissors))
+			{
+				for (uint32_t i = 0; i < viewport.scissorCount; ++i)
+				{
+					_key.add(viewport.pScissors[i].offset.x);
+					_key.add(viewport.pScissors[i].offset.y);
+					_key.add(viewport.pScissors[i].extent.width);
+					_key.add(viewport.pScissors[i].extent.height);
+				}
+			}
+		}
+
+		if (_key.addPresent(_createInfo.pRasterizationState))
+		{
+			const VkPipelineRasterizationStateCreateInfo& rasterization = *_createInfo.pRasterizationState;
+			requireNoChain(rasterization.pNext);
+			_key.add(rasterization.flags);
+			_key.add(rasterization.depthClampEnable);
+			_key.add(rasterization.rasterizerDiscardEnable);
+			_key.add(rasterization.polygonMode);
+			_key.add(rasterization.cullMode);
+			_key.add(rasterization.frontFace);
+			_key.add(rasterization.depthBiasEnable);
+			_key.add(rasterization.depthBiasConstantFactor);
+			_key.add(rasterization.depthBiasClamp);
+			_key.add(rasterization.depthBiasSlopeFactor);
+			_key.add(rasterization.lineWidth);
+		}
+	}
+
+	//Used by both the fragment shader and the fragment output libraries
+	void addMultisampleState(KeyWriter& _key, const VkGraphicsPipelineCreateInfo& _createInfo)
+	{
+		if (_key.addPresent(_createInfo.pMultisampleState))
+		{
+			const VkPipelineMultisampleStateCreateInfo& multisample = *_createInfo.pMultisampleState;
+			requireNoChain(multisample.pNext);
+			_key.add(multisample.flags);
+			_key.add(multisample.rasterizationSamples);
+			_key.add(multisample.sampleShadingEnable);
+			_key.add(multisample.minSampleShading);
+			if (_key.addPresent(multisample.pSampleMask))
+			{
+				for (uint32_t i = 0; i < (static_cast<uint32_t>(multisample.rasterizationSamples) + 31) / 32; ++i)
+				{
+					_key.add(multisample.pSampleMask[i]);
+				}
+			}
+			_key.add(multisample.alphaToCoverageEnable);
+			_key.add(multisample.alphaToOneEnable);
+		}
+	}
+
+	void addDepthStencilState(KeyWriter& _key, const VkGraphicsPipelineCreateInfo& _createInfo)
+	{
+		if (_key.addPresent(_createInfo.pDepthStencilState))
+		{
+			const VkPipelineDepthStencilStateCreateInfo& depthStencil = *_createInfo.pDepthStencilState;
+			requireNoChain(depthStencil.pNext);
+			_key.add(depthStencil.flags);
+			_key.add(depthStencil.depthTestEnable);
+			_key.add(depthStencil.depthWriteEnable);
+			_key.add(depthStencil.depthCompareOp);
+			_key.add(depthStencil.depthBoundsTestEnable);
+			_key.add(depthStencil.stencilTestEnable);
+			addStencilOp(_key, depthStencil.front);
+			addStencilOp(_key, depthStencil.back);
+			_key.add(depthStencil.minDepthBounds);
+			_key.add(depthStencil.maxDepthBounds);
+		}
+	}
+
+	void addColorBlendState(KeyWriter& _key, const VkGraphicsPipelineCreateInfo& _createInfo)
+	{
+		if (_key.addPresent(_createInfo.pColorBlendState))
+		{
+			const VkPipelineColorBlendStateCreateInfo& colorBlend = *_createInfo.pColorBlendState;
+			requireNoChain(colorBlend.pNext);
+			_key.add(colorBlend.flags);
+			_key.add(colorBlend.logicOpEnable);
+			_key.add(colorBlend.logicOp);
+			_key.add(colorBlend.attachmentCount);
+			for (uint32_t i = 0; i < colorBlend.attachmentCount; ++i)
+			{
+				const VkPipelineColorBlendAttachmentState& attachment = colorBlend.pAttachments[i];
+				_key.add(attachment.blendEnable);
+				_key.add(attachment.srcColorBlendFactor);
+				_key.add(attachment.dstColorBlendFactor);
+				_key.add(attachment.colorBlendOp);
+				_key.add(attachment.srcAlphaBlendFactor);
+				_key.add(attachment.dstAlphaBlendFactor);
+				_key.add(attachment.alphaBlendOp);
+				_key.add(attachment.colorWriteMask);
+			}
+			for (float constant : colorBlend.blendConstants)
+			{
+				_key.add(constant);
+			}
+		}
+	}
+
+	//The complete key of a graphics pipeline, or of one of its library parts
+	KeyWriter graphicsPipelineKey(const ConcurrentHandleMap& _moduleHashes, const VkGraphicsPipelineCreateInfo& _createInfo,
+		VkGraphicsPipelineLibraryFlagsEXT _parts)
+	{
+		requireNoChain(_createInfo.pNext);
+
+		KeyWriter key;
+		key.add(_parts == AllLibraryParts ? PipelineKind::Graphics : PipelineKind::Library);
+		key.add(_parts);
+		key.add(_createInfo.flags);
+		std::vector<VkDynamicState> dynamicStates = addDynamicState(key, _createInfo);
+
+		if (_parts & VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT)
+		{
+			addVertexInputState(key, _createInfo);
+		}
+		if (_parts & VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT)
+		{
+			addStages(key, _moduleHashes, _createInfo, false);
+			addPreRasterizationState(key, _createInfo, dynamicStates);
+		}
+		if (_parts & (VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT))
+		{
+			addMultisampleState(key, _createInfo);
+		}
+		if (_parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT)
+		{
+			addStages(key, _moduleHashes, _createInfo, true);
+			addDepthStencilState(key, _createInfo);
+		}
+		if (_parts & VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT)
+		{
+			addColorBlendState(key, _createInfo);
+		}
+
+		//vertex input is the only part that doesn't depend on the layout or the render pass
+		if (_parts & (VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT))
+		{
+			key.addHandle(_createInfo.layout);
+		}
+		if (_parts != VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT)
+		{
+			key.addHandle(_createInfo.renderPass);
+			key.add(_createInfo.subpass);
+		}
+		return key;
+	}
+
+	//Looks the key up, creates the object on a miss. Another thread may create the same object meanwhile, then the
+	//first one to insert wins and the other copy is destroyed.
+	template <typename Handle, typename Create, typename Destroy>
+	Handle getOrCreate(ConcurrentHandleMap& _map, KeyWriter& _key, std::atomic<uint64_t>& _hits, std::atomic<uint64_t>& _raced,
+		Create&& _create, Destroy&& _destroy)
+	{
+		uint64_t hash = _key.hash();
+		if (const ConcurrentHandleMap::Entry* entry = _map.find(hash, _key.bytes))
+		{
+			_hits.fetch_add(1, std::memory_order_relaxed);
+			return toHandle<Handle>(entry->value);
+		}
+
+		Handle handle = _create();
+		const ConcurrentHandleMap::Entry* entry = _map.insert(hash, std::move(_key.bytes), handleValue(handle));
+		if (entry->value != handleValue(handle))
+		{
+			_destroy(handle);
+			_raced.fetch_add(1, std::memory_order_relaxed);
+		}
+		return toHandle<Handle>(entry->value);
+	}
+}
+
+ConcurrentHandleMap::ConcurrentHandleMap()
+{
+	clear();
+}
+
+const ConcurrentHandleMap::Entry* ConcurrentHandleMap::find(uint64_t _hash, const std::vector<uint8_t>& _key) const
+{
+	const Slots* table = current.load(std::memory_order_acquire);
+	for (size_t i = _hash & table->mask; ; i = (i + 1) & table->mask)
+	{
+		const Entry* entry = table->slots[i].load(std::memory_order_acquire);
+		if (!entry)
+		{
+			return nullptr;
+		}
+		if (entry->hash == _hash && entry->key == _key)
+		{
+			return entry;
+		}
+	}
+}
+
+const ConcurrentHandleMap::Entry* ConcurrentHandleMap::insert(uint64_t _hash, std::vector<uint8_t> _key, uint64_t _value)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (const Entry* existing = find(_hash, _key))
+	{
+		return existing;
+	}
+
+	//at most half full, probes stay short and there's always an empty slot to end them
+	if ((entries.size() + 1) * 2 > generations.back()->mask + 1)
+	{
+		grow();
+	}
+
+	entries.push_back(std::make_unique<Entry>(Entry{ _hash, std::move(_key), _value }));
+	const Entry* entry = entries.back().get();
+
+	//only this thread writes slots, the slot can't be taken between the probe and the store
+	const Slots* table = generations.back().get();
+	size_t i = _hash & table->mask;
+	while (table->slots[i].load(std::memory_order_relaxed))
+	{
+		i = (i + 1) & table->mask;
+	}
+	table->slots[i].store(entry, std::memory_order_release);
+	return entry;
+}
+
+void ConcurrentHandleMap::grow()
+{
+	const Slots* old = generations.back().get();
+	auto table = std::make_unique<Slots>();
+	table->mask = (old->mask + 1) * 2 - 1;
+	table->slots = std::make_unique<std::atomic<const Entry*>[]>(table->mask + 1);
+	for (size_t i = 0; i <= table->mask; ++i)
+	{
+		table->slots[i].store(nullptr, std::memory_order_relaxed);
+	}
+
+	for (const std::unique_ptr<Entry>& entry : entries)
+	{
+		size_t i = entry->hash & table->mask;
+		while (table->slots[i].load(std::memory_order_relaxed))
+		{
+			i = (i + 1) & table->mask;
+		}
+		table->slots[i].store(entry.get(), std::memory_order_relaxed);
+	}
+
+	current.store(table.get(), std::memory_order_release);
+	generations.push_back(std::move(table));
+}
+
+size_t ConcurrentHandleMap::size() const
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return entries.size();
+}
+
+void ConcurrentHandleMap::clear()
+{
+	auto table = std::make_unique<Slots>();
+	table->mask = InitialSlots - 1;
+	table->slots = std::make_unique<std::atomic<const Entry*>[]>(InitialSlots);
+	for (size_t i = 0; i < InitialSlots; ++i)
+	{
+		table->slots[i].store(nullptr, std::memory_order_relaxed);
+	}
+
+	current.store(table.get(), std::memory_order_release);
+	generations.clear();
+	generations.push_back(std::move(table));
+	entries.clear();
+}
+
+void PipelineStateCache::init(VkDevice _device, VkPipelineCache _pipelineCache)
+{
+	device = _device;
+	pipelineCache = _pipelineCache;
+}
+
+void PipelineStateCache::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	//pipelines before what they were created from
+	pipelines.forEach([this](const ConcurrentHandleMap::Entry& _entry) { vkDestroyPipeline(device, toHandle<VkPipeline>(_entry.value), nullptr); });
+	pipelineLayouts.forEach([this](const ConcurrentHandleMap::Entry& _entry) { vkDestroyPipelineLayout(device, toHandle<VkPipelineLayout>(_entry.value), nullptr); });
+	descriptorSetLayouts.forEach([this](const ConcurrentHandleMap::Entry& _entry) { vkDestroyDescriptorSetLayout(device, toHandle<VkDescriptorSetLayout>(_entry.value), nullptr); });
+	renderPasses.forEach([this](const ConcurrentHandleMap::Entry& _entry) { vkDestroyRenderPass(device, toHandle<VkRenderPass>(_entry.value), nullptr); });
+	samplers.forEach([this](const ConcurrentHandleMap::Entry& _entry) { vkDestroySampler(device, toHandle<VkSampler>(_entry.value), nullptr); });
+	shaderModules.forEach([this](const ConcurrentHandleMap::Entry& _entry) { vkDestroyShaderModule(device, toHandle<VkShaderModule>(_entry.value), nullptr); });
+
+	for (ConcurrentHandleMap* map : { &pipelines, &pipelineLayouts, &descriptorSetLayouts, &renderPasses, &samplers, &shaderModules, &moduleHashes })
+	{
+		map->clear();
+	}
+	device = VK_NULL_HANDLE;
+	pipelineCache = VK_NULL_HANDLE;
+}
+
+VkShaderModule PipelineStateCache::getShaderModule(const VkShaderModuleCreateInfo& _createInfo)
+{
+	requireNoChain(_createInfo.pNext);
+	lookups.fetch_add(1, std::memory_order_relaxed);
+
+	KeyWriter key;
+	key.add(_createInfo.flags);
+	key.addBytes(_createInfo.pCode, _createInfo.codeSize);
+	uint64_t codeHash = key.hash();
+
+	VkShaderModule module = getOrCreate<VkShaderModule>(shaderModules, key, hits, raced, [this, &_createInfo]()
+	{
+		VkShaderModule created;
+		if (vkCreateShaderModule(device, &_createInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to Create Shader Module.");
+		}
+		return created;
+	}, [this](VkShaderModule _module) { vkDestroyShaderModule(device, _module, nullptr); });
+
+	//pipelines key their stages by code, this is how they find it from the module
+	KeyWriter moduleKey;
+	moduleKey.addHandle(module);
+	if (!moduleHashes.find(moduleKey.hash(), moduleKey.bytes))
+	{
+		uint64_t hash = moduleKey.hash();
+		moduleHashes.insert(hash, std::move(moduleKey.bytes), codeHash);
+	}
+	return module;
+}
+
+VkSampler PipelineStateCache::getSampler(const VkSamplerCreateInfo& _createInfo)
+{
+	requireNoChain(_createInfo.pNext);
+	lookups.fetch_add(1, std::memory_order_relaxed);
+
+	KeyWriter key;
+	key.add(_createInfo.flags);
+	key.add(_createInfo.magFilter);
+	key.add(_createInfo.minFilter);
+	key.add(_createInfo.mipmapMode);
+	key.add(_createInfo.addressModeU);
+	key.add(_createInfo.addressModeV);
+	key.add(_createInfo.addressModeW);
+	key.add(_createInfo.mipLodBias);
+	key.add(_createInfo.anisotropyEnable);
+	key.add(_createInfo.maxAnisotropy);
+	key.add(_createInfo.compareEnable);
+	key.add(_createInfo.compareOp);
+	key.add(_createInfo.minLod);
+	key.add(_createInfo.maxLod);
+	key.add(_createInfo.borderColor);
+	key.add(_createInfo.unnormalizedCoordinates);
+
+	return getOrCreate<VkSampler>(samplers, key, hits, raced, [this, &_createInfo]()
+	{
+		VkSampler created;
+		if (vkCreateSampler(device, &_createInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to create sampler!");
+		}
+		return created;
+	}, [this](VkSampler _sampler) { vkDestroySampler(device, _sampler, nullptr); });
+}
+
+VkDescriptorSetLayout PipelineStateCache::getDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& _createInfo)
+{
+	requireNoChain(_createInfo.pNext);
+	lookups.fetch_add(1, std::memory_order_relaxed);
+
+	//the order bindings are listed in doesn't change the layout
+	std::vector<const VkDescriptorSetLayoutBinding*> bindings(_createInfo.bindingCount);
+	for (uint32_t i = 0; i < _createInfo.bindingCount; ++i)
+	{
+		bindings[i] = &_createInfo.pBindings[i];
+	}
+	std::sort(bindings.begin(), bindings.end(), [](const VkDescriptorSetLayoutBinding* _a, const VkDescriptorSetLayoutBinding* _b)
+	{
+		return _a->binding < _b->binding;
+	});
+
+	KeyWriter key;
+	key.add(_createInfo.flags);
+	key.add(_createInfo.bindingCount);
+	for (const VkDescriptorSetLayoutBinding* binding : bindings)
+	{
+		key.add(binding->binding);
+		key.add(binding->descriptorType);
+		key.add(binding->descriptorCount);
+		key.add(binding->stageFlags);
+		if (key.addPresent(binding->pImmutableSamplers))
+		{
+			for (uint32_t i = 0; i < binding->descriptorCount; ++i)
+			{
+				key.addHandle(binding->pImmutableSamplers[i]);
+			}
+		}
+	}
+
+	return getOrCreate<VkDescriptorSetLayout>(descriptorSetLayouts, key, hits, raced, [this, &_createInfo]()
+	{
+		VkDescriptorSetLayout created;
+		if (vkCreateDescriptorSetLayout(device, &_createInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to create descriptor set layout!");
+		}
+		return created;
+	}, [this](VkDescriptorSetLayout _layout) { vkDestroyDescriptorSetLayout(device, _layout, nullptr); });
+}
+
+VkPipelineLayout PipelineStateCache::getPipelineLayout(const VkPipelineLayoutCreateInfo& _createInfo)
+{
+	requireNoChain(_createInfo.pNext);
+	lookups.fetch_add(1, std::memory_order_relaxed);
+
+	KeyWriter key;
+	key.add(_createInfo.flags);
+	key.add(_createInfo.setLayoutCount);
+	for (uint32_t i = 0; i < _createInfo.setLayoutCount; ++i)
+	{
+		key.addHandle(_createInfo.pSetLayouts[i]);
+	}
+	key.add(_createInfo.pushConstantRangeCount);
+	for (uint32_t i = 0; i < _createInfo.pushConstantRangeCount; ++i)
+	{
+		key.add(_createInfo.pPushConstantRanges[i].stageFlags);
+		key.add(_createInfo.pPushConstantRanges[i].offset);
+		key.add(_createInfo.pPushConstantRanges[i].size);
+	}
+
+	return getOrCreate<VkPipelineLayout>(pipelineLayouts, key, hits, raced, [this, &_createInfo]()
+	{
+		VkPipelineLayout created;
+		if (vkCreatePipelineLayout(device, &_createInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to Create Pipeline Layout.");
+		}
+		return created;
+	}, [this](VkPipelineLayout _layout) { vkDestroyPipelineLayout(device, _layout, nullptr); });
+}
+
+VkRenderPass PipelineStateCache::getRenderPass(const VkRenderPassCreateInfo& _createInfo)
+{
+	requireNoChain(_createInfo.pNext);
+	lookups.fetch_add(1, std::memory_order_relaxed);
+
+	KeyWriter key;
+	key.add(_createInfo.flags);
+	key.add(_createInfo.attachmentCount);
+	for (uint32_t i = 0; i < _createInfo.attachmentCount; ++i)
+	{
+		const VkAttachmentDescription& attachment = _createInfo.pAttachments[i];
+		key.add(attachment.flags);
+		key.add(attachment.format);
+		key.add(attachment.samples);
+		key.add(attachment.loadOp);
+		key.add(attachment.storeOp);
+		key.add(attachment.stencilLoadOp);
+		key.add(attachment.stencilStoreOp);
+		key.add(attachment.initialLayout);
+		key.add(attachment.finalLayout);
+	}
+
+	key.add(_createInfo.subpassCount);
+	for (uint32_t i = 0; i < _createInfo.subpassCount; ++i)
+	{
+		const VkSubpassDescription& subpass = _createInfo.pSubpasses[i];
+		key.add(subpass.flags);
+		key.add(subpass.pipelineBindPoint);
+		key.add(subpass.inputAttachmentCount);
+		for (uint32_t j = 0; j < subpass.inputAttachmentCount; ++j)
+		{
+			addAttachmentReference(key, subpass.pInputAttachments[j]);
+		}
+		key.add(subpass.colorAttachmentCount);
+		for (uint32_t j = 0; j < subpass.colorAttachmentCount; ++j)
+		{
+			addAttachmentReference(key, subpass.pColorAttachments[j]);
+		}
+		if (key.addPresent(subpass.pResolveAttachments))
+		{
+			for (uint32_t j = 0; j < subpass.colorAttachmentCount; ++j)
+			{
+				addAttachmentReference(key, subpass.pResolveAttachments[j]);
+			}
+		}
+		if (key.addPresent(subpass.pDepthStencilAttachment))
+		{
+			addAttachmentReference(key, *subpass.pDepthStencilAttachment);
+		}
+		key.add(subpass.preserveAttachmentCount);
+		for (uint32_t j = 0; j < subpass.preserveAttachmentCount; ++j)
+		{
+			key.add(subpass.pPreserveAttachments[j]);
+		}
+	}
+
+	key.add(_createInfo.dependencyCount);
+	for (uint32_t i = 0; i < _createInfo.dependencyCount; ++i)
+	{
+		const VkSubpassDependency& dependency = _createInfo.pDependencies[i];
+		key.add(dependency.srcSubpass);
+		key.add(dependency.dstSubpass);
+		key.add(dependency.srcStageMask);
+		key.add(dependency.dstStageMask);
+		key.add(dependency.srcAccessMask);
+		key.add(dependency.dstAccessMask);
+		key.add(dependency.dependencyFlags);
+	}
+
+	return getOrCreate<VkRenderPass>(renderPasses, key, hits, raced, [this, &_createInfo]()
+	{
+		VkRenderPass created;
+		if (vkCreateRenderPass(device, &_createInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to create render pass!");
+		}
+		return created;
+	}, [this](VkRenderPass _renderPass) { vkDestroyRenderPass(device, _renderPass, nullptr); });
+}
+
+PipelineStateKey PipelineStateCache::getGraphicsPipelineKey(const VkGraphicsPipelineCreateInfo& _createInfo) const
+{
+	KeyWriter key = graphicsPipelineKey(moduleHashes, _createInfo, AllLibraryParts);
+	uint64_t hash = key.hash();
+	return PipelineStateKey{ hash, std::move(key.bytes) };
+}
+
+VkPipeline PipelineStateCache::getGraphicsPipeline(const VkGraphicsPipelineCreateInfo& _createInfo)
+{
+	lookups.fetch_add(1, std::memory_order_relaxed);
+	KeyWriter key = graphicsPipelineKey(moduleHashes, _createInfo, AllLibraryParts);
+
+	return getOrCreate<VkPipeline>(pipelines, key, hits, raced, [this, &_createInfo]()
+	{
+		VkPipeline created;
+		if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &_createInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to create graphics pipeline!");
+		}
+		return created;
+	}, [this](VkPipeline _pipeline) { vkDestroyPipeline(device, _pipeline, nullptr); });
+}
+
+VkPipeline PipelineStateCache::findPipelineLibrary(const VkGraphicsPipelineCreateInfo& _createInfo, VkGraphicsPipelineLibraryFlagBitsEXT _part) const
+{
+	KeyWriter key = graphicsPipelineKey(moduleHashes, _createInfo, _part);
+	const ConcurrentHandleMap::Entry* entry = pipelines.find(key.hash(), key.bytes);
+	return entry ? toHandle<VkPipeline>(entry->value) : VK_NULL_HANDLE;
+}
+
+//The part is created from the full create info with everything that belongs to other parts left out. Libraries keep
+//what link time optimization needs, so they can be linked both ways.
+VkPipeline PipelineStateCache::getPipelineLibrary(const VkGraphicsPipelineCreateInfo& _createInfo, VkGraphicsPipelineLibraryFlagBitsEXT _part)
+{
+	lookups.fetch_add(1, std::memory_order_relaxed);
+	KeyWriter key = graphicsPipelineKey(moduleHashes, _createInfo, _part);
+
+	return getOrCreate<VkPipeline>(pipelines, key, hits, raced, [this, &_createInfo, _part]()
+	{
+		std::vector<VkPipelineShaderStageCreateInfo> stages;
+		for (uint32_t i = 0; i < _createInfo.stageCount; ++i)
+		{
+			bool fragment = _createInfo.pStages[i].stage == VK_SHADER_STAGE_FRAGMENT_BIT;
+			if ((fragment && _part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT) ||
+				(!fragment && _part == VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT))
+			{
+				stages.push_back(_createInfo.pStages[i]);
+			}
+		}
+
+		VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{
+			VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,	//sType
+			nullptr,														//pNext
+			static_cast<VkGraphicsPipelineLibraryFlagsEXT>(_part)			//flags
+		};
+
+		bool vertexInput = _part == VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT;
+		bool preRasterization = _part == VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT;
+		bool fragmentShader = _part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT;
+		bool fragmentOutput = _part == VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+		VkGraphicsPipelineCreateInfo partInfo{
+			VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,										//sType
+			&libraryInfo,																			//pNext
+			_createInfo.flags | VK_PIPELINE_CREATE_LIBRARY_BIT_KHR |
+				VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT,						//flags
+			static_cast<uint32_t>(stages.size()),													//stageCount
+			stages.data(),																			//pStages
+			vertexInput ? _createInfo.pVertexInputState : nullptr,									//pVertexInputState
+			vertexInput ? _createInfo.pInputAssemblyState : nullptr,								//pInputAssemblyState
+			preRasterization ? _createInfo.pTessellationState : nullptr,							//pTessellationState
+			preRasterization ? _createInfo.pViewportState : nullptr,								//pViewportState
+			preRasterization ? _createInfo.pRasterizationState : nullptr,							//pRasterizationState
+			fragmentShader || fragmentOutput ? _createInfo.pMultisampleState : nullptr,				//pMultisampleState
+			fragmentShader ? _createInfo.pDepthStencilState : nullptr,								//pDepthStencilState
+			fragmentOutput ? _createInfo.pColorBlendState : nullptr,								//pColorBlendState
+			_createInfo.pDynamicState,																//pDynamicState
+			preRasterization || fragmentShader ? _createInfo.layout : VK_NULL_HANDLE,				//layout
+			vertexInput ? VK_NULL_HANDLE : _createInfo.renderPass,									//renderPass
+			vertexInput ? 0 : _createInfo.subpass,													//subpass
+			VK_NULL_HANDLE,																			//basePipelineHandle
+			-1																						//basePipelineIndex
+		};
+
+		VkPipeline created;
+		if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &partInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to create a graphics pipeline library!");
+		}
+		return created;
+	}, [this](VkPipeline _pipeline) { vkDestroyPipeline(device, _pipeline, nullptr); });
+}
+
+VkPipeline PipelineStateCache::getLinkedPipeline(const VkPipeline* _libraries, uint32_t _libraryCount, VkPipelineLayout _layout, bool _optimized)
+{
+	lookups.fetch_add(1, std::memory_order_relaxed);
+
+	KeyWriter key;
+	key.add(PipelineKind::Linked);
+	key.add(static_cast<uint8_t>(_optimized));
+	key.add(_libraryCount);
+	for (uint32_t i = 0; i < _libraryCount; ++i)
+	{
+		key.addHandle(_libraries[i]);
+	}
+	key.addHandle(_layout);
+
+	return getOrCreate<VkPipeline>(pipelines, key, hits, raced, [this, _libraries, _libraryCount, _layout, _optimized]()
+	{
+		VkPipelineLibraryCreateInfoKHR linkInfo{
+			VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,	//sType
+			nullptr,											//pNext
+			_libraryCount,										//libraryCount
+			_libraries											//pLibraries
+		};
+
+		VkGraphicsPipelineCreateInfo pipelineInfo{};
+		pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+		pipelineInfo.pNext = &linkInfo;
+		pipelineInfo.flags = _optimized ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+		pipelineInfo.layout = _layout;
+		pipelineInfo.basePipelineIndex = -1;
+
+		VkPipeline created;
+		if (vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to link graphics pipeline libraries!");
+		}
+		return created;
+	}, [this](VkPipeline _pipeline) { vkDestroyPipeline(device, _pipeline, nullptr); });
+}
+
+VkPipeline PipelineStateCache::getComputePipeline(const VkComputePipelineCreateInfo& _createInfo)
+{
+	requireNoChain(_createInfo.pNext);
+	lookups.fetch_add(1, std::memory_order_relaxed);
+
+	KeyWriter key;
+	key.add(PipelineKind::Compute);
+	key.add(_createInfo.flags);
+	addStage(key, moduleHashes, _createInfo.stage);
+	key.addHandle(_createInfo.layout);
+
+	return getOrCreate<VkPipeline>(pipelines, key, hits, raced, [this, &_createInfo]()
+	{
+		VkPipeline created;
+		if (vkCreateComputePipelines(device, pipelineCache, 1, &_createInfo, nullptr, &created) != VK_SUCCESS)
+		{
+			throw std::runtime_error("[VK_Device]: Failed to create compute pipeline!");
+		}
+		return created;
+	}, [this](VkPipeline _pipeline) { vkDestroyPipeline(device, _pipeline, nullptr); });
+}
+
+PipelineStateCacheStats PipelineStateCache::getStats() const
+{
+	PipelineStateCacheStats stats;
+	stats.lookups = lookups.load(std::memory_order_relaxed);
+	stats.hits = hits.load(std::memory_order_relaxed);
+	stats.raced = raced.load(std::memory_order_relaxed);
+	stats.shaderModules = shaderModules.size();
+	stats.samplers = samplers.size();
+	stats.descriptorSetLayouts = descriptorSetLayouts.size();
+	stats.pipelineLayouts = pipelineLayouts.size();
+	stats.renderPasses = renderPasses.size();
+	stats.pipelines = pipelines.size();
+	return stats;
+}
@@ -0,0 +1,696 @@
+#include <RenderGraph.hpp>
+#include <vulkanUtils.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+namespace {
+
+	struct UsageInfo {
+		VkPipelineStageFlags stages;
+		VkAccessFlags access;
+		VkImageLayout layout;
+		VkImageUsageFlags imageUsage;
+		bool reads;
+		bool writes;
+		bool discards;	//the pass overwrites every texel, so the old contents don't have to survive a layout transition
+	};
+
+	UsageInfo usageInfo(ImageUsage _usage)
+	{
+		const VkPipelineStageFlags depthStages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+		switch (_usage)
+		{
+		case ImageUsage::ColorAttachmentWrite:
+			return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, false, true, true };
+		case ImageUsage::ColorAttachmentReadWrite:
+			return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, true, false };
+		case ImageUsage::DepthAttachmentWrite:
+			return { depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false, true, true };
+		case ImageUsage::DepthAttachmentReadWrite:
+			return { depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, true, false };
+		case ImageUsage::DepthAttachmentRead:
+			return { depthStages, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+				VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, false, false };
+		case ImageUsage::SampledFragment:
+			return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, true, false, false };
+		case ImageUsage::SampledCompute:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, true, false, false };
+		case ImageUsage::StorageRead:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true, false, false };
+		case ImageUsage::StorageWrite:
+			return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, true, false };
+		case ImageUsage::TransferSource:
+			return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, true, false, false };
+		case ImageUsage::TransferDestination:
+		default:
+			return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, false, true, false };
+		}
+	}
+
+	constexpr VkAccessFlags WriteAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+	//What the last passes did to an image, tracked while walking the execution order.
+	struct AccessState {
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags writeStages = 0;	//stages of the last write (or whatever the image arrived from)
+		VkAccessFlags writeAccess = 0;			//writes that still have to be made available
+		VkPipelineStageFlags readStages = 0;	//reads since the last write, a later write or transition has to wait for them
+		VkPipelineStageFlags visibleStages = 0;	//stages the last write has already been made visible to
+		bool touched = false;
+	};
+
+	bool lifetimesOverlap(const AliasingRequest& _a, const AliasingRequest& _b)
+	{
+		return _a.firstPass <= _b.lastPass && _b.firstPass <= _a.lastPass;
+	}
+
+}
+
+AliasingPlan planAliasing(const std::vector<AliasingRequest>& _requests)
+{
+	AliasingPlan plan;
+	plan.offsets.assign(_requests.size(), 0);
+
+	std::vector<uint32_t> order(_requests.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&_requests](uint32_t _a, uint32_t _b) {
+		return _requests[_a].size > _requests[_b].size;
+	});
+
+	struct Range {
+		VkDeviceSize begin;
+		VkDeviceSize end;
+	};
+	std::vector<uint32_t> placed;
+	std::vector<Range> occupied;
+
+	for (uint32_t index : order)
+	{
+		const AliasingRequest& request = _requests[index];
+
+		//memory held by anything alive at the same time as this request
+		occupied.clear();
+		for (uint32_t other : placed)
+		{
+			if (lifetimesOverlap(request, _requests[other]))
+			{
+				occupied.push_back({ plan.offsets[other], plan.offsets[other] + _requests[other].size });
+			}
+		}
+		std::sort(occupied.begin(), occupied.end(), [](const Range& _a, const Range& _b) { return _a.begin < _b.begin; });
+
+		//first gap large enough
+		VkDeviceSize offset = 0;
+		for (const Range& range : occupied)
+		{
+			if (alignUp(offset, request.alignment) + request.size <= range.begin)
+			{
+				break;
+			}
+			offset = std::max(offset, range.end);
+		}
+		offset = alignUp(offset, request.alignment);
+
+		plan.offsets[index] = offset;
+		plan.totalSize = std::max(plan.totalSize, offset + request.size);
+		placed.push_back(index);
+	}
+
+	return plan;
+}
+
+RenderGraph::PassBuilder::PassBuilder(RenderGraph& _graph, uint32_t _pass)
+	: graph(_graph), pass(_pass)
+{
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::use(RenderResource _resource, ImageUsage _usage)
+{
+	if (_resource >= graph.resources.size())
+	{
+		throw std::invalid_argument("[RenderGraph]: Pass '" + graph.passes[pass].name + "' uses an unknown resource!");
+	}
+
+	std::vector<ResourceUse>& uses = graph.passes[pass].uses;
+	for (const ResourceUse& existing : uses)
+	{
+		if (existing.resource == _resource)
+		{
+			throw std::invalid_argument("[RenderGraph]: Pass '" + graph.passes[pass].name + "' uses '" +
+				graph.resources[_resource].name + "' more than once!");
+		}
+	}
+
+	uses.push_back({ _resource, _usage });
+	graph.compiled = false;
+	return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::keepAlive()
+{
+	graph.passes[pass].keepAlive = true;
+	graph.compiled = false;
+	return *this;
+}
+
+RenderResource RenderGraph::importImage(const std::string& _name, VkImageAspectFlags _aspect,
+	VkImageLayout _initialLayout, VkPipelineStageFlags _initialStages, VkImageLayout _finalLayout)
+{
+	Resource resource;
+	resource.name = _name;
+	resource.imported = true;
+	resource.aspect = _aspect;
+	resource.initialLayout = _initialLayout;
+	resource.initialStages = _initialStages;
+	resource.finalLayout = _finalLayout;
+
+	resources.push_back(resource);
+	compiled = false;
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+void RenderGraph::setImportedImage(RenderResource _resource, VkImage _image, VkImageView _view)
+{
+	Resource& resource = resources.at(_resource);
+	if (!resource.imported)
+	{
+		throw std::invalid_argument("[RenderGraph]: '" + resource.name + "' isn't an imported image!");
+	}
+	resource.image = _image;
+	resource.view = _view;
+	resource.absent = false;
+}
+
+void RenderGraph::skipImportedImage(RenderResource _resource)
+{
+	Resource& resource = resources.at(_resource);
+	if (!resource.imported)
+	{
+		throw std::invalid_argument("[RenderGraph]: '" + resource.name + "' isn't an imported image!");
+	}
+	resource.image = VK_NULL_HANDLE;
+	resource.view = VK_NULL_HANDLE;
+	resource.absent = true;
+}
+
+RenderResource RenderGraph::createTransientImage(const std::string& _name, const TransientImageDesc& _desc)
+{
+	if (_desc.extent.width == 0 || _desc.extent.height == 0)
+	{
+		throw std::invalid_argument("[RenderGraph]: Transient image '" + _name + "' has no extent!");
+	}
+
+	Resource resource;
+	resource.name = _name;
+	resource.desc = _desc;
+	resource.aspect = _desc.aspect;
+
+	resources.push_back(resource);
+	compiled = false;
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+RenderGraph::PassBuilder RenderGraph::addPass(const std::string& _name, ExecuteFunction _execute)
+{
+	Pass pass;
+	pass.name = _name;
+	pass.execute = std::move(_execute);
+
+	passes.push_back(std::move(pass));
+	compiled = false;
+	return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+}
+
+void RenderGraph::markOutput(RenderResource _resource)
+{
+	resources.at(_resource).output = true;
+	compiled = false;
+}
+
+void RenderGraph::compile(VkDevice _device, VkPhysicalDevice _physicalDevice)
+{
+	destroyTransients();
+	device = _device;
+
+	cullPasses();
+	computeLifetimes();
+	createTransients(_physicalDevice);
+	planBarriers();
+
+	compiled = true;
+}
+
+//Walks the passes backwards keeping the set of resources whose current contents somebody still needs.
+//A pass survives if it produces one of them; a pass that overwrites a resource without reading it ends that
+//resource's need, so earlier writers of the same resource get culled.
+void RenderGraph::cullPasses()
+{
+	std::vector<uint8_t> needed(resources.size(), 0);
+	for (size_t r = 0; r < resources.size(); ++r)
+	{
+		needed[r] = resources[r].output;
+	}
+
+	for (size_t p = passes.size(); p-- > 0;)
+	{
+		Pass& pass = passes[p];
+
+		bool alive = pass.keepAlive;
+		for (const ResourceUse& use : pass.uses)
+		{
+			alive = alive || (usageInfo(use.usage).writes && needed[use.resource]);
+		}
+		pass.culled = !alive;
+		if (!alive)
+		{
+			continue;
+		}
+
+		for (const ResourceUse& use : pass.uses)
+		{
+			UsageInfo info = usageInfo(use.usage);
+			if (info.writes && !info.reads)
+			{
+				needed[use.resource] = 0;
+			}
+		}
+		for (const ResourceUse& use : pass.uses)
+		{
+			if (usageInfo(use.usage).reads)
+			{
+				needed[use.resource] = 1;
+			}
+		}
+	}
+
+	executionOrder.clear();
+	for (uint32_t p = 0; p < passes.size(); ++p)
+	{
+		if (!passes[p].culled)
+		{
+			executionOrder.push_back(p);
+		}
+	}
+}
+
+//First and last position in the execution order each transient is used at, plus the usage flags it has to be created with.
+void RenderGraph::computeLifetimes()
+{
+	for (Resource& resource : resources)
+	{
+		resource.firstPass = std::numeric_limits<uint32_t>::max();
+		resource.lastPass = 0;
+		resource.usageFlags = 0;
+	}
+
+	for (uint32_t position = 0; position < executionOrder.size(); ++position)
+	{
+		for (const ResourceUse& use : passes[executionOrder[position]].uses)
+		{
+			Resource& resource = resources[use.resource];
+			resource.firstPass = std::min(resource.firstPass, position);
+			resource.lastPass = std::max(resource.lastPass, position);
+			resource.usageFlags |= usageInfo(use.usage).imageUsage;
+		}
+	}
+}
+
+void RenderGraph::createTransients(VkPhysicalDevice _physicalDevice)
+{
+	memoryStats = TransientMemoryStats{};
+
+	std::vector<RenderResource> transients;
+	std::vector<AliasingRequest> requests;
+	uint32_t memoryTypeBits = ~0u;
+
+	for (RenderResource r = 0; r < resources.size(); ++r)
+	{
+		Resource& resource = resources[r];
+		if (resource.imported || resource.firstPass == std::numeric_limits<uint32_t>::max())
+		{
+			continue;
+		}
+
+		VkImageCreateInfo imageInfo{
+			VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,	//sType
+			nullptr,								//pNext
+			0,										//flags
+			VK_IMAGE_TYPE_2D,						//imageType
+			resource.desc.format,					//format
+			VkExtent3D {							//extent
+				resource.desc.extent.width,
+				resource.desc.extent.height,
+				1
+			},
+			resource.desc.mipLevels,				//mipLevels
+			1,										//arrayLayers
+			VK_SAMPLE_COUNT_1_BIT,					//samples
+			VK_IMAGE_TILING_OPTIMAL,				//tiling
+			resource.usageFlags,					//usage
+			VK_SHARING_MODE_EXCLUSIVE,				//sharingMode
+			0,										//queueFamilyIndexCount
+			nullptr,								//pQueueFamilyIndices
+			VK_IMAGE_LAYOUT_UNDEFINED				//initialLayout
+		};
+		if (vkCreateImage(device, &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+			throw std::runtime_error("[RenderGraph]: Failed to create transient image '" + resource.name + "'!");
+		}
+
+		VkMemoryRequirements requirements;
+		vkGetImageMemoryRequirements(device, resource.image, &requirements);
+		memoryTypeBits &= requirements.memoryTypeBits;
+		resource.memorySize = requirements.size;
+
+		transients.push_back(r);
+		requests.push_back({ requirements.size, requirements.alignment, resource.firstPass, resource.lastPass });
+		memoryStats.unaliasedBytes += requirements.size;
+	}
+
+	memoryStats.transientCount = static_cast<uint32_t>(transients.size());
+	if (transients.empty())
+	{
+		return;
+	}
+	if (memoryTypeBits == 0)
+	{
+		throw std::runtime_error("[RenderGraph]: Transient images have no memory type in common!");
+	}
+
+	AliasingPlan plan = planAliasing(requests);
+	memoryStats.aliasedBytes = plan.totalSize;
+
+	VkMemoryAllocateInfo allocateInfo{
+		VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,	//sType
+		nullptr,								//pNext
+		plan.totalSize,							//allocationSize
+		findMemoryType(_physicalDevice, memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)	//memoryTypeIndex
+	};
+	if (vkAllocateMemory(device, &allocateInfo, nullptr, &transientMemory) != VK_SUCCESS) {
+		throw std::runtime_error("[RenderGraph]: Failed to allocate transient memory!");
+	}
+
+	for (size_t i = 0; i < transients.size(); ++i)
+	{
+		Resource& resource = resources[transients[i]];
+		resource.memoryOffset = plan.offsets[i];
+		vkBindImageMemory(device, resource.image, transientMemory, resource.memoryOffset);
+
+		VkImageViewCreateInfo viewInfo{
+			VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,	//sType
+			nullptr,									//pNext
+			0,											//flags
+			resource.image,								//image
+			VK_IMAGE_VIEW_TYPE_2D,						//viewType
+			resource.desc.format,						//format
+			VkComponentMapping {},						//components
+			VkImageSubresourceRange {					//subresourceRange
+				resource.aspect,
+				0,
+				resource.desc.mipLevels,
+				0,
+				1
+			}
+		};
+		if (vkCreateImageView(device, &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+			throw std::runtime_error("[RenderGraph]: Failed to create a view for transient image '" + resource.name + "'!");
+		}
+	}
+}
+
+void RenderGraph::destroyTransients()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	for (Resource& resource : resources)
+	{
+		if (resource.imported)
+		{
+			continue;
+		}
+		if (resource.view != VK_NULL_HANDLE)
+		{
+			vkDestroyImageView(device, resource.view, nullptr);
+			resource.view = VK_NULL_HANDLE;
+		}
+		if (resource.image != VK_NULL_HANDLE)
+		{
+			vkDestroyImage(device, resource.image, nullptr);
+			resource.image = VK_NULL_HANDLE;
+		}
+	}
+
+	if (transientMemory != VK_NULL_HANDLE)
+	{
+		vkFreeMemory(device, transientMemory, nullptr);
+		transientMemory = VK_NULL_HANDLE;
+	}
+	compiled = false;
+}
+
+void RenderGraph::destroy()
+{
+	destroyTransients();
+	device = VK_NULL_HANDLE;
+}
+
+//Simulates one execution of the graph and records, per pass, the smallest set of dependencies it needs:
+//a layout transition when the layout changes, a memory dependency for read-after-write and write-after-write,
+//and a bare execution dependency for write-after-read. Everything a pass needs is merged into one batch.
+void RenderGraph::planBarriers()
+{
+	std::vector<AccessState> states(resources.size());
+	for (size_t r = 0; r < resources.size(); ++r)
+	{
+		if (resources[r].imported)
+		{
+			states[r].layout = resources[r].initialLayout;
+			states[r].writeStages = resources[r].initialStages;
+		}
+	}
+
+	passBarriers.assign(executionOrder.size(), BarrierBatch{});
+
+	for (uint32_t position = 0; position < executionOrder.size(); ++position)
+	{
+		BarrierBatch& batch = passBarriers[position];
+
+		for (const ResourceUse& use : passes[executionOrder[position]].uses)
+		{
+			const Resource& resource = resources[use.resource];
+			AccessState& state = states[use.resource];
+			UsageInfo info = usageInfo(use.usage);
+
+			if (!state.touched && !resource.imported)
+			{
+				if (info.reads)
+				{
+					throw std::logic_error("[RenderGraph]: Pass '" + passes[executionOrder[position]].name +
+						"' reads transient '" + resource.name + "' before anything writes it!");
+				}
+
+				//memory shared with a transient that died earlier: wait for its last users before reusing the bytes
+				for (size_t other = 0; other < resources.size(); ++other)
+				{
+					const Resource& previous = resources[other];
+					bool sharesMemory = !previous.imported && previous.image != VK_NULL_HANDLE && other != use.resource &&
+						previous.lastPass < resource.firstPass &&
+						previous.memoryOffset < resource.memoryOffset + resource.memorySize &&
+						resource.memoryOffset < previous.memoryOffset + previous.memorySize;
+					if (sharesMemory)
+					{
+						state.writeStages |= states[other].writeStages | states[other].readStages;
+						state.writeAccess |= states[other].writeAccess;
+					}
+				}
+			}
+			state.touched = true;
+
+			bool layoutChange = state.layout != info.layout;
+			VkPipelineStageFlags waitStages = 0;
+
+			if (layoutChange || info.writes)
+			{
+				//transitions and writes must wait for every earlier read and write
+				waitStages = state.writeStages | state.readStages;
+				if (layoutChange || state.writeAccess != 0)
+				{
+					batch.barriers.push_back({
+						use.resource,
+						state.writeAccess,
+						info.access,
+						info.discards ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout,
+						info.layout
+					});
+				}
+			}
+			else if (state.writeStages != 0 && (info.stages & ~state.visibleStages) != 0)
+			{
+				//read after write, in the layout it's already in
+				waitStages = state.writeStages;
+				if (state.writeAccess != 0)
+				{
+					batch.barriers.push_back({ use.resource, state.writeAccess, info.access, state.layout, state.layout });
+				}
+			}
+
+			if (waitStages != 0 || layoutChange)
+			{
+				batch.srcStages |= waitStages != 0 ? waitStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+				batch.dstStages |= info.stages;
+			}
+
+			if (info.writes)
+			{
+				state.writeStages = info.stages;
+				state.writeAccess = info.access & WriteAccessMask;
+				state.readStages = 0;
+				state.visibleStages = 0;
+			}
+			else if (layoutChange) {
+				//the transition waited for everything before it
+				state.readStages = info.stages;
+				state.visibleStages = info.stages;
+			}
+			else {
+				state.readStages |= info.stages;
+				state.visibleStages |= info.stages;
+			}
+			state.layout = info.layout;
+		}
+	}
+
+	//hand imported images back in the layout their owner expects
+	finalBarriers = BarrierBatch{};
+	for (RenderResource r = 0; r < resources.size(); ++r)
+	{
+		const Resource& resource = resources[r];
+		const AccessState& state = states[r];
+		if (!resource.imported || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.finalLayout == state.layout)
+		{
+			continue;
+		}
+
+		finalBarriers.barriers.push_back({ r, state.writeAccess, 0, state.layout, resource.finalLayout });
+		VkPipelineStageFlags waitStages = state.writeStages | state.readStages;
+		finalBarriers.srcStages |= waitStages != 0 ? waitStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		finalBarriers.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+	}
+}
+
+void RenderGraph::execute(VkCommandBuffer _commandBuffer)
+{
+	if (!compiled)
+	{
+		throw std::logic_error("[RenderGraph]: execute() called before compile()!");
+	}
+
+	for (size_t position = 0; position < executionOrder.size(); ++position)
+	{
+		recordBarriers(_commandBuffer, passBarriers[position]);
+		passes[executionOrder[position]].execute(_commandBuffer);
+	}
+	recordBarriers(_commandBuffer, finalBarriers);
+}
+
+void RenderGraph::recordBarriers(VkCommandBuffer _commandBuffer, const BarrierBatch& _batch)
+{
+	if (_batch.empty())
+	{
+		return;
+	}
+
+	barrierScratch.clear();
+	for (const Barrier& barrier : _batch.barriers)
+	{
+		const Resource& resource = resources[barrier.resource];
+		if (resource.absent)
+		{
+			continue;
+		}
+		if (resource.image == VK_NULL_HANDLE)
+		{
+			throw std::logic_error("[RenderGraph]: No image set for imported resource '" + resource.name + "'!");
+		}
+
+		barrierScratch.push_back(VkImageMemoryBarrier{
+			VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,	//sType
+			nullptr,								//pNext
+			barrier.srcAccess,						//srcAccessMask
+			barrier.dstAccess,						//dstAccessMask
+			barrier.oldLayout,						//oldLayout
+			barrier.newLayout,						//newLayout
+			VK_QUEUE_FAMILY_IGNORED,				//srcQueueFamilyIndex
+			VK_QUEUE_FAMILY_IGNORED,				//dstQueueFamilyIndex
+			resource.image,							//image
+			VkImageSubresourceRange {				//subresourceRange
+				resource.aspect,
+				0,
+				VK_REMAINING_MIP_LEVELS,
+				0,
+				VK_REMAINING_ARRAY_LAYERS
+			}
+		});
+	}
+
+	vkCmdPipelineBarrier(_commandBuffer, _batch.srcStages, _batch.dstStages, 0,
+		0, nullptr,
+		0, nullptr,
+		static_cast<uint32_t>(barrierScratch.size()), barrierScratch.data());
+}
+
+VkImage RenderGraph::getImage(RenderResource _resource) const
+{
+	return resources.at(_resource).image;
+}
+
+VkImageView RenderGraph::getImageView(RenderResource _resource) const
+{
+	return resources.at(_resource).view;
+}
+
+const TransientMemoryStats& RenderGraph::getMemoryStats() const
+{
+	return memoryStats;
+}
+
+uint32_t RenderGraph::getPassCount() const
+{
+	return static_cast<uint32_t>(passes.size());
+}
+
+uint32_t RenderGraph::getCulledPassCount() const
+{
+	return static_cast<uint32_t>(passes.size() - executionOrder.size());
+}
+
+void RenderGraph::printSummary() const
+{
+	size_t barrierCount = finalBarriers.barriers.size();
+	for (const BarrierBatch& batch : passBarriers)
+	{
+		barrierCount += batch.barriers.size();
+	}
+
+	std::cout << "[RenderGraph]: " << executionOrder.size() << " of " << passes.size() << " passes after culling, "
+		<< barrierCount << " image barriers\n";
+	std::cout << "[RenderGraph]: Peak transient memory: " << memoryStats.aliasedBytes / 1024 << " KiB aliased, "
+		<< memoryStats.unaliasedBytes / 1024 << " KiB without aliasing (" << memoryStats.transientCount << " images)\n";
+}
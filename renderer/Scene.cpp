@@ -0,0 +1,294 @@
+#include <Scene.hpp>
+#include <JobSystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+//Levels smaller than this aren't worth splitting across workers
+static constexpr uint32_t TransformGrainSize = 4096;
+
+Entity Scene::createEntity(Entity _parent)
+{
+	if (_parent != InvalidEntity && !isAlive(_parent))
+	{
+		throw std::invalid_argument("[Scene]: Parent entity doesn't exist!");
+	}
+
+	Entity entity;
+	if (!freeEntities.empty())
+	{
+		entity = freeEntities.back();
+		freeEntities.pop_back();
+	}
+	else {
+		entity = static_cast<Entity>(entityToDense.size());
+		entityToDense.push_back(InvalidIndex);
+		entityDepth.push_back(0);
+	}
+
+	uint32_t dense = static_cast<uint32_t>(denseToEntity.size());
+	entityToDense[entity] = dense;
+	entityDepth[entity] = _parent == InvalidEntity ? 0 : entityDepth[_parent] + 1;
+
+	denseToEntity.push_back(entity);
+	parents.push_back(_parent == InvalidEntity ? InvalidIndex : entityToDense[_parent]);
+	localTransforms.emplace_back();
+	worldMatrices.emplace_back(1.0f);
+	localRadii.push_back(-1.0f);
+	localDirty.push_back(1);
+	worldChanged.push_back(0);
+
+	//appending keeps parents before children but can break the contiguous depth levels
+	orderDirty = true;
+	return entity;
+}
+
+void Scene::destroyEntity(Entity _entity)
+{
+	if (!isAlive(_entity))
+	{
+		return;
+	}
+	if (orderDirty)
+	{
+		rebuildOrder();
+	}
+
+	//children always come after their parent, so one forward pass finds the whole subtree
+	const uint32_t root = entityToDense[_entity];
+	std::vector<uint8_t> removed(denseToEntity.size(), 0);
+	std::vector<uint32_t> newToOld;
+	newToOld.reserve(denseToEntity.size());
+
+	for (uint32_t i = 0; i < denseToEntity.size(); ++i)
+	{
+		removed[i] = i == root || (i > root && parents[i] != InvalidIndex && removed[parents[i]]);
+		if (removed[i])
+		{
+			entityToDense[denseToEntity[i]] = InvalidIndex;
+			freeEntities.push_back(denseToEntity[i]);
+		}
+		else {
+			newToOld.push_back(i);
+		}
+	}
+
+	applyOrder(newToOld);
+}
+
+bool Scene::isAlive(Entity _entity) const
+{
+	return _entity < entityToDense.size() && entityToDense[_entity] != InvalidIndex;
+}
+
+void Scene::setLocalTransform(Entity _entity, const Transform& _transform)
+{
+	uint32_t dense = entityToDense.at(_entity);
+	localTransforms[dense] = _transform;
+	localDirty[dense] = 1;
+}
+
+const Transform& Scene::getLocalTransform(Entity _entity) const
+{
+	return localTransforms[entityToDense.at(_entity)];
+}
+
+//A negative radius means the entity has nothing to draw and never shows up as visible.
+void Scene::setBoundingRadius(Entity _entity, float _radius)
+{
+	localRadii[entityToDense.at(_entity)] = _radius;
+}
+
+const glm::mat4& Scene::getWorldMatrix(Entity _entity) const
+{
+	return worldMatrices[entityToDense.at(_entity)];
+}
+
+void Scene::updateTransforms(JobSystem* _jobs)
+{
+	if (orderDirty)
+	{
+		rebuildOrder();
+	}
+
+	//a level only depends on the levels before it, so each one is a parallel-for followed by a join
+	for (size_t level = 0; level + 1 < levelOffsets.size(); ++level)
+	{
+		uint32_t begin = static_cast<uint32_t>(levelOffsets[level]);
+		uint32_t end = static_cast<uint32_t>(levelOffsets[level + 1]);
+
+		if (_jobs && end - begin > TransformGrainSize)
+		{
+			_jobs->parallelFor(begin, end, TransformGrainSize, [this](uint32_t _first, uint32_t _last) {
+				updateRange(_first, _last);
+			});
+		}
+		else {
+			updateRange(begin, end);
+		}
+	}
+}
+
+void Scene::updateRange(size_t _begin, size_t _end)
+{
+	for (size_t i = _begin; i < _end; ++i)
+	{
+		uint32_t parent = parents[i];
+		bool changed = localDirty[i] || (parent != InvalidIndex && worldChanged[parent]);
+		worldChanged[i] = changed;
+		if (!changed)
+		{
+			continue;
+		}
+		localDirty[i] = 0;
+
+		const Transform& local = localTransforms[i];
+		glm::mat4 localMatrix = glm::mat4_cast(local.rotation);
+		localMatrix[0] *= local.scale.x;
+		localMatrix[1] *= local.scale.y;
+		localMatrix[2] *= local.scale.z;
+		localMatrix[3] = glm::vec4(local.position, 1.0f);
+
+		if (parent == InvalidIndex)
+		{
+			worldMatrices[i] = localMatrix;
+			continue;
+		}
+
+		//both matrices are affine, so skip the bottom row of the full 4x4 product
+		const glm::mat4& p = worldMatrices[parent];
+		glm::mat4& world = worldMatrices[i];
+		world[0] = p[0] * localMatrix[0][0] + p[1] * localMatrix[0][1] + p[2] * localMatrix[0][2];
+		world[1] = p[0] * localMatrix[1][0] + p[1] * localMatrix[1][1] + p[2] * localMatrix[1][2];
+		world[2] = p[0] * localMatrix[2][0] + p[1] * localMatrix[2][1] + p[2] * localMatrix[2][2];
+		world[3] = p[0] * localMatrix[3][0] + p[1] * localMatrix[3][1] + p[2] * localMatrix[3][2] + p[3];
+	}
+}
+
+void Scene::gatherBounds(BoundingSpheres& _bounds) const
+{
+	_bounds.resize(denseToEntity.size());
+
+	for (size_t i = 0; i < denseToEntity.size(); ++i)
+	{
+		const glm::mat4& world = worldMatrices[i];
+		if (localRadii[i] < 0.0f)
+		{
+			_bounds.set(i, 0.0f, 0.0f, 0.0f, -std::numeric_limits<float>::infinity());
+			continue;
+		}
+
+		float maxScale = std::sqrt(std::max({
+			glm::dot(glm::vec3(world[0]), glm::vec3(world[0])),
+			glm::dot(glm::vec3(world[1]), glm::vec3(world[1])),
+			glm::dot(glm::vec3(world[2]), glm::vec3(world[2]))
+		}));
+		_bounds.set(i, world[3].x, world[3].y, world[3].z, localRadii[i] * maxScale);
+	}
+}
+
+const std::vector<glm::mat4>& Scene::getWorldMatrices() const
+{
+	return worldMatrices;
+}
+
+const std::vector<Entity>& Scene::getDenseEntities() const
+{
+	return denseToEntity;
+}
+
+size_t Scene::size() const
+{
+	return denseToEntity.size();
+}
+
+size_t Scene::depthLevels() const
+{
+	return levelOffsets.empty() ? 0 : levelOffsets.size() - 1;
+}
+
+//Stable counting sort by depth. Parents are shallower than their children, so they always end up first.
+void Scene::rebuildOrder()
+{
+	uint32_t maxDepth = 0;
+	for (Entity entity : denseToEntity)
+	{
+		maxDepth = std::max(maxDepth, entityDepth[entity]);
+	}
+
+	std::vector<size_t> offsets(maxDepth + 2, 0);
+	for (Entity entity : denseToEntity)
+	{
+		offsets[entityDepth[entity] + 1]++;
+	}
+	for (size_t d = 1; d < offsets.size(); ++d)
+	{
+		offsets[d] += offsets[d - 1];
+	}
+
+	std::vector<uint32_t> newToOld(denseToEntity.size());
+	std::vector<size_t> cursor(offsets.begin(), offsets.end() - 1);
+	for (uint32_t i = 0; i < denseToEntity.size(); ++i)
+	{
+		newToOld[cursor[entityDepth[denseToEntity[i]]]++] = i;
+	}
+
+	applyOrder(newToOld);
+}
+
+//Permutes (and possibly shrinks) every dense array so that new position n holds what was at _newToOld[n].
+void Scene::applyOrder(const std::vector<uint32_t>& _newToOld)
+{
+	std::vector<uint32_t> oldToNew(denseToEntity.size(), InvalidIndex);
+	for (uint32_t n = 0; n < _newToOld.size(); ++n)
+	{
+		oldToNew[_newToOld[n]] = n;
+	}
+
+	auto permute = [&_newToOld](auto& _array)
+	{
+		std::remove_reference_t<decltype(_array)> reordered;
+		reordered.reserve(_newToOld.size());
+		for (uint32_t old : _newToOld)
+		{
+			reordered.push_back(_array[old]);
+		}
+		_array.swap(reordered);
+	};
+
+	permute(denseToEntity);
+	permute(parents);
+	permute(localTransforms);
+	permute(worldMatrices);
+	permute(localRadii);
+	permute(localDirty);
+	permute(worldChanged);
+
+	for (uint32_t& parent : parents)
+	{
+		if (parent != InvalidIndex)
+		{
+			parent = oldToNew[parent];
+		}
+	}
+	for (uint32_t n = 0; n < denseToEntity.size(); ++n)
+	{
+		entityToDense[denseToEntity[n]] = n;
+	}
+
+	//dense order is sorted by depth at this point, recount the level ranges
+	levelOffsets.assign(1, 0);
+	for (uint32_t n = 0; n < denseToEntity.size(); ++n)
+	{
+		uint32_t depth = entityDepth[denseToEntity[n]];
+		while (levelOffsets.size() <= depth + 1)
+		{
+			levelOffsets.push_back(n);
+		}
+		levelOffsets.back() = n + 1;
+	}
+
+	orderDirty = false;
+}
@@ -0,0 +1,83 @@
+#include <ShaderCache.hpp>
+
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+
+namespace
+{
+	std::vector<char> readWholeFile(const std::filesystem::path& _path)
+	{
+		std::ifstream file(_path, std::ios::ate | std::ios::binary);
+		if (!file.is_open()) {
+			throw std::runtime_error(std::string("[CPU]: Failed to open file at: ") + _path.string());
+		}
+
+		std::vector<char> code(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(code.data(), code.size());
+		return code;
+	}
+}
+
+ShaderCache& ShaderCache::get()
+{
+	static ShaderCache cache;
+	return cache;
+}
+
+std::string ShaderCache::key(const std::filesystem::path& _path)
+{
+	return _path.lexically_normal().string();
+}
+
+size_t ShaderCache::preload(JobSystem& _jobs, const std::filesystem::path& _directory)
+{
+	std::error_code error;
+	std::vector<std::filesystem::path> paths;
+	for (const std::filesystem::directory_entry& entry : std::filesystem::directory_iterator(_directory, error))
+	{
+		if (entry.is_regular_file() && entry.path().extension() == ".spv")
+		{
+			paths.push_back(entry.path());
+		}
+	}
+
+	std::atomic<uint32_t> loaded{ 0 };
+	_jobs.parallelFor(0, static_cast<uint32_t>(paths.size()), 1, [this, &paths, &loaded](uint32_t _first, uint32_t _last)
+	{
+		for (uint32_t i = _first; i < _last; ++i)
+		{
+			//jobs can't throw, a file that can't be read now fails where it's used instead
+			std::vector<char> code;
+			try {
+				code = readWholeFile(paths[i]);
+			} catch (const std::exception&) {
+				continue;
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			files[key(paths[i])] = std::move(code);
+			loaded++;
+		}
+	});
+	return loaded;
+}
+
+std::vector<char> ShaderCache::read(const std::filesystem::path& _path)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		auto found = files.find(key(_path));
+		if (found != files.end())
+		{
+			return found->second;
+		}
+	}
+	return readWholeFile(_path);
+}
+
+void ShaderCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	files.clear();
+}
@@ -0,0 +1,193 @@
+#include <StartupGraph.hpp>
+
+#include <stdexcept>
+
+StartupGraph::StageId StartupGraph::addStage(std::string _name, std::function<void()> _function, StageThread _thread)
+{
+	stages.push_back(Stage{ std::move(_name), std::move(_function), _thread, {}, 0 });
+	timings.push_back(StageTiming{});
+	return static_cast<StageId>(stages.size() - 1);
+}
+
+void StartupGraph::addDependency(StageId _before, StageId _after)
+{
+	if (_before >= stages.size() || _after >= stages.size() || _before == _after)
+	{
+		throw std::invalid_argument("[StartupGraph]: Invalid dependency!");
+	}
+
+	stages[_before].successors.push_back(_after);
+	stages[_after].dependencyCount++;
+}
+
+//Kahn's algorithm, if it can't visit every stage there is a cycle somewhere.
+void StartupGraph::validate() const
+{
+	std::vector<uint32_t> remaining(stages.size());
+	std::vector<StageId> ready;
+	for (StageId i = 0; i < stages.size(); ++i)
+	{
+		remaining[i] = stages[i].dependencyCount;
+		if (remaining[i] == 0)
+		{
+			ready.push_back(i);
+		}
+	}
+
+	size_t visited = 0;
+	while (!ready.empty())
+	{
+		StageId id = ready.back();
+		ready.pop_back();
+		visited++;
+
+		for (StageId successor : stages[id].successors)
+		{
+			if (--remaining[successor] == 0)
+			{
+				ready.push_back(successor);
+			}
+		}
+	}
+
+	if (visited != stages.size())
+	{
+		throw std::logic_error("[StartupGraph]: Stage dependencies contain a cycle!");
+	}
+}
+
+void StartupGraph::execute(JobSystem& _jobs)
+{
+	validate();
+
+	runInline = _jobs.getWorkerCount() == 0;
+	remainingDependencies.resize(stages.size());
+	for (StageId i = 0; i < stages.size(); ++i)
+	{
+		remainingDependencies[i] = stages[i].dependencyCount;
+		timings[i] = StageTiming{};
+	}
+	mainQueue.clear();
+	finishedCount = 0;
+	error = nullptr;
+
+	startTime = Clock::now();
+	JobCounter counter;
+	for (StageId i = 0; i < stages.size(); ++i)
+	{
+		if (stages[i].dependencyCount == 0)
+		{
+			schedule(_jobs, counter, i);
+		}
+	}
+
+	//main thread stages run here as they become ready, in between this thread just waits for the workers
+	while (true)
+	{
+		StageId id;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			mainCondition.wait(lock, [this]() { return !mainQueue.empty() || finishedCount == stages.size() || error; });
+			if (error || mainQueue.empty())
+			{
+				break;
+			}
+			id = mainQueue.front();
+			mainQueue.pop_front();
+		}
+		runStage(_jobs, counter, id);
+	}
+	_jobs.wait(counter);
+	totalTime = std::chrono::duration<double>(Clock::now() - startTime).count();
+
+	if (error)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+void StartupGraph::schedule(JobSystem& _jobs, JobCounter& _counter, StageId _id)
+{
+	if (stages[_id].thread == StageThread::Main || runInline)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			mainQueue.push_back(_id);
+		}
+		mainCondition.notify_one();
+		return;
+	}
+	_jobs.run(_counter, [this, &_jobs, &_counter, _id]() { runStage(_jobs, _counter, _id); });
+}
+
+void StartupGraph::runStage(JobSystem& _jobs, JobCounter& _counter, StageId _id)
+{
+	Clock::time_point start = Clock::now();
+	std::exception_ptr stageError;
+	try {
+		stages[_id].function();
+	} catch (...) {
+		stageError = std::current_exception();
+	}
+	Clock::time_point end = Clock::now();
+
+	std::vector<StageId> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		timings[_id].start = std::chrono::duration<double>(start - startTime).count();
+		timings[_id].duration = std::chrono::duration<double>(end - start).count();
+		timings[_id].finished = true;
+		finishedCount++;
+		if (stageError && !error)
+		{
+			error = stageError;
+		}
+		if (!error)
+		{
+			for (StageId successor : stages[_id].successors)
+			{
+				if (--remainingDependencies[successor] == 0)
+				{
+					ready.push_back(successor);
+				}
+			}
+		}
+	}
+
+	//successors are queued before this job retires, so the counter can't hit zero early
+	for (StageId successor : ready)
+	{
+		schedule(_jobs, _counter, successor);
+	}
+	mainCondition.notify_one();
+}
+
+StartupGraph::Clock::time_point StartupGraph::getStartTime() const
+{
+	return startTime;
+}
+
+double StartupGraph::getTotalTime() const
+{
+	return totalTime;
+}
+
+size_t StartupGraph::size() const
+{
+	return stages.size();
+}
+
+const std::string& StartupGraph::getName(StageId _id) const
+{
+	return stages[_id].name;
+}
+
+StageThread StartupGraph::getThread(StageId _id) const
+{
+	return stages[_id].thread;
+}
+
+const StageTiming& StartupGraph::getTiming(StageId _id) const
+{
+	return timings[_id];
+}
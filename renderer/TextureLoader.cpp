@@ -0,0 +1,194 @@
+#include <TextureLoader.hpp>
+#include <BlockDecoding.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+static const uint8_t Ktx2Identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+static uint64_t readLittleEndian(const uint8_t* _bytes, uint32_t _count)
+{
+	uint64_t value = 0;
+	for (uint32_t i = 0; i < _count; ++i)
+	{
+		value |= static_cast<uint64_t>(_bytes[i]) << (8 * i);
+	}
+	return value;
+}
+
+Ktx2Header readKtx2Header(const std::filesystem::path& _path)
+{
+	std::ifstream file(_path, std::ios::binary);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[Texture]: Couldn't open " + _path.string());
+	}
+
+	//identifier, 13 uint32 and 2 uint64, the level index follows
+	uint8_t bytes[80];
+	if (!file.read(reinterpret_cast<char*>(bytes), sizeof(bytes)) || memcmp(bytes, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0)
+	{
+		throw std::runtime_error("[Texture]: " + _path.string() + " isn't a KTX2 file!");
+	}
+
+	auto field = [&bytes](uint32_t _offset) { return static_cast<uint32_t>(readLittleEndian(bytes + _offset, 4)); };
+	uint32_t vkFormat = field(12);
+	uint32_t pixelDepth = field(28);
+	uint32_t layerCount = field(32);
+	uint32_t faceCount = field(36);
+	uint32_t supercompressionScheme = field(44);
+
+	if (vkFormat == VK_FORMAT_UNDEFINED || supercompressionScheme != 0)
+	{
+		throw std::runtime_error("[Texture]: " + _path.string() + " is supercompressed or Basis Universal, transcode it offline!");
+	}
+	if (field(24) == 0 || pixelDepth > 1 || layerCount > 1 || faceCount != 1)
+	{
+		throw std::runtime_error("[Texture]: " + _path.string() + " isn't a single 2D image!");
+	}
+
+	Ktx2Header result;
+	result.format = static_cast<VkFormat>(vkFormat);
+	result.width = field(20);
+	result.height = field(24);
+
+	//a level count of 0 asks the loader to generate mips
+	result.generateMips = field(40) == 0;
+	uint32_t levelCount = std::max(field(40), 1u);
+	for (uint32_t level = 0; level < levelCount; ++level)
+	{
+		//byteOffset, byteLength, uncompressedByteLength
+		uint8_t levelBytes[24];
+		if (!file.read(reinterpret_cast<char*>(levelBytes), sizeof(levelBytes)))
+		{
+			throw std::runtime_error("[Texture]: " + _path.string() + " has a truncated level index!");
+		}
+		result.levels.push_back({ readLittleEndian(levelBytes, 8), readLittleEndian(levelBytes + 8, 8) });
+	}
+
+	return result;
+}
+
+TextureFormatSupport queryTextureFormatSupport(VkPhysicalDevice _physicalDevice)
+{
+	VkPhysicalDeviceFeatures features;
+	vkGetPhysicalDeviceFeatures(_physicalDevice, &features);
+
+	TextureFormatSupport support;
+	support.bc = features.textureCompressionBC;
+	support.etc2 = features.textureCompressionETC2;
+	support.astcLdr = features.textureCompressionASTC_LDR;
+	return support;
+}
+
+void TextureLoader::init(VkPhysicalDevice _physicalDevice, const TextureFormatSupport& _support, TextureStreamer& _streamer)
+{
+	physicalDevice = _physicalDevice;
+	support = _support;
+	streamer = &_streamer;
+}
+
+TextureHandle TextureLoader::loadKtx2(const std::filesystem::path& _path)
+{
+	Ktx2Header header = readKtx2Header(_path);
+
+	if (getBlockFormatInfo(header.format).bytesPerBlock == 0 && header.format != VK_FORMAT_R8G8B8A8_UNORM && header.format != VK_FORMAT_R8G8B8A8_SRGB)
+	{
+		throw std::runtime_error("[Texture]: " + _path.string() + " has a format that's neither block compressed nor RGBA8!");
+	}
+
+	bool decode = !isSampleable(header.format);
+	VkFormat decodedFormat = decode ? getDecodedFormat(header.format) : header.format;
+	if (decodedFormat == VK_FORMAT_UNDEFINED)
+	{
+		throw std::runtime_error("[Texture]: " + _path.string() + " has a format the device can't sample and there is no CPU decoder for!");
+	}
+
+	StreamedTextureDesc desc;
+	desc.format = decodedFormat;
+	desc.width = header.width;
+	desc.height = header.height;
+	//blits and the downsample shader only handle uncompressed formats, compressed files keep their single level
+	desc.generateMips = header.generateMips && getBlockFormatInfo(decodedFormat).bytesPerBlock == 0;
+
+	for (uint32_t mip = 0; mip < header.levels.size(); ++mip)
+	{
+		uint32_t width = std::max(header.width >> mip, 1u);
+		uint32_t height = std::max(header.height >> mip, 1u);
+		VkDeviceSize rgba8Size = static_cast<VkDeviceSize>(width) * height * 4;
+		VkDeviceSize expectedSize = getBlockFormatInfo(header.format).bytesPerBlock != 0 ? getCompressedLevelSize(header.format, width, height) : rgba8Size;
+		if (header.levels[mip].length != expectedSize)
+		{
+			throw std::runtime_error("[Texture]: " + _path.string() + " mip " + std::to_string(mip) + " has the wrong size!");
+		}
+
+		desc.mipSizes.push_back(decode ? rgba8Size : header.levels[mip].length);
+		stats.textureBytes += desc.mipSizes.back();
+		stats.rgba8Bytes += rgba8Size;
+	}
+
+	//levels are read straight from the file whenever the streamer wants them, decoded ones through a scratch buffer.
+	//The streamer reads on its job workers, several levels at once, so every call opens the file for itself.
+	VkFormat sourceFormat = header.format;
+	std::vector<Ktx2Level> levels = header.levels;
+	uint32_t width = header.width;
+	uint32_t height = header.height;
+	desc.readMip = [_path, levels, sourceFormat, decode, width, height](uint32_t _mip, void* _destination) {
+		std::ifstream file(_path, std::ios::binary);
+		file.seekg(static_cast<std::streamoff>(levels[_mip].offset));
+
+		if (!decode)
+		{
+			if (!file.read(static_cast<char*>(_destination), static_cast<std::streamsize>(levels[_mip].length)))
+			{
+				throw std::runtime_error("[Texture]: Couldn't read mip " + std::to_string(_mip) + " of " + _path.string());
+			}
+			return;
+		}
+
+		std::vector<uint8_t> blocks(levels[_mip].length);
+		if (!file.read(reinterpret_cast<char*>(blocks.data()), static_cast<std::streamsize>(blocks.size())))
+		{
+			throw std::runtime_error("[Texture]: Couldn't read mip " + std::to_string(_mip) + " of " + _path.string());
+		}
+		decodeBlocks(sourceFormat, blocks.data(), std::max(width >> _mip, 1u), std::max(height >> _mip, 1u), static_cast<uint8_t*>(_destination));
+	};
+
+	stats.texturesLoaded++;
+	if (decode)
+	{
+		stats.texturesDecoded++;
+	}
+
+	return streamer->addTexture(std::move(desc));
+}
+
+bool TextureLoader::isSampleable(VkFormat _format) const
+{
+	bool featureEnabled = true;
+	if (_format >= VK_FORMAT_BC1_RGB_UNORM_BLOCK && _format <= VK_FORMAT_BC7_SRGB_BLOCK)
+	{
+		featureEnabled = support.bc;
+	}
+	else if (_format >= VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK && _format <= VK_FORMAT_EAC_R11G11_SNORM_BLOCK)
+	{
+		featureEnabled = support.etc2;
+	}
+	else if (_format >= VK_FORMAT_ASTC_4x4_UNORM_BLOCK && _format <= VK_FORMAT_ASTC_12x12_SRGB_BLOCK)
+	{
+		featureEnabled = support.astcLdr;
+	}
+
+	//the feature only promises the family, drivers may still leave out individual formats
+	VkFormatProperties properties;
+	vkGetPhysicalDeviceFormatProperties(physicalDevice, _format, &properties);
+	return featureEnabled && (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+}
+
+const AssetStats& TextureLoader::getStats() const
+{
+	return stats;
+}
@@ -0,0 +1,654 @@
+#include <TextureStreaming.hpp>
+#include <vulkanUtils.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+//copyBufferToImage offsets must be a multiple of the texel block size, 16 covers every format we stream
+static constexpr VkDeviceSize StagingAlignment = 16;
+
+std::vector<uint32_t> planResidency(const std::vector<ResidencyRequest>& _requests, VkDeviceSize _budget)
+{
+	std::vector<uint32_t> targets(_requests.size());
+	VkDeviceSize total = 0;
+
+	for (size_t i = 0; i < _requests.size(); ++i)
+	{
+		const ResidencyRequest& request = _requests[i];
+		targets[i] = std::min(request.requestedMip, request.tailMip);
+		for (uint32_t mip = targets[i]; mip < request.mipCount; ++mip)
+		{
+			total += request.mipBytes[mip];
+		}
+	}
+
+	std::vector<uint32_t> order(_requests.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&_requests](uint32_t _a, uint32_t _b) {
+		return _requests[_a].lastUsedFrame < _requests[_b].lastUsedFrame;
+	});
+
+	for (uint32_t index : order)
+	{
+		if (total <= _budget)
+		{
+			break;
+		}
+
+		const ResidencyRequest& request = _requests[index];
+		while (total > _budget && targets[index] < request.tailMip)
+		{
+			total -= request.mipBytes[targets[index]];
+			targets[index]++;
+		}
+	}
+
+	return targets;
+}
+
+uint32_t mipForScreenSize(uint32_t _width, uint32_t _height, float _screenPixels)
+{
+	float ratio = static_cast<float>(std::max(_width, _height)) / std::max(_screenPixels, 1.0f);
+	return ratio <= 1.0f ? 0 : static_cast<uint32_t>(std::floor(std::log2(ratio)));
+}
+
+void TextureStreamer::init(VkDevice _device, VkPhysicalDevice _physicalDevice, VkQueue _queue, uint32_t _queueFamily,
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR _getMemoryProperties2, JobSystem* _jobs, const TextureStreamingConfig& _config)
+{
+	device = _device;
+	physicalDevice = _physicalDevice;
+	queue = _queue;
+	jobs = _jobs;
+	getMemoryProperties2 = _getMemoryProperties2;
+	config = _config;
+
+	//budget against the biggest device local heap, that's where the images end up
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+	for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; ++i)
+	{
+		const VkMemoryHeap& heap = memoryProperties.memoryHeaps[i];
+		if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && heap.size > deviceLocalHeapSize)
+		{
+			deviceLocalHeap = i;
+			deviceLocalHeapSize = heap.size;
+		}
+	}
+
+	VkCommandPoolCreateInfo commandPoolCreateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,			//sType
+		nullptr,											//pNext
+		VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,	//flags
+		_queueFamily										//queueFamilyIndex
+	};
+	if (vkCreateCommandPool(device, &commandPoolCreateInfo, nullptr, &commandPool) != VK_SUCCESS) {
+		throw std::runtime_error("[Streaming]: Unable to create Command Pool!");
+	}
+
+	VkCommandBufferAllocateInfo commandBufferAllocateInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO, //sType
+		nullptr,										//pNext
+		commandPool,									//commandPool
+		VK_COMMAND_BUFFER_LEVEL_PRIMARY,				//level
+		1												//commandBufferCount
+	};
+	if (vkAllocateCommandBuffers(device, &commandBufferAllocateInfo, &commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[Streaming]: Couldn't allocate Command Buffer!");
+	}
+
+	VkFenceCreateInfo fenceCreateInfo{
+		VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,	//sType
+		nullptr,								//pNext
+		0										//flags
+	};
+	if (vkCreateFence(device, &fenceCreateInfo, nullptr, &uploadFence) != VK_SUCCESS) {
+		throw std::runtime_error("[Streaming]: Couldn't create upload fence!");
+	}
+
+	createBuffer(device, physicalDevice, config.uploadBytesPerFrame, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, {}, stagingBuffer, stagingMemory);
+	vkMapMemory(device, stagingMemory, 0, VK_WHOLE_SIZE, 0, reinterpret_cast<void**>(&stagingMapped));
+
+	mipGenerator.init(device, physicalDevice, config.downsampleShader);
+
+	stats.budgetBytes = currentBudget();
+}
+
+void TextureStreamer::destroy()
+{
+	if (device == VK_NULL_HANDLE)
+	{
+		return;
+	}
+
+	waitForLoads();
+	submitUploads();
+	waitForUploads();
+	releaseRetired();
+
+	for (Texture& texture : textures)
+	{
+		vkDestroyImageView(device, texture.view, nullptr);
+		texture.image.destroy(device);
+	}
+	textures.clear();
+	mipGenerator.destroy();
+
+	vkUnmapMemory(device, stagingMemory);
+	vkDestroyBuffer(device, stagingBuffer, nullptr);
+	vkFreeMemory(device, stagingMemory, nullptr);
+	vkDestroyFence(device, uploadFence, nullptr);
+	vkDestroyCommandPool(device, commandPool, nullptr);
+
+	device = VK_NULL_HANDLE;
+}
+
+//Bytes a level takes in the staging buffer, generated levels never pass through it.
+static VkDeviceSize getStagingSize(const StreamedTextureDesc& _desc, uint32_t _mip)
+{
+	if (_desc.generateMips && _mip > 0)
+	{
+		return 0;
+	}
+	return alignUp(_desc.mipSizes[_mip], StagingAlignment);
+}
+
+TextureHandle TextureStreamer::addTexture(StreamedTextureDesc _desc)
+{
+	if (_desc.mipSizes.empty() || _desc.width == 0 || _desc.height == 0 || !_desc.readMip)
+	{
+		throw std::invalid_argument("[Streaming]: Texture needs a size, at least one mip and a way to read them!");
+	}
+	if (_desc.generateMips && _desc.mipSizes.size() != 1)
+	{
+		throw std::invalid_argument("[Streaming]: Textures with generated mips only provide mip 0!");
+	}
+
+	Texture texture;
+	if (_desc.generateMips)
+	{
+		//the whole chain down to 1x1, sized from mip 0 by texel count
+		texture.mipCount = static_cast<uint32_t>(std::floor(std::log2(std::max(_desc.width, _desc.height)))) + 1;
+		double texelBytes = static_cast<double>(_desc.mipSizes[0]) / (static_cast<double>(_desc.width) * _desc.height);
+		for (uint32_t mip = 0; mip < texture.mipCount; ++mip)
+		{
+			double texels = static_cast<double>(std::max(_desc.width >> mip, 1u)) * std::max(_desc.height >> mip, 1u);
+			texture.deviceMipBytes.push_back(std::max<VkDeviceSize>(static_cast<VkDeviceSize>(texels * texelBytes), 1));
+		}
+		//generating again would need mip 0, so the chain is never shortened
+		texture.tailMip = 0;
+	} else {
+		texture.mipCount = static_cast<uint32_t>(_desc.mipSizes.size());
+		texture.deviceMipBytes = _desc.mipSizes;
+
+		texture.tailMip = texture.mipCount - 1;
+		for (uint32_t mip = 0; mip < texture.mipCount; ++mip)
+		{
+			if (std::max(_desc.width >> mip, _desc.height >> mip) <= config.mipTailSize)
+			{
+				texture.tailMip = mip;
+				break;
+			}
+		}
+	}
+	texture.residentMip = texture.mipCount;
+	texture.requestedMip = texture.tailMip;
+	texture.lastUsedFrame = frame;
+	texture.desc = std::move(_desc);
+
+	VkDeviceSize tailBytes = 0;
+	for (uint32_t mip = texture.tailMip; mip < texture.mipCount; ++mip)
+	{
+		tailBytes += getStagingSize(texture.desc, mip);
+	}
+	if (tailBytes > config.uploadBytesPerFrame)
+	{
+		throw std::invalid_argument("[Streaming]: Mip tail doesn't fit in the staging buffer!");
+	}
+
+	//the tail has to be there before the texture is first sampled, flush what's queued if it doesn't fit
+	if (stagingUsed + tailBytes > config.uploadBytesPerFrame)
+	{
+		submitUploads();
+		waitForUploads();
+	}
+
+	textures.push_back(std::move(texture));
+	TextureHandle handle = static_cast<TextureHandle>(textures.size() - 1);
+	applyResidency({ { handle, textures.back().tailMip } });
+	return handle;
+}
+
+void TextureStreamer::requestMip(TextureHandle _texture, uint32_t _mip)
+{
+	Texture& texture = textures.at(_texture);
+	//several requests in one frame keep the finest
+	texture.requestedMip = texture.lastUsedFrame == frame ? std::min(texture.requestedMip, _mip) : _mip;
+	texture.requestedMip = std::min(texture.requestedMip, texture.mipCount - 1);
+	texture.lastUsedFrame = frame;
+}
+
+void TextureStreamer::update()
+{
+	waitForUploads();
+	//the caller waited for the last frame, nothing samples the retired images anymore
+	releaseRetired();
+
+	std::vector<ResidencyRequest> requests(textures.size());
+	stats.requestedBytes = 0;
+	for (size_t i = 0; i < textures.size(); ++i)
+	{
+		const Texture& texture = textures[i];
+		requests[i] = { texture.requestedMip, texture.tailMip, texture.mipCount, texture.lastUsedFrame, texture.deviceMipBytes.data() };
+		for (uint32_t mip = std::min(texture.requestedMip, texture.tailMip); mip < texture.mipCount; ++mip)
+		{
+			stats.requestedBytes += texture.deviceMipBytes[mip];
+		}
+	}
+
+	stats.budgetBytes = currentBudget();
+	std::vector<uint32_t> targets = planResidency(requests, stats.budgetBytes);
+
+	//evictions only copy on the GPU, they always go through. Textures being read keep their levels until the reads
+	//are uploaded, since those end where the resident levels start.
+	std::vector<ResidencyChange> changes;
+	for (uint32_t i = 0; i < textures.size(); ++i)
+	{
+		if (!textures[i].loading && targets[i] > textures[i].residentMip)
+		{
+			changes.push_back({ i, targets[i] });
+		}
+	}
+
+	bool loaded = finishLoads(changes);
+	applyResidency(changes);
+	if (loaded)
+	{
+		loads.clear();
+	}
+	if (loads.empty())
+	{
+		startLoads(targets);
+	}
+	submitUploads();
+	frame++;
+}
+
+//Finished reads are uploaded whether or not they're still wanted, the next update evicts them again if they aren't.
+bool TextureStreamer::finishLoads(std::vector<ResidencyChange>& _changes)
+{
+	if (loads.empty() || !loadCounter.done())
+	{
+		return false;
+	}
+
+	if (jobs != nullptr)
+	{
+		try {
+			jobs->wait(loadCounter);
+		} catch (...) {
+			for (const PendingLoad& load : loads)
+			{
+				textures[load.texture].loading = false;
+			}
+			loads.clear();
+			throw;
+		}
+	}
+
+	VkDeviceSize loadedBytes = 0;
+	for (const PendingLoad& load : loads)
+	{
+		Texture& texture = textures[load.texture];
+		for (uint32_t mip = load.mip; mip < texture.residentMip; ++mip)
+		{
+			loadedBytes += getStagingSize(texture.desc, mip);
+		}
+		texture.loading = false;
+		_changes.push_back({ load.texture, load.mip, &load });
+	}
+
+	//the batch was sized to fit the staging buffer, tails added since the last update may still be queued in it
+	if (stagingUsed + loadedBytes > config.uploadBytesPerFrame)
+	{
+		submitUploads();
+		waitForUploads();
+	}
+	return true;
+}
+
+//Picks the levels to stream in next, most recently used textures first and as many as the staging buffer will have
+//room for once they're uploaded, and reads them on the job system.
+void TextureStreamer::startLoads(const std::vector<uint32_t>& _targets)
+{
+	std::vector<uint32_t> order;
+	for (uint32_t i = 0; i < textures.size(); ++i)
+	{
+		if (_targets[i] < textures[i].residentMip)
+		{
+			order.push_back(i);
+		}
+	}
+	std::stable_sort(order.begin(), order.end(), [this](uint32_t _a, uint32_t _b) {
+		return textures[_a].lastUsedFrame > textures[_b].lastUsedFrame;
+	});
+
+	VkDeviceSize staged = 0;
+	for (uint32_t index : order)
+	{
+		Texture& texture = textures[index];
+
+		uint32_t mip = texture.residentMip;
+		while (mip > _targets[index])
+		{
+			VkDeviceSize levelBytes = getStagingSize(texture.desc, mip - 1);
+			if (staged + levelBytes > config.uploadBytesPerFrame)
+			{
+				break;
+			}
+			staged += levelBytes;
+			mip--;
+		}
+
+		if (mip < texture.residentMip)
+		{
+			PendingLoad& load = loads.emplace_back();
+			load.texture = index;
+			load.mip = mip;
+			load.readMip = texture.desc.readMip;
+			load.levels.resize(texture.residentMip - mip);
+			for (uint32_t level = 0; level < load.levels.size(); ++level)
+			{
+				load.levels[level].resize(texture.desc.mipSizes[mip + level]);
+			}
+			texture.loading = true;
+		}
+	}
+
+	//only once every load is in place, the jobs hold on to them
+	for (PendingLoad& load : loads)
+	{
+		PendingLoad* pending = &load;
+		for (uint32_t level = 0; level < load.levels.size(); ++level)
+		{
+			if (jobs != nullptr)
+			{
+				jobs->run(loadCounter, [pending, level]() { pending->readMip(pending->mip + level, pending->levels[level].data()); });
+			}
+			else {
+				pending->readMip(pending->mip + level, pending->levels[level].data());
+			}
+			stats.mipsRead++;
+		}
+	}
+}
+
+void TextureStreamer::waitForLoads()
+{
+	if (jobs != nullptr && !loads.empty())
+	{
+		//the jobs write into loads, what they threw doesn't matter anymore
+		try {
+			jobs->wait(loadCounter);
+		} catch (...) {
+		}
+	}
+	loads.clear();
+}
+
+//Replaces each texture's image with one holding levels [mip, mipCount). Levels both images hold are copied on the GPU,
+//finer ones are read from the source into the staging buffer, which the caller made sure has room. The transitions of
+//all textures are batched, so a whole update costs two barriers plus one per generated level.
+void TextureStreamer::applyResidency(const std::vector<ResidencyChange>& _changes)
+{
+	if (_changes.empty())
+	{
+		return;
+	}
+
+	beginUploads();
+
+	std::vector<TrackedImage> images(_changes.size());
+	for (size_t i = 0; i < _changes.size(); ++i)
+	{
+		Texture& texture = textures[_changes[i].texture];
+		const StreamedTextureDesc& desc = texture.desc;
+		const uint32_t mip = _changes[i].mip;
+
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		if (desc.generateMips)
+		{
+			usage |= mipGenerator.getRequiredUsage(desc.format);
+		}
+		images[i].create(device, physicalDevice, desc.format,
+			VkExtent2D { std::max(desc.width >> mip, 1u), std::max(desc.height >> mip, 1u) }, texture.mipCount - mip, usage);
+
+		//generated levels get transitioned by the generator as it goes
+		barriers.transition(images[i], VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+			0, desc.generateMips ? 1 : VK_REMAINING_MIP_LEVELS);
+		if (texture.image.getImage() != VK_NULL_HANDLE)
+		{
+			barriers.transition(texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+		}
+	}
+	barriers.flush(commandBuffer);
+
+	for (size_t i = 0; i < _changes.size(); ++i)
+	{
+		const Texture& texture = textures[_changes[i].texture];
+		const StreamedTextureDesc& desc = texture.desc;
+		const uint32_t newResident = _changes[i].mip;
+		const uint32_t oldResident = texture.residentMip;
+		const uint32_t endMip = desc.generateMips ? newResident + 1 : texture.mipCount;
+
+		for (uint32_t mip = newResident; mip < endMip; ++mip)
+		{
+			VkExtent3D extent{ std::max(desc.width >> mip, 1u), std::max(desc.height >> mip, 1u), 1 };
+			VkImageSubresourceLayers dstLayers{ VK_IMAGE_ASPECT_COLOR_BIT, mip - newResident, 0, 1 };
+
+			if (mip >= oldResident)
+			{
+				VkImageCopy region{
+					VkImageSubresourceLayers { VK_IMAGE_ASPECT_COLOR_BIT, mip - oldResident, 0, 1 },	//srcSubresource
+					VkOffset3D { 0, 0, 0 },		//srcOffset
+					dstLayers,					//dstSubresource
+					VkOffset3D { 0, 0, 0 },		//dstOffset
+					extent						//extent
+				};
+				vkCmdCopyImage(commandBuffer, texture.image.getImage(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+					images[i].getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+			}
+			else {
+				if (_changes[i].load != nullptr)
+				{
+					const std::vector<uint8_t>& level = _changes[i].load->levels[mip - _changes[i].load->mip];
+					std::memcpy(stagingMapped + stagingUsed, level.data(), level.size());
+				}
+				else {
+					desc.readMip(mip, stagingMapped + stagingUsed);
+				}
+
+				VkBufferImageCopy region{
+					stagingUsed,				//bufferOffset
+					0,							//bufferRowLength -> tightly packed
+					0,							//bufferImageHeight
+					dstLayers,					//imageSubresource
+					VkOffset3D { 0, 0, 0 },		//imageOffset
+					extent						//imageExtent
+				};
+				vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, images[i].getImage(), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+				stagingUsed += getStagingSize(desc, mip);
+				stats.bytesUploaded += desc.mipSizes[mip];
+				stats.mipsStreamedIn++;
+			}
+		}
+	}
+
+	for (size_t i = 0; i < _changes.size(); ++i)
+	{
+		if (textures[_changes[i].texture].desc.generateMips)
+		{
+			mipGenerator.generate(commandBuffer, images[i], barriers);
+			stats.mipsGenerated += images[i].getMipLevels() - 1;
+		}
+	}
+
+	for (TrackedImage& image : images)
+	{
+		barriers.transition(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+	}
+	barriers.flush(commandBuffer);
+
+	for (size_t i = 0; i < _changes.size(); ++i)
+	{
+		Texture& texture = textures[_changes[i].texture];
+
+		if (_changes[i].mip > texture.residentMip)
+		{
+			stats.mipsEvicted += _changes[i].mip - texture.residentMip;
+		}
+		if (texture.image.getImage() != VK_NULL_HANDLE)
+		{
+			retired.push_back({ texture.image, texture.view });
+			stats.residentBytes -= texture.image.getMemorySize();
+		}
+
+		texture.image = images[i];
+		texture.view = images[i].createView(device);
+		texture.residentMip = _changes[i].mip;
+		stats.residentBytes += images[i].getMemorySize();
+	}
+
+	stats.barriersRecorded = barriers.getBarriersRecorded();
+	stats.transitionsElided = barriers.getTransitionsElided();
+}
+
+void TextureStreamer::beginUploads()
+{
+	if (recording)
+	{
+		return;
+	}
+
+	//the command buffer and staging memory are reused, the previous batch has to be done with them
+	waitForUploads();
+
+	VkCommandBufferBeginInfo beginInfo{
+		VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,	//sType
+		nullptr,										//pNext
+		VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,	//flags
+		nullptr											//pInheritanceInfo
+	};
+	vkResetCommandBuffer(commandBuffer, 0);
+	if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+		throw std::runtime_error("[Streaming]: Couldn't begin recording Command Buffer!");
+	}
+	recording = true;
+	stagingUsed = 0;
+}
+
+void TextureStreamer::submitUploads()
+{
+	if (!recording)
+	{
+		return;
+	}
+
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("[Streaming]: Couldn't end recording Command Buffer!");
+	}
+
+	VkSubmitInfo submitInfo{
+		VK_STRUCTURE_TYPE_SUBMIT_INFO,	//sType
+		nullptr,						//pNext
+		0,								//waitSemaphoreCount
+		nullptr,						//pWaitSemaphores
+		nullptr,						//pWaitDstStageMask
+		1,								//commandBufferCount
+		&commandBuffer,					//pCommandBuffers
+		0,								//signalSemaphoreCount
+		nullptr							//pSignalSemaphores
+	};
+	//same queue as the frame, so submission order alone makes the uploads visible to the next frame's shaders
+	if (vkQueueSubmit(queue, 1, &submitInfo, uploadFence) != VK_SUCCESS) {
+		throw std::runtime_error("[Streaming]: Could not submit uploads!");
+	}
+
+	recording = false;
+	uploadPending = true;
+}
+
+void TextureStreamer::waitForUploads()
+{
+	if (!uploadPending)
+	{
+		return;
+	}
+
+	vkWaitForFences(device, 1, &uploadFence, VK_TRUE, UINT64_MAX);
+	vkResetFences(device, 1, &uploadFence);
+	uploadPending = false;
+	stagingUsed = 0;
+	mipGenerator.releaseTransient();
+}
+
+void TextureStreamer::releaseRetired()
+{
+	for (RetiredImage& image : retired)
+	{
+		vkDestroyImageView(device, image.view, nullptr);
+		image.image.destroy(device);
+	}
+	retired.clear();
+}
+
+VkImageView TextureStreamer::getImageView(TextureHandle _texture) const
+{
+	return textures.at(_texture).view;
+}
+
+uint32_t TextureStreamer::getResidentMip(TextureHandle _texture) const
+{
+	return textures.at(_texture).residentMip;
+}
+
+VkExtent2D TextureStreamer::getExtent(TextureHandle _texture) const
+{
+	const StreamedTextureDesc& desc = textures.at(_texture).desc;
+	return VkExtent2D{ desc.width, desc.height };
+}
+
+const TextureStreamingStats& TextureStreamer::getStats() const
+{
+	return stats;
+}
+
+//With VK_EXT_memory_budget: our share of what the driver says this process may use on the heap, minus what
+//everything else in the process already holds there. Without it: the configured budget or half the heap.
+VkDeviceSize TextureStreamer::currentBudget() const
+{
+	if (getMemoryProperties2 == nullptr)
+	{
+		return config.budgetBytes != 0 ? config.budgetBytes : deviceLocalHeapSize / 2;
+	}
+
+	VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties{};
+	budgetProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+	VkPhysicalDeviceMemoryProperties2 memoryProperties{};
+	memoryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+	memoryProperties.pNext = &budgetProperties;
+	getMemoryProperties2(physicalDevice, &memoryProperties);
+
+	VkDeviceSize heapBudget = budgetProperties.heapBudget[deviceLocalHeap];
+	VkDeviceSize heapUsage = budgetProperties.heapUsage[deviceLocalHeap];
+	VkDeviceSize usedByOthers = heapUsage > stats.residentBytes ? heapUsage - stats.residentBytes : 0;
+	VkDeviceSize ourShare = static_cast<VkDeviceSize>(static_cast<double>(heapBudget) * config.budgetFraction);
+	VkDeviceSize available = ourShare > usedByOthers ? ourShare - usedByOthers : 0;
+
+	return config.budgetBytes != 0 ? std::min(config.budgetBytes, available) : available;
+}
@@ -0,0 +1,230 @@
+#include <TrackedImage.hpp>
+#include <vulkanUtils.hpp>
+
+#include <algorithm>
+#include <stdexcept>
+
+static constexpr VkAccessFlags WriteAccess =
+	VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+	VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+void TrackedImage::create(VkDevice _device, VkPhysicalDevice _physicalDevice, VkFormat _format, VkExtent2D _extent,
+	uint32_t _mipLevels, VkImageUsageFlags _usage)
+{
+	VkImageCreateInfo imageInfo{
+		VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,	//sType
+		nullptr,								//pNext
+		0,										//flags
+		VK_IMAGE_TYPE_2D,						//imageType
+		_format,								//format
+		VkExtent3D { _extent.width, _extent.height, 1 },	//extent
+		_mipLevels,								//mipLevels
+		1,										//arrayLayers
+		VK_SAMPLE_COUNT_1_BIT,					//samples
+		VK_IMAGE_TILING_OPTIMAL,				//tiling
+		_usage,									//usage
+		VK_SHARING_MODE_EXCLUSIVE,				//sharingMode
+		0,										//queueFamilyIndexCount
+		nullptr,								//pQueueFamilyIndices
+		VK_IMAGE_LAYOUT_UNDEFINED				//initialLayout
+	};
+	if (vkCreateImage(_device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Image]: Failed to create image!");
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetImageMemoryRequirements(_device, image, &requirements);
+	VkMemoryAllocateInfo allocateInfo{
+		VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,	//sType
+		nullptr,								//pNext
+		requirements.size,						//allocationSize
+		findMemoryType(_physicalDevice, requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)	//memoryTypeIndex
+	};
+	if (vkAllocateMemory(_device, &allocateInfo, nullptr, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Image]: Failed to allocate image memory!");
+	}
+	vkBindImageMemory(_device, image, memory, 0);
+
+	memorySize = requirements.size;
+	format = _format;
+	extent = _extent;
+	//only depth formats without stencil are created here
+	aspect = (_usage & VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+	levels.assign(_mipLevels, SubresourceState{});
+}
+
+void TrackedImage::wrap(VkImage _image, VkFormat _format, VkExtent2D _extent, uint32_t _mipLevels, VkImageAspectFlags _aspect,
+	VkImageLayout _currentLayout)
+{
+	image = _image;
+	memory = VK_NULL_HANDLE;
+	memorySize = 0;
+	format = _format;
+	extent = _extent;
+	aspect = _aspect;
+	levels.assign(_mipLevels, SubresourceState{ _currentLayout, 0, 0 });
+}
+
+void TrackedImage::destroy(VkDevice _device)
+{
+	if (memory != VK_NULL_HANDLE)
+	{
+		vkDestroyImage(_device, image, nullptr);
+		vkFreeMemory(_device, memory, nullptr);
+	}
+	image = VK_NULL_HANDLE;
+	memory = VK_NULL_HANDLE;
+	memorySize = 0;
+	levels.clear();
+}
+
+VkImageView TrackedImage::createView(VkDevice _device, uint32_t _baseMip, uint32_t _levelCount) const
+{
+	VkImageViewCreateInfo viewInfo{
+		VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,	//sType
+		nullptr,									//pNext
+		0,											//flags
+		image,										//image
+		VK_IMAGE_VIEW_TYPE_2D,						//viewType
+		format,										//format
+		VkComponentMapping {},						//components
+		VkImageSubresourceRange {					//subresourceRange
+			aspect,
+			_baseMip,
+			_levelCount,
+			0,
+			1
+		}
+	};
+
+	VkImageView view;
+	if (vkCreateImageView(_device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Image]: Failed to create image view!");
+	}
+	return view;
+}
+
+VkImage TrackedImage::getImage() const
+{
+	return image;
+}
+
+VkFormat TrackedImage::getFormat() const
+{
+	return format;
+}
+
+VkExtent2D TrackedImage::getExtent(uint32_t _mip) const
+{
+	return { std::max(extent.width >> _mip, 1u), std::max(extent.height >> _mip, 1u) };
+}
+
+uint32_t TrackedImage::getMipLevels() const
+{
+	return static_cast<uint32_t>(levels.size());
+}
+
+VkDeviceSize TrackedImage::getMemorySize() const
+{
+	return memorySize;
+}
+
+const SubresourceState& TrackedImage::getState(uint32_t _mip) const
+{
+	return levels[_mip];
+}
+
+void BarrierBatch::transition(TrackedImage& _image, VkImageLayout _layout, VkPipelineStageFlags _stages, VkAccessFlags _access,
+	uint32_t _baseMip, uint32_t _levelCount)
+{
+	uint32_t mipCount = _image.getMipLevels();
+	uint32_t endMip = _levelCount == VK_REMAINING_MIP_LEVELS ? mipCount : std::min(mipCount, _baseMip + _levelCount);
+
+	//levels needing a barrier are merged with the previous level's when both come from the same state
+	size_t firstBarrier = barriers.size();
+	for (uint32_t mip = _baseMip; mip < endMip; ++mip)
+	{
+		SubresourceState& state = _image.levels[mip];
+
+		for (const Pending& other : pending)
+		{
+			if (other.image == &_image && other.mip == mip)
+			{
+				throw std::logic_error("[Barriers]: Mip level transitioned twice in one batch!");
+			}
+		}
+
+		//same layout and nobody writes: readers can run side by side, they only join the state
+		bool hazard = (state.access & WriteAccess) || (_access & WriteAccess);
+		if (state.layout == _layout && !hazard)
+		{
+			state.stages |= _stages;
+			state.access |= _access;
+			transitionsElided++;
+			continue;
+		}
+
+		pending.push_back({ &_image, mip });
+		srcStages |= state.stages;
+		dstStages |= _stages;
+
+		VkAccessFlags srcAccess = state.access & WriteAccess;
+		if (barriers.size() > firstBarrier)
+		{
+			VkImageMemoryBarrier& previous = barriers.back();
+			if (previous.oldLayout == state.layout && previous.srcAccessMask == srcAccess &&
+				previous.subresourceRange.baseMipLevel + previous.subresourceRange.levelCount == mip)
+			{
+				previous.subresourceRange.levelCount++;
+				state = SubresourceState{ _layout, _stages, _access };
+				continue;
+			}
+		}
+
+		barriers.push_back(VkImageMemoryBarrier{
+			VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,	//sType
+			nullptr,								//pNext
+			srcAccess,								//srcAccessMask -> reads need no flush, the stage dependency covers them
+			_access,								//dstAccessMask
+			state.layout,							//oldLayout
+			_layout,								//newLayout
+			VK_QUEUE_FAMILY_IGNORED,				//srcQueueFamilyIndex
+			VK_QUEUE_FAMILY_IGNORED,				//dstQueueFamilyIndex
+			_image.image,							//image
+			VkImageSubresourceRange { _image.aspect, mip, 1, 0, 1 }	//subresourceRange
+		});
+		state = SubresourceState{ _layout, _stages, _access };
+	}
+}
+
+void BarrierBatch::flush(VkCommandBuffer _commandBuffer)
+{
+	if (!barriers.empty())
+	{
+		//nothing used the images yet when every source state is fresh
+		VkPipelineStageFlags waitStages = srcStages != 0 ? srcStages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+		vkCmdPipelineBarrier(_commandBuffer, waitStages, dstStages, 0, 0, nullptr, 0, nullptr,
+			static_cast<uint32_t>(barriers.size()), barriers.data());
+		barriersRecorded += barriers.size();
+	}
+
+	barriers.clear();
+	pending.clear();
+	srcStages = 0;
+	dstStages = 0;
+}
+
+bool BarrierBatch::empty() const
+{
+	return barriers.empty();
+}
+
+uint64_t BarrierBatch::getBarriersRecorded() const
+{
+	return barriersRecorded;
+}
+
+uint64_t BarrierBatch::getTransitionsElided() const
+{
+	return transitionsElided;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+//Texel block dimensions and size of a block compressed format.
+struct BlockFormatInfo {
+	uint32_t blockWidth = 0;
+	uint32_t blockHeight = 0;
+	uint32_t bytesPerBlock = 0;		//0 if the format isn't block compressed
+};
+
+BlockFormatInfo getBlockFormatInfo(VkFormat _format);
+
+//Bytes of a _width x _height level of a block compressed format, partial blocks at the edges count as whole ones.
+VkDeviceSize getCompressedLevelSize(VkFormat _format, uint32_t _width, uint32_t _height);
+
+//RGBA8 format the CPU decoder turns _format into, VK_FORMAT_UNDEFINED when there is no decoder for it.
+//Covers BC1-BC5, BC4/BC5 SNORM decoding to R8G8B8A8_SNORM, and ETC2 RGB8/RGBA8. BC6H, BC7, ASTC and the remaining ETC2/EAC formats have to be sampled natively.
+VkFormat getDecodedFormat(VkFormat _format);
+
+//Decodes a whole level into tightly packed RGBA8, _format has to be one getDecodedFormat knows.
+void decodeBlocks(VkFormat _format, const uint8_t* _blocks, uint32_t _width, uint32_t _height, uint8_t* _rgba);
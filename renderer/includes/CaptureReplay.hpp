@@ -0,0 +1,94 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include <DynamicResolution.hpp>
+#include <FrameCapture.hpp>
+#include <TrackedImage.hpp>
+
+struct CaptureReplayConfig {
+	std::filesystem::path shaderDir;	//compiled shaders the captured pipelines are rebuilt from, res/shaders
+	std::string deviceName;				//part of the name of the device to replay on ("llvmpipe" for lavapipe), empty prefers a discrete GPU
+};
+
+//What loading a capture took, uploads are timed apart from creating the buffers.
+struct ReplayLoadStats {
+	uint32_t bufferCount = 0;
+	uint32_t pipelineCount = 0;
+	uint64_t uploadBytes = 0;
+	double uploadTime = 0.0;		//seconds from recording the copies to their fence
+	double pipelineTime = 0.0;		//seconds creating every pipeline, nothing is cached between loads
+};
+
+//One replay of a capture's pass.
+struct ReplayTiming {
+	double recordTime = 0.0;		//seconds recording the command buffer
+	double frameTime = 0.0;			//seconds from the start of recording to the fence
+	double gpuTime = 0.0;			//seconds between timestamps around the pass
+	bool gpuTimed = false;			//the queue has timestamps, gpuTime is valid
+};
+
+//Replays captures written by FrameCapture on a device without a surface. The pass renders into images of its own at
+//the captured extent and formats. Buffers and pipelines come from the capture's resource commands when it's loaded,
+//every replay then records the pass commands, submits them and waits, so replays don't overlap and time the frame
+//alone.
+class CaptureReplayer
+{
+private:
+	CaptureReplayConfig config;
+	const CaptureFile* capture = nullptr;
+
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	std::string deviceName;
+	uint32_t queueFamily = 0;
+	VkQueue queue = VK_NULL_HANDLE;
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkFence fence = VK_NULL_HANDLE;
+	GpuFrameTimer gpuTimer;
+	bool gpuTimed = false;
+
+	//owned by the loaded capture
+	VkExtent2D extent{ 0, 0 };
+	TrackedImage colorImage;
+	TrackedImage depthImage;
+	VkImageView colorView = VK_NULL_HANDLE;
+	VkImageView depthView = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	VkFramebuffer framebuffer = VK_NULL_HANDLE;
+	std::vector<VkBuffer> buffers;
+	std::vector<VkDeviceMemory> bufferMemory;
+	std::vector<VkDeviceSize> bufferSizes;
+	std::vector<VkPipelineLayout> pipelineLayouts;
+	std::vector<VkPipeline> pipelines;
+	uint32_t drawCount = 0;
+
+	void createTargets();
+	void createBuffers(ReplayLoadStats& _stats);
+	void createPipelines();
+	VkBuffer getBuffer(uint32_t _buffer, VkDeviceSize _end) const;
+	void record();
+	void submit();
+
+public:
+	//Throws when there's no device with a graphics queue matching the config.
+	void init(const CaptureReplayConfig& _config);
+	void destroy();
+
+	//Replaces whatever was loaded before. _capture stays mapped while it's loaded, its pass commands are read in place.
+	ReplayLoadStats load(const CaptureFile& _capture);
+	void unload();
+	ReplayTiming replay();
+
+	//Draws in one replay of the loaded pass.
+	uint32_t getDrawCount() const;
+	const std::string& getDeviceName() const;
+	VkDevice getDevice() const;
+	VkPhysicalDevice getPhysicalDevice() const;
+	//The graphics queue's family, for command pools of other users of the device.
+	uint32_t getQueueFamily() const;
+};
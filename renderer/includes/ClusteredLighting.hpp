@@ -0,0 +1,130 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <DynamicResolution.hpp>
+#include <PipelineStateCache.hpp>
+
+//Matches PointLight in light_cluster.comp and clustered.frag.
+struct PointLight {
+	glm::vec3 position;		//world space
+	float radius;			//no light reaches past it
+	glm::vec3 color;		//linear, premultiplied by intensity
+	float padding = 0.0f;
+};
+static_assert(sizeof(PointLight) == 32, "PointLight is read as a tightly packed std430 array");
+
+//The view volume cut into tilesX x tilesY screen tiles and slices along depth. Slices are even in depth buffer values,
+//which are linear in view depth for the engine's orthographic camera.
+struct ClusterGrid {
+	uint32_t tilesX = 32;
+	uint32_t tilesY = 18;
+	uint32_t slices = 32;
+
+	uint32_t count() const;
+	//World space box around cluster (_x, _y, _z), the way light_cluster.comp computes it.
+	void bounds(const glm::mat4& _inverseViewProjection, uint32_t _x, uint32_t _y, uint32_t _z, glm::vec3& _min,
+		glm::vec3& _max) const;
+	//Cluster a fragment at framebuffer position _pixel with depth buffer value _depth falls into, like clustered.frag.
+	uint32_t find(const glm::vec2& _pixel, float _depth, const glm::vec2& _extent) const;
+};
+
+//Closest point test, what a light has to pass to be listed for a cluster.
+bool sphereIntersectsBox(const glm::vec3& _center, float _radius, const glm::vec3& _min, const glm::vec3& _max);
+
+struct ClusteredLightingConfig {
+	std::filesystem::path shaderDir;		//res/shaders, holding light_cluster.spv
+	ClusterGrid grid;
+	uint32_t maxLights = 4096;				//per frame, lights beyond it are dropped
+	uint32_t maxClusterLights = 256;		//per cluster, at most 256, the nearest aren't favoured when it overflows
+	uint32_t averageClusterLights = 32;		//sizes the index list all clusters share
+	uint32_t framesInFlight = 1;			//frames whose lights the GPU may still read while the next frame writes
+	std::vector<uint32_t> queueFamilies;	//families binning lights and shading with them
+};
+
+//Matches the Counters block in light_cluster.comp.
+struct ClusterCounters {
+	uint32_t indexCount;		//light indices written by every cluster together
+	uint32_t overflowClusters;	//clusters that had more lights than fit into their list
+};
+
+struct ClusterStats {
+	uint64_t frames = 0;
+	uint64_t lights = 0;			//summed over all frames
+	uint64_t droppedLights = 0;		//set beyond maxLights
+	uint64_t binnedFrames = 0;		//frames whose counters were read back
+	uint64_t lightIndices = 0;		//summed over the frames read back
+	uint64_t overflowClusters = 0;
+	uint64_t gpuTimedFrames = 0;
+	double gpuBinTimeTotal = 0.0;	//seconds spent binning on the GPU
+};
+
+//Clustered forward lighting. Every frame a compute pass bins the frame's point lights into the clusters of
+//ClusterGrid: one workgroup per cluster tests all lights against the cluster's box, gathers the hits in shared memory
+//and reserves a compact range of the shared index list with a single atomic. Fragments then find their cluster from
+//their framebuffer position and depth and only loop over its lights, so shading cost follows how many lights overlap
+//a fragment rather than how many there are. Lights are written by the CPU into a host visible buffer holding
+//framesInFlight slices of maxLights, the cluster lists are rebuilt from scratch each frame.
+class ClusteredLighting
+{
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	ClusteredLightingConfig config;
+	uint32_t indexCapacity = 0;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;	//owned by the state cache, like the layout and pipeline
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> descriptorSets;	//one per slice of the light buffer
+
+	VkBuffer lightBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory lightMemory = VK_NULL_HANDLE;
+	PointLight* lightMapped = nullptr;
+	VkDeviceSize sliceSize = 0;		//maxLights rounded up to the storage buffer offset alignment
+
+	//device local, only touched by the binning pass and the fragment shader
+	VkBuffer clusterBuffer = VK_NULL_HANDLE;	//uvec2 per cluster: first index, light count
+	VkDeviceMemory clusterMemory = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+	VkBuffer counterBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory counterMemory = VK_NULL_HANDLE;
+
+	VkBuffer readbackBuffer = VK_NULL_HANDLE;	//host visible ClusterCounters, one per slice
+	VkDeviceMemory readbackMemory = VK_NULL_HANDLE;
+	ClusterCounters* readbackMapped = nullptr;
+	std::vector<bool> sliceRecorded;
+
+	GpuFrameTimer binTimer;
+	bool timed = false;
+
+	uint32_t frameSlot = 0;
+	uint32_t lightCount = 0;
+	glm::mat4 inverseViewProjection{ 1.0f };
+	ClusterStats stats;
+
+public:
+	//Returns false when the shader hasn't been compiled, nothing is created then.
+	bool init(VkDevice _device, VkPhysicalDevice _physicalDevice, PipelineStateCache& _states, const ClusteredLightingConfig& _config);
+	void destroy();
+
+	//Set 0 of every pipeline shading with the clusters, see clustered.frag.
+	VkDescriptorSetLayout getDescriptorSetLayout() const;
+	//Fragment push constants the shading pipelines have to leave room for, clustered.frag reads them at offset 32.
+	static uint32_t getPushConstantSize();
+
+	//Copies this frame's lights into the next slice. Only once the GPU finished the frame that used that slice, i.e.
+	//after waiting on its fence, which is also when the slice's counters are read back.
+	void beginFrame(const PointLight* _lights, uint32_t _count, const glm::mat4& _viewProjection);
+	//Bins the lights outside of a render pass, leaving the cluster lists readable by fragment shaders.
+	void recordBinning(VkCommandBuffer _commandBuffer);
+	//Binds set 0 and pushes the grid at _pushOffset of _layout for fragments rendered into _renderExtent.
+	void bind(VkCommandBuffer _commandBuffer, VkPipelineLayout _layout, uint32_t _pushOffset, VkExtent2D _renderExtent);
+
+	const ClusterGrid& getGrid() const;
+	const ClusterStats& getStats() const;
+};
@@ -0,0 +1,129 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+enum class UpscaleFilter {
+	Bilinear,
+	Sharpen		//contrast adaptive sharpening on top of the bilinear taps
+};
+
+const char* upscaleFilterName(UpscaleFilter _filter);
+
+struct DynamicResolutionConfig {
+	float minScale = 0.5f;				//per axis, of the output extent
+	float maxScale = 1.0f;				//above 1 renders more pixels than are shown
+	double frameBudget = 1.0 / 60.0;	//seconds of GPU time a frame may take
+};
+
+//_extent scaled per axis and rounded down to a multiple of 8 pixels, so tiny scale changes don't change the extent.
+//Never smaller than 8x8 (or _extent, if that's smaller).
+VkExtent2D scaledExtent(VkExtent2D _extent, float _scale);
+
+//Turns measured GPU frame times into a render scale. The cost of a frame is roughly proportional to its pixel count,
+//so the scale moves by the square root of budget over time. It drops as soon as the smoothed time goes over budget
+//and only grows again in small steps after a while below it, so one slow frame doesn't make the resolution oscillate.
+class ResolutionController
+{
+private:
+	DynamicResolutionConfig config;
+	float scale = 1.0f;
+	double averageTime = 0.0;		//rises quickly and falls slowly with the measured times
+	bool measured = false;
+	uint32_t cooldown = 0;			//frames left before the scale may grow
+	uint64_t changes = 0;
+
+public:
+	void init(const DynamicResolutionConfig& _config);
+
+	//Feeds the GPU time of one frame in seconds, returns true when the scale changed.
+	bool update(double _gpuTime);
+
+	float getScale() const;
+	double getAverageTime() const;
+	uint64_t getChanges() const;
+};
+
+//Two timestamps around a frame's graphics work. They are read back after the frame's fence, so reading never stalls.
+class GpuFrameTimer
+{
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkQueryPool queryPool = VK_NULL_HANDLE;
+	double nanosecondsPerTick = 1.0;
+	uint64_t validMask = ~0ull;
+	bool written = false;		//end() was recorded since the last read
+
+public:
+	//Returns false when _queueFamily doesn't support timestamps, nothing is created then.
+	bool init(VkDevice _device, VkPhysicalDevice _physicalDevice, uint32_t _queueFamily);
+	void destroy();
+
+	void begin(VkCommandBuffer _commandBuffer, VkPipelineStageFlagBits _stage);
+	void end(VkCommandBuffer _commandBuffer);
+
+	//Seconds between begin and end of the last finished frame, false if there's none yet.
+	bool read(double& _seconds);
+};
+
+struct UpscalerConfig {
+	std::filesystem::path shaderDir;		//res/shaders, holding fullscreen.spv and upscale.spv
+	VkFormat outputFormat = VK_FORMAT_UNDEFINED;
+	VkExtent2D outputExtent{ 0, 0 };
+	std::vector<VkImageView> outputViews;	//one framebuffer is created for each, this is output 0
+	VkExtent2D sourceExtent{ 0, 0 };		//what the source is allocated with, frames render into its top left part
+	UpscaleFilter filter = UpscaleFilter::Sharpen;
+	float sharpness = 0.5f;					//0 to 1, only used by Sharpen
+};
+
+//Stretches the rendered part of a scene target over a swapchain image with one fullscreen triangle. Further swapchains
+//of the output format can be added as outputs, they share the pipeline and differ only in framebuffers and extent.
+class Upscaler
+{
+private:
+	struct Output {
+		VkExtent2D extent{ 0, 0 };
+		std::vector<VkFramebuffer> framebuffers;
+	};
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	std::vector<Output> outputs;
+	VkExtent2D sourceExtent{ 0, 0 };
+	UpscaleFilter filter = UpscaleFilter::Sharpen;
+	float sharpness = 0.0f;
+
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;
+
+	void createRenderPass(VkFormat _format);
+	void createFramebuffers(Output& _output, VkExtent2D _extent, const std::vector<VkImageView>& _views);
+	void destroyFramebuffers(Output& _output);
+	void createDescriptors();
+	void createPipeline(const std::filesystem::path& _shaderDir);
+
+public:
+	//Returns false when the shaders haven't been compiled, nothing is created then.
+	bool init(VkDevice _device, const UpscalerConfig& _config);
+	void destroy();
+
+	//Another set of images in the output format, e.g. another window's swapchain. Returns the output to record into.
+	uint32_t addOutput(VkExtent2D _extent, const std::vector<VkImageView>& _views);
+	//Points _output at new images once its swapchain was recreated. The old framebuffers go right away, so nothing
+	//recorded into them may still be pending.
+	void setOutput(uint32_t _output, VkExtent2D _extent, const std::vector<VkImageView>& _views);
+	//The image the scene renders into, sampled in SHADER_READ_ONLY. Set before the first record(), the scene target is
+	//a frame graph transient and only exists once the graph was compiled. Nothing recorded may still be pending.
+	void setSource(VkImageView _sourceView);
+
+	//Upscales _renderExtent of the source into image _imageIndex of _output, which has to be in
+	//COLOR_ATTACHMENT_OPTIMAL. Every output pixel is written, the previous contents are discarded.
+	void record(VkCommandBuffer _commandBuffer, uint32_t _output, uint32_t _imageIndex, VkExtent2D _renderExtent);
+
+	UpscaleFilter getFilter() const;
+};
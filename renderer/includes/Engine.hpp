@@ -2,9 +2,37 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <vector>
+#include <map>
 #include <optional>
 #include <string>
 #include <filesystem>
+#include <atomic>
+#include <chrono>
+#include <exception>
+
+#include <TripleBuffer.hpp>
+#include <SceneSnapshot.hpp>
+#include <JobSystem.hpp>
+#include <Scene.hpp>
+#include <RenderGraph.hpp>
+#include <TextureStreaming.hpp>
+#include <TextureLoader.hpp>
+#include <MeshLibrary.hpp>
+#include <MeshletRenderer.hpp>
+#include <OcclusionCulling.hpp>
+#include <LodSelection.hpp>
+#include <DynamicResolution.hpp>
+#include <FramePacer.hpp>
+#include <StartupGraph.hpp>
+#include <PipelineStateCache.hpp>
+#include <PipelineCompiler.hpp>
+#include <InstanceRenderer.hpp>
+#include <ParticleSystem.hpp>
+#include <ClusteredLighting.hpp>
+#include <FrameCapture.hpp>
+#include <PushConstants.hpp>
+#include <OutputTarget.hpp>
+#include <TrackedImage.hpp>
 
 
 const uint32_t WIDTH = 800;
@@ -16,13 +44,112 @@ const bool enableValidationLayers = true;
 const bool enableValidationLayers = false;
 #endif // If in release mode, no validation layers are to be used.
 
+struct EngineConfig {
+	double updateRate = 60.0;	//simulation steps per second
+	double renderRate = 0.0;	//frames per second, 0 lets presentation decide
+	bool asyncCompute = true;	//run compute on a dedicated queue family when the device has one, otherwise on the graphics queue
+	uint32_t textureBudgetMiB = 0;	//cap for streamed textures, 0 derives it from the device's memory budget
+	bool meshlets = true;		//cull and draw meshlets instead of whole meshes when GPU culling is available
+	bool meshShaders = true;	//use VK_EXT_mesh_shader for meshlets when the device has it, otherwise expand them in compute
+	bool occlusionCulling = true;	//two phase Hi-Z occlusion culling on top of GPU frustum culling
+	float lodPixelError = 1.0f;		//objects draw the coarsest level of detail whose error stays below this many pixels
+	bool dynamicResolution = true;	//scale the render resolution to keep GPU frame time within budget, then upscale
+	float minRenderScale = 0.5f;	//per axis, of the swapchain extent
+	float maxRenderScale = 1.0f;
+	double gpuFrameBudgetMs = 0.0;	//0 derives it from the render rate, or from 60 Hz when uncapped
+	UpscaleFilter upscaleFilter = UpscaleFilter::Sharpen;
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;	//falls back to FIFO when the surface doesn't support it
+	uint32_t swapchainImageCount = 0;	//0 takes one more than the surface minimum, clamped to what the surface allows
+	uint32_t maxQueuedFrames = 1;	//presents waiting for the display at once, needs VK_KHR_present_wait, 0 doesn't limit
+	double pacerSpinMs = 1.0;		//the end of every pacing wait is spun rather than slept, 0 only sleeps
+	bool startupReport = false;		//print how long each startup stage took once the first frame is presented
+	bool pipelineLibraries = true;	//link pipelines from VK_EXT_graphics_pipeline_library parts when the device has it, otherwise compile them in the background
+	uint32_t markerCount = 0;		//instanced markers drawn over the scene
+	bool instancing = true;			//draw the markers with one draw per mesh and material, otherwise with one draw each
+	uint32_t particleCount = 0;		//GPU particle capacity, 0 disables particles
+	bool particleSort = true;		//sort particles back to front and alpha blend them, otherwise add them up unsorted
+	uint32_t lightCount = 0;		//moving point lights shaded with clustered forward lighting, 0 leaves the scene unlit
+	std::filesystem::path capturePath;	//write the main pass of frame captureFrame there for renderer_replay, empty doesn't capture
+	uint32_t captureFrame = 100;	//late enough for pipelines, textures and resolution to have settled
+	uint32_t windowCount = 1;		//windows showing the scene, one per monitor while there are enough. The ones past the first need dynamic resolution's scene target
+};
+
+//Written by the update and render threads while running, only read it once run() has returned.
+struct EngineStats {
+	uint64_t simulationSteps = 0;
+	uint64_t framesRendered = 0;
+	uint64_t staleFrames = 0;		//frames rendered without a new snapshot since the previous one
+	double snapshotCopyTotal = 0.0;	//seconds spent copying simulation state into snapshots
+	double snapshotCopyMax = 0.0;
+
+	//Summed over all frames. Counted by the culling shaders when culling on the GPU, read back a frame later.
+	uint64_t objectsSubmitted = 0;		//objects handed to culling
+	uint64_t objectsFrustumCulled = 0;
+	uint64_t objectsOcclusionCulled = 0;	//inside the frustum but hidden behind what was drawn in the early phase
+	uint64_t lodTriangles = 0;			//triangles of the levels picked for the objects handed to culling
+	uint64_t fullDetailTriangles = 0;	//what the same objects would have cost at full detail
+
+	//Only with dynamic resolution
+	double renderScaleTotal = 0.0;		//summed over all frames
+	float renderScaleMin = 0.0f;
+	double gpuTimeTotal = 0.0;			//seconds, over the frames that had a timestamp read back
+	uint64_t gpuTimedFrames = 0;
+
+	//Only with more than one window
+	uint64_t outputPresentsFailed = 0;	//frames a further window sat out, plus presents to them that didn't succeed
+};
+
+//Matches the push constant block in mesh.vert, the lit fragment shader's block starts behind it
+struct MeshPushConstants {
+	float positionOffset[4];
+	float positionScale[4];
+};
+using MeshConstantBlock = PushConstantBlock<MeshPushConstants, VK_SHADER_STAGE_VERTEX_BIT>;
+
 class Engine
 {
 private:
+	EngineConfig config;
+	EngineStats stats;
+	JobSystem jobs;
+
+	//Simulation state, owned by the update thread
+	uint64_t simulationTick = 0;
+	double simulationTime = 0.0;
+	Frustum cameraFrustum;
+	glm::vec4 cameraPosition;
+	glm::mat4 cameraViewProjection;
+	Scene scene;
+	Entity meshObject = InvalidEntity;
+
+	//Render thread scratch
+	std::vector<uint32_t> visibleObjects;
+	std::vector<VkSemaphore> frameWaitSemaphores;
+	std::vector<VkPipelineStageFlags> frameWaitStages;
+	std::vector<VkSwapchainKHR> frameSwapchains;
+	std::vector<uint32_t> frameImageIndices;
+	std::vector<uint32_t> framePresentOutputs;		//the output behind each further swapchain presented this frame
+	std::vector<uint64_t> framePresentIds;
+	std::vector<VkResult> framePresentResults;
+
+	TripleBuffer<SceneSnapshot> sceneSnapshots;
+	std::atomic<bool> running{ false };
+	std::exception_ptr updateError;
+	std::exception_ptr renderError;
+	std::atomic<std::chrono::steady_clock::rep> lastInputPoll{ 0 };	//time since the clock's epoch, written by the main thread
+
+	//Startup runs as a graph of stages, see initialize()
+	StartupGraph startup;
+	size_t preloadedShaders = 0;
+	std::atomic<bool> firstFramePresented{ false };
+	double timeToFirstFrame = 0.0;		//seconds from the start of startup, written by the render thread before the flag
+
 	GLFWwindow* window;
 	VkInstance instance;
 	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
 	VkDevice device;
+	bool physicalDeviceProperties2 = false;		//VK_KHR_get_physical_device_properties2 is enabled on the instance
+	uint32_t instanceApiVersion = VK_API_VERSION_1_0;
 
 	VkSurfaceKHR surface;
 
@@ -31,16 +158,64 @@ private:
 	std::vector<VkImageView> swapchainImageViews;
 	VkFormat swapchainImageFormat;
 	VkExtent2D swapchainImageExtent;
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+	//Frame pacing: the render thread starts frames when the pacer lets it, presents carry ids with VK_KHR_present_wait
+	bool presentWait = false;		//VK_KHR_present_id and VK_KHR_present_wait are enabled
+	PFN_vkWaitForPresentKHR waitForPresent = nullptr;
+	FramePacer pacer;
 
-	std::vector<VkFramebuffer> swapchainFramebuffers;
+	std::vector<VkFramebuffer> swapchainFramebuffers;	//only without dynamic resolution
+
+	//Further windows show the same frame: the scene target is upscaled into each of their swapchains in the frame's
+	//command buffer, one submit waits for all of their images and one present shows them. Output i is the upscaler's
+	//output i + 1, the main window is its output 0.
+	std::vector<OutputTarget> outputs;
+	std::vector<RenderResource> outputBackbuffers;
+
+	//Dynamic resolution: the scene renders into the top left renderExtent of sceneTarget, picked from GPU frame times,
+	//and is upscaled into the swapchain image. Without it the scene renders into the swapchain image directly.
+	bool dynamicResolution = false;
+	VkFramebuffer sceneFramebuffer = VK_NULL_HANDLE;
+	VkExtent2D sceneExtent{ 0, 0 };		//what the scene color and depth transients are allocated with, the largest scale
+	VkExtent2D renderExtent{ 0, 0 };	//what this frame renders
+	ResolutionController resolution;
+	GpuFrameTimer frameTimer;
+	Upscaler upscaler;
 
 	VkQueue graphicsQueue;
 	VkQueue presentQueue;
+	VkQueue computeQueue;		//graphicsQueue when there is no async compute family (or it's disabled)
+	uint32_t computeFamily = 0;
+	bool asyncCompute = false;
+
+	//Depth is reversed (cleared to 0, nearer is larger), which keeps float precision where the distance is large
+	VkFormat depthFormat;			//depth itself is a frame graph transient
+
+	//Kept between runs in the executable's directory, loaded while the device is still being created
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+	std::vector<char> pipelineCacheData;	//what was loaded, until the cache is created from it
+	size_t pipelineCacheLoadedBytes = 0;
+	//Owns the render passes, layouts, modules and pipelines below, nothing here destroys them on its own
+	PipelineStateCache stateCache;
+	//Pipelines needed after startup come from here, so creating one never stalls a frame
+	PipelineCompiler pipelineCompiler;
+	bool pipelineLibraries = false;	//VK_KHR_pipeline_library and VK_EXT_graphics_pipeline_library are enabled
 
 	VkRenderPass renderPass;
+	VkRenderPass loadRenderPass;	//compatible with renderPass, but keeps color and depth for the late occlusion phase
 	VkPipelineLayout pipelineLayout;
+	MeshConstantBlock meshConstants;
 
-	VkPipeline graphicsPipeline;
+	//Barriers and layout transitions between passes come from here, the render pass itself has no external dependencies
+	RenderGraph frameGraph;
+	RenderResource backbuffer = InvalidRenderResource;
+	//Depth and the offscreen scene color only live within a frame, so they're transients the graph allocates and aliases
+	RenderResource depthBuffer = InvalidRenderResource;
+	RenderResource sceneTarget = InvalidRenderResource;	//the backbuffer itself without dynamic resolution
+	uint32_t currentImageIndex = 0;
+
+	const CompiledPipeline* meshPipeline = nullptr;	//fast linked at first with pipeline libraries, optimized later
 
 	VkCommandPool commandPool;
 	VkCommandBuffer commandBuffer;
@@ -49,6 +224,96 @@ private:
 	VkSemaphore renderFinishedSemaphore;
 	VkFence inFlightFence;
 
+	//GPU culling: a compute pass writes one indirect draw per object, the graphics pass consumes them.
+	//Falls back to culling on the CPU when the device can't draw indirect with per-draw first instances.
+	static constexpr uint32_t MaxGpuObjects = 65535;	//smallest maxDrawIndirectCount allowed with multiDrawIndirect
+	bool gpuCulling = false;
+	uint32_t gpuObjectCount = 0;
+	VkCommandPool computeCommandPool = VK_NULL_HANDLE;
+	VkCommandBuffer computeCommandBuffer = VK_NULL_HANDLE;
+	VkSemaphore computeFinishedSemaphore = VK_NULL_HANDLE;
+	VkDescriptorSetLayout cullDescriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout cullPipelineLayout = VK_NULL_HANDLE;
+	VkPipeline cullPipeline = VK_NULL_HANDLE;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet cullDescriptorSet = VK_NULL_HANDLE;
+	VkBuffer objectBoundsBuffer = VK_NULL_HANDLE;		//host visible, rewritten every frame
+	VkDeviceMemory objectBoundsMemory = VK_NULL_HANDLE;
+	void* objectBoundsMapped = nullptr;
+	VkBuffer objectLodBuffer = VK_NULL_HANDLE;			//index and meshlet range of each object's level, like the bounds
+	VkDeviceMemory objectLodMemory = VK_NULL_HANDLE;
+	void* objectLodMapped = nullptr;
+	VkBuffer drawCommandBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory drawCommandMemory = VK_NULL_HANDLE;
+
+	//Meshlet culling replaces the per object draws when GPU culling is available, through mesh shaders if the device
+	//has VK_EXT_mesh_shader and through compute expanded indirect draws if not
+	bool meshShading = false;		//VK_EXT_mesh_shader is enabled
+	VkPhysicalDeviceMeshShaderPropertiesEXT meshShaderProperties{};
+	PFN_vkCmdDrawMeshTasksEXT drawMeshTasks = nullptr;
+	bool meshletCulling = false;
+	MeshletRenderer meshletRenderer;
+
+	//Two phase occlusion culling: what was visible last frame is drawn first, a Hi-Z pyramid is built from that depth
+	//and everything else is tested against it and drawn on top. Needs GPU culling, all culling shaders bind its state.
+	bool occlusionCulling = false;
+	OcclusionCuller occlusion;
+	Frustum frameFrustum;	//what this frame culls against, the late phase is recorded from the frame graph
+
+	//Texture memory is kept within budget by streaming mips in and out
+	TextureStreamer textures;
+	TextureFormatSupport textureFormats;
+	TextureLoader textureLoader;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;	//only loaded with VK_EXT_memory_budget
+	//Without clustered lighting the mesh pipeline samples the first texture in res/textures, its mips are requested
+	//by how large the visible objects get on screen
+	bool sceneTextured = false;
+	TextureHandle sceneTexture = InvalidTexture;
+	VkDescriptorSetLayout sceneTextureSetLayout = VK_NULL_HANDLE;	//owned by stateCache, like the sampler
+	VkSampler sceneTextureSampler = VK_NULL_HANDLE;
+	VkDescriptorPool sceneTexturePool = VK_NULL_HANDLE;
+	VkDescriptorSet sceneTextureSet = VK_NULL_HANDLE;
+	VkImageView sceneTextureView = VK_NULL_HANDLE;	//what sceneTextureSet points at, residency changes replace the view
+	std::vector<uint32_t> textureDemandVisible;		//reused every frame
+
+	//Cooked meshes from res/meshes, every object draws sceneMesh for now
+	MeshLibrary meshes;
+	MeshHandle sceneMesh = 0;
+
+	//Levels of detail are picked on the render thread before culling, culling only decides whether they're drawn
+	LodSelectionConfig lodConfig;
+	LodSelector lodSelector;
+
+	//Markers go through the instancing path: grouped by mesh and material and drawn in the main pass on top of the scene
+	bool instanceRendering = false;	//the instance renderer was created, it needs instanced.spv
+	InstanceRenderer instances;
+	InstanceMaterial markerMaterials[2] = {};
+	glm::mat4 frameViewProjection{ 1.0f };	//what instances and particles are drawn with
+
+	//Particles are emitted, simulated and sorted in compute before the main pass, which draws them last
+	bool particleRendering = false;	//the particle system was created, it needs the particle shaders
+	ParticleSystem particles;
+	double particleTime = 0.0;		//simulation time the particles were last advanced to
+
+	//Lights are binned into clusters in compute before the main pass, whose fragment shader then shades with them.
+	//Only the vertex pipeline is lit, the mesh shader path keeps the unlit fragment shader.
+	bool clusteredLighting = false;	//set before the mesh pipeline is created, which picks its fragment shader by it
+	ClusteredLighting lighting;
+	std::vector<PointLight> frameLights;
+	GpuFrameTimer shadingTimer;		//around the main passes, to compare light counts
+	bool shadingTimed = false;
+	double shadingTimeTotal = 0.0;
+	uint64_t shadingTimedFrames = 0;
+
+	//Frame capture: the scene mesh is recorded when it's created, the main pass of one frame when it's recorded, and
+	//the capture is written once that frame was submitted
+	FrameCapture capture;
+	uint32_t captureVertexBuffer = 0;
+	uint32_t captureIndexBuffer = 0;
+	CapturePipelineKey meshPipelineKey{};
+	bool capturingFrame = false;
+	bool captureWritten = false;
+
 	VkDebugUtilsMessengerEXT debugMessenger;
 
 	const std::vector<const char*> ValidationLayers = {
@@ -63,6 +328,7 @@ private:
 		//The Physical Device may not support all Queue Families.
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		std::optional<uint32_t> computeFamily;	//compute without graphics, i.e. a queue that can run alongside graphics
 
 		bool isComplete()
 		{
@@ -70,18 +336,33 @@ private:
 		}
 	};
 
+	struct DeviceMemoryInfo {
+		std::vector<VkMemoryHeap> heaps;
+		VkDeviceSize deviceLocalBytes = 0;	//size of the largest device local heap
+		bool memoryBudget = false;			//VK_EXT_memory_budget is supported
+	};
+	DeviceMemoryInfo memoryInfo;
+
 	struct SwapchainSupportDetails {
 		VkSurfaceCapabilitiesKHR capabilities;
 		std::vector<VkSurfaceFormatKHR> formats;
 		std::vector<VkPresentModeKHR> presentModes;
 	};
 
+	//Enumerations that are asked for repeatedly, per physical device. Filled while picking the device and only read
+	//afterwards, so the startup stages running in parallel can use them.
+	std::map<VkPhysicalDevice, QueueFamilyIndices> queueFamilyCache;
+	std::map<VkPhysicalDevice, std::vector<VkExtensionProperties>> deviceExtensionCache;
+
 public:
+	Engine(const EngineConfig& _config = EngineConfig{});
+
 	void run();
+	const EngineStats& getStats() const;
 
 private:
+	void initialize();
 	void initWindow();
-	void initVulkan();
 	void mainLoop();
 	void cleanUp();
 
@@ -89,27 +370,71 @@ private:
 	void pickPhysicalDevice();
 	void createLogicalDevice();
 	void createSurface();
+	void loadPipelineCacheData();
+	void createPipelineCache();
+	void savePipelineCache();
 	void createSwapchain();
+	void createSceneTarget();
+	void createOutputs();
+	void createFramePacer();
+	void createDepthResources();
 	void createRenderPass();
 	void createGraphicsPipeline();
+	void createComputePipeline();
 	void createFramebuffers();
 	void createCommandPool();
 	void createCommandBuffer();
 	void createSyncObjects();
+	void createComputeResources();
+	void createTextureStreamer();
+	void createMeshes();
+	void createOcclusionCuller();
+	void createMeshletRenderer();
+	void createFrameGraph();
+	void createInstanceRenderer();
+	void createParticleSystem();
+	void createClusteredLighting();
+
+	void updateLoop();
+	void renderLoop();
+	void updateSimulation(double _deltaTime);
+	void writeSnapshot(SceneSnapshot& _snapshot);
+	void printStats();
+	void printStartupReport();
 
-	void drawFrame();
+	void drawFrame(const SceneSnapshot& _snapshot);
+	void selectLods(const SceneSnapshot& _snapshot);
+	void requestSceneTexture(const SceneSnapshot& _snapshot);
+	void updateSceneTextureSet();
+	void updateMarkers(const SceneSnapshot& _snapshot);
 
 	void recordCommandBuffer(VkCommandBuffer _commandBuffer, uint32_t _imageIndex);
+	void uploadObjectBounds(const SceneSnapshot& _snapshot);
+	void recordComputeCommandBuffer(VkCommandBuffer _commandBuffer, const SceneSnapshot& _snapshot);
+	void recordCulling(VkCommandBuffer _commandBuffer, const Frustum& _frustum, CullPhase _phase);
+	void recordLateCulling(VkCommandBuffer _commandBuffer);
+	void recordMainPass(VkCommandBuffer _commandBuffer, CullPhase _phase);
+	void recordOverlays(VkCommandBuffer _commandBuffer, CullPhase _phase);
+	void captureMainPass(CullPhase _phase);
+	void updateLights(const SceneSnapshot& _snapshot);
 
 	std::vector<const char*> getRequiredInstanceExtensions();
 
 	int rateDeviceSuitability(VkPhysicalDevice _device);
 	bool checkDeviceExtensionSupport(VkPhysicalDevice _device);
+	const std::vector<VkExtensionProperties>& getDeviceExtensions(VkPhysicalDevice _device);
+	bool hasDeviceExtension(VkPhysicalDevice _device, const char* _extension);
+	DeviceMemoryInfo queryDeviceMemoryInfo(VkPhysicalDevice _device);
+	bool checkMeshShaderSupport(VkPhysicalDevice _device);
+	bool checkPresentWaitSupport(VkPhysicalDevice _device);
+	bool checkPipelineLibrarySupport(VkPhysicalDevice _device);
 	QueueFamilyIndices queryQueueFamilyIndices(VkPhysicalDevice _device);
 	SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice _device);
+	std::vector<uint32_t> getSharedQueueFamilies();
 
+	VkFormat findDepthFormat();
 	VkSurfaceFormatKHR chooseSwapSurfaceFormat(std::vector<VkSurfaceFormatKHR> _surfaceFormats);
-	VkPresentModeKHR choostSwapPresentMode(std::vector<VkPresentModeKHR> _presentModes);
+	VkPresentModeKHR chooseSwapPresentMode(std::vector<VkPresentModeKHR> _presentModes);
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR _capabilities);
 
 	bool checkValidationLayerSupport();
@@ -0,0 +1,138 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <vector>
+
+//A captured frame (.vkcap): the buffers the frame's main pass reads, their contents, the pipelines it binds and its
+//draw list, reduced to what a replay needs to issue the same work on another machine. Every section starts at a 16
+//byte aligned offset from the start of the file and records have a fixed size, so a mapped file is used in place.
+//Layout: CaptureHeader, CaptureCommand[commandCount], CapturePipelineKey[pipelineCount], data.
+constexpr char CaptureMagic[4] = { 'V', 'K', 'C', 'P' };
+constexpr uint32_t CaptureVersion = 1;
+
+//Arguments are uint32 words, 64 bit values take a low and a high word. Data offsets point into the data section.
+enum class CaptureOp : uint32_t {
+	CreateBuffer,		//buffer, usage, size lo, size hi
+	UploadBuffer,		//buffer, offset lo, offset hi, data lo, data hi, size
+	BeginPass,			//clear color as four float bit patterns, clear depth bit pattern
+	EndPass,
+	BindPipeline,		//pipeline key index
+	BindVertexBuffer,	//buffer, offset lo, offset hi
+	BindIndexBuffer,	//buffer, offset lo, offset hi, VkIndexType
+	PushConstants,		//stages, offset, size, data lo, data hi
+	DrawIndexed,		//indexCount, instanceCount, firstIndex, vertexOffset, firstInstance
+	Draw,				//vertexCount, instanceCount, firstVertex, firstInstance
+	OpCount
+};
+
+struct CaptureCommand {
+	CaptureOp op;
+	uint32_t args[7];
+};
+static_assert(sizeof(CaptureCommand) == 32, "CaptureCommand is read in place from mapped captures");
+
+//Enough of a graphics pipeline to build it again from the shaders in res/shaders, which a replay finds by name.
+//stateHash is what the PipelineStateCache filed the live pipeline under, so equal hashes mean equal pipelines.
+struct CapturePipelineKey {
+	char vertexShader[32];		//.spv file name, zero terminated
+	char fragmentShader[32];
+	uint64_t stateHash;
+	uint32_t vertexStride;		//binding 0 is a PackedVertex stream when it's sizeof(PackedVertex), there's none for 0
+	uint32_t cullMode;
+	uint32_t frontFace;
+	uint32_t depthCompareOp;
+	uint32_t depthWrite;
+	uint32_t blendEnable;		//alpha blending
+	uint32_t pushConstantStages;
+	uint32_t pushConstantSize;	//one range from offset 0
+	uint32_t setLayoutCount;	//descriptor sets the live pipeline used, a replay has nothing to bind to them
+	uint32_t padding;
+};
+static_assert(sizeof(CapturePipelineKey) % 16 == 0, "CapturePipelineKey keeps the sections after it aligned");
+
+struct CaptureHeader {
+	char magic[4];
+	uint32_t version;
+	uint32_t width;				//extent the pass rendered at
+	uint32_t height;
+	uint32_t colorFormat;		//VkFormat
+	uint32_t depthFormat;
+	uint32_t commandCount;
+	uint32_t pipelineCount;
+	uint64_t commandOffset;
+	uint64_t pipelineOffset;
+	uint64_t dataOffset;
+	uint64_t dataSize;
+	uint64_t frame;				//frames the engine had rendered before this one
+	uint64_t reserved;
+};
+static_assert(sizeof(CaptureHeader) % 16 == 0, "CaptureHeader keeps the sections after it aligned");
+
+//Records a capture. Resources are recorded when the engine creates them, the pass when it records the captured frame,
+//so the commands come out in the order a replay has to run them in.
+class FrameCapture
+{
+private:
+	std::vector<CaptureCommand> commands;
+	std::vector<CapturePipelineKey> pipelines;
+	std::vector<uint8_t> data;
+	uint32_t bufferCount = 0;
+
+	void push(CaptureOp _op, std::initializer_list<uint32_t> _args);
+	uint64_t addData(const void* _data, size_t _size);
+
+public:
+	uint32_t createBuffer(VkBufferUsageFlags _usage, VkDeviceSize _size);
+	void uploadBuffer(uint32_t _buffer, VkDeviceSize _offset, const void* _data, size_t _size);
+
+	void beginPass(const float _clearColor[4], float _clearDepth);
+	void endPass();
+	//Keys are stored once, every bind of an equal one refers to the same record.
+	void bindPipeline(const CapturePipelineKey& _key);
+	void bindVertexBuffer(uint32_t _buffer, VkDeviceSize _offset);
+	void bindIndexBuffer(uint32_t _buffer, VkDeviceSize _offset, VkIndexType _indexType);
+	void pushConstants(VkShaderStageFlags _stages, uint32_t _offset, uint32_t _size, const void* _values);
+	void drawIndexed(uint32_t _indexCount, uint32_t _instanceCount, uint32_t _firstIndex, int32_t _vertexOffset, uint32_t _firstInstance);
+	void draw(uint32_t _vertexCount, uint32_t _instanceCount, uint32_t _firstVertex, uint32_t _firstInstance);
+
+	void write(const std::filesystem::path& _path, VkExtent2D _extent, VkFormat _colorFormat, VkFormat _depthFormat,
+		uint64_t _frame) const;
+	size_t getCommandCount() const;
+};
+
+//A capture file mapped read only. Opening checks the header and that every section lies within the file, commands
+//check their own data ranges through getData().
+class CaptureFile
+{
+private:
+	const uint8_t* bytes = nullptr;
+	size_t size = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#endif
+
+	void close();
+
+public:
+	CaptureFile() = default;
+	CaptureFile(const CaptureFile&) = delete;
+	CaptureFile& operator=(const CaptureFile&) = delete;
+	~CaptureFile();
+
+	void open(const std::filesystem::path& _path);
+
+	const CaptureHeader& getHeader() const;
+	const CaptureCommand* getCommands() const;
+	const CapturePipelineKey* getPipelines() const;
+	//_size bytes at _offset into the data section, throws when they reach past it.
+	const uint8_t* getData(uint64_t _offset, uint64_t _size) const;
+};
+
+inline uint64_t joinWords(uint32_t _low, uint32_t _high)
+{
+	return static_cast<uint64_t>(_high) << 32 | _low;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+const char* presentModeName(VkPresentModeKHR _mode);
+
+struct FramePacerConfig {
+	uint32_t maxQueuedFrames = 1;	//presents that may wait for the display at once, 0 leaves that to the swapchain
+	double frameInterval = 0.0;		//seconds between frame starts, 0 doesn't cap the frame rate
+	double spinTime = 0.001;		//the end of every wait is spun instead of slept, sleeps overshoot by a scheduler tick
+};
+
+//Seconds, summed over all frames.
+struct FramePacingStats {
+	uint64_t presents = 0;
+	double inputToPresentTotal = 0.0;	//from the input poll a frame's snapshot saw to its vkQueuePresentKHR returning
+	double inputToPresentMax = 0.0;
+	uint64_t framesDisplayed = 0;		//presents the display was waited on, only with VK_KHR_present_wait
+	double inputToDisplayTotal = 0.0;
+	double inputToDisplayMax = 0.0;
+	double waitTotal = 0.0;				//slept or spun by the render thread before starting frames
+};
+
+//Decides when the render thread starts a frame. Caps the frame rate and, with VK_KHR_present_wait, waits until at
+//most maxQueuedFrames - 1 presents are still waiting for the display, since every queued present makes the next frame
+//show older input. Without present wait only the swapchain image count limits how many frames queue up.
+class FramePacer
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	FramePacerConfig config;
+	VkDevice device = VK_NULL_HANDLE;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	PFN_vkWaitForPresentKHR waitForPresent = nullptr;	//null without VK_KHR_present_wait
+	uint64_t presentId = 0;			//of the last present, ids start at 1
+	uint64_t displayedId = 0;		//last present the display was waited on
+	std::vector<Clock::time_point> inputTimes;		//ring indexed by present id, for the presents still queued
+	Clock::time_point nextFrame;
+	bool started = false;
+	FramePacingStats stats;
+
+	//Sleeps until shortly before _deadline and spins the rest.
+	void waitUntil(Clock::time_point _deadline);
+
+public:
+	//_waitForPresent may be null, only the frame rate is paced then.
+	void init(VkDevice _device, VkSwapchainKHR _swapchain, PFN_vkWaitForPresentKHR _waitForPresent,
+		const FramePacerConfig& _config);
+
+	//Blocks until the next frame may start. Call it before taking the input and simulation state the frame shows.
+	void waitForFrameStart();
+
+	//Id to chain into the next present with VkPresentIdKHR, 0 when presents aren't waited on.
+	uint64_t nextPresentId() const;
+	//Call right after vkQueuePresentKHR, with the time of the input poll the presented frame saw.
+	void presented(Clock::time_point _inputTime);
+
+	bool limitsQueue() const;
+	const FramePacingStats& getStats() const;
+};
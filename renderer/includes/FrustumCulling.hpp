@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+//Bounding spheres stored as structure-of-arrays so the SIMD kernels can load 4 or 8 objects per instruction.
+//Arrays are padded to a multiple of SimdWidth with spheres that can never be visible.
+struct BoundingSpheres {
+	static constexpr size_t SimdWidth = 8;
+
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	void resize(size_t _count);
+	void set(size_t _index, float _x, float _y, float _z, float _radius);
+
+	size_t size() const;
+	size_t paddedSize() const;
+
+private:
+	size_t count = 0;
+};
+
+//Six normalized planes (xyz = inward normal, w = distance), in the order left, right, bottom, top, near, far.
+struct Frustum {
+	float planes[6][4] = {};
+
+	//Extracts the planes from a column-major view-projection matrix with Vulkan's [0, 1] clip depth.
+	static Frustum fromViewProjection(const float* _matrix);
+};
+
+enum class CullingPath {
+	Scalar,
+	SSE2,
+	AVX2
+};
+
+//Widest kernel the current CPU supports.
+CullingPath bestCullingPath();
+const char* cullingPathName(CullingPath _path);
+
+//Writes the indices of every sphere that intersects the frustum into _visible, in increasing order.
+void cullSpheres(const BoundingSpheres& _spheres, const Frustum& _frustum, std::vector<uint32_t>& _visible);
+void cullSpheres(const BoundingSpheres& _spheres, const Frustum& _frustum, std::vector<uint32_t>& _visible, CullingPath _path);
+
+//Same as above into caller-owned storage of at least cullingOutputCapacity() elements. Returns the visible count.
+//Paths the CPU doesn't support fall back to the best one it does.
+uint32_t cullSpheres(const BoundingSpheres& _spheres, const Frustum& _frustum, uint32_t* _visible, CullingPath _path);
+size_t cullingOutputCapacity(const BoundingSpheres& _spheres);
@@ -0,0 +1,62 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+using InstanceMaterial = uint32_t;
+
+//One instance the way the instanced vertex shader reads it from its per instance binding, see instanced.vert.
+struct InstanceData {
+	glm::vec4 transform[3];		//rows of the affine world transform, the fourth row is always 0 0 0 1
+	uint32_t color = 0xffffffff;	//RGBA8, red in the lowest byte
+	float custom[3] = {};		//passed through for materials with shaders of their own
+};
+static_assert(sizeof(InstanceData) == 64, "InstanceData is read as a tightly packed vertex stream");
+
+//Every instance of one mesh and material, drawn with a single call.
+struct InstanceGroup {
+	uint32_t mesh;				//MeshHandle
+	InstanceMaterial material;
+	uint32_t firstInstance;		//into the packed instances
+	uint32_t instanceCount;
+};
+
+//Collects instances by mesh and material and packs them so each pair is one contiguous range. Instances can be added
+//in any order, finding a pair's run is two array lookups, and allocate() hands out room for a whole run at once so
+//several threads can fill their own runs. Nothing is freed by clear(), a frame with the same pairs as the one before
+//doesn't allocate.
+class InstanceBatcher
+{
+private:
+	struct Bucket {
+		uint32_t mesh;
+		InstanceMaterial material;
+		std::vector<InstanceData> instances;
+	};
+
+	std::vector<Bucket> buckets;
+	//material, then mesh -> bucket + 1, 0 for none. Mesh handles and materials are both dense indices.
+	std::vector<std::vector<uint32_t>> bucketIndex;
+	size_t instanceCount = 0;
+
+	std::vector<uint32_t> order;	//scratch for pack()
+	std::vector<InstanceGroup> groups;
+
+	Bucket& findBucket(uint32_t _mesh, InstanceMaterial _material);
+
+public:
+	void clear();
+
+	void add(uint32_t _mesh, InstanceMaterial _material, const InstanceData& _instance);
+	//Room for _count instances of the pair, to be written by the caller before pack(). Valid until the next add,
+	//allocate or clear, so allocate every run first and fill them afterwards.
+	InstanceData* allocate(uint32_t _mesh, InstanceMaterial _material, uint32_t _count);
+
+	//Copies every instance into _destination, grouped by material and then by mesh so draws change pipelines as
+	//little as possible. Instances beyond _capacity are left out. The groups stay valid until the next pack().
+	const std::vector<InstanceGroup>& pack(InstanceData* _destination, size_t _capacity);
+
+	size_t size() const;
+};
@@ -0,0 +1,100 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <InstanceBatcher.hpp>
+#include <MeshLibrary.hpp>
+#include <PipelineCompiler.hpp>
+#include <PipelineStateCache.hpp>
+#include <PushConstants.hpp>
+
+struct InstanceRendererConfig {
+	std::filesystem::path shaderDir;		//res/shaders, holding instanced.spv and frag.spv
+	VkRenderPass renderPass = VK_NULL_HANDLE;	//materials draw in subpass 0 of it or of a compatible pass
+	uint32_t maxInstances = 1u << 18;		//per frame, instances beyond it are dropped
+	uint32_t framesInFlight = 1;			//frames whose instances the GPU may still read while the next frame packs
+	bool drawPerInstance = false;			//one draw per instance instead of per group, to compare against
+	std::vector<uint32_t> queueFamilies;	//families drawing the instances
+};
+
+//Fixed function state a material's pipeline differs in, the shaders are the same for all of them.
+struct InstanceMaterialInfo {
+	bool alphaBlend = false;
+	bool depthWrite = true;
+	VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+};
+
+//Matches the push constant block in instanced.vert
+struct InstancePushConstants {
+	float viewProjection[16];
+	float positionOffset[4];
+	float positionScale[4];
+};
+
+struct InstanceStats {
+	uint64_t frames = 0;
+	uint64_t instances = 0;			//drawn, summed over all frames
+	uint64_t dropped = 0;			//added beyond maxInstances
+	uint64_t draws = 0;
+	uint64_t skippedDraws = 0;		//their material was still compiling
+	uint64_t pushes = 0;			//push constant updates recorded
+	uint64_t skippedPushes = 0;		//left out, the next mesh had the same offset and scale
+	double recordTotal = 0.0;		//seconds spent packing and recording
+};
+
+//Draws many copies of meshes with one indexed draw per mesh and material. Instances are collected into an
+//InstanceBatcher during the frame, then packed into a host visible buffer bound as a per instance vertex stream
+//(binding 1, next to the mesh's vertices at binding 0). The buffer holds framesInFlight slices of maxInstances, each
+//frame packs into the next one and draws with its firstInstance pointing there.
+class InstanceRenderer
+{
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	PipelineStateCache* states = nullptr;
+	PipelineCompiler* compiler = nullptr;
+	const MeshLibrary* meshes = nullptr;
+	VkRenderPass renderPass = VK_NULL_HANDLE;
+	bool drawPerInstance = false;
+
+	VkShaderModule vertexModule = VK_NULL_HANDLE;	//owned by the state cache, like the layout and the pipelines
+	VkShaderModule fragmentModule = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	PushConstantBlock<InstancePushConstants, VK_SHADER_STAGE_VERTEX_BIT> pushConstants;
+	std::vector<const CompiledPipeline*> materials;
+
+	VkBuffer instanceBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory instanceMemory = VK_NULL_HANDLE;
+	InstanceData* instanceMapped = nullptr;
+	uint32_t maxInstances = 0;
+	uint32_t framesInFlight = 0;
+	uint32_t frameSlot = 0;
+
+	InstanceBatcher batcher;
+	const std::vector<InstanceGroup>* groups = nullptr;	//packed by endFrame(), drawn by record()
+	InstanceStats stats;
+
+public:
+	//Returns false when the shaders haven't been compiled, nothing is created then.
+	bool init(VkDevice _device, VkPhysicalDevice _physicalDevice, PipelineStateCache& _states, PipelineCompiler& _compiler,
+		const MeshLibrary& _meshes, const InstanceRendererConfig& _config);
+	void destroy();
+
+	//Requested from the pipeline compiler, so it may take a few frames before its instances show up. Materials with
+	//equal state share a pipeline.
+	InstanceMaterial createMaterial(const InstanceMaterialInfo& _info);
+
+	//The batcher to add this frame's instances to, emptied. Only once the GPU finished the frame that used this
+	//frame's slice, i.e. after waiting on its fence.
+	InstanceBatcher& beginFrame();
+	//Packs what was added into this frame's slice.
+	void endFrame();
+	//Draws the packed groups inside a render pass with viewport and scissor already set. Leaves the last material's
+	//pipeline bound.
+	void record(VkCommandBuffer _commandBuffer, const glm::mat4& _viewProjection);
+
+	bool getDrawPerInstance() const;
+	const InstanceStats& getStats() const;
+};
@@ -0,0 +1,216 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <WorkStealingDeque.hpp>
+
+//Tracks a group of jobs. wait() on it returns once every job run against it has finished.
+//A job that throws still counts as finished, the first exception is kept and rethrown by wait().
+struct JobCounter {
+	std::atomic<uint32_t> pending{ 0 };
+	std::atomic<bool> failed{ false };
+	std::exception_ptr exception;
+
+	bool done() const
+	{
+		return pending.load(std::memory_order_acquire) == 0;
+	}
+
+	//Keeps only the first one, it's published to wait() by the job's decrement of pending.
+	void fail(std::exception_ptr _exception)
+	{
+		if (!failed.exchange(true, std::memory_order_relaxed))
+		{
+			exception = std::move(_exception);
+		}
+	}
+};
+
+//Fixed-size pool of workers, each with its own Chase-Lev deque.
+//Jobs spawned from a worker go to that worker's deque, idle workers steal from the others.
+//Jobs spawned from any other thread go through a shared injection queue.
+class JobSystem
+{
+public:
+	//Captures are stored inline in the job, keep them to pointers and small values.
+	static constexpr size_t JobStorageSize = 64;
+
+private:
+	struct alignas(64) Job {
+		void (*invoke)(Job&) = nullptr;
+		void (*destroy)(Job&) = nullptr;
+		JobCounter* counter = nullptr;
+		bool heapAllocated = false;
+		std::atomic<bool> inUse{ false };
+		alignas(std::max_align_t) unsigned char storage[JobStorageSize];
+	};
+
+	//Per worker job slots, recycled round-robin. A slot is only reused once its job has finished.
+	static constexpr uint32_t JobPoolSize = 4096;
+	static constexpr uint32_t DequeCapacity = 4096;
+
+	struct Worker {
+		WorkStealingDeque<Job> deque{ DequeCapacity };
+		std::unique_ptr<Job[]> pool{ new Job[JobPoolSize] };
+		uint32_t nextJob = 0;
+		uint32_t stealSeed = 0;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::vector<std::thread> threads;
+
+	std::mutex injectionMutex;
+	std::deque<Job*> injectionQueue;
+	std::atomic<uint32_t> injectedCount{ 0 };
+
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+	std::atomic<uint32_t> sleepingWorkers{ 0 };
+	std::atomic<bool> stopping{ false };
+
+public:
+	//0 uses one worker per hardware thread, minus the calling thread.
+	explicit JobSystem(uint32_t _workerCount = 0);
+	~JobSystem();
+
+	JobSystem(const JobSystem&) = delete;
+	JobSystem& operator=(const JobSystem&) = delete;
+
+	uint32_t getWorkerCount() const;
+
+	//Queues _function to run on some worker. _counter is incremented now and decremented once it has run.
+	//_function may throw: the exception is caught on whichever thread ran it and handed to wait() on _counter,
+	//the other jobs against _counter still run to completion before it's rethrown.
+	template <typename F>
+	void run(JobCounter& _counter, F&& _function);
+
+	//Blocks until _counter reaches zero, running queued jobs in the meantime. Then rethrows the first exception
+	//any of its jobs threw, which resets _counter for reuse.
+	void wait(JobCounter& _counter);
+
+	//Calls _function(first, last) over [_begin, _end) in chunks of at most _grainSize and waits for all of them.
+	//If a chunk throws, the remaining chunks still run and the first exception is rethrown once they're done.
+	template <typename F>
+	void parallelFor(uint32_t _begin, uint32_t _end, uint32_t _grainSize, const F& _function);
+
+private:
+	void workerLoop(uint32_t _index);
+
+	Job* allocateJob();
+	void submit(Job* _job);
+	Job* findJob();
+	void execute(Job* _job);
+	void wakeWorkers();
+
+	template <typename F>
+	static void splitRange(JobSystem* _jobs, JobCounter* _counter, uint32_t _begin, uint32_t _end, uint32_t _grainSize, const F* _function);
+};
+
+//Set of tasks with explicit ordering constraints, executed on a JobSystem.
+//Tasks whose dependencies have all finished run in parallel. The graph can be executed any number of times.
+class TaskGraph
+{
+public:
+	using TaskId = uint32_t;
+
+private:
+	struct Task {
+		std::function<void()> function;
+		std::vector<TaskId> successors;
+		uint32_t dependencyCount = 0;
+	};
+
+	std::vector<Task> tasks;
+	std::unique_ptr<std::atomic<uint32_t>[]> remainingDependencies;
+	bool validated = false;
+
+public:
+	TaskId addTask(std::function<void()> _function);
+
+	//_after won't start before _before has finished.
+	void addDependency(TaskId _before, TaskId _after);
+
+	//Runs every task and returns once all of them have finished. Throws if the dependencies form a cycle.
+	//A task that throws keeps its successors from running, the first exception is rethrown once every task that
+	//could still run has finished.
+	void execute(JobSystem& _jobs);
+
+	size_t size() const;
+
+private:
+	void validate();
+	void runTask(JobSystem& _jobs, JobCounter& _counter, TaskId _id);
+};
+
+namespace jobs_detail {
+	//Thread-local identity of the current worker, -1 on threads that don't belong to any JobSystem.
+	struct WorkerIdentity {
+		const void* owner = nullptr;
+		int32_t index = -1;
+	};
+	WorkerIdentity& currentWorker();
+}
+
+template <typename F>
+void JobSystem::run(JobCounter& _counter, F&& _function)
+{
+	using Callable = std::decay_t<F>;
+	static_assert(sizeof(Callable) <= JobStorageSize, "Job captures too large, capture by pointer instead.");
+	static_assert(alignof(Callable) <= alignof(std::max_align_t), "Job captures over-aligned.");
+
+	Job* job = allocateJob();
+	new (job->storage) Callable(std::forward<F>(_function));
+	job->invoke = [](Job& _job) { (*std::launder(reinterpret_cast<Callable*>(_job.storage)))(); };
+	job->destroy = [](Job& _job) { std::launder(reinterpret_cast<Callable*>(_job.storage))->~Callable(); };
+	job->counter = &_counter;
+
+	_counter.pending.fetch_add(1, std::memory_order_relaxed);
+	submit(job);
+}
+
+template <typename F>
+void JobSystem::splitRange(JobSystem* _jobs, JobCounter* _counter, uint32_t _begin, uint32_t _end, uint32_t _grainSize, const F* _function)
+{
+	//hand the upper half off and keep splitting the lower half, so thieves always take the biggest chunks
+	while (_end - _begin > _grainSize)
+	{
+		uint32_t middle = _begin + (_end - _begin) / 2;
+		_jobs->run(*_counter, [=]() { splitRange(_jobs, _counter, middle, _end, _grainSize, _function); });
+		_end = middle;
+	}
+	(*_function)(_begin, _end);
+}
+
+template <typename F>
+void JobSystem::parallelFor(uint32_t _begin, uint32_t _end, uint32_t _grainSize, const F& _function)
+{
+	if (_begin >= _end)
+	{
+		return;
+	}
+	if (_grainSize == 0)
+	{
+		_grainSize = 1;
+	}
+
+	//the lowest chunk runs right here, don't let it unwind past jobs still pointing at counter and _function
+	JobCounter counter;
+	try {
+		splitRange(this, &counter, _begin, _end, _grainSize, &_function);
+	} catch (...) {
+		counter.fail(std::current_exception());
+	}
+	wait(counter);
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+#include <FrustumCulling.hpp>
+#include <MeshFormat.hpp>
+
+struct LodSelectionConfig {
+	float maxPixelError = 1.0f;		//coarsest level whose error projects to at most this many pixels is drawn
+	float hysteresis = 0.25f;		//a coarser level has to fit this fraction below the threshold before switching to it
+};
+
+//Picks a level of detail per object from the simplification error projected to the screen. Levels are kept between
+//frames so objects near a threshold don't flicker between two of them.
+class LodSelector
+{
+private:
+	std::vector<uint8_t> levels;	//per object, 0 is the full mesh
+	uint64_t switches = 0;
+
+public:
+	//_camera is xyz position and w = 1 for a perspective camera, or view direction and w = 0 for an orthographic one.
+	//_pixelsPerUnit converts an error at distance 1 (perspective) or any distance (orthographic) to pixels, half the
+	//viewport height divided by tan(fovY / 2) for a perspective projection.
+	void select(const BoundingSpheres& _bounds, size_t _count, const float* _camera, float _pixelsPerUnit,
+		const MeshLod* _lods, uint32_t _lodCount, const LodSelectionConfig& _config);
+
+	const std::vector<uint8_t>& getLevels() const;
+	//How often any object changed level since the start.
+	uint64_t getSwitches() const;
+};
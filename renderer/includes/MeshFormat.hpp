@@ -0,0 +1,104 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+//Cooked meshes (.vmesh) as written by tools/mesh_cooker. Vertices and indices are stored exactly as the vertex
+//input and vkCmdBindIndexBuffer consume them, so loading is a read straight into a staging buffer.
+//
+//	MeshFileHeader
+//	MeshLod[lodCount]
+//	PackedVertex[vertexCount]
+//	uint16_t or uint32_t[indexCount], padded to 4 bytes
+//	Meshlet[meshletCount]
+//	uint32_t[meshletVertexCount]	meshlet vertex list
+//	uint32_t[indexCount / 3]		meshlet triangle list, one packed triangle per triangle of the index buffer
+//
+//Every level of detail is a range of the one index buffer over the shared vertices, with meshlets of its own.
+
+constexpr uint32_t MeshFileMagic = 0x48534d56;	//"VMSH"
+constexpr uint32_t MeshFileVersion = 3;
+constexpr uint32_t MeshMaxLods = 8;
+
+//Meshlet size limits, the usual sweet spot for mesh shader hardware and well within the 256 vertices and primitives
+//every VK_EXT_mesh_shader implementation has to support. meshlet.mesh declares the same maximums.
+constexpr uint32_t MeshletMaxVertices = 64;
+constexpr uint32_t MeshletMaxTriangles = 124;
+
+struct MeshFileHeader {
+	uint32_t magic = MeshFileMagic;
+	uint32_t version = MeshFileVersion;
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	uint32_t indexSize = 4;			//2 or 4 bytes
+	uint32_t meshletCount = 0;
+	uint32_t meshletVertexCount = 0;
+	uint32_t lodCount = 1;
+	float positionOffset[3] = {};	//position = positionOffset + unorm16 position * positionScale
+	float positionScale[3] = {};
+	float center[3] = {};			//bounding sphere in mesh space
+	float radius = 0.0f;
+};
+static_assert(sizeof(MeshFileHeader) == 72, "MeshFileHeader is read and written as is");
+
+//16 bytes, half of the float layout it's cooked from.
+struct PackedVertex {
+	uint16_t position[4];	//R16G16B16A16_UNORM within the mesh bounds, w is unused
+	int16_t normal[2];		//R16G16_SNORM, octahedral encoding
+	uint16_t texcoord[2];	//R16G16_SFLOAT
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex is uploaded as is");
+
+//Up to MeshletMaxTriangles consecutive triangles of the index buffer and the vertices they use. The culling shaders
+//read these as they are, see meshlet.task and meshlet_cull.comp.
+struct Meshlet {
+	float center[3];		//bounding sphere in mesh space
+	float radius;
+	float coneAxis[3];		//average facing of the triangles
+	float coneCutoff;		//sine of the cone's half angle, 1 with a zero axis when the meshlet can't be backface culled
+	uint32_t vertexOffset;	//first entry in the meshlet vertex list
+	uint32_t triangleOffset;	//first triangle, in the index buffer and the meshlet triangle list alike
+	uint32_t vertexCount;
+	uint32_t triangleCount;
+};
+static_assert(sizeof(Meshlet) == 48, "Meshlet is uploaded as is");
+
+//One level of detail, finest first. Coarser levels are simplified from the finest one and reuse its vertices.
+struct MeshLod {
+	uint32_t firstIndex;
+	uint32_t indexCount;
+	uint32_t firstMeshlet;	//relative to the mesh's first meshlet
+	uint32_t meshletCount;
+	float error;			//how far the simplified surface may be from the original one, in mesh units. 0 for the finest level
+};
+static_assert(sizeof(MeshLod) == 20, "MeshLod is read and written as is");
+
+//Uncompressed vertex the importers produce and the optimizer works on.
+struct MeshVertex {
+	float position[3];
+	float normal[3];
+	float texcoord[2];
+};
+
+struct CookedMesh {
+	MeshFileHeader header;
+	std::vector<MeshLod> lods;
+	std::vector<PackedVertex> vertices;
+	std::vector<uint8_t> indices;	//header.indexSize bytes per index
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;		//mesh vertex indices
+	std::vector<uint32_t> meshletTriangles;		//three 8 bit meshlet vertex indices per triangle
+};
+
+//Quantizes an indexed triangle list and splits it into meshlets. Indices are stored as 16 bit when every vertex fits.
+CookedMesh packMesh(const std::vector<MeshVertex>& _vertices, const std::vector<uint32_t>& _indices);
+//Same for a chain of levels of detail over the same vertices, finest first, with each level's simplification error.
+CookedMesh packMesh(const std::vector<MeshVertex>& _vertices, const std::vector<std::vector<uint32_t>>& _lodIndices,
+	const std::vector<float>& _lodErrors);
+
+CookedMesh readCookedMesh(const std::filesystem::path& _path);
+void writeCookedMesh(const std::filesystem::path& _path, const CookedMesh& _mesh);
+
+uint16_t floatToHalf(float _value);
+//Unit vector to two snorm16 values on the octahedron, the vertex shader unfolds it again.
+void encodeOctahedral(const float _normal[3], int16_t _encoded[2]);
@@ -0,0 +1,90 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+#include <MeshFormat.hpp>
+
+using MeshHandle = uint32_t;
+
+//Where a mesh lives in the shared buffers and how to unpack its positions. Counts cover every level of detail,
+//draws pick one of lods.
+struct GpuMesh {
+	VkDeviceSize vertexOffset = 0;		//bytes into the vertex buffer
+	VkDeviceSize indexOffset = 0;		//bytes into the index buffer
+	uint32_t vertexCount = 0;
+	uint32_t indexCount = 0;
+	VkIndexType indexType = VK_INDEX_TYPE_UINT32;
+	float positionOffset[3] = {};
+	float positionScale[3] = {};
+	float center[3] = {};
+	float radius = 0.0f;
+
+	//element offsets into the meshlet buffers, a meshlet's own offsets are relative to these
+	uint32_t meshletOffset = 0;
+	uint32_t meshletCount = 0;
+	uint32_t meshletVertexOffset = 0;
+	uint32_t meshletVertexCount = 0;
+	uint32_t meshletTriangleOffset = 0;		//meshlet triangles run parallel to the index buffer, indexCount / 3 of them
+
+	//finest first, the first one is the full mesh and has the most meshlets
+	uint32_t lodCount = 1;
+	MeshLod lods[MeshMaxLods] = {};
+};
+
+struct MeshStats {
+	uint32_t meshes = 0;
+	uint64_t triangles = 0;				//at full detail
+	uint64_t lodTriangles = 0;			//of all coarser levels together
+	VkDeviceSize vertexBytes = 0;
+	VkDeviceSize indexBytes = 0;
+	uint64_t meshlets = 0;
+	VkDeviceSize meshletBytes = 0;		//meshlets, their vertex and their triangle lists
+};
+
+//All meshes in one device local vertex buffer and one index buffer, their meshlets in three storage buffers next to
+//them. Meshes are added on the CPU first and uploaded together, cooked data goes to the staging buffer unchanged.
+class MeshLibrary
+{
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	std::vector<uint32_t> queueFamilies;	//every family that reads the buffers
+
+	std::vector<GpuMesh> meshes;
+	std::vector<CookedMesh> pending;	//added since the last upload
+
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+	VkBuffer meshletBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory meshletMemory = VK_NULL_HANDLE;
+	VkBuffer meshletVertexBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory meshletVertexMemory = VK_NULL_HANDLE;
+	VkBuffer meshletTriangleBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory meshletTriangleMemory = VK_NULL_HANDLE;
+
+	MeshStats stats;
+
+public:
+	//Meshlets get culled in compute as well as in graphics, buffers are shared between all of _queueFamilies.
+	void init(VkDevice _device, VkPhysicalDevice _physicalDevice, const std::vector<uint32_t>& _queueFamilies);
+	void destroy();
+
+	MeshHandle add(CookedMesh _mesh);
+	//Creates the buffers and copies every added mesh, blocking until the copy finished. Only called once for now.
+	void upload(VkQueue _queue, uint32_t _queueFamily);
+
+	//Binds the mesh's vertices to binding 0 and its indices, draws then start at vertex and index 0.
+	void bind(VkCommandBuffer _commandBuffer, MeshHandle _mesh) const;
+
+	const GpuMesh& get(MeshHandle _mesh) const;
+	const MeshStats& getStats() const;
+
+	//Storage buffer views for shaders that fetch vertices and meshlets themselves.
+	VkBuffer getVertexBuffer() const;
+	VkBuffer getMeshletBuffer() const;
+	VkBuffer getMeshletVertexBuffer() const;
+	VkBuffer getMeshletTriangleBuffer() const;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <MeshFormat.hpp>
+
+//How an index buffer hits a FIFO post-transform cache.
+struct VertexCacheStats {
+	uint32_t misses = 0;
+	float acmr = 0.0f;		//average cache miss ratio: vertex shader runs per triangle, 0.5 at best and 3 at worst
+	float atvr = 0.0f;		//average transformed vertex ratio: vertex shader runs per vertex, 1 at best
+};
+
+VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& _indices, size_t _vertexCount, uint32_t _cacheSize = 16);
+
+//Merges vertices that are bit identical and rewrites _indices to match. Returns the number of vertices removed.
+size_t deduplicateVertices(std::vector<MeshVertex>& _vertices, std::vector<uint32_t>& _indices);
+
+//Reorders triangles so neighbours share vertices while they're still in the post-transform cache
+//(Forsyth, "Linear-Speed Vertex Cache Optimisation"). Doesn't assume a particular cache size.
+void optimizeVertexCache(std::vector<uint32_t>& _indices, size_t _vertexCount);
+
+//Reorders clusters of a cache optimized index buffer so outward facing ones come first and occlude more of the
+//rest (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"). Clusters are split
+//wherever that keeps their ACMR within _threshold of the input's, so 1.05 allows 5% more cache misses.
+void optimizeOverdraw(std::vector<uint32_t>& _indices, const std::vector<MeshVertex>& _vertices, float _threshold = 1.05f);
+
+//Renumbers vertices in the order the index buffer first uses them, so vertex fetch walks memory linearly.
+//Vertices no triangle uses are dropped. Returns the new vertex count.
+size_t optimizeVertexFetch(std::vector<MeshVertex>& _vertices, std::vector<uint32_t>& _indices);
+
+//Collapses edges onto one of their own vertices, cheapest first by quadric error (Garland and Heckbert, "Surface
+//Simplification Using Quadric Error Metrics"), until at most _targetIndexCount indices are left or every remaining
+//collapse would move the surface further than _targetError from the input. Vertices on borders and attribute seams
+//never move, and no vertex is created, so the result indexes _vertices like the input does. Writes the error reached,
+//in mesh units, to _resultError.
+std::vector<uint32_t> simplifyMesh(const std::vector<MeshVertex>& _vertices, const std::vector<uint32_t>& _indices,
+	size_t _targetIndexCount, float _targetError, float* _resultError = nullptr);
+
+//Splits the index buffer, in order, into meshlets of at most MeshletMaxVertices vertices and MeshletMaxTriangles
+//triangles. Every meshlet is a contiguous range of the index buffer, so the orders above carry over to it and the same
+//meshlets can be drawn as plain indexed draws. Fills each meshlet's bounding sphere and normal cone.
+void buildMeshlets(const std::vector<MeshVertex>& _vertices, const std::vector<uint32_t>& _indices, std::vector<Meshlet>& _meshlets,
+	std::vector<uint32_t>& _meshletVertices, std::vector<uint32_t>& _meshletTriangles);
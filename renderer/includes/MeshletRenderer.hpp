@@ -0,0 +1,87 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <vector>
+
+#include <FrustumCulling.hpp>
+#include <MeshLibrary.hpp>
+#include <OcclusionCulling.hpp>
+
+struct MeshletRendererConfig {
+	std::filesystem::path shaderDir;		//res/shaders, holding the compiled meshlet shaders and frag.spv
+	VkRenderPass renderPass = VK_NULL_HANDLE;	//the mesh shader pipeline draws in subpass 0 of it
+	VkBuffer objectBounds = VK_NULL_HANDLE;	//one vec4 sphere per object, written by the Engine every frame
+	VkBuffer objectLods = VK_NULL_HANDLE;	//the MeshLod ranges each object draws as a uvec4, written along with the bounds
+	const OcclusionCuller* occlusion = nullptr;	//pyramid, visibility flags and counters, bound in every phase
+	uint32_t maxObjects = 0;
+	std::vector<uint32_t> queueFamilies;	//families the culling runs on
+	PFN_vkCmdDrawMeshTasksEXT drawMeshTasks = nullptr;	//set only when VK_EXT_mesh_shader is enabled
+	VkPhysicalDeviceMeshShaderPropertiesEXT meshShaderProperties{};
+};
+
+//Culls every meshlet of every object's level of detail against the frustum and its normal cone before anything is
+//rasterized.
+//With VK_EXT_mesh_shader a task shader culls and the mesh shader emits the survivors. Without it a compute pass expands
+//each object's meshlets into indexed indirect draws, culled ones with an instance count of 0, for the vertex pipeline.
+class MeshletRenderer
+{
+public:
+	enum class Path { MeshShader, ComputeExpand };
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	const MeshLibrary* meshes = nullptr;
+	Path path = Path::ComputeExpand;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;		//task + mesh pipeline, or the expanding compute pipeline
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	//frustum, camera and object count, host visible and rewritten every frame
+	VkBuffer frameBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory frameMemory = VK_NULL_HANDLE;
+	void* frameMapped = nullptr;
+	uint32_t objectCount = 0;
+
+	//compute expand only: one indexed indirect draw per meshlet of every object drawn
+	VkBuffer clusterDrawBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory clusterDrawMemory = VK_NULL_HANDLE;
+	uint32_t clusterDrawCapacity = 0;
+	uint32_t expandedObjects = 0;		//objects whose draws the last recordCulling wrote
+	uint32_t maxDrawIndirectCount = 0;
+	uint32_t maxComputeGroupCount[2] = {};
+
+	PFN_vkCmdDrawMeshTasksEXT drawMeshTasks = nullptr;
+	uint32_t maxTaskGroupCount[2] = {};
+	uint32_t maxTaskGroupTotalCount = 0;
+
+	uint64_t meshletsSubmitted = 0;		//object and meshlet pairs handed to culling, across all frames
+
+	void createDescriptors(const MeshletRendererConfig& _config);
+	void createMeshShaderPipeline(const MeshletRendererConfig& _config);
+	void createExpandPipeline(const MeshletRendererConfig& _config);
+
+public:
+	//Returns false when the path's shaders haven't been compiled, nothing is created then.
+	bool init(VkDevice _device, VkPhysicalDevice _physicalDevice, Path _path, const MeshLibrary& _meshes,
+		const MeshletRendererConfig& _config);
+	void destroy();
+
+	Path getPath() const;
+	uint64_t getMeshletsSubmitted() const;
+
+	//_camera is the eye position with w = 1, or the view direction with w = 0 for orthographic views.
+	void setFrame(const Frustum& _frustum, const float _camera[4], uint32_t _objectCount);
+
+	//Compute expand: records the dispatch writing the phase's draws. The Early or All phase goes on the queue the culling
+	//runs on, the Late phase after the pyramid was built and the early draws consumed them.
+	void recordCulling(VkCommandBuffer _commandBuffer, MeshHandle _mesh, CullPhase _phase);
+	//Mesh shader: binds its own pipeline and draws every object of the phase. Compute expand: draws what recordCulling
+	//wrote, with the caller's vertex pipeline and _mesh bound.
+	void recordDraw(VkCommandBuffer _commandBuffer, MeshHandle _mesh, CullPhase _phase);
+};
+
+const char* meshletPathName(MeshletRenderer::Path _path);
@@ -0,0 +1,46 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <vector>
+
+#include <TrackedImage.hpp>
+
+//Fills a mip chain from its top level on the GPU. Formats that can be filtered linearly are blitted, RGBA8 images
+//that can't go through a compute downsample, anything else is blitted with nearest filtering.
+class MipGenerator
+{
+public:
+	enum class Method { LinearBlit, Compute, NearestBlit };
+
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;		//null when the downsample shader isn't available
+
+	//per level views and descriptor sets only live until the commands using them finished
+	std::vector<VkDescriptorPool> descriptorPools;
+	size_t currentPool = 0;
+	std::vector<VkImageView> transientViews;
+
+	void createDescriptorPool();
+	VkDescriptorSet allocateDescriptorSet();
+
+public:
+	//A missing _downsampleShader only costs the compute path.
+	void init(VkDevice _device, VkPhysicalDevice _physicalDevice, const std::filesystem::path& _downsampleShader);
+	void destroy();
+
+	Method chooseMethod(VkFormat _format) const;
+	//Usage the image has to be created with for its mips to be generated.
+	VkImageUsageFlags getRequiredUsage(VkFormat _format) const;
+
+	//Generates levels 1 and up from level 0, which has to be written already. The levels are left in whatever state
+	//the last step needed, the caller transitions them to where they're used next through _barriers.
+	void generate(VkCommandBuffer _commandBuffer, TrackedImage& _image, BarrierBatch& _barriers);
+
+	//Call once the command buffers that generated mips finished executing.
+	void releaseTransient();
+};
@@ -0,0 +1,102 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <TrackedImage.hpp>
+
+//Which objects a culling dispatch or draw handles, matches the PHASE_ constants in the culling shaders.
+//Early draws what was visible last frame, the pyramid is built from its depth and Late tests everything against it.
+enum class CullPhase : uint32_t {
+	All = 0,	//frustum only, no occlusion culling
+	Early = 1,
+	Late = 2
+};
+
+struct OcclusionConfig {
+	std::filesystem::path reduceShader;		//hiz_reduce.spv, without it the pyramid is never built
+	VkExtent2D depthExtent{ 0, 0 };			//the depth buffer itself is set later, see setDepthView()
+	uint32_t maxObjects = 0;
+	std::vector<uint32_t> queueFamilies;	//families the culling runs on
+	VkPipelineStageFlags readerStages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;	//stages testing bounds against the pyramid
+};
+
+//Matches the Counters block in the culling shaders. Only the Late and All phases count, so each object is counted once.
+struct OcclusionCounters {
+	uint32_t frustumCulled;
+	uint32_t occlusionCulled;
+};
+
+//Hierarchical Z for two phase occlusion culling: a min depth pyramid (depth is reversed, so min is the farthest)
+//and per object flags remembering what passed last frame. Culling shaders bind the pyramid, the flags, the camera
+//and the counters themselves, see hizVisible in cull.comp.
+class OcclusionCuller
+{
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+
+	//a power of two no larger than the depth buffer, so every level halves exactly
+	TrackedImage pyramid;
+	VkImageView pyramidView = VK_NULL_HANDLE;
+	std::vector<VkImageView> levelViews;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkExtent2D depthExtent{ 0, 0 };
+	VkPipelineStageFlags readerStages = 0;
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+	VkPipeline pipeline = VK_NULL_HANDLE;		//null when hiz_reduce.spv isn't available
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	std::vector<VkDescriptorSet> levelSets;		//level 0 reads depth, every other level the one above it
+
+	//one uint per object, device local and only ever touched by the culling shaders. The late phase writes this frame's
+	//bit while other workgroups of the same object may still read last frame's, so the two alternate.
+	VkBuffer visibilityBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory visibilityMemory = VK_NULL_HANDLE;
+	uint32_t visibilityBit = 0;
+
+	//view projection and pyramid size, host visible and rewritten every frame
+	VkBuffer cameraBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory cameraMemory = VK_NULL_HANDLE;
+	void* cameraMapped = nullptr;
+
+	VkBuffer counterBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory counterMemory = VK_NULL_HANDLE;
+	void* counterMapped = nullptr;
+
+	void createPyramid();
+	void createReducePipeline(const OcclusionConfig& _config);
+	void writeLevelSet(uint32_t _level, VkImageView _source);
+	void clearState(VkQueue _queue, uint32_t _queueFamily);
+
+public:
+	//Creates the pyramid and buffers in any case so culling shaders always have something bound, the visibility
+	//flags start cleared so the first frame tests everything in its Late phase.
+	void init(VkDevice _device, VkPhysicalDevice _physicalDevice, VkQueue _queue, uint32_t _queueFamily,
+		const OcclusionConfig& _config);
+	void destroy();
+
+	//False when the reduce shader is missing, only the All phase can be used then.
+	bool canBuild() const;
+	//The depth buffer build() reduces into level 0, it has to be in SHADER_READ_ONLY when build() runs. Depth is a
+	//frame graph transient, so it only exists once the graph was compiled. Not while a build() is pending.
+	void setDepthView(VkImageView _depthView);
+
+	//Call once per frame before any culling is recorded, also swaps which visibility bit is last frame's.
+	//The viewport scale is the part of the depth buffer the frame renders to, starting at its top left corner.
+	void beginFrame(const glm::mat4& _viewProjection, float _viewportScaleX, float _viewportScaleY);
+	//Returns what the last finished frame counted and resets the counters. Call after waiting for that frame.
+	OcclusionCounters takeCounters();
+
+	//Reduces the depth buffer into every pyramid level, leaving them readable by the reader stages.
+	void build(VkCommandBuffer _commandBuffer);
+
+	VkDescriptorImageInfo getPyramidInfo() const;
+	VkBuffer getVisibilityBuffer() const;
+	VkBuffer getCameraBuffer() const;
+	VkBuffer getCounterBuffer() const;
+	VkExtent2D getPyramidExtent() const;
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct OutputTargetConfig {
+	uint32_t width = 800;
+	uint32_t height = 600;
+	std::string title;
+	GLFWmonitor* monitor = nullptr;		//the window opens at this monitor's top left corner, nullptr leaves it to the window system
+	VkFormat format = VK_FORMAT_UNDEFINED;	//what the scene is upscaled into, the surface has to offer it
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;	//falls back to FIFO when the surface doesn't support it
+	uint32_t imageCount = 0;			//0 takes one more than the surface minimum, clamped to what the surface allows
+	uint32_t queueFamily = 0;			//renders into the images and presents them, has to support the surface
+};
+
+//A window of its own presenting the scene on a device that's shared with other outputs: surface, swapchain, image views
+//and the semaphore its images are acquired with. Rendering into the images is up to the owner, which records every
+//output's pass into one command buffer and presents all of them with one call.
+class OutputTarget
+{
+private:
+	OutputTargetConfig config;
+	VkInstance instance = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkDevice device = VK_NULL_HANDLE;
+	GLFWwindow* window = nullptr;
+	VkSurfaceKHR surface = VK_NULL_HANDLE;
+	VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+	std::vector<VkImage> images;
+	std::vector<VkImageView> imageViews;
+	VkExtent2D extent{ 0, 0 };
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+	VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+	uint32_t imageIndex = 0;
+
+	bool acquired = false;		//this frame's acquire signaled the semaphore, the image has to be rendered and presented
+	bool stale = false;			//out of date or suboptimal, recreate() before the next acquire
+	bool retired = false;		//the surface is gone, nothing is acquired from it anymore
+	//width in the upper and height in the lower half. GLFW only answers on the main thread, the render thread reads
+	//what it last saw. Behind a pointer so outputs can still be kept in a vector.
+	std::unique_ptr<std::atomic<uint64_t>> framebufferSize = std::make_unique<std::atomic<uint64_t>>(0);
+
+	VkExtent2D chooseExtent(const VkSurfaceCapabilitiesKHR& _capabilities) const;
+	void createSwapchain();
+	void destroySwapchain();
+	void onResult(VkResult _result);
+
+public:
+	//Opens the window, so only on the main thread. Throws when the surface can't be presented to from the queue
+	//family or doesn't offer the format.
+	void init(VkInstance _instance, VkPhysicalDevice _physicalDevice, VkDevice _device, const OutputTargetConfig& _config);
+	//Only once the device is idle.
+	void destroy();
+
+	//Signals getImageAvailableSemaphore() once the image is free, getImageIndex() is the one to render into. Only when
+	//isAcquired() afterwards: a stale or retired output isn't acquired from at all, a failed acquire signals nothing.
+	VkResult acquire();
+	//The output's entry of the present results, marks it stale or retired like a failed acquire does.
+	void presented(VkResult _result);
+	//Rebuilds the swapchain of a stale output, idling the device first. Returns false while the window is minimized,
+	//the output stays stale and is skipped until a later call succeeds.
+	bool recreate();
+	//Records the window's framebuffer size for recreate(). Only on the main thread, after polling events.
+	void pollFramebufferSize();
+
+	bool isAcquired() const;
+	bool isStale() const;
+	bool isRetired() const;
+
+	bool shouldClose() const;
+	VkSwapchainKHR getSwapchain() const;
+	const std::vector<VkImage>& getImages() const;
+	const std::vector<VkImageView>& getImageViews() const;
+	VkExtent2D getExtent() const;
+	VkPresentModeKHR getPresentMode() const;
+	VkSemaphore getImageAvailableSemaphore() const;
+	uint32_t getImageIndex() const;
+};
@@ -0,0 +1,122 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <PipelineCompiler.hpp>
+#include <PipelineStateCache.hpp>
+
+struct ParticleConfig {
+	std::filesystem::path shaderDir;		//res/shaders, holding the compiled particle shaders
+	VkRenderPass renderPass = VK_NULL_HANDLE;	//particles draw in subpass 0 of it or of a compatible pass
+	uint32_t maxParticles = 1u << 20;
+	bool sort = true;		//back to front for alpha blending, otherwise additive blending without sorting
+	glm::vec3 emitterPosition{ 0.0f };
+	float emitterRadius = 0.0f;
+	float emitRate = 0.0f;		//particles per second, 0 keeps about maxParticles alive
+	float lifetime = 2.0f;		//seconds
+	float speed = 1.0f;			//initial speed, in a cone around -gravity
+	float gravity = 1.0f;		//along +y, which points down the screen
+	float particleSize = 0.01f;	//quad half size in clip space at w = 1
+	std::vector<uint32_t> queueFamilies;	//families simulating and drawing the particles
+};
+
+//Matches the Counters block in the particle shaders. The CPU only ever sees a copy, a frame late.
+struct ParticleCounters {
+	int32_t deadCount;
+	uint32_t aliveCount[2];		//alive lists, the one emitted into and simulated from alternates every frame
+	uint32_t emitted;			//this frame, emits fail once the dead list is empty
+	VkDispatchIndirectCommand simulate;	//sized by the alive count after emitting
+	uint32_t padding;
+	VkDrawIndirectCommand draw;	//one quad instance per particle that survived the frame
+};
+
+struct ParticleStats {
+	uint64_t frames = 0;
+	uint64_t aliveTotal = 0;		//read back a frame late, summed over all frames
+	uint32_t aliveMax = 0;
+	uint64_t emitRequested = 0;
+	uint64_t emitted = 0;			//fewer than requested when the pool was full
+	double recordTotal = 0.0;		//seconds, what the CPU spends per frame regardless of the particle count
+};
+
+//Particles live entirely on the GPU. Their state is kept as structure of arrays in storage buffers (position and age,
+//velocity and lifetime, color) and indices move between a dead list and two alive lists with atomics: emit pops the
+//dead list and appends to this frame's alive list, simulate integrates every alive particle and either pushes it back
+//on the dead list or compacts it into the other alive list, writing its sort key on the way. Keys are then bitonic
+//sorted back to front and the draw reads particles in key order. Dispatch and draw sizes are written by the GPU from
+//its own counters, so the CPU records the same few commands for ten particles as for millions and never reads or
+//writes particle data; it only learns the alive count from a copy of the counters a frame later.
+//Sorting runs over the whole capacity rounded up to a power of two, its cost follows maxParticles rather than the
+//alive count.
+class ParticleSystem
+{
+private:
+	enum Stage { Reset, Emit, Args, Simulate, Sort, StageCount };
+
+	VkDevice device = VK_NULL_HANDLE;
+	PipelineCompiler* compiler = nullptr;
+	ParticleConfig config;
+	uint32_t sortCapacity = 0;		//a power of two, at least one sort workgroup
+
+	VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;	//owned by the state cache, like layouts and pipelines
+	VkPipelineLayout computeLayout = VK_NULL_HANDLE;
+	VkPipelineLayout drawLayout = VK_NULL_HANDLE;
+	VkPipeline pipelines[StageCount] = {};
+	const CompiledPipeline* drawPipeline = nullptr;
+	VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+
+	//device local, only ever touched by the particle shaders
+	struct StateBuffer {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceMemory memory = VK_NULL_HANDLE;
+	};
+	StateBuffer positions;		//vec4: position, age
+	StateBuffer velocities;		//vec4: velocity, lifetime
+	StateBuffer colors;			//RGBA8
+	StateBuffer deadList;
+	StateBuffer aliveLists;		//two of maxParticles, one after the other
+	StateBuffer sortKeys;		//uvec2: key, particle index, sortCapacity of them
+	StateBuffer counters;		//ParticleCounters, also the indirect dispatch and draw
+
+	VkBuffer readbackBuffer = VK_NULL_HANDLE;	//host visible copy of the counters
+	VkDeviceMemory readbackMemory = VK_NULL_HANDLE;
+	void* readbackMapped = nullptr;
+
+	bool reset = true;			//the dead list still has to be filled
+	uint32_t current = 0;		//alive list emitted into and simulated from this frame
+	uint32_t emitCount = 0;
+	float emitRemainder = 0.0f;
+	float deltaTime = 0.0f;
+	uint32_t seed = 0;
+	glm::vec4 camera{ 0.0f };
+	bool recorded = false;		//the counters copy belongs to a frame that ran
+
+	ParticleStats stats;
+
+	void createDescriptors(PipelineStateCache& _states);
+	void createPipelines(PipelineStateCache& _states);
+	//0 groups dispatches indirectly with the size particle_args wrote
+	void dispatch(VkCommandBuffer _commandBuffer, Stage _stage, uint32_t _groups, uint32_t _mode, uint32_t _sortK, uint32_t _sortJ);
+
+public:
+	//Returns false when the shaders haven't been compiled, nothing is created then.
+	bool init(VkDevice _device, VkPhysicalDevice _physicalDevice, PipelineStateCache& _states, PipelineCompiler& _compiler,
+		const ParticleConfig& _config);
+	void destroy();
+
+	//Call once per frame after waiting for the previous one, picks up its counters. _camera is the eye position with
+	//w = 1, or the view direction with w = 0 for orthographic views.
+	void beginFrame(float _deltaTime, const glm::vec4& _camera);
+	//Emits, simulates, compacts and sorts outside of a render pass, leaving the results readable by the draw.
+	void recordSimulation(VkCommandBuffer _commandBuffer);
+	//Draws the particles inside a render pass with viewport and scissor already set.
+	void recordDraw(VkCommandBuffer _commandBuffer, const glm::mat4& _viewProjection, float _aspect);
+
+	bool isSorted() const;
+	uint32_t getCapacity() const;
+	const ParticleStats& getStats() const;
+};
@@ -0,0 +1,104 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <PipelineStateCache.hpp>
+
+enum class PipelineCompileMode {
+	Libraries,	//VK_EXT_graphics_pipeline_library parts, linked fast on demand and link time optimized in the background
+	Async		//complete pipelines compiled in the background
+};
+
+const char* pipelineCompileModeName(PipelineCompileMode _mode);
+
+//A pipeline handed out by the PipelineCompiler, written by it while the pipeline compiles. The handle changes at most
+//once after it's set, when the optimized link replaces the fast one. The fast one stays valid for command buffers that
+//still use it.
+struct CompiledPipeline {
+	std::atomic<VkPipeline> pipeline{ VK_NULL_HANDLE };	//VK_NULL_HANDLE while compiling, draws with it have to be skipped
+	std::atomic<bool> optimized{ false };		//nothing will replace the pipeline anymore
+	std::atomic<bool> failed{ false };
+	std::exception_ptr error;					//why it failed, set before failed
+};
+
+struct PipelineCompilerStats {
+	uint64_t requested = 0;			//distinct pipelines
+	uint64_t linkedOnRequest = 0;	//every part was ready, so the fast link ran on the requesting thread
+	uint64_t fastLinks = 0;
+	uint64_t optimizedLinks = 0;
+	uint64_t asyncCompiles = 0;		//complete pipelines compiled without libraries
+	double fastLinkTotal = 0.0;		//seconds
+	double fastLinkMax = 0.0;
+	double backgroundTotal = 0.0;	//seconds spent on the compile thread
+};
+
+//Hands out pipelines without compiling them on the thread that asks, so a pipeline used for the first time mid-frame
+//doesn't stall the frame. With VK_EXT_graphics_pipeline_library a pipeline is linked from its four library parts,
+//which are shared by every pipeline using the same shaders or output state. When all parts already exist the fast
+//link happens right away, it's cheap enough for a recording thread. Otherwise the parts compile in the background and
+//the pipeline can't be used until they're done. Every fast link is followed by an optimized one in the background
+//that replaces it once finished. Without the extension, whole pipelines compile in the background.
+//Compiles run on a thread of their own rather than on the JobSystem, where a frame waiting on its jobs could end up
+//running a compile in between.
+class PipelineCompiler
+{
+private:
+	struct Request;	//the CompiledPipeline and everything needed to build it
+	struct Task {
+		Request* request;
+		bool optimize;	//the optimized link of a request that already has its fast one
+	};
+
+	PipelineStateCache* states = nullptr;
+	PipelineCompileMode mode = PipelineCompileMode::Async;
+
+	ConcurrentHandleMap requests;	//pipeline key -> Request, found without locking
+
+	//Guards everything below
+	mutable std::mutex mutex;
+	std::condition_variable workCondition;
+	std::condition_variable readyCondition;
+	std::deque<std::unique_ptr<Request>> owned;
+	std::deque<Task> queue;
+	bool stopping = false;
+	PipelineCompilerStats stats;
+
+	std::thread thread;
+
+	void compileLoop();
+	void build(Request& _request);
+	void linkFast(Request& _request);
+	void optimize(Request& _request);
+	void enqueue(Task _task);
+
+public:
+	PipelineCompiler();
+	~PipelineCompiler();
+	PipelineCompiler(const PipelineCompiler&) = delete;
+	PipelineCompiler& operator=(const PipelineCompiler&) = delete;
+
+	//Libraries need VK_EXT_graphics_pipeline_library enabled on the device _states creates objects on.
+	void init(PipelineStateCache& _states, PipelineCompileMode _mode);
+	//Stops the compile thread, dropping queued work. The pipelines themselves belong to the state cache.
+	void destroy();
+
+	//The pipeline _createInfo describes, started now if it wasn't requested before. The create info is copied, it
+	//doesn't have to outlive the call. Building the key costs about as much as copying the create info, keep the
+	//returned pointer rather than requesting every frame. Valid until destroy().
+	const CompiledPipeline* request(const VkGraphicsPipelineCreateInfo& _createInfo);
+
+	//Blocks until _pipeline can be bound, for pipelines that are needed before anything can be drawn. Rethrows if
+	//compiling it failed.
+	void wait(const CompiledPipeline* _pipeline);
+
+	PipelineCompileMode getMode() const;
+	PipelineCompilerStats getStats() const;
+};
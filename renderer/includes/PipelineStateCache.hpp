@@ -0,0 +1,133 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//Hash table from canonical key bytes to a 64 bit value, entries are only removed all at once. Lookups don't lock:
+//a slot is published once its entry is complete, and a full table is copied into a bigger one instead of being
+//rehashed in place, so a reader still probing the old one sees a consistent, at worst slightly stale, set.
+//Old tables are kept until clear(). Inserts are serialized on a mutex.
+class ConcurrentHandleMap
+{
+public:
+	struct Entry {
+		uint64_t hash;
+		std::vector<uint8_t> key;
+		uint64_t value;
+	};
+
+private:
+	struct Slots {
+		size_t mask = 0;
+		std::unique_ptr<std::atomic<const Entry*>[]> slots;
+	};
+
+	std::atomic<const Slots*> current{ nullptr };
+	mutable std::mutex mutex;
+	std::vector<std::unique_ptr<Slots>> generations;	//every table ever published, readers may still be in any of them
+	std::vector<std::unique_ptr<Entry>> entries;
+
+	void grow();
+
+public:
+	ConcurrentHandleMap();
+
+	//Safe from any thread, also while another one inserts. nullptr if there's no entry for the key.
+	const Entry* find(uint64_t _hash, const std::vector<uint8_t>& _key) const;
+
+	//Adds the entry unless an equal key got there first, returns whichever entry is in the table now.
+	const Entry* insert(uint64_t _hash, std::vector<uint8_t> _key, uint64_t _value);
+
+	//Not thread safe, nothing may be reading.
+	template <typename Function>
+	void forEach(Function&& _function) const
+	{
+		for (const std::unique_ptr<Entry>& entry : entries)
+		{
+			_function(*entry);
+		}
+	}
+	size_t size() const;
+	void clear();
+};
+
+//The four parts of VK_EXT_graphics_pipeline_library, a complete pipeline has all of them.
+constexpr VkGraphicsPipelineLibraryFlagsEXT AllLibraryParts = VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT |
+	VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT | VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT |
+	VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT;
+
+struct PipelineStateKey {
+	uint64_t hash = 0;
+	std::vector<uint8_t> bytes;
+};
+
+struct PipelineStateCacheStats {
+	uint64_t lookups = 0;
+	uint64_t hits = 0;
+	uint64_t raced = 0;		//created by two threads at once, the copy that lost was destroyed again
+	size_t shaderModules = 0;
+	size_t samplers = 0;
+	size_t descriptorSetLayouts = 0;
+	size_t pipelineLayouts = 0;
+	size_t renderPasses = 0;
+	size_t pipelines = 0;
+};
+
+//Creates every pipeline, render pass, sampler, layout and shader module once. Each object is keyed by a hash of its
+//create info, written out field by field rather than as raw structs, so padding and pointers don't make equal states
+//differ: shaders by the hash of their code, then vertex layout, raster, depth, blend and dynamic state.
+//Asking for an existing object is a hash lookup that doesn't lock, so recording threads can ask for pipelines.
+//Misses create the object outside of any lock, compiles on different threads don't wait for each other.
+//The cache owns what it returns, nothing it hands out may be destroyed by the caller. Handles inside create infos
+//(modules, layouts, render passes) have to come from the cache too, a destroyed handle that's reused by the driver
+//would otherwise hit an entry made for the old object. Create infos with a pNext chain aren't supported.
+class PipelineStateCache
+{
+private:
+	VkDevice device = VK_NULL_HANDLE;
+	VkPipelineCache pipelineCache = VK_NULL_HANDLE;
+
+	ConcurrentHandleMap shaderModules;
+	ConcurrentHandleMap moduleHashes;	//module handle -> hash of its code
+	ConcurrentHandleMap samplers;
+	ConcurrentHandleMap descriptorSetLayouts;
+	ConcurrentHandleMap pipelineLayouts;
+	ConcurrentHandleMap renderPasses;
+	ConcurrentHandleMap pipelines;		//graphics, compute, libraries and linked, their keys start with which they are
+
+	std::atomic<uint64_t> lookups{ 0 };
+	std::atomic<uint64_t> hits{ 0 };
+	std::atomic<uint64_t> raced{ 0 };
+
+public:
+	//_pipelineCache may be VK_NULL_HANDLE, it's what pipelines are compiled with.
+	void init(VkDevice _device, VkPipelineCache _pipelineCache);
+	//Destroys every object the cache created, none of them may still be in use.
+	void destroy();
+
+	VkShaderModule getShaderModule(const VkShaderModuleCreateInfo& _createInfo);
+	VkSampler getSampler(const VkSamplerCreateInfo& _createInfo);
+	VkDescriptorSetLayout getDescriptorSetLayout(const VkDescriptorSetLayoutCreateInfo& _createInfo);
+	VkPipelineLayout getPipelineLayout(const VkPipelineLayoutCreateInfo& _createInfo);
+	VkRenderPass getRenderPass(const VkRenderPassCreateInfo& _createInfo);
+	VkPipeline getGraphicsPipeline(const VkGraphicsPipelineCreateInfo& _createInfo);
+	VkPipeline getComputePipeline(const VkComputePipelineCreateInfo& _createInfo);
+
+	//The key getGraphicsPipeline files _createInfo under, for callers that keep their own tables of pipelines.
+	PipelineStateKey getGraphicsPipelineKey(const VkGraphicsPipelineCreateInfo& _createInfo) const;
+
+	//One VK_EXT_graphics_pipeline_library part of the pipeline _createInfo describes, keyed by only the state that
+	//part uses. Pipelines that share shaders or output state share those parts. Needs the extension enabled.
+	VkPipeline getPipelineLibrary(const VkGraphicsPipelineCreateInfo& _createInfo, VkGraphicsPipelineLibraryFlagBitsEXT _part);
+	//VK_NULL_HANDLE unless getPipelineLibrary already created the part, never creates anything.
+	VkPipeline findPipelineLibrary(const VkGraphicsPipelineCreateInfo& _createInfo, VkGraphicsPipelineLibraryFlagBitsEXT _part) const;
+	//A pipeline linked from library parts. Without _optimized the link is fast, with it the driver optimizes across
+	//the parts, which takes about as long as a full compile.
+	VkPipeline getLinkedPipeline(const VkPipeline* _libraries, uint32_t _libraryCount, VkPipelineLayout _layout, bool _optimized);
+
+	PipelineStateCacheStats getStats() const;
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+//Every implementation has at least this much push constant space, blocks that end within it work on any device.
+constexpr uint32_t GuaranteedPushConstantsSize = 128;
+
+//A push constant block of type T, seen by Stages at byte Offset of the pipeline layouts it's pushed through. Its size
+//and alignment are checked when the template is instantiated: blocks have to end within the 128 bytes every device
+//has, unless Limit is raised, in which case validate() checks them against the device when the layout is created.
+//
+//push() remembers what it last recorded and skips vkCmdPushConstants when the values, the command buffer and the
+//layout are unchanged. Push constants stay set across pipeline binds and render passes within a command buffer, so
+//only reset() has to be called, once a command buffer is begun again.
+template <typename T, VkShaderStageFlags Stages, uint32_t Offset = 0, uint32_t Limit = GuaranteedPushConstantsSize>
+class PushConstantBlock
+{
+	static_assert(std::is_trivially_copyable<T>::value, "Push constants are copied byte for byte");
+	static_assert(Offset % 4 == 0 && sizeof(T) % 4 == 0, "Push constant offsets and sizes have to be multiples of 4");
+	static_assert(Offset + sizeof(T) <= Limit, "The push constant block doesn't fit into its limit");
+
+private:
+	T values{};
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkPipelineLayout layout = VK_NULL_HANDLE;
+	bool valid = false;
+	uint64_t pushes = 0;
+	uint64_t skipped = 0;
+
+public:
+	static constexpr uint32_t offset = Offset;
+	static constexpr uint32_t size = sizeof(T);
+
+	//What the pipeline layouts this is pushed through have to contain.
+	static constexpr VkPushConstantRange range()
+	{
+		return VkPushConstantRange{ Stages, Offset, sizeof(T) };
+	}
+
+	//Only needed for blocks reaching past the guaranteed size, throws when the device has less room.
+	static void validate(const VkPhysicalDeviceLimits& _limits)
+	{
+		if (Offset + sizeof(T) > _limits.maxPushConstantsSize)
+		{
+			throw std::runtime_error("[PushConstants]: A block ends at byte " + std::to_string(Offset + sizeof(T)) +
+				", the device only has " + std::to_string(_limits.maxPushConstantsSize) + "!");
+		}
+	}
+
+	//Forgets what was pushed, the next push() records either way.
+	void reset()
+	{
+		valid = false;
+	}
+
+	//Returns whether anything was recorded.
+	bool push(VkCommandBuffer _commandBuffer, VkPipelineLayout _layout, const T& _values)
+	{
+		if (valid && _commandBuffer == commandBuffer && _layout == layout && std::memcmp(&values, &_values, sizeof(T)) == 0)
+		{
+			skipped++;
+			return false;
+		}
+
+		vkCmdPushConstants(_commandBuffer, _layout, Stages, Offset, sizeof(T), &_values);
+		values = _values;
+		commandBuffer = _commandBuffer;
+		layout = _layout;
+		valid = true;
+		pushes++;
+		return true;
+	}
+
+	uint64_t getPushes() const
+	{
+		return pushes;
+	}
+
+	//Pushes that were left out because nothing changed.
+	uint64_t getSkipped() const
+	{
+		return skipped;
+	}
+};
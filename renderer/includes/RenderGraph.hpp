@@ -0,0 +1,194 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+//Handle to an image declared on a RenderGraph.
+using RenderResource = uint32_t;
+constexpr RenderResource InvalidRenderResource = std::numeric_limits<uint32_t>::max();
+
+//How a pass touches an image. Each usage implies the pipeline stages, access mask and layout the graph
+//has to transition the image into before the pass runs.
+enum class ImageUsage {
+	ColorAttachmentWrite,		//cleared or fully overwritten, previous contents are discarded
+	ColorAttachmentReadWrite,	//loaded and/or blended on top of
+	DepthAttachmentWrite,		//cleared, previous contents are discarded
+	DepthAttachmentReadWrite,	//loaded and tested against
+	DepthAttachmentRead,
+	SampledFragment,
+	SampledCompute,
+	StorageRead,
+	StorageWrite,
+	TransferSource,
+	TransferDestination
+};
+
+//Image that only lives inside one execution of the graph. Its memory is shared with other transients whose lifetimes don't overlap.
+struct TransientImageDesc {
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	VkExtent2D extent{ 0, 0 };
+	uint32_t mipLevels = 1;
+	VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+struct TransientMemoryStats {
+	VkDeviceSize unaliasedBytes = 0;	//every transient in its own allocation
+	VkDeviceSize aliasedBytes = 0;		//size of the shared block actually allocated
+	uint32_t transientCount = 0;
+};
+
+//One transient as seen by the aliasing planner: its memory requirements and the range of passes it's alive for.
+struct AliasingRequest {
+	VkDeviceSize size = 0;
+	VkDeviceSize alignment = 1;
+	uint32_t firstPass = 0;
+	uint32_t lastPass = 0;
+};
+
+struct AliasingPlan {
+	std::vector<VkDeviceSize> offsets;	//per request, into one shared block
+	VkDeviceSize totalSize = 0;
+};
+
+//Places every request in a single block so that two requests only share bytes if their pass ranges are disjoint.
+//Largest first, each at the lowest offset that doesn't collide with a placed request it's alive alongside.
+AliasingPlan planAliasing(const std::vector<AliasingRequest>& _requests);
+
+//Frame graph built once and executed every frame.
+//Passes declare the images they use, compile() culls passes whose results nobody reads, derives every layout
+//transition and execution dependency, and packs transients into one aliased allocation.
+//execute() then records one batched vkCmdPipelineBarrier in front of each pass that needs it.
+class RenderGraph
+{
+public:
+	using ExecuteFunction = std::function<void(VkCommandBuffer)>;
+
+	class PassBuilder
+	{
+	private:
+		RenderGraph& graph;
+		uint32_t pass;
+
+	public:
+		PassBuilder(RenderGraph& _graph, uint32_t _pass);
+
+		PassBuilder& use(RenderResource _resource, ImageUsage _usage);
+		//The pass has effects outside the graph and must never be culled.
+		PassBuilder& keepAlive();
+	};
+
+private:
+	struct ResourceUse {
+		RenderResource resource;
+		ImageUsage usage;
+	};
+
+	struct Pass {
+		std::string name;
+		ExecuteFunction execute;
+		std::vector<ResourceUse> uses;
+		bool keepAlive = false;
+		bool culled = false;
+	};
+
+	struct Resource {
+		std::string name;
+		bool imported = false;
+		bool output = false;
+
+		//Imported images: the state the image arrives in and the layout it has to leave in
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView view = VK_NULL_HANDLE;
+		VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkPipelineStageFlags initialStages = 0;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		bool absent = false;		//skipped this frame, its barriers are left out
+
+		//Transient images
+		TransientImageDesc desc;
+		VkImageUsageFlags usageFlags = 0;
+		uint32_t firstPass = std::numeric_limits<uint32_t>::max();
+		uint32_t lastPass = 0;
+		VkDeviceSize memoryOffset = 0;
+		VkDeviceSize memorySize = 0;
+	};
+
+	struct Barrier {
+		RenderResource resource;
+		VkAccessFlags srcAccess;
+		VkAccessFlags dstAccess;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+	};
+
+	struct BarrierBatch {
+		VkPipelineStageFlags srcStages = 0;
+		VkPipelineStageFlags dstStages = 0;
+		std::vector<Barrier> barriers;
+
+		bool empty() const { return srcStages == 0 && dstStages == 0; }
+	};
+
+	std::vector<Pass> passes;
+	std::vector<Resource> resources;
+
+	//Filled by compile()
+	std::vector<uint32_t> executionOrder;
+	std::vector<BarrierBatch> passBarriers;		//indexed like executionOrder
+	BarrierBatch finalBarriers;
+	bool compiled = false;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkDeviceMemory transientMemory = VK_NULL_HANDLE;
+	TransientMemoryStats memoryStats;
+
+	std::vector<VkImageMemoryBarrier> barrierScratch;
+
+public:
+	RenderGraph() = default;
+	RenderGraph(const RenderGraph&) = delete;
+	RenderGraph& operator=(const RenderGraph&) = delete;
+
+	//An image owned outside the graph. _initialStages are the stages that last touched it before the graph runs
+	//(e.g. the wait stage of the acquire semaphore), so the first barrier can chain onto them.
+	RenderResource importImage(const std::string& _name, VkImageAspectFlags _aspect,
+		VkImageLayout _initialLayout, VkPipelineStageFlags _initialStages, VkImageLayout _finalLayout);
+	//Imported images may change every frame (swapchain images), so the handles are supplied before each execute().
+	void setImportedImage(RenderResource _resource, VkImage _image, VkImageView _view);
+	//An imported image that isn't there this frame, e.g. a window whose image couldn't be acquired. Its barriers are
+	//left out until the next setImportedImage(), the passes using it have to skip their own work.
+	void skipImportedImage(RenderResource _resource);
+
+	RenderResource createTransientImage(const std::string& _name, const TransientImageDesc& _desc);
+
+	PassBuilder addPass(const std::string& _name, ExecuteFunction _execute);
+
+	//Anything contributing to an output is kept, everything else is culled.
+	void markOutput(RenderResource _resource);
+
+	//Culls passes, creates and aliases transients and plans every barrier.
+	//Call again after adding passes or resources; previously created transients are released first.
+	void compile(VkDevice _device, VkPhysicalDevice _physicalDevice);
+	void execute(VkCommandBuffer _commandBuffer);
+	void destroy();
+
+	VkImage getImage(RenderResource _resource) const;
+	VkImageView getImageView(RenderResource _resource) const;
+
+	const TransientMemoryStats& getMemoryStats() const;
+	uint32_t getPassCount() const;
+	uint32_t getCulledPassCount() const;
+	void printSummary() const;
+
+private:
+	void cullPasses();
+	void computeLifetimes();
+	void createTransients(VkPhysicalDevice _physicalDevice);
+	void destroyTransients();
+	void planBarriers();
+	void recordBarriers(VkCommandBuffer _commandBuffer, const BarrierBatch& _batch);
+};
@@ -0,0 +1,79 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <FrustumCulling.hpp>
+
+class JobSystem;
+
+//Stable handle to a scene entity. Dense storage is reordered freely, handles are not.
+using Entity = uint32_t;
+constexpr Entity InvalidEntity = std::numeric_limits<uint32_t>::max();
+
+struct Transform {
+	glm::vec3 position{ 0.0f };
+	glm::quat rotation{ 1.0f, 0.0f, 0.0f, 0.0f };
+	glm::vec3 scale{ 1.0f };
+};
+
+//Entities and their components in dense arrays, sorted by hierarchy depth.
+//Every parent comes before its children and each depth level is one contiguous range,
+//so world matrices are computed in a single linear pass that runs each level in parallel.
+class Scene
+{
+private:
+	static constexpr uint32_t InvalidIndex = std::numeric_limits<uint32_t>::max();
+
+	//Indexed by Entity
+	std::vector<uint32_t> entityToDense;
+	std::vector<uint32_t> entityDepth;
+	std::vector<Entity> freeEntities;
+
+	//Indexed by dense position
+	std::vector<Entity> denseToEntity;
+	std::vector<uint32_t> parents;			//dense index of the parent or InvalidIndex
+	std::vector<Transform> localTransforms;
+	std::vector<glm::mat4> worldMatrices;
+	std::vector<float> localRadii;			//bounding sphere radius in local space
+	std::vector<uint8_t> localDirty;		//set by setLocalTransform, cleared by updateTransforms
+	std::vector<uint8_t> worldChanged;		//world matrix was recomputed in the last update
+
+	std::vector<size_t> levelOffsets;		//dense range of depth d is [levelOffsets[d], levelOffsets[d + 1])
+	bool orderDirty = false;
+
+public:
+	//_parent must already exist. Children are placed after their parent on the next update.
+	Entity createEntity(Entity _parent = InvalidEntity);
+	//Destroys the entity and its whole subtree.
+	void destroyEntity(Entity _entity);
+	bool isAlive(Entity _entity) const;
+
+	void setLocalTransform(Entity _entity, const Transform& _transform);
+	const Transform& getLocalTransform(Entity _entity) const;
+	void setBoundingRadius(Entity _entity, float _radius);
+
+	//Valid after updateTransforms().
+	const glm::mat4& getWorldMatrix(Entity _entity) const;
+
+	//Recomputes world matrices of every entity whose local transform, or any ancestor's, changed.
+	//Levels are split across _jobs when given, otherwise run on the calling thread.
+	void updateTransforms(JobSystem* _jobs = nullptr);
+
+	//World-space bounding spheres and matrices in dense order, i.e. object i of the output is getDenseEntities()[i].
+	void gatherBounds(BoundingSpheres& _bounds) const;
+	const std::vector<glm::mat4>& getWorldMatrices() const;
+	const std::vector<Entity>& getDenseEntities() const;
+
+	size_t size() const;
+	size_t depthLevels() const;
+
+private:
+	void rebuildOrder();
+	void applyOrder(const std::vector<uint32_t>& _newToOld);
+	void updateRange(size_t _begin, size_t _end);
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <chrono>
+
+#include <glm/glm.hpp>
+
+#include <FrustumCulling.hpp>
+
+//Immutable view of the simulation handed from the update thread to the render thread.
+//Everything the render thread needs to record a frame must be copied in here; it never reads live simulation state.
+struct SceneSnapshot {
+	uint64_t tick = 0;		//number of simulation steps taken
+	double simulationTime = 0.0;	//seconds of simulated time
+	std::chrono::steady_clock::time_point inputTime;	//last input poll before the snapshot was written
+
+	Frustum cameraFrustum;
+	glm::vec4 cameraPosition;		//w = 0 for orthographic views, xyz is the view direction then
+	glm::mat4 cameraViewProjection;	//what cameraFrustum was extracted from, projects bounds onto the Hi-Z pyramid
+	BoundingSpheres objectBounds;	//indexed by object, the render thread draws object i as instance i
+	std::vector<glm::mat4> objectTransforms;
+};
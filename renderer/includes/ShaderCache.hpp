@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <JobSystem.hpp>
+
+//SPIR-V read ahead of the pipelines that use it. Startup reads every shader on the job system before there is a
+//device to create modules with, everything that loads shaders then takes them from here. Shaders that weren't
+//preloaded are read from disk.
+class ShaderCache
+{
+private:
+	std::mutex mutex;
+	std::unordered_map<std::string, std::vector<char>> files;	//by normalized path
+
+	static std::string key(const std::filesystem::path& _path);
+
+public:
+	//One cache for the whole process, shaders are loaded from code that has no access to the Engine.
+	static ShaderCache& get();
+
+	//Reads every .spv in _directory, spread over _jobs. Returns how many were read, 0 if the directory doesn't exist.
+	size_t preload(JobSystem& _jobs, const std::filesystem::path& _directory);
+
+	//Code of _path, preloaded or read now. Throws if the file can't be opened.
+	std::vector<char> read(const std::filesystem::path& _path);
+
+	//Drops everything preloaded, once all pipelines have been created.
+	void clear();
+};
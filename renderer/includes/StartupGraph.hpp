@@ -0,0 +1,79 @@
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <JobSystem.hpp>
+
+//Where a startup stage may run. GLFW only creates windows and reports their size on the main thread.
+enum class StageThread {
+	Any,	//a job system worker
+	Main	//the thread calling StartupGraph::execute
+};
+
+struct StageTiming {
+	double start = 0.0;		//seconds since execute() started
+	double duration = 0.0;
+	bool finished = false;
+};
+
+//Engine startup as stages with dependencies between them. Every stage runs as soon as its dependencies have finished,
+//so loading that doesn't depend on the device overlaps with the serial Vulkan setup. Each stage is timed.
+//Unlike TaskGraph, stages can be pinned to the calling thread.
+class StartupGraph
+{
+public:
+	using StageId = uint32_t;
+	using Clock = std::chrono::steady_clock;
+
+private:
+	struct Stage {
+		std::string name;
+		std::function<void()> function;
+		StageThread thread = StageThread::Any;
+		std::vector<StageId> successors;
+		uint32_t dependencyCount = 0;
+	};
+
+	std::vector<Stage> stages;
+	std::vector<StageTiming> timings;
+	Clock::time_point startTime;
+	double totalTime = 0.0;
+	bool runInline = false;	//no workers to run Any stages on, everything runs on the calling thread
+
+	//Guards everything below while executing
+	std::mutex mutex;
+	std::condition_variable mainCondition;
+	std::vector<uint32_t> remainingDependencies;
+	std::deque<StageId> mainQueue;
+	uint32_t finishedCount = 0;
+	std::exception_ptr error;
+
+	void validate() const;
+	void schedule(JobSystem& _jobs, JobCounter& _counter, StageId _id);
+	void runStage(JobSystem& _jobs, JobCounter& _counter, StageId _id);
+
+public:
+	StageId addStage(std::string _name, std::function<void()> _function, StageThread _thread = StageThread::Any);
+
+	//_after won't start before _before has finished.
+	void addDependency(StageId _before, StageId _after);
+
+	//Runs every stage and returns once all of them have finished. If a stage throws, no further stages are started
+	//and the exception is rethrown once the ones already running are done. Throws if the dependencies form a cycle.
+	void execute(JobSystem& _jobs);
+
+	Clock::time_point getStartTime() const;
+	//Wall time of the last execute(), in seconds.
+	double getTotalTime() const;
+	size_t size() const;
+	const std::string& getName(StageId _id) const;
+	StageThread getThread(StageId _id) const;
+	const StageTiming& getTiming(StageId _id) const;
+};
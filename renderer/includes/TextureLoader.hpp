@@ -0,0 +1,59 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <TextureStreaming.hpp>
+
+struct Ktx2Level {
+	uint64_t offset = 0;		//from the start of the file
+	uint64_t length = 0;
+};
+
+//The parts of a KTX2 header the loader needs. Only single layer, single face 2D textures without supercompression.
+struct Ktx2Header {
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<Ktx2Level> levels;	//mip 0 first
+	bool generateMips = false;		//the file only has mip 0 and asks for the rest to be generated
+};
+
+Ktx2Header readKtx2Header(const std::filesystem::path& _path);
+
+//Which block compressed families the device can sample, decided at device selection.
+//The matching features have to be enabled on the logical device for the formats to be usable.
+struct TextureFormatSupport {
+	bool bc = false;
+	bool etc2 = false;
+	bool astcLdr = false;
+};
+
+TextureFormatSupport queryTextureFormatSupport(VkPhysicalDevice _physicalDevice);
+
+struct AssetStats {
+	uint32_t texturesLoaded = 0;
+	uint32_t texturesDecoded = 0;	//decoded to RGBA8 on the CPU because the device can't sample their format
+	VkDeviceSize textureBytes = 0;	//full mip chains as they are uploaded
+	VkDeviceSize rgba8Bytes = 0;	//the same chains stored as RGBA8
+};
+
+//Loads KTX2 textures into the streamer. Formats the device samples are uploaded as stored, mip by mip,
+//anything else goes through the CPU decoder as RGBA8.
+class TextureLoader
+{
+private:
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	TextureFormatSupport support;
+	TextureStreamer* streamer = nullptr;
+	AssetStats stats;
+
+public:
+	void init(VkPhysicalDevice _physicalDevice, const TextureFormatSupport& _support, TextureStreamer& _streamer);
+
+	TextureHandle loadKtx2(const std::filesystem::path& _path);
+
+	bool isSampleable(VkFormat _format) const;
+	const AssetStats& getStats() const;
+};
@@ -0,0 +1,181 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include <JobSystem.hpp>
+#include <TrackedImage.hpp>
+#include <MipGenerator.hpp>
+
+using TextureHandle = uint32_t;
+constexpr TextureHandle InvalidTexture = std::numeric_limits<uint32_t>::max();
+
+//Where a streamed texture's mips come from. Mips are read on demand, so the pixel data can stay on disk.
+struct StreamedTextureDesc {
+	VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+	uint32_t width = 0;
+	uint32_t height = 0;
+	std::vector<VkDeviceSize> mipSizes;		//bytes of each level as stored, mip 0 first
+	bool generateMips = false;				//only mip 0 is provided, the rest of the chain is generated on the GPU
+
+	//Copies mip _mip (mipSizes[_mip] bytes, tightly packed) into _destination. Streamed levels are read on the job
+	//system, so this may run on any thread and concurrently for different levels, it mustn't touch the device.
+	std::function<void(uint32_t _mip, void* _destination)> readMip;
+};
+
+struct TextureStreamingConfig {
+	VkDeviceSize budgetBytes = 0;				//0 = derive from VK_EXT_memory_budget, or half the device local heap without it
+	double budgetFraction = 0.8;				//share of the reported heap budget the streamer may take
+	VkDeviceSize uploadBytesPerFrame = 16ull << 20;	//staging size, bounds how much streams in per update
+	uint32_t mipTailSize = 128;					//mips this size and smaller are loaded up front and never evicted
+	std::filesystem::path downsampleShader;		//compute fallback for generating mips of formats that can't be blitted linearly
+};
+
+struct TextureStreamingStats {
+	VkDeviceSize budgetBytes = 0;
+	VkDeviceSize residentBytes = 0;
+	VkDeviceSize requestedBytes = 0;		//what every texture would take at the mip it was last asked for
+	uint64_t bytesUploaded = 0;
+	uint64_t mipsStreamedIn = 0;
+	uint64_t mipsRead = 0;					//read (and decoded) on the job system ahead of their upload
+	uint64_t mipsEvicted = 0;
+	uint64_t mipsGenerated = 0;
+	uint64_t barriersRecorded = 0;
+	uint64_t transitionsElided = 0;
+};
+
+//Residency decision for one texture, input to planResidency.
+struct ResidencyRequest {
+	uint32_t requestedMip = 0;		//finest level the texture was asked for
+	uint32_t tailMip = 0;			//finest level of the mip tail, which always stays resident
+	uint32_t mipCount = 0;
+	uint64_t lastUsedFrame = 0;
+	const VkDeviceSize* mipBytes = nullptr;	//device size of each level
+};
+
+//Finest mip each texture may keep so the total stays within _budget. Every texture starts at its requested mip
+//and the least recently used ones give up their finest level, one at a time, until everything fits.
+//The mip tail is never given up, so the result can still exceed _budget if the tails alone do.
+std::vector<uint32_t> planResidency(const std::vector<ResidencyRequest>& _requests, VkDeviceSize _budget);
+
+//Finest mip worth sampling for a texture covering _screenPixels pixels along its larger axis.
+uint32_t mipForScreenSize(uint32_t _width, uint32_t _height, float _screenPixels);
+
+//Keeps a window of each texture's mip chain resident on the GPU, from the finest level that's needed down to the tail.
+//A texture's image only holds its resident levels: growing or shrinking the window creates a new image,
+//copies the levels both share on the GPU and uploads the rest, so memory use follows residency instead of full chains.
+class TextureStreamer
+{
+private:
+	struct Texture {
+		StreamedTextureDesc desc;
+		std::vector<VkDeviceSize> deviceMipBytes;	//estimated device footprint per level, used for budgeting
+		uint32_t mipCount = 0;
+		uint32_t tailMip = 0;
+		uint32_t requestedMip = 0;
+		uint32_t residentMip = 0;		//finest level in the image, levels [residentMip, mipCount) are resident
+		uint64_t lastUsedFrame = 0;
+		bool loading = false;			//finer levels are being read, residency stays as is until they're uploaded
+
+		TrackedImage image;
+		VkImageView view = VK_NULL_HANDLE;
+	};
+
+	struct RetiredImage {
+		TrackedImage image;
+		VkImageView view;
+	};
+
+	//Levels [mip, residentMip) of a texture, read on the job system into memory of their own. The read function is
+	//copied so jobs never reach into textures, which addTexture() may reallocate.
+	struct PendingLoad {
+		uint32_t texture;
+		uint32_t mip;
+		std::function<void(uint32_t _mip, void* _destination)> readMip;
+		std::vector<std::vector<uint8_t>> levels;
+	};
+
+	struct ResidencyChange {
+		uint32_t texture;
+		uint32_t mip;		//new finest resident level
+		const PendingLoad* load = nullptr;	//where the levels that aren't resident yet come from, readMip without one
+	};
+
+	TextureStreamingConfig config;
+	TextureStreamingStats stats;
+
+	VkDevice device = VK_NULL_HANDLE;
+	VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+	VkQueue queue = VK_NULL_HANDLE;
+	JobSystem* jobs = nullptr;
+	PFN_vkGetPhysicalDeviceMemoryProperties2KHR getMemoryProperties2 = nullptr;
+	uint32_t deviceLocalHeap = 0;
+	VkDeviceSize deviceLocalHeapSize = 0;
+
+	VkCommandPool commandPool = VK_NULL_HANDLE;
+	VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+	VkFence uploadFence = VK_NULL_HANDLE;
+	bool recording = false;
+	bool uploadPending = false;
+	VkBuffer stagingBuffer = VK_NULL_HANDLE;
+	VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+	uint8_t* stagingMapped = nullptr;
+	VkDeviceSize stagingUsed = 0;
+
+	BarrierBatch barriers;
+	MipGenerator mipGenerator;
+
+	std::vector<Texture> textures;
+	std::vector<RetiredImage> retired;
+	//one batch of reads at a time, uploaded by the first update() after all of them finished
+	std::vector<PendingLoad> loads;
+	JobCounter loadCounter;
+	uint64_t frame = 0;
+
+public:
+	TextureStreamer() = default;
+	TextureStreamer(const TextureStreamer&) = delete;
+	TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+	//_getMemoryProperties2 may be null when VK_EXT_memory_budget isn't enabled, the configured budget is used then.
+	//Uploads are submitted to _queue, which has to be the queue that samples the textures. Streamed levels are read on
+	//_jobs, without one they're read on the thread calling update().
+	void init(VkDevice _device, VkPhysicalDevice _physicalDevice, VkQueue _queue, uint32_t _queueFamily,
+		PFN_vkGetPhysicalDeviceMemoryProperties2KHR _getMemoryProperties2, JobSystem* _jobs, const TextureStreamingConfig& _config);
+	void destroy();
+
+	//Uploads the mip tail right away, reading it on the calling thread. Finer levels only stream in once they're requested.
+	TextureHandle addTexture(StreamedTextureDesc _desc);
+
+	//Marks the texture as used this frame and needing levels down to _mip.
+	void requestMip(TextureHandle _texture, uint32_t _mip);
+
+	//Call once per frame after the previous frame's fence was waited on, before recording anything that samples.
+	//Evicts according to the budget, uploads the levels whose reads have finished and starts reading the next ones,
+	//so finer levels show up a frame or more after they were first requested. Rethrows what a read threw.
+	void update();
+
+	//The image view changes whenever residency does, descriptors referencing it must be refreshed after update().
+	VkImageView getImageView(TextureHandle _texture) const;
+	//Finest resident level in terms of the full chain, i.e. the view's level 0 is this mip of the source.
+	uint32_t getResidentMip(TextureHandle _texture) const;
+	//Size of mip 0 of the full chain.
+	VkExtent2D getExtent(TextureHandle _texture) const;
+
+	const TextureStreamingStats& getStats() const;
+	VkDeviceSize currentBudget() const;
+
+private:
+	void applyResidency(const std::vector<ResidencyChange>& _changes);
+	//Adds the uploads of a finished batch to _changes, which then has to be applied before the batch is cleared.
+	bool finishLoads(std::vector<ResidencyChange>& _changes);
+	void startLoads(const std::vector<uint32_t>& _targets);
+	void waitForLoads();
+	void beginUploads();
+	void submitUploads();
+	void waitForUploads();
+	void releaseRetired();
+};
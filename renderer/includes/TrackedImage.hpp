@@ -0,0 +1,74 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+//How a mip level was last used, i.e. what the next barrier on it has to wait for.
+struct SubresourceState {
+	VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+	VkPipelineStageFlags stages = 0;	//every stage that used it since the last barrier
+	VkAccessFlags access = 0;
+};
+
+//A 2D image that knows the layout and last access of each of its mip levels, so transitions only
+//have to name the state they want. Owns its memory when created here, wrapped images only get tracked.
+class TrackedImage
+{
+private:
+	VkImage image = VK_NULL_HANDLE;
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize memorySize = 0;
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkExtent2D extent{ 0, 0 };
+	VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	std::vector<SubresourceState> levels;
+
+	friend class BarrierBatch;
+
+public:
+	void create(VkDevice _device, VkPhysicalDevice _physicalDevice, VkFormat _format, VkExtent2D _extent,
+		uint32_t _mipLevels, VkImageUsageFlags _usage);
+	void wrap(VkImage _image, VkFormat _format, VkExtent2D _extent, uint32_t _mipLevels, VkImageAspectFlags _aspect,
+		VkImageLayout _currentLayout);
+	void destroy(VkDevice _device);
+
+	//View over levels [_baseMip, _baseMip + _levelCount), owned by the caller.
+	VkImageView createView(VkDevice _device, uint32_t _baseMip = 0, uint32_t _levelCount = VK_REMAINING_MIP_LEVELS) const;
+
+	VkImage getImage() const;
+	VkFormat getFormat() const;
+	VkExtent2D getExtent(uint32_t _mip = 0) const;
+	uint32_t getMipLevels() const;
+	VkDeviceSize getMemorySize() const;
+	const SubresourceState& getState(uint32_t _mip) const;
+};
+
+//Collects transitions for any number of images and records them as one vkCmdPipelineBarrier.
+//Transitions that don't change the layout and only add readers are elided. Each mip level may only
+//be transitioned once per flush, a second use has to depend on the first and needs its own barrier.
+class BarrierBatch
+{
+private:
+	struct Pending {
+		const TrackedImage* image;
+		uint32_t mip;
+	};
+
+	std::vector<VkImageMemoryBarrier> barriers;
+	std::vector<Pending> pending;
+	VkPipelineStageFlags srcStages = 0;
+	VkPipelineStageFlags dstStages = 0;
+	uint64_t barriersRecorded = 0;
+	uint64_t transitionsElided = 0;
+
+public:
+	void transition(TrackedImage& _image, VkImageLayout _layout, VkPipelineStageFlags _stages, VkAccessFlags _access,
+		uint32_t _baseMip = 0, uint32_t _levelCount = VK_REMAINING_MIP_LEVELS);
+
+	//Records everything collected so far, nothing if every transition was elided.
+	void flush(VkCommandBuffer _commandBuffer);
+
+	bool empty() const;
+	uint64_t getBarriersRecorded() const;
+	uint64_t getTransitionsElided() const;
+};
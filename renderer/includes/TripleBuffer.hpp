@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+//Lock-free single-producer/single-consumer handoff of the newest value.
+//The producer always owns one slot, the consumer owns another and the third sits in the middle.
+//Publishing and acquiring are a single atomic exchange of the middle slot, so neither side ever blocks.
+template <typename T>
+class TripleBuffer
+{
+private:
+	//low 2 bits: slot index, bit 2: the middle slot holds a value the consumer hasn't seen yet
+	static constexpr uint8_t IndexMask = 0x3;
+	static constexpr uint8_t FreshBit = 0x4;
+
+	T slots[3];
+
+	uint8_t writeIndex = 0;
+	uint8_t readIndex = 1;
+	alignas(64) std::atomic<uint8_t> middle{ 2 };
+
+public:
+	//Slot the producer may freely write to. It is never visible to the consumer until publish().
+	T& writeSlot()
+	{
+		return slots[writeIndex];
+	}
+
+	//Hands the write slot to the consumer and takes back whichever slot was in the middle.
+	void publish()
+	{
+		uint8_t previous = middle.exchange(writeIndex | FreshBit, std::memory_order_acq_rel);
+		writeIndex = previous & IndexMask;
+	}
+
+	//Swaps in the newest published value if there is one. Returns false if nothing new was published.
+	bool acquire()
+	{
+		if (!(middle.load(std::memory_order_relaxed) & FreshBit))
+		{
+			return false;
+		}
+
+		uint8_t previous = middle.exchange(readIndex, std::memory_order_acq_rel);
+		readIndex = previous & IndexMask;
+		return true;
+	}
+
+	//Most recently acquired value. Stays valid and unchanged until the next acquire().
+	const T& readSlot() const
+	{
+		return slots[readIndex];
+	}
+};
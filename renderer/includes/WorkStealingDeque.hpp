@@ -0,0 +1,92 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+//Chase-Lev work-stealing deque (Le et al., "Correct and Efficient Work-Stealing for Weak Memory Models").
+//The owning thread pushes and pops at the bottom, any other thread may steal from the top.
+//Capacity is fixed; push() reports failure instead of growing so the caller can run the work inline.
+template <typename T>
+class WorkStealingDeque
+{
+private:
+	alignas(64) std::atomic<int64_t> top{ 0 };
+	alignas(64) std::atomic<int64_t> bottom{ 0 };
+	int64_t mask;
+	std::unique_ptr<std::atomic<T*>[]> buffer;
+
+public:
+	//_capacity must be a power of two
+	explicit WorkStealingDeque(uint32_t _capacity)
+		: mask(static_cast<int64_t>(_capacity) - 1), buffer(new std::atomic<T*>[_capacity])
+	{
+	}
+
+	//Owner only.
+	bool push(T* _item)
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed);
+		int64_t t = top.load(std::memory_order_acquire);
+		if (b - t > mask)
+		{
+			return false;
+		}
+
+		buffer[b & mask].store(_item, std::memory_order_relaxed);
+		//release pairs with the acquire load of bottom in steal(), publishing the item and whatever it points to
+		bottom.store(b + 1, std::memory_order_release);
+		return true;
+	}
+
+	//Owner only. Returns nullptr when empty or when the last item was lost to a thief.
+	T* pop()
+	{
+		int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+		bottom.store(b, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t t = top.load(std::memory_order_relaxed);
+
+		if (t > b)
+		{
+			bottom.store(b + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		T* item = buffer[b & mask].load(std::memory_order_relaxed);
+		if (t == b)
+		{
+			//last item, race the thieves for it
+			if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				item = nullptr;
+			}
+			bottom.store(b + 1, std::memory_order_relaxed);
+		}
+		return item;
+	}
+
+	//Any thread. Returns nullptr when empty or when another thread won the race.
+	T* steal()
+	{
+		int64_t t = top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		int64_t b = bottom.load(std::memory_order_acquire);
+
+		if (t >= b)
+		{
+			return nullptr;
+		}
+
+		T* item = buffer[t & mask].load(std::memory_order_relaxed);
+		if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			return nullptr;
+		}
+		return item;
+	}
+
+	bool empty() const
+	{
+		return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+	}
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <ShaderCache.hpp>
+
+//Index of the first memory type allowed by _typeBits that has every flag in _properties.
+inline uint32_t findMemoryType(VkPhysicalDevice _physicalDevice, uint32_t _typeBits, VkMemoryPropertyFlags _properties)
+{
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(_physicalDevice, &memoryProperties);
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; ++i)
+	{
+		if ((_typeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & _properties) == _properties)
+		{
+			return i;
+		}
+	}
+
+	throw std::runtime_error("[VK_Memory]: No suitable memory type found!");
+}
+
+//Rounds _value up to a multiple of _alignment, which Vulkan guarantees is a power of two.
+inline VkDeviceSize alignUp(VkDeviceSize _value, VkDeviceSize _alignment)
+{
+	return (_value + _alignment - 1) & ~(_alignment - 1);
+}
+
+//Creates a buffer with its own memory allocation. Buffers used by more than one queue family are created
+//with concurrent sharing so they never need an ownership transfer.
+inline void createBuffer(VkDevice _device, VkPhysicalDevice _physicalDevice, VkDeviceSize _size, VkBufferUsageFlags _usage,
+	VkMemoryPropertyFlags _properties, const std::vector<uint32_t>& _queueFamilies, VkBuffer& _buffer, VkDeviceMemory& _memory)
+{
+	bool concurrent = _queueFamilies.size() > 1;
+
+	VkBufferCreateInfo bufferInfo{
+		VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,								//sType
+		nullptr,															//pNext
+		0,																	//flags
+		_size,																//size
+		_usage,																//usage
+		concurrent ? VK_SHARING_MODE_CONCURRENT : VK_SHARING_MODE_EXCLUSIVE,//sharingMode
+		static_cast<uint32_t>(concurrent ? _queueFamilies.size() : 0),		//queueFamilyIndexCount
+		concurrent ? _queueFamilies.data() : nullptr						//pQueueFamilyIndices
+	};
+	if (vkCreateBuffer(_device, &bufferInfo, nullptr, &_buffer) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Memory]: Failed to create buffer!");
+	}
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(_device, _buffer, &requirements);
+
+	VkMemoryAllocateInfo allocateInfo{
+		VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,	//sType
+		nullptr,								//pNext
+		requirements.size,						//allocationSize
+		findMemoryType(_physicalDevice, requirements.memoryTypeBits, _properties)	//memoryTypeIndex
+	};
+	if (vkAllocateMemory(_device, &allocateInfo, nullptr, &_memory) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Memory]: Failed to allocate buffer memory!");
+	}
+
+	vkBindBufferMemory(_device, _buffer, _memory, 0);
+}
+
+//Reads a SPIR-V file into a shader module, for code outside the Engine that brings its own shaders.
+//Shaders preloaded at startup come from the ShaderCache instead of the disk.
+inline VkShaderModule loadShaderModule(VkDevice _device, const std::filesystem::path& _path)
+{
+	std::vector<char> code = ShaderCache::get().read(_path);
+
+	VkShaderModuleCreateInfo createInfo{
+		VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,		//sType
+		nullptr,											//pNext
+		0,													//flags
+		code.size(),										//codeSize
+		reinterpret_cast<const uint32_t*>(code.data())		//pCode
+	};
+
+	VkShaderModule shaderModule;
+	if (vkCreateShaderModule(_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+		throw std::runtime_error("[VK_Device]: Failed to Create Shader Module.");
+	}
+	return shaderModule;
+}
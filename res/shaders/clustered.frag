@@ -0,0 +1,55 @@
+#version 460
+
+//testf.frag lit by point lights: the fragment finds its cluster and only shades with the lights binned into it.
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragPosition;
+layout(location = 2) in vec3 fragNormal;
+
+layout(location = 0) out vec4 outColor;
+
+//PointLight in ClusteredLighting.hpp
+struct PointLight {
+    vec4 positionRadius;
+    vec4 color;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer Lights {
+    PointLight lights[];
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Clusters {
+    uvec2 clusters[];   //first index, light count
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+//after the vertex stage's MeshPushConstants
+layout(push_constant) uniform Grid {
+    layout(offset = 32) vec2 tileScale;
+    uint tilesX;
+    uint tilesY;
+    uint slices;
+};
+
+const vec3 ambient = vec3(0.1);
+
+void main() {
+    uvec2 tile = min(uvec2(gl_FragCoord.xy * tileScale), uvec2(tilesX, tilesY) - 1);
+    uint slice = min(uint(gl_FragCoord.z * slices), slices - 1);
+    uvec2 cluster = clusters[(slice * tilesY + tile.y) * tilesX + tile.x];
+
+    vec3 normal = normalize(fragNormal);
+    vec3 lighting = ambient;
+    for (uint i = 0; i < cluster.y; ++i) {
+        PointLight light = lights[lightIndices[cluster.x + i]];
+        vec3 toLight = light.positionRadius.xyz - fragPosition;
+        float lightDistance = length(toLight);
+        //smooth falloff reaching 0 at the radius the light was binned with, so cluster edges never show
+        float window = clamp(1.0 - pow(lightDistance / light.positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (1.0 + lightDistance * lightDistance);
+        lighting += light.color.rgb * max(dot(normal, toLight / max(lightDistance, 1e-4)), 0.0) * attenuation;
+    }
+    outColor = vec4(fragColor * lighting, 1.0);
+}
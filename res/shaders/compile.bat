@@ -1,3 +1,22 @@
-C:/VulkanSDK/1.3.231.1/Bin/glslc.exe testv.vert -o vert.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe mesh.vert -o mesh.spv
 C:/VulkanSDK/1.3.231.1/Bin/glslc.exe testf.frag -o frag.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe clustered.frag -o clustered.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe textured.frag -o textured.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe light_cluster.comp -o light_cluster.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe cull.comp -o cull.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe downsample.comp -o downsample.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe hiz_reduce.comp -o hiz_reduce.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe --target-spv=spv1.4 meshlet_cull.task -o meshlet_cull.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe --target-spv=spv1.4 meshlet.mesh -o meshlet.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe meshlet_expand.comp -o meshlet_expand.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe fullscreen.vert -o fullscreen.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe upscale.frag -o upscale.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe instanced.vert -o instanced.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe particle.vert -o particle.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe particle_sprite.frag -o particle_sprite.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe particle_reset.comp -o particle_reset.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe particle_emit.comp -o particle_emit.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe particle_args.comp -o particle_args.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe particle_simulate.comp -o particle_simulate.spv
+C:/VulkanSDK/1.3.231.1/Bin/glslc.exe particle_sort.comp -o particle_sort.spv
 pause
\ No newline at end of file
@@ -0,0 +1,37 @@
+#version 460
+
+//Cooked vertices like mesh.vert, plus one InstanceData per instance from binding 1, see InstanceBatcher.hpp
+layout(location = 0) in vec4 inPosition;    //unorm16 within the mesh bounds
+layout(location = 1) in vec2 inNormal;      //octahedral
+layout(location = 2) in vec2 inTexcoord;
+layout(location = 3) in vec4 inTransform0;  //rows of the instance's world transform
+layout(location = 4) in vec4 inTransform1;
+layout(location = 5) in vec4 inTransform2;
+layout(location = 6) in vec4 inColor;       //unorm8
+layout(location = 7) in vec3 inCustom;      //for materials with shaders of their own
+
+layout(location = 0) out vec3 fragColor;
+
+layout(push_constant) uniform Instances {
+    mat4 viewProjection;
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (normal.z < 0.0) {
+        normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(normal);
+}
+
+void main() {
+    vec4 position = vec4(positionOffset.xyz + inPosition.xyz * positionScale.xyz, 1.0);
+    vec3 world = vec3(dot(inTransform0, position), dot(inTransform1, position), dot(inTransform2, position));
+    gl_Position = viewProjection * vec4(world, 1.0);
+
+    vec3 normal = decodeOctahedral(inNormal);
+    normal = normalize(vec3(dot(inTransform0.xyz, normal), dot(inTransform1.xyz, normal), dot(inTransform2.xyz, normal)));
+    fragColor = inColor.rgb * (0.6 + 0.4 * normal.z);
+}
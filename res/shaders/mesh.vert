@@ -0,0 +1,34 @@
+#version 460
+
+//Unpacks the cooked vertex format, see PackedVertex in MeshFormat.hpp
+layout(location = 0) in vec4 inPosition;    //unorm16 within the mesh bounds
+layout(location = 1) in vec2 inNormal;      //octahedral
+layout(location = 2) in vec2 inTexcoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosition;    //world space, for clustered.frag
+layout(location = 2) out vec3 fragNormal;
+layout(location = 3) out vec2 fragTexcoord;  //for textured.frag
+
+layout(push_constant) uniform Mesh {
+    vec4 positionOffset;
+    vec4 positionScale;
+};
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    if (normal.z < 0.0) {
+        normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(normal);
+}
+
+void main() {
+    vec3 position = positionOffset.xyz + inPosition.xyz * positionScale.xyz;
+    vec3 normal = decodeOctahedral(inNormal);
+    gl_Position = vec4(position, 1.0);
+    fragColor = normal * 0.5 + 0.5;
+    fragPosition = position;
+    fragNormal = normal;
+    fragTexcoord = inTexcoord;
+}
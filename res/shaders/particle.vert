@@ -0,0 +1,46 @@
+#version 460
+
+//One quad per particle in sort order, expanded from the vertex index. The instance count comes from the GPU.
+layout(std430, set = 0, binding = 0) readonly buffer Positions {
+    vec4 positions[];   //xyz, w = age
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer Velocities {
+    vec4 velocities[];  //xyz, w = lifetime
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer Colors {
+    uint colors[];      //RGBA8
+};
+
+layout(std430, set = 0, binding = 6) readonly buffer SortKeys {
+    uvec2 keys[];       //x = key, y = particle index
+};
+
+layout(push_constant) uniform Draw {
+    mat4 viewProjection;
+    float size;         //half size in clip space at w = 1
+    float aspect;       //width over height
+};
+
+layout(location = 0) out vec4 fragColor;
+layout(location = 1) out vec2 fragCorner;
+
+const vec2 corners[6] = vec2[](
+    vec2(-1.0, -1.0), vec2(1.0, -1.0), vec2(1.0, 1.0),
+    vec2(-1.0, -1.0), vec2(1.0, 1.0), vec2(-1.0, 1.0)
+);
+
+void main() {
+    uint index = keys[gl_InstanceIndex].y;
+    vec4 position = positions[index];
+    float life = position.w / velocities[index].w;
+
+    vec2 corner = corners[gl_VertexIndex];
+    gl_Position = viewProjection * vec4(position.xyz, 1.0);
+    gl_Position.xy += corner * size * vec2(1.0 / aspect, 1.0);
+
+    fragColor = unpackUnorm4x8(colors[index]);
+    fragColor.a *= 1.0 - life;
+    fragCorner = corner;
+}
@@ -0,0 +1,14 @@
+#version 460
+
+//Unlit, samples the streamed scene texture, whichever of its mips are resident
+layout(location = 2) in vec3 fragNormal;
+layout(location = 3) in vec2 fragTexcoord;
+
+layout(set = 0, binding = 0) uniform sampler2D sceneTexture;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float facing = 0.5 + 0.5 * abs(normalize(fragNormal).z);
+    outColor = vec4(texture(sceneTexture, fragTexcoord).rgb * facing, 1.0);
+}
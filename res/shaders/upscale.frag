@@ -0,0 +1,43 @@
+#version 460
+
+//Stretches the rendered part of the scene target over the swapchain image. Sharpening is contrast adaptive, after
+//AMD's CAS: the cross around each pixel is subtracted less where it's already close to clipping, so edges don't ring.
+layout(location = 0) in vec2 uv;
+
+layout(location = 0) out vec4 outColor;
+
+layout(set = 0, binding = 0) uniform sampler2D scene;
+
+layout(push_constant) uniform Upscale {
+    vec2 uvScale;       //rendered extent over the scene target's extent
+    vec2 texelSize;     //of the scene target
+    vec2 uvMin;         //first and last rendered texel centers, nothing outside them is sampled
+    vec2 uvMax;
+    float sharpness;    //0 to 1
+    uint sharpen;
+};
+
+vec3 fetch(vec2 sceneUV) {
+    return texture(scene, clamp(sceneUV, uvMin, uvMax)).rgb;
+}
+
+void main() {
+    vec2 sceneUV = uv * uvScale;
+    vec3 center = fetch(sceneUV);
+    if (sharpen == 0) {
+        outColor = vec4(center, 1.0);
+        return;
+    }
+
+    vec3 north = fetch(sceneUV - vec2(0.0, texelSize.y));
+    vec3 south = fetch(sceneUV + vec2(0.0, texelSize.y));
+    vec3 west = fetch(sceneUV - vec2(texelSize.x, 0.0));
+    vec3 east = fetch(sceneUV + vec2(texelSize.x, 0.0));
+
+    vec3 lowest = min(center, min(min(north, south), min(west, east)));
+    vec3 highest = max(center, max(max(north, south), max(west, east)));
+    vec3 amount = sqrt(clamp(min(lowest, 1.0 - highest) / max(highest, 1e-4), 0.0, 1.0));
+    vec3 weight = -amount / mix(8.0, 5.0, sharpness);
+    vec3 sharpened = (center + (north + south + west + east) * weight) / (1.0 + 4.0 * weight);
+    outColor = vec4(clamp(sharpened, 0.0, 1.0), 1.0);
+}
@@ -0,0 +1,270 @@
+#include "Json.hpp"
+
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace {
+	class JsonParser
+	{
+	private:
+		const std::string& text;
+		size_t position = 0;
+
+	public:
+		explicit JsonParser(const std::string& _text) : text(_text) {}
+
+		JsonValue parseDocument()
+		{
+			JsonValue value = parseValue();
+			skipWhitespace();
+			if (position != text.size())
+			{
+				fail("trailing characters");
+			}
+			return value;
+		}
+
+	private:
+		[[noreturn]] void fail(const char* _what) const
+		{
+			throw std::runtime_error(std::string("[Json]: ") + _what + " at offset " + std::to_string(position));
+		}
+
+		void skipWhitespace()
+		{
+			while (position < text.size() && (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+			{
+				position++;
+			}
+		}
+
+		bool consume(char _expected)
+		{
+			skipWhitespace();
+			if (position < text.size() && text[position] == _expected)
+			{
+				position++;
+				return true;
+			}
+			return false;
+		}
+
+		void expect(char _expected)
+		{
+			if (!consume(_expected))
+			{
+				fail("unexpected character");
+			}
+		}
+
+		bool consumeLiteral(const char* _literal)
+		{
+			size_t length = std::char_traits<char>::length(_literal);
+			if (text.compare(position, length, _literal) == 0)
+			{
+				position += length;
+				return true;
+			}
+			return false;
+		}
+
+		JsonValue parseValue()
+		{
+			skipWhitespace();
+			if (position >= text.size())
+			{
+				fail("unexpected end");
+			}
+
+			JsonValue value;
+			char c = text[position];
+			if (c == '{')
+			{
+				value.type = JsonValue::Type::Object;
+				position++;
+				if (!consume('}'))
+				{
+					do {
+						skipWhitespace();
+						std::string key = parseString();
+						expect(':');
+						value.object.emplace_back(std::move(key), parseValue());
+					} while (consume(','));
+					expect('}');
+				}
+			}
+			else if (c == '[')
+			{
+				value.type = JsonValue::Type::Array;
+				position++;
+				if (!consume(']'))
+				{
+					do {
+						value.array.push_back(parseValue());
+					} while (consume(','));
+					expect(']');
+				}
+			}
+			else if (c == '"')
+			{
+				value.type = JsonValue::Type::String;
+				value.string = parseString();
+			}
+			else if (consumeLiteral("true"))
+			{
+				value.type = JsonValue::Type::Bool;
+				value.boolean = true;
+			}
+			else if (consumeLiteral("false"))
+			{
+				value.type = JsonValue::Type::Bool;
+			}
+			else if (consumeLiteral("null"))
+			{
+				value.type = JsonValue::Type::Null;
+			}
+			else {
+				const char* start = text.c_str() + position;
+				char* end = nullptr;
+				value.type = JsonValue::Type::Number;
+				value.number = std::strtod(start, &end);
+				if (end == start)
+				{
+					fail("invalid value");
+				}
+				position += static_cast<size_t>(end - start);
+			}
+			return value;
+		}
+
+		void appendUtf8(std::string& _out, uint32_t _codepoint)
+		{
+			if (_codepoint < 0x80)
+			{
+				_out += static_cast<char>(_codepoint);
+			}
+			else if (_codepoint < 0x800)
+			{
+				_out += static_cast<char>(0xc0 | (_codepoint >> 6));
+				_out += static_cast<char>(0x80 | (_codepoint & 0x3f));
+			}
+			else if (_codepoint < 0x10000)
+			{
+				_out += static_cast<char>(0xe0 | (_codepoint >> 12));
+				_out += static_cast<char>(0x80 | ((_codepoint >> 6) & 0x3f));
+				_out += static_cast<char>(0x80 | (_codepoint & 0x3f));
+			}
+			else {
+				_out += static_cast<char>(0xf0 | (_codepoint >> 18));
+				_out += static_cast<char>(0x80 | ((_codepoint >> 12) & 0x3f));
+				_out += static_cast<char>(0x80 | ((_codepoint >> 6) & 0x3f));
+				_out += static_cast<char>(0x80 | (_codepoint & 0x3f));
+			}
+		}
+
+		uint32_t parseHex4()
+		{
+			if (position + 4 > text.size())
+			{
+				fail("truncated escape");
+			}
+			uint32_t value = static_cast<uint32_t>(std::strtoul(text.substr(position, 4).c_str(), nullptr, 16));
+			position += 4;
+			return value;
+		}
+
+		std::string parseString()
+		{
+			if (position >= text.size() || text[position] != '"')
+			{
+				fail("expected a string");
+			}
+			position++;
+
+			std::string result;
+			while (position < text.size() && text[position] != '"')
+			{
+				char c = text[position++];
+				if (c != '\\')
+				{
+					result += c;
+					continue;
+				}
+				if (position >= text.size())
+				{
+					fail("truncated escape");
+				}
+
+				char escape = text[position++];
+				switch (escape)
+				{
+				case 'b': result += '\b'; break;
+				case 'f': result += '\f'; break;
+				case 'n': result += '\n'; break;
+				case 'r': result += '\r'; break;
+				case 't': result += '\t'; break;
+				case 'u': {
+					uint32_t codepoint = parseHex4();
+					//surrogate pair
+					if (codepoint >= 0xd800 && codepoint < 0xdc00 && text.compare(position, 2, "\\u") == 0)
+					{
+						position += 2;
+						codepoint = 0x10000 + ((codepoint - 0xd800) << 10) + (parseHex4() - 0xdc00);
+					}
+					appendUtf8(result, codepoint);
+					break;
+				}
+				default: result += escape; break;
+				}
+			}
+			if (position >= text.size())
+			{
+				fail("unterminated string");
+			}
+			position++;
+			return result;
+		}
+	};
+
+	const JsonValue NullValue;
+}
+
+const JsonValue* JsonValue::find(const std::string& _key) const
+{
+	for (const auto& member : object)
+	{
+		if (member.first == _key)
+		{
+			return &member.second;
+		}
+	}
+	return nullptr;
+}
+
+double JsonValue::getNumber(const std::string& _key, double _fallback) const
+{
+	const JsonValue* member = find(_key);
+	return member && member->type == Type::Number ? member->number : _fallback;
+}
+
+std::string JsonValue::getString(const std::string& _key, const std::string& _fallback) const
+{
+	const JsonValue* member = find(_key);
+	return member && member->type == Type::String ? member->string : _fallback;
+}
+
+size_t JsonValue::size() const
+{
+	return type == Type::Array ? array.size() : object.size();
+}
+
+const JsonValue& JsonValue::operator[](size_t _index) const
+{
+	return _index < array.size() ? array[_index] : NullValue;
+}
+
+JsonValue parseJson(const std::string& _text)
+{
+	return JsonParser(_text).parseDocument();
+}
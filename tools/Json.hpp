@@ -0,0 +1,30 @@
+#pragma once
+#include <string>
+#include <utility>
+#include <vector>
+
+//Just enough JSON for glTF: the whole document is parsed into a tree up front.
+class JsonValue
+{
+public:
+	enum class Type { Null, Bool, Number, String, Array, Object };
+
+	Type type = Type::Null;
+	bool boolean = false;
+	double number = 0.0;
+	std::string string;
+	std::vector<JsonValue> array;
+	std::vector<std::pair<std::string, JsonValue>> object;	//in document order
+
+	//Member with the given key, nullptr if this isn't an object or has no such member.
+	const JsonValue* find(const std::string& _key) const;
+
+	//Typed access to members, _fallback when the member is missing.
+	double getNumber(const std::string& _key, double _fallback) const;
+	std::string getString(const std::string& _key, const std::string& _fallback) const;
+
+	size_t size() const;
+	const JsonValue& operator[](size_t _index) const;
+};
+
+JsonValue parseJson(const std::string& _text);
@@ -0,0 +1,241 @@
+#include "MeshImport.hpp"
+
+#include <MeshFormat.hpp>
+#include <MeshOptimizer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+struct CookerOptions {
+	std::filesystem::path input;
+	std::filesystem::path output;
+	bool overdraw = true;
+	float overdrawThreshold = 1.05f;	//ACMR the overdraw pass may give up, relative to the cache optimized order
+	uint32_t cacheSize = 16;			//FIFO size the ACMR is reported for
+	uint32_t lodCount = 6;				//levels of detail including the full mesh, fewer when simplification stalls
+	float lodRatio = 0.5f;				//triangles each level keeps of the one before it
+	float lodError = 0.05f;				//largest simplification error, relative to the mesh's bounding radius
+};
+
+static void printUsage()
+{
+	std::cout << "Usage: mesh_cooker <input.obj|.gltf|.glb> <output.vmesh> [options]\n"
+		<< "  --overdraw-threshold <x>  ACMR allowed for overdraw ordering, relative to the cache order (default 1.05)\n"
+		<< "  --no-overdraw             only optimize for the vertex cache\n"
+		<< "  --cache-size <n>          FIFO size used for the ACMR report (default 16)\n"
+		<< "  --lods <n>                levels of detail including the full mesh, at most " << MeshMaxLods << " (default 6)\n"
+		<< "  --lod-ratio <x>           triangles each level keeps of the previous one (default 0.5)\n"
+		<< "  --lod-error <x>           largest simplification error relative to the bounding radius (default 0.05)\n";
+}
+
+static CookerOptions parseArguments(int argc, char** argv)
+{
+	CookerOptions options;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		auto nextValue = [&]() -> std::string
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::invalid_argument(std::string("[MeshCooker]: Missing value for ") + argv[i]);
+			}
+			return argv[++i];
+		};
+
+		if (strcmp(argv[i], "--overdraw-threshold") == 0)
+		{
+			options.overdrawThreshold = std::stof(nextValue());
+		}
+		else if (strcmp(argv[i], "--no-overdraw") == 0)
+		{
+			options.overdraw = false;
+		}
+		else if (strcmp(argv[i], "--cache-size") == 0)
+		{
+			options.cacheSize = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--lods") == 0)
+		{
+			options.lodCount = std::clamp(static_cast<uint32_t>(std::stoul(nextValue())), 1u, MeshMaxLods);
+		}
+		else if (strcmp(argv[i], "--lod-ratio") == 0)
+		{
+			options.lodRatio = std::clamp(std::stof(nextValue()), 0.01f, 0.95f);
+		}
+		else if (strcmp(argv[i], "--lod-error") == 0)
+		{
+			options.lodError = std::stof(nextValue());
+		}
+		else if (strncmp(argv[i], "--", 2) == 0)
+		{
+			throw std::invalid_argument(std::string("[MeshCooker]: Unknown argument ") + argv[i]);
+		}
+		else {
+			positional.push_back(argv[i]);
+		}
+	}
+
+	if (positional.size() != 2)
+	{
+		printUsage();
+		throw std::invalid_argument("[MeshCooker]: Expected an input and an output file");
+	}
+	options.input = positional[0];
+	options.output = positional[1];
+	return options;
+}
+
+//Radius of the sphere around the bounding box center, the error bound is relative to it.
+static float boundingRadius(const std::vector<MeshVertex>& _vertices)
+{
+	float boundsMin[3] = { _vertices[0].position[0], _vertices[0].position[1], _vertices[0].position[2] };
+	float boundsMax[3] = { boundsMin[0], boundsMin[1], boundsMin[2] };
+	for (const MeshVertex& vertex : _vertices)
+	{
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			boundsMin[axis] = std::min(boundsMin[axis], vertex.position[axis]);
+			boundsMax[axis] = std::max(boundsMax[axis], vertex.position[axis]);
+		}
+	}
+
+	float radiusSquared = 0.0f;
+	for (const MeshVertex& vertex : _vertices)
+	{
+		float distanceSquared = 0.0f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			float offset = vertex.position[axis] - (boundsMin[axis] + boundsMax[axis]) * 0.5f;
+			distanceSquared += offset * offset;
+		}
+		radiusSquared = std::max(radiusSquared, distanceSquared);
+	}
+	return std::sqrt(radiusSquared);
+}
+
+int main(int argc, char** argv)
+{
+	try {
+		CookerOptions options = parseArguments(argc, argv);
+		Clock::time_point start = Clock::now();
+
+		ImportedMesh mesh = importMesh(options.input);
+		size_t importedVertices = mesh.vertices.size();
+		size_t triangleCount = mesh.indices.size() / 3;
+		if (triangleCount == 0)
+		{
+			throw std::runtime_error("[MeshCooker]: " + options.input.string() + " has no triangles!");
+		}
+
+		deduplicateVertices(mesh.vertices, mesh.indices);
+		VertexCacheStats sourceOrder = analyzeVertexCache(mesh.indices, mesh.vertices.size(), options.cacheSize);
+
+		//every level is simplified from the full mesh, so its error is measured against the original surface
+		std::vector<std::vector<uint32_t>> lodIndices = { mesh.indices };
+		std::vector<float> lodErrors = { 0.0f };
+		float errorLimit = options.lodError * boundingRadius(mesh.vertices);
+		while (lodIndices.size() < options.lodCount)
+		{
+			size_t target = static_cast<size_t>(lodIndices.back().size() / 3 * options.lodRatio) * 3;
+			float error = 0.0f;
+			std::vector<uint32_t> simplified = simplifyMesh(mesh.vertices, mesh.indices, target, errorLimit, &error);
+			//a level that barely shrinks only costs memory, the error bound was reached
+			if (simplified.empty() || simplified.size() > lodIndices.back().size() * 9 / 10)
+			{
+				break;
+			}
+			lodIndices.push_back(std::move(simplified));
+			lodErrors.push_back(std::max(error, lodErrors.back()));
+		}
+
+		for (std::vector<uint32_t>& indices : lodIndices)
+		{
+			optimizeVertexCache(indices, mesh.vertices.size());
+		}
+		VertexCacheStats cacheOrder = analyzeVertexCache(lodIndices[0], mesh.vertices.size(), options.cacheSize);
+
+		VertexCacheStats finalOrder = cacheOrder;
+		if (options.overdraw)
+		{
+			for (std::vector<uint32_t>& indices : lodIndices)
+			{
+				optimizeOverdraw(indices, mesh.vertices, options.overdrawThreshold);
+			}
+			finalOrder = analyzeVertexCache(lodIndices[0], mesh.vertices.size(), options.cacheSize);
+		}
+
+		//the full mesh decides the vertex order, coarser levels use a subset of its vertices
+		std::vector<uint32_t> allIndices;
+		for (const std::vector<uint32_t>& indices : lodIndices)
+		{
+			allIndices.insert(allIndices.end(), indices.begin(), indices.end());
+		}
+		optimizeVertexFetch(mesh.vertices, allIndices);
+		size_t firstIndex = 0;
+		for (std::vector<uint32_t>& indices : lodIndices)
+		{
+			std::copy(allIndices.begin() + firstIndex, allIndices.begin() + firstIndex + indices.size(), indices.begin());
+			firstIndex += indices.size();
+		}
+
+		CookedMesh cooked = packMesh(mesh.vertices, lodIndices, lodErrors);
+		writeCookedMesh(options.output, cooked);
+
+		double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+		size_t importedVertexBytes = importedVertices * sizeof(MeshVertex);
+		size_t cookedVertexBytes = cooked.vertices.size() * sizeof(PackedVertex);
+		size_t importedIndexBytes = triangleCount * 3 * sizeof(uint32_t);
+
+		std::cout << std::fixed << std::setprecision(3);
+		std::cout << "[MeshCooker]: " << options.input.filename().string() << " -> " << options.output.filename().string()
+			<< " in " << seconds * 1e3 << " ms\n";
+		std::cout << "[MeshCooker]: " << triangleCount << " triangles, " << importedVertices << " vertices imported, "
+			<< cooked.vertices.size() << " after deduplication" << (mesh.generatedNormals ? " (normals generated)" : "") << "\n";
+		std::cout << "[MeshCooker]: ACMR (" << options.cacheSize << " entry FIFO): " << sourceOrder.acmr << " source order, "
+			<< cacheOrder.acmr << " vertex cache order";
+		if (options.overdraw)
+		{
+			std::cout << ", " << finalOrder.acmr << " after overdraw ordering";
+		}
+		std::cout << " (ATVR " << sourceOrder.atvr << " -> " << finalOrder.atvr << ")\n";
+		std::cout << "[MeshCooker]: Vertex bytes: " << importedVertexBytes << " -> " << cookedVertexBytes << " ("
+			<< importedVertexBytes - cookedVertexBytes << " saved), index bytes: " << importedIndexBytes << " -> "
+			<< cooked.indices.size() << " (" << cooked.header.indexSize * 8 << " bit)\n";
+
+		for (size_t lod = 0; lod < cooked.lods.size(); ++lod)
+		{
+			const MeshLod& level = cooked.lods[lod];
+			std::cout << "[MeshCooker]: LOD " << lod << ": " << level.indexCount / 3 << " triangles ("
+				<< 100.0 * level.indexCount / 3 / triangleCount << "%), " << level.meshletCount << " meshlets, error "
+				<< level.error << "\n";
+		}
+
+		size_t cullableCones = 0;
+		for (const Meshlet& meshlet : cooked.meshlets)
+		{
+			cullableCones += meshlet.coneCutoff < 1.0f ? 1 : 0;
+		}
+		double meshletCount = static_cast<double>(cooked.meshlets.size());
+		std::cout << "[MeshCooker]: " << cooked.meshlets.size() << " meshlets over all levels, avg " << cooked.meshletVertices.size() / meshletCount
+			<< " vertices and " << allIndices.size() / 3 / meshletCount << " triangles (max " << MeshletMaxVertices << "/" << MeshletMaxTriangles
+			<< "), " << 100.0 * cullableCones / meshletCount << "% backface cullable\n";
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,681 @@
+#include "MeshImport.hpp"
+#include "Json.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+namespace {
+	glm::vec3 normalizeOr(const glm::vec3& _vector, const glm::vec3& _fallback)
+	{
+		float length = glm::length(_vector);
+		return length > 0.0f ? _vector / length : _fallback;
+	}
+
+	void setVertex(MeshVertex& _vertex, const glm::vec3& _position, const glm::vec3& _normal, const glm::vec2& _texcoord)
+	{
+		std::memcpy(_vertex.position, glm::value_ptr(_position), sizeof(_vertex.position));
+		std::memcpy(_vertex.normal, glm::value_ptr(_normal), sizeof(_vertex.normal));
+		std::memcpy(_vertex.texcoord, glm::value_ptr(_texcoord), sizeof(_vertex.texcoord));
+	}
+
+	std::vector<uint8_t> readBinaryFile(const std::filesystem::path& _path)
+	{
+		std::ifstream file(_path, std::ios::ate | std::ios::binary);
+		if (!file.is_open())
+		{
+			throw std::runtime_error("[Import]: Couldn't open " + _path.string());
+		}
+
+		std::vector<uint8_t> bytes(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+		return bytes;
+	}
+
+	//OBJ indices are 1 based, negative ones count back from the last element read so far.
+	int32_t resolveObjIndex(const std::string& _token, size_t _count, size_t _lineNumber)
+	{
+		if (_token.empty())
+		{
+			return -1;
+		}
+
+		long index = std::stol(_token);
+		long resolved = index > 0 ? index - 1 : static_cast<long>(_count) + index;
+		if (index == 0 || resolved < 0 || resolved >= static_cast<long>(_count))
+		{
+			throw std::runtime_error("[Import]: Index " + _token + " out of range on line " + std::to_string(_lineNumber));
+		}
+		return static_cast<int32_t>(resolved);
+	}
+}
+
+ImportedMesh importObj(const std::filesystem::path& _path)
+{
+	std::ifstream file(_path);
+	if (!file.is_open())
+	{
+		throw std::runtime_error("[Import]: Couldn't open " + _path.string());
+	}
+
+	struct Corner {
+		int32_t position;
+		int32_t texcoord;	//-1 when the face has none
+		int32_t normal;
+	};
+
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<glm::vec2> texcoords;
+	std::vector<Corner> corners;	//three per triangle
+	std::vector<Corner> face;
+
+	std::string line;
+	size_t lineNumber = 0;
+	while (std::getline(file, line))
+	{
+		lineNumber++;
+		std::istringstream stream(line);
+		std::string keyword;
+		stream >> keyword;
+
+		if (keyword == "v")
+		{
+			glm::vec3 position(0.0f);
+			stream >> position.x >> position.y >> position.z;
+			positions.push_back(position);
+		}
+		else if (keyword == "vn")
+		{
+			glm::vec3 normal(0.0f);
+			stream >> normal.x >> normal.y >> normal.z;
+			normals.push_back(normal);
+		}
+		else if (keyword == "vt")
+		{
+			glm::vec2 texcoord(0.0f);
+			stream >> texcoord.x >> texcoord.y;
+			//OBJ puts v = 0 at the bottom, Vulkan samples from the top
+			texcoords.push_back(glm::vec2(texcoord.x, 1.0f - texcoord.y));
+		}
+		else if (keyword == "f")
+		{
+			//v, v/vt, v//vn or v/vt/vn
+			face.clear();
+			std::string token;
+			while (stream >> token)
+			{
+				size_t firstSlash = token.find('/');
+				size_t secondSlash = firstSlash == std::string::npos ? std::string::npos : token.find('/', firstSlash + 1);
+
+				Corner corner;
+				corner.position = resolveObjIndex(token.substr(0, firstSlash), positions.size(), lineNumber);
+				corner.texcoord = firstSlash == std::string::npos ? -1 :
+					resolveObjIndex(token.substr(firstSlash + 1, secondSlash - firstSlash - 1), texcoords.size(), lineNumber);
+				corner.normal = secondSlash == std::string::npos ? -1 :
+					resolveObjIndex(token.substr(secondSlash + 1), normals.size(), lineNumber);
+				if (corner.position < 0)
+				{
+					throw std::runtime_error("[Import]: Face without a position on line " + std::to_string(lineNumber));
+				}
+				face.push_back(corner);
+			}
+			if (face.size() < 3)
+			{
+				throw std::runtime_error("[Import]: Face with less than 3 corners on line " + std::to_string(lineNumber));
+			}
+
+			for (size_t k = 1; k + 1 < face.size(); ++k)
+			{
+				corners.push_back(face[0]);
+				corners.push_back(face[k]);
+				corners.push_back(face[k + 1]);
+			}
+		}
+	}
+
+	ImportedMesh mesh;
+
+	//corners without a normal get the average of the faces around their position, i.e. smooth shading
+	std::vector<glm::vec3> positionNormals;
+	for (size_t i = 0; i < corners.size(); i += 3)
+	{
+		if (corners[i].normal >= 0 && corners[i + 1].normal >= 0 && corners[i + 2].normal >= 0)
+		{
+			continue;
+		}
+		if (positionNormals.empty())
+		{
+			positionNormals.assign(positions.size(), glm::vec3(0.0f));
+			mesh.generatedNormals = true;
+		}
+
+		const glm::vec3& p0 = positions[corners[i].position];
+		glm::vec3 faceNormal = glm::cross(positions[corners[i + 1].position] - p0, positions[corners[i + 2].position] - p0);
+		for (int corner = 0; corner < 3; ++corner)
+		{
+			positionNormals[corners[i + corner].position] += faceNormal;
+		}
+	}
+
+	mesh.vertices.resize(corners.size());
+	mesh.indices.resize(corners.size());
+	for (size_t i = 0; i < corners.size(); ++i)
+	{
+		const Corner& corner = corners[i];
+		glm::vec3 normal = corner.normal >= 0 ? normals[corner.normal] : positionNormals[corner.position];
+		glm::vec2 texcoord = corner.texcoord >= 0 ? texcoords[corner.texcoord] : glm::vec2(0.0f);
+
+		setVertex(mesh.vertices[i], positions[corner.position], normalizeOr(normal, glm::vec3(0.0f, 0.0f, 1.0f)), texcoord);
+		mesh.indices[i] = static_cast<uint32_t>(i);
+	}
+
+	return mesh;
+}
+
+namespace {
+	constexpr uint32_t GlbMagic = 0x46546c67;		//"glTF"
+	constexpr uint32_t GlbChunkJson = 0x4e4f534a;	//"JSON"
+	constexpr uint32_t GlbChunkBin = 0x004e4942;	//"BIN\0"
+
+	constexpr uint32_t ComponentByte = 5120;
+	constexpr uint32_t ComponentUnsignedByte = 5121;
+	constexpr uint32_t ComponentShort = 5122;
+	constexpr uint32_t ComponentUnsignedShort = 5123;
+	constexpr uint32_t ComponentUnsignedInt = 5125;
+	constexpr uint32_t ComponentFloat = 5126;
+
+	constexpr uint32_t ModeTriangles = 4;
+
+	struct GltfDocument {
+		JsonValue json;
+		std::vector<std::vector<uint8_t>> buffers;
+	};
+
+	struct AccessorView {
+		const uint8_t* data = nullptr;
+		size_t count = 0;
+		size_t stride = 0;
+		uint32_t componentType = 0;
+		uint32_t components = 0;
+		bool normalized = false;
+	};
+
+	std::vector<uint8_t> decodeBase64(const std::string& _text)
+	{
+		auto value = [](char _c) -> int {
+			if (_c >= 'A' && _c <= 'Z') return _c - 'A';
+			if (_c >= 'a' && _c <= 'z') return _c - 'a' + 26;
+			if (_c >= '0' && _c <= '9') return _c - '0' + 52;
+			if (_c == '+') return 62;
+			if (_c == '/') return 63;
+			return -1;
+		};
+
+		std::vector<uint8_t> bytes;
+		bytes.reserve(_text.size() * 3 / 4);
+		uint32_t bits = 0;
+		int bitCount = 0;
+		for (char c : _text)
+		{
+			int v = value(c);
+			if (v < 0)
+			{
+				continue;	//padding and whitespace
+			}
+			bits = (bits << 6) | static_cast<uint32_t>(v);
+			bitCount += 6;
+			if (bitCount >= 8)
+			{
+				bitCount -= 8;
+				bytes.push_back(static_cast<uint8_t>(bits >> bitCount));
+			}
+		}
+		return bytes;
+	}
+
+	std::string decodeUri(const std::string& _uri)
+	{
+		std::string result;
+		for (size_t i = 0; i < _uri.size(); ++i)
+		{
+			if (_uri[i] == '%' && i + 2 < _uri.size())
+			{
+				result += static_cast<char>(std::stoi(_uri.substr(i + 1, 2), nullptr, 16));
+				i += 2;
+			} else {
+				result += _uri[i];
+			}
+		}
+		return result;
+	}
+
+	uint32_t readUint32(const uint8_t* _bytes)
+	{
+		uint32_t value;
+		std::memcpy(&value, _bytes, sizeof(value));
+		return value;
+	}
+
+	GltfDocument loadGltf(const std::filesystem::path& _path)
+	{
+		std::vector<uint8_t> bytes = readBinaryFile(_path);
+
+		GltfDocument document;
+		std::string jsonText;
+		std::vector<uint8_t> binChunk;
+		if (bytes.size() >= 12 && readUint32(bytes.data()) == GlbMagic)
+		{
+			if (readUint32(bytes.data() + 4) != 2)
+			{
+				throw std::runtime_error("[Import]: " + _path.string() + " isn't glTF 2.0!");
+			}
+
+			size_t offset = 12;
+			size_t end = std::min<size_t>(readUint32(bytes.data() + 8), bytes.size());
+			while (offset + 8 <= end)
+			{
+				uint32_t chunkLength = readUint32(bytes.data() + offset);
+				uint32_t chunkType = readUint32(bytes.data() + offset + 4);
+				offset += 8;
+				if (offset + chunkLength > end)
+				{
+					throw std::runtime_error("[Import]: " + _path.string() + " has a truncated chunk!");
+				}
+
+				if (chunkType == GlbChunkJson)
+				{
+					jsonText.assign(reinterpret_cast<const char*>(bytes.data() + offset), chunkLength);
+				}
+				else if (chunkType == GlbChunkBin && binChunk.empty())
+				{
+					binChunk.assign(bytes.begin() + offset, bytes.begin() + offset + chunkLength);
+				}
+				offset += (chunkLength + 3) & ~3u;
+			}
+		} else {
+			jsonText.assign(bytes.begin(), bytes.end());
+		}
+
+		document.json = parseJson(jsonText);
+
+		const JsonValue* buffers = document.json.find("buffers");
+		for (size_t i = 0; buffers && i < buffers->size(); ++i)
+		{
+			const JsonValue& buffer = (*buffers)[i];
+			std::string uri = buffer.getString("uri", "");
+
+			std::vector<uint8_t> data;
+			if (uri.empty())
+			{
+				//the GLB binary chunk, which only the first buffer can refer to
+				if (i != 0)
+				{
+					throw std::runtime_error("[Import]: Buffer " + std::to_string(i) + " has no uri!");
+				}
+				data = std::move(binChunk);
+			}
+			else if (uri.compare(0, 5, "data:") == 0)
+			{
+				size_t comma = uri.find(',');
+				if (comma == std::string::npos || uri.rfind(";base64", comma) == std::string::npos)
+				{
+					throw std::runtime_error("[Import]: Only base64 data uris are supported!");
+				}
+				data = decodeBase64(uri.substr(comma + 1));
+			} else {
+				data = readBinaryFile(_path.parent_path() / std::filesystem::u8path(decodeUri(uri)));
+			}
+
+			if (data.size() < static_cast<size_t>(buffer.getNumber("byteLength", 0.0)))
+			{
+				throw std::runtime_error("[Import]: Buffer " + std::to_string(i) + " is shorter than its byteLength!");
+			}
+			document.buffers.push_back(std::move(data));
+		}
+
+		return document;
+	}
+
+	const JsonValue& getElement(const GltfDocument& _document, const char* _array, size_t _index)
+	{
+		const JsonValue* array = _document.json.find(_array);
+		if (!array || _index >= array->size())
+		{
+			throw std::runtime_error(std::string("[Import]: Missing ") + _array + " " + std::to_string(_index));
+		}
+		return (*array)[_index];
+	}
+
+	AccessorView getAccessor(const GltfDocument& _document, size_t _index)
+	{
+		const JsonValue& accessor = getElement(_document, "accessors", _index);
+		if (accessor.find("sparse"))
+		{
+			throw std::runtime_error("[Import]: Sparse accessors aren't supported!");
+		}
+		if (!accessor.find("bufferView"))
+		{
+			throw std::runtime_error("[Import]: Accessors without a buffer view aren't supported!");
+		}
+
+		AccessorView view;
+		view.count = static_cast<size_t>(accessor.getNumber("count", 0.0));
+		view.componentType = static_cast<uint32_t>(accessor.getNumber("componentType", 0.0));
+		const JsonValue* normalized = accessor.find("normalized");
+		view.normalized = normalized && normalized->boolean;
+
+		std::string type = accessor.getString("type", "");
+		view.components = type == "SCALAR" ? 1 : type == "VEC2" ? 2 : type == "VEC3" ? 3 : type == "VEC4" ? 4 : 0;
+
+		size_t componentSize = 0;
+		switch (view.componentType)
+		{
+		case ComponentByte: case ComponentUnsignedByte: componentSize = 1; break;
+		case ComponentShort: case ComponentUnsignedShort: componentSize = 2; break;
+		case ComponentUnsignedInt: case ComponentFloat: componentSize = 4; break;
+		}
+		if (view.components == 0 || componentSize == 0)
+		{
+			throw std::runtime_error("[Import]: Accessor " + std::to_string(_index) + " has an unsupported type!");
+		}
+
+		const JsonValue& bufferView = getElement(_document, "bufferViews", static_cast<size_t>(accessor.getNumber("bufferView", 0.0)));
+		size_t bufferIndex = static_cast<size_t>(bufferView.getNumber("buffer", 0.0));
+		if (bufferIndex >= _document.buffers.size())
+		{
+			throw std::runtime_error("[Import]: Buffer view refers to a missing buffer!");
+		}
+		const std::vector<uint8_t>& buffer = _document.buffers[bufferIndex];
+
+		size_t elementSize = componentSize * view.components;
+		size_t offset = static_cast<size_t>(bufferView.getNumber("byteOffset", 0.0) + accessor.getNumber("byteOffset", 0.0));
+		view.stride = static_cast<size_t>(bufferView.getNumber("byteStride", static_cast<double>(elementSize)));
+		if (view.count > 0 && offset + view.stride * (view.count - 1) + elementSize > buffer.size())
+		{
+			throw std::runtime_error("[Import]: Accessor " + std::to_string(_index) + " reads past its buffer!");
+		}
+		view.data = buffer.data() + offset;
+		return view;
+	}
+
+	float readComponent(const AccessorView& _view, size_t _element, uint32_t _component)
+	{
+		const uint8_t* bytes = _view.data + _element * _view.stride;
+		switch (_view.componentType)
+		{
+		case ComponentFloat: {
+			float value;
+			std::memcpy(&value, bytes + _component * 4, 4);
+			return value;
+		}
+		case ComponentUnsignedByte: {
+			float value = bytes[_component];
+			return _view.normalized ? value / 255.0f : value;
+		}
+		case ComponentByte: {
+			float value = static_cast<int8_t>(bytes[_component]);
+			return _view.normalized ? std::max(value / 127.0f, -1.0f) : value;
+		}
+		case ComponentUnsignedShort: {
+			uint16_t value;
+			std::memcpy(&value, bytes + _component * 2, 2);
+			return _view.normalized ? value / 65535.0f : static_cast<float>(value);
+		}
+		case ComponentShort: {
+			int16_t value;
+			std::memcpy(&value, bytes + _component * 2, 2);
+			return _view.normalized ? std::max(value / 32767.0f, -1.0f) : static_cast<float>(value);
+		}
+		default: {
+			uint32_t value;
+			std::memcpy(&value, bytes + _component * 4, 4);
+			return static_cast<float>(value);
+		}
+		}
+	}
+
+	uint32_t readIndex(const AccessorView& _view, size_t _element)
+	{
+		const uint8_t* bytes = _view.data + _element * _view.stride;
+		switch (_view.componentType)
+		{
+		case ComponentUnsignedByte:
+			return bytes[0];
+		case ComponentUnsignedShort: {
+			uint16_t value;
+			std::memcpy(&value, bytes, 2);
+			return value;
+		}
+		case ComponentUnsignedInt: {
+			uint32_t value;
+			std::memcpy(&value, bytes, 4);
+			return value;
+		}
+		default:
+			throw std::runtime_error("[Import]: Indices have to be unsigned integers!");
+		}
+	}
+
+	glm::mat4 getNodeMatrix(const JsonValue& _node)
+	{
+		const JsonValue* matrix = _node.find("matrix");
+		if (matrix && matrix->size() == 16)
+		{
+			float values[16];
+			for (size_t i = 0; i < 16; ++i)
+			{
+				values[i] = static_cast<float>((*matrix)[i].number);
+			}
+			return glm::make_mat4(values);	//column major, like glTF
+		}
+
+		glm::vec3 translation(0.0f);
+		glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+		glm::vec3 scale(1.0f);
+		if (const JsonValue* t = _node.find("translation"))
+		{
+			translation = glm::vec3((*t)[0].number, (*t)[1].number, (*t)[2].number);
+		}
+		if (const JsonValue* r = _node.find("rotation"))
+		{
+			//glTF stores xyzw, glm takes w first
+			rotation = glm::quat(static_cast<float>((*r)[3].number), static_cast<float>((*r)[0].number),
+				static_cast<float>((*r)[1].number), static_cast<float>((*r)[2].number));
+		}
+		if (const JsonValue* s = _node.find("scale"))
+		{
+			scale = glm::vec3((*s)[0].number, (*s)[1].number, (*s)[2].number);
+		}
+
+		glm::mat4 result = glm::mat4_cast(rotation);
+		result[0] *= scale.x;
+		result[1] *= scale.y;
+		result[2] *= scale.z;
+		result[3] = glm::vec4(translation, 1.0f);
+		return result;
+	}
+
+	void collectMeshInstances(const GltfDocument& _document, size_t _node, const glm::mat4& _parent, size_t _depth,
+		std::vector<std::pair<size_t, glm::mat4>>& _instances)
+	{
+		const JsonValue& node = getElement(_document, "nodes", _node);
+		if (_depth > _document.json.find("nodes")->size())
+		{
+			throw std::runtime_error("[Import]: The node hierarchy has a cycle!");
+		}
+
+		glm::mat4 world = _parent * getNodeMatrix(node);
+		if (const JsonValue* mesh = node.find("mesh"))
+		{
+			_instances.emplace_back(static_cast<size_t>(mesh->number), world);
+		}
+		if (const JsonValue* children = node.find("children"))
+		{
+			for (size_t i = 0; i < children->size(); ++i)
+			{
+				collectMeshInstances(_document, static_cast<size_t>((*children)[i].number), world, _depth + 1, _instances);
+			}
+		}
+	}
+}
+
+ImportedMesh importGltf(const std::filesystem::path& _path)
+{
+	GltfDocument document = loadGltf(_path);
+
+	//meshes as placed by the default scene, or every mesh as is when the file has no scene
+	std::vector<std::pair<size_t, glm::mat4>> instances;
+	const JsonValue* scenes = document.json.find("scenes");
+	if (scenes && scenes->size() > 0 && document.json.find("nodes"))
+	{
+		const JsonValue& scene = getElement(document, "scenes", static_cast<size_t>(document.json.getNumber("scene", 0.0)));
+		const JsonValue* roots = scene.find("nodes");
+		for (size_t i = 0; roots && i < roots->size(); ++i)
+		{
+			collectMeshInstances(document, static_cast<size_t>((*roots)[i].number), glm::mat4(1.0f), 0, instances);
+		}
+	} else {
+		const JsonValue* meshes = document.json.find("meshes");
+		for (size_t i = 0; meshes && i < meshes->size(); ++i)
+		{
+			instances.emplace_back(i, glm::mat4(1.0f));
+		}
+	}
+
+	ImportedMesh result;
+	size_t skippedPrimitives = 0;
+	for (const auto& [meshIndex, world] : instances)
+	{
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(world)));
+		bool mirrored = glm::determinant(glm::mat3(world)) < 0.0f;
+
+		const JsonValue* primitives = getElement(document, "meshes", meshIndex).find("primitives");
+		for (size_t p = 0; primitives && p < primitives->size(); ++p)
+		{
+			const JsonValue& primitive = (*primitives)[p];
+			const JsonValue* attributes = primitive.find("attributes");
+			if (primitive.getNumber("mode", ModeTriangles) != ModeTriangles || !attributes || !attributes->find("POSITION"))
+			{
+				skippedPrimitives++;
+				continue;
+			}
+
+			AccessorView positions = getAccessor(document, static_cast<size_t>(attributes->getNumber("POSITION", 0.0)));
+			const JsonValue* normalAttribute = attributes->find("NORMAL");
+			const JsonValue* texcoordAttribute = attributes->find("TEXCOORD_0");
+			AccessorView normals = normalAttribute ? getAccessor(document, static_cast<size_t>(normalAttribute->number)) : AccessorView{};
+			AccessorView texcoords = texcoordAttribute ? getAccessor(document, static_cast<size_t>(texcoordAttribute->number)) : AccessorView{};
+
+			size_t firstVertex = result.vertices.size();
+			size_t firstIndex = result.indices.size();
+			result.vertices.resize(firstVertex + positions.count);
+			for (size_t i = 0; i < positions.count; ++i)
+			{
+				glm::vec3 position(readComponent(positions, i, 0), readComponent(positions, i, 1), readComponent(positions, i, 2));
+				glm::vec3 normal(0.0f);
+				if (normalAttribute && i < normals.count)
+				{
+					normal = glm::vec3(readComponent(normals, i, 0), readComponent(normals, i, 1), readComponent(normals, i, 2));
+					normal = normalizeOr(normalMatrix * normal, glm::vec3(0.0f, 0.0f, 1.0f));
+				}
+				glm::vec2 texcoord(0.0f);
+				if (texcoordAttribute && i < texcoords.count)
+				{
+					texcoord = glm::vec2(readComponent(texcoords, i, 0), readComponent(texcoords, i, 1));
+				}
+
+				setVertex(result.vertices[firstVertex + i], glm::vec3(world * glm::vec4(position, 1.0f)), normal, texcoord);
+			}
+
+			if (const JsonValue* indexAccessor = primitive.find("indices"))
+			{
+				AccessorView indices = getAccessor(document, static_cast<size_t>(indexAccessor->number));
+				for (size_t i = 0; i + 2 < indices.count; i += 3)
+				{
+					for (int corner = 0; corner < 3; ++corner)
+					{
+						uint32_t index = readIndex(indices, i + corner);
+						if (index >= positions.count)
+						{
+							throw std::runtime_error("[Import]: Index past the end of its primitive's vertices!");
+						}
+						result.indices.push_back(static_cast<uint32_t>(firstVertex) + index);
+					}
+				}
+			} else {
+				for (size_t i = 0; i + 2 < positions.count; i += 3)
+				{
+					for (int corner = 0; corner < 3; ++corner)
+					{
+						result.indices.push_back(static_cast<uint32_t>(firstVertex + i + corner));
+					}
+				}
+			}
+
+			//a mirroring transform flips the winding, turn it back so front faces stay front faces
+			if (mirrored)
+			{
+				for (size_t i = firstIndex; i < result.indices.size(); i += 3)
+				{
+					std::swap(result.indices[i + 1], result.indices[i + 2]);
+				}
+			}
+
+			if (!normalAttribute)
+			{
+				result.generatedNormals = true;
+
+				std::vector<glm::vec3> accumulated(positions.count, glm::vec3(0.0f));
+				for (size_t i = firstIndex; i < result.indices.size(); i += 3)
+				{
+					const float* p0 = result.vertices[result.indices[i]].position;
+					const float* p1 = result.vertices[result.indices[i + 1]].position;
+					const float* p2 = result.vertices[result.indices[i + 2]].position;
+					glm::vec3 faceNormal = glm::cross(glm::make_vec3(p1) - glm::make_vec3(p0), glm::make_vec3(p2) - glm::make_vec3(p0));
+					for (int corner = 0; corner < 3; ++corner)
+					{
+						accumulated[result.indices[i + corner] - firstVertex] += faceNormal;
+					}
+				}
+				for (size_t i = 0; i < positions.count; ++i)
+				{
+					glm::vec3 normal = normalizeOr(accumulated[i], glm::vec3(0.0f, 0.0f, 1.0f));
+					std::memcpy(result.vertices[firstVertex + i].normal, glm::value_ptr(normal), sizeof(MeshVertex::normal));
+				}
+			}
+		}
+	}
+
+	if (skippedPrimitives > 0)
+	{
+		std::cout << "[Import]: Skipped " << skippedPrimitives << " primitives that aren't triangle lists\n";
+	}
+	return result;
+}
+
+ImportedMesh importMesh(const std::filesystem::path& _path)
+{
+	std::string extension = _path.extension().string();
+	std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char _c) { return static_cast<char>(std::tolower(_c)); });
+
+	if (extension == ".obj")
+	{
+		return importObj(_path);
+	}
+	if (extension == ".gltf" || extension == ".glb")
+	{
+		return importGltf(_path);
+	}
+	throw std::runtime_error("[Import]: Don't know how to import " + _path.string() + ", expected .obj, .gltf or .glb");
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <vector>
+
+#include <MeshFormat.hpp>
+
+//Triangle list as it comes out of the source file, before any optimization.
+struct ImportedMesh {
+	std::vector<MeshVertex> vertices;
+	std::vector<uint32_t> indices;
+	bool generatedNormals = false;		//the source had none, they were averaged from the faces
+};
+
+//Wavefront OBJ. Polygons are fanned into triangles and every face corner becomes its own vertex, like the format stores it.
+ImportedMesh importObj(const std::filesystem::path& _path);
+
+//glTF 2.0, .gltf with external or embedded buffers and .glb. Every triangle primitive of the default scene is merged
+//into one mesh with its node transforms applied. Sparse accessors and compression extensions aren't supported.
+ImportedMesh importGltf(const std::filesystem::path& _path);
+
+//Picks the importer by extension.
+ImportedMesh importMesh(const std::filesystem::path& _path);
@@ -0,0 +1,158 @@
+#include <CaptureReplay.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+struct ReplayOptions {
+	std::filesystem::path capture;
+	std::filesystem::path shaderDir = "res/shaders";	//where the application's build puts the compiled shaders
+	uint32_t iterations = 100;
+	uint32_t warmup = 10;		//iterations run before timing, while drivers settle
+	std::string deviceName;		//part of the device name to replay on, empty prefers a discrete GPU
+};
+
+static void printUsage()
+{
+	std::cout << "Usage: renderer_replay <capture.vkcap> [options]\n"
+		<< "  --iterations <n>  timed replays of the captured frame (default 100)\n"
+		<< "  --warmup <n>      untimed replays before them (default 10)\n"
+		<< "  --shaders <dir>   compiled shaders the pipelines are rebuilt from (default res/shaders)\n"
+		<< "  --device <name>   replay on the device whose name contains <name>, e.g. llvmpipe\n";
+}
+
+static ReplayOptions parseArguments(int argc, char** argv)
+{
+	ReplayOptions options;
+	std::vector<std::string> positional;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		auto nextValue = [&]() -> std::string
+		{
+			if (i + 1 >= argc)
+			{
+				throw std::invalid_argument(std::string("[Replay]: Missing value for ") + argv[i]);
+			}
+			return argv[++i];
+		};
+
+		if (strcmp(argv[i], "--iterations") == 0)
+		{
+			options.iterations = std::max(static_cast<uint32_t>(std::stoul(nextValue())), 1u);
+		}
+		else if (strcmp(argv[i], "--warmup") == 0)
+		{
+			options.warmup = static_cast<uint32_t>(std::stoul(nextValue()));
+		}
+		else if (strcmp(argv[i], "--shaders") == 0)
+		{
+			options.shaderDir = nextValue();
+		}
+		else if (strcmp(argv[i], "--device") == 0)
+		{
+			options.deviceName = nextValue();
+		}
+		else if (strncmp(argv[i], "--", 2) == 0)
+		{
+			throw std::invalid_argument(std::string("[Replay]: Unknown argument ") + argv[i]);
+		}
+		else {
+			positional.push_back(argv[i]);
+		}
+	}
+
+	if (positional.size() != 1)
+	{
+		printUsage();
+		throw std::invalid_argument("[Replay]: Expected a capture file!");
+	}
+	options.capture = positional[0];
+	return options;
+}
+
+struct Timings {
+	std::vector<double> samples;
+
+	void add(double _seconds)
+	{
+		samples.push_back(_seconds);
+	}
+
+	void print(const char* _name) const
+	{
+		if (samples.empty())
+		{
+			std::cout << "[Replay]: " << _name << ": not measured\n";
+			return;
+		}
+		std::vector<double> sorted = samples;
+		std::sort(sorted.begin(), sorted.end());
+		double total = 0.0;
+		for (double sample : sorted)
+		{
+			total += sample;
+		}
+		std::cout << "[Replay]: " << _name << ": avg " << total / sorted.size() * 1e3 << " ms, median "
+			<< sorted[sorted.size() / 2] * 1e3 << " ms, min " << sorted.front() * 1e3 << " ms, max " << sorted.back() * 1e3
+			<< " ms\n";
+	}
+};
+
+//renderer_replay <capture.vkcap> [--iterations N] [--warmup N] [--shaders dir] [--device name]
+int main(int argc, char** argv)
+{
+	CaptureReplayer replayer;
+	try {
+		ReplayOptions options = parseArguments(argc, argv);
+
+		CaptureFile capture;
+		capture.open(options.capture);
+		const CaptureHeader& header = capture.getHeader();
+		std::cout << "[Replay]: " << options.capture.string() << ": " << header.commandCount << " commands, "
+			<< header.pipelineCount << " pipelines, " << header.dataSize / 1024.0 << " KiB of data\n";
+
+		replayer.init({ options.shaderDir, options.deviceName });
+		std::cout << "[Replay]: Replaying on " << replayer.getDeviceName() << "\n";
+		ReplayLoadStats load = replayer.load(capture);
+		std::cout << "[Replay]: Uploaded " << load.uploadBytes / 1024.0 << " KiB into " << load.bufferCount << " buffers in "
+			<< load.uploadTime * 1e3 << " ms (" << load.uploadBytes / std::max(load.uploadTime, 1e-9) / (1024.0 * 1024.0)
+			<< " MiB/s), created " << load.pipelineCount << " pipelines in " << load.pipelineTime * 1e3 << " ms\n";
+
+		Timings recordTimes;
+		Timings frameTimes;
+		Timings gpuTimes;
+		for (uint32_t i = 0; i < options.warmup + options.iterations; ++i)
+		{
+			ReplayTiming timing = replayer.replay();
+			if (i < options.warmup)
+			{
+				continue;
+			}
+			recordTimes.add(timing.recordTime);
+			frameTimes.add(timing.frameTime);
+			if (timing.gpuTimed)
+			{
+				gpuTimes.add(timing.gpuTime);
+			}
+		}
+
+		std::cout << "[Replay]: Frame " << header.frame << " at " << header.width << "x" << header.height << ", "
+			<< replayer.getDrawCount() << " draws, " << options.iterations << " iterations after " << options.warmup
+			<< " warmup\n";
+		recordTimes.print("CPU record");
+		frameTimes.print("CPU record to fence");
+		gpuTimes.print("GPU");
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		replayer.destroy();
+		return EXIT_FAILURE;
+	}
+
+	replayer.destroy();
+	return EXIT_SUCCESS;
+}